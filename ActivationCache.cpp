@@ -0,0 +1,120 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include "ActivationCache.h"
+
+using namespace ABI::Windows::Devices::Enumeration;
+using namespace ABI::Windows::Devices::WiFiDirect;
+using namespace Microsoft::WRL;
+using namespace Microsoft::WRL::Wrappers;
+
+ActivationCache::ActivationCache()
+{
+	ZeroMemory(&_counters, sizeof(_counters));
+}
+
+template <typename TStatics>
+HRESULT ActivationCache::GetStatics(const wchar_t* runtimeClass, ComPtr<TStatics>& cached, ComPtr<TStatics>& statics)
+{
+	std::lock_guard<std::mutex> lock(_lock);
+
+	if (cached)
+	{
+		_counters.factoriesReused++;
+		statics = cached;
+		return S_OK;
+	}
+
+	HRESULT hr = Windows::Foundation::GetActivationFactory(HStringReference(runtimeClass).Get(), &cached);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	_counters.factoriesResolved++;
+	statics = cached;
+	return S_OK;
+}
+
+HRESULT ActivationCache::GetWiFiDirectDeviceStatics(ComPtr<IWiFiDirectDeviceStatics2>& statics)
+{
+	return GetStatics(RuntimeClass_Windows_Devices_WiFiDirect_WiFiDirectDevice, _wfdStatics, statics);
+}
+
+HRESULT ActivationCache::GetDeviceInformationStatics(ComPtr<IDeviceInformationStatics>& statics)
+{
+	return GetStatics(RuntimeClass_Windows_Devices_Enumeration_DeviceInformation, _deviceInfoStatics, statics);
+}
+
+HRESULT ActivationCache::GetConnectionParameters(INT16 groupOwnerIntent, WiFiDirectPairingProcedure pairingProcedure, ComPtr<IWiFiDirectConnectionParameters>& parameters)
+{
+	std::lock_guard<std::mutex> lock(_lock);
+
+	for (auto& entry : _parameters)
+	{
+		if (entry.groupOwnerIntent == groupOwnerIntent && entry.pairingProcedure == pairingProcedure)
+		{
+			_counters.parametersReused++;
+			parameters = entry.parameters;
+			return S_OK;
+		}
+	}
+
+	ParametersEntry entry;
+	entry.groupOwnerIntent = groupOwnerIntent;
+	entry.pairingProcedure = pairingProcedure;
+
+	HRESULT hr = Windows::Foundation::ActivateInstance(HStringReference(RuntimeClass_Windows_Devices_WiFiDirect_WiFiDirectConnectionParameters).Get(), &entry.parameters);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	hr = entry.parameters->put_GroupOwnerIntent(groupOwnerIntent);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	ComPtr<IWiFiDirectConnectionParameters2> parameters2;
+	hr = entry.parameters.As(&parameters2);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	hr = parameters2->put_PreferredPairingProcedure(pairingProcedure);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	_counters.parametersActivated++;
+	_parameters.push_back(entry);
+	parameters = entry.parameters;
+	return S_OK;
+}
+
+ActivationCounters ActivationCache::GetCounters() const
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	return _counters;
+}
+
+void ActivationCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(_lock);
+
+	_wfdStatics.Reset();
+	_deviceInfoStatics.Reset();
+	_parameters.clear();
+}
@@ -0,0 +1,65 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+/// How often the cache had to go to WinRT and how often it answered from what it already had
+struct ActivationCounters
+{
+	uint64_t factoriesResolved;
+	uint64_t factoriesReused;
+	uint64_t parametersActivated;
+	uint64_t parametersReused;
+};
+
+/// Activation factories and connection parameter objects the helper needs on every connect, pair
+/// and scan. Factories are resolved once; parameter objects are built once per configuration and
+/// never modified afterwards, so the same object can back any number of concurrent operations.
+/// Thread-safe.
+class ActivationCache
+{
+public:
+	ActivationCache();
+
+	HRESULT GetWiFiDirectDeviceStatics(Microsoft::WRL::ComPtr<ABI::Windows::Devices::WiFiDirect::IWiFiDirectDeviceStatics2>& statics);
+	HRESULT GetDeviceInformationStatics(Microsoft::WRL::ComPtr<ABI::Windows::Devices::Enumeration::IDeviceInformationStatics>& statics);
+
+	/// Shared parameters for a group owner intent and preferred pairing procedure; do not modify them
+	HRESULT GetConnectionParameters(INT16 groupOwnerIntent,
+		ABI::Windows::Devices::WiFiDirect::WiFiDirectPairingProcedure pairingProcedure,
+		Microsoft::WRL::ComPtr<ABI::Windows::Devices::WiFiDirect::IWiFiDirectConnectionParameters>& parameters);
+
+	ActivationCounters GetCounters() const;
+
+	/// Drop everything, e.g. to measure the uncached path
+	void Clear();
+
+private:
+	struct ParametersEntry
+	{
+		INT16 groupOwnerIntent;
+		ABI::Windows::Devices::WiFiDirect::WiFiDirectPairingProcedure pairingProcedure;
+		Microsoft::WRL::ComPtr<ABI::Windows::Devices::WiFiDirect::IWiFiDirectConnectionParameters> parameters;
+	};
+
+	template <typename TStatics>
+	HRESULT GetStatics(const wchar_t* runtimeClass, Microsoft::WRL::ComPtr<TStatics>& cached, Microsoft::WRL::ComPtr<TStatics>& statics);
+
+	mutable std::mutex _lock;
+
+	Microsoft::WRL::ComPtr<ABI::Windows::Devices::WiFiDirect::IWiFiDirectDeviceStatics2> _wfdStatics;
+	Microsoft::WRL::ComPtr<ABI::Windows::Devices::Enumeration::IDeviceInformationStatics> _deviceInfoStatics;
+
+	/// Few configurations are ever used, a linear search beats a map
+	std::vector<ParametersEntry> _parameters;
+
+	ActivationCounters _counters;
+};
@@ -0,0 +1,106 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include "AdmissionBenchmark.h"
+
+ConnectionStormResult SimulateConnectionStorm(unsigned int requests, bool controlled)
+{
+	typedef AdmissionController<unsigned int>::Clock Clock;
+
+	struct Pairing
+	{
+		Clock::time_point started;
+		Clock::time_point done;
+		bool fails;
+	};
+
+	const auto step = std::chrono::milliseconds(10);
+	const auto arrivalWindow = std::chrono::milliseconds(2000);
+
+	AdmissionController<unsigned int> admission;
+	std::vector<unsigned int> evicted;
+	ConnectionStormResult result = {};
+	std::vector<Pairing> active;
+	std::mt19937 random(42);
+
+	// Any non-zero epoch, a default time point means "never refilled" to the controller
+	Clock::time_point start = Clock::time_point() + std::chrono::hours(1);
+	Clock::time_point now = start;
+	unsigned int arrived = 0;
+
+	auto begin = [&]()
+	{
+		uint32_t concurrent = static_cast<uint32_t>(active.size()) + 1;
+
+		Pairing pairing;
+		pairing.started = now;
+		pairing.done = now + std::chrono::milliseconds(800) * (2 + concurrent) / 3;
+		pairing.fails = (concurrent > 6);
+		active.push_back(pairing);
+
+		if (concurrent > result.maxInFlight)
+		{
+			result.maxInFlight = concurrent;
+		}
+	};
+
+	while (arrived < requests || !active.empty() || admission.HasQueued())
+	{
+		for (auto it = active.begin(); it != active.end();)
+		{
+			if (it->done > now)
+			{
+				++it;
+				continue;
+			}
+
+			if (it->fails)
+			{
+				result.failed++;
+			}
+			else
+			{
+				result.succeeded++;
+			}
+
+			if (controlled)
+			{
+				admission.OnCompleted(it->done - it->started);
+			}
+			it = active.erase(it);
+		}
+
+		// Requests arrive evenly over the window, one in five from a known peer
+		while (arrived < requests && start + arrivalWindow * arrived / requests <= now)
+		{
+			if (!controlled || admission.Offer(arrived, random() % 5 == 0, now, evicted) == AdmissionOutcome::Admitted)
+			{
+				begin();
+			}
+			arrived++;
+		}
+
+		if (controlled)
+		{
+			for (size_t i = admission.TakeAdmitted(now).size(); i > 0; i--)
+			{
+				begin();
+			}
+		}
+
+		now += step;
+	}
+
+	result.counters = admission.GetCounters();
+	result.drained = std::chrono::duration_cast<std::chrono::milliseconds>(now - start);
+	return result;
+}
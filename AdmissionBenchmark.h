@@ -0,0 +1,31 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "AdmissionController.h"
+
+#include <chrono>
+#include <cstdint>
+
+/// How a connection storm went, with or without admission control
+struct ConnectionStormResult
+{
+	uint32_t succeeded;
+	uint32_t failed;
+	uint32_t maxInFlight;
+	AdmissionCounters counters;
+	std::chrono::milliseconds drained;
+};
+
+/// A burst of connection requests against a simulated listener whose pairings slow down with
+/// every concurrent one and fail outright beyond six; runs on a simulated clock
+ConnectionStormResult SimulateConnectionStorm(unsigned int requests, bool controlled);
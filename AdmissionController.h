@@ -0,0 +1,319 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <vector>
+
+/// Limits on how fast and how many incoming connections are let through
+struct AdmissionSettings
+{
+	AdmissionSettings()
+		: ratePerSecond(4.0),
+		  burst(8),
+		  maxInFlight(4),
+		  maxQueued(32),
+		  maxQueueDelay(15000),
+		  latencyTarget(5000)
+	{}
+
+	/// Token bucket: sustained admissions per second and how many may go at once after a lull
+	double ratePerSecond;
+	uint32_t burst;
+	/// Admitted requests still pairing
+	uint32_t maxInFlight;
+	/// Requests waiting for a slot; beyond this unknown peers are rejected
+	size_t maxQueued;
+	/// Waiting longer than this rejects a request, the peer has likely given up
+	std::chrono::milliseconds maxQueueDelay;
+	/// Completions slower than this shrink the in-flight limit until they speed up again
+	std::chrono::milliseconds latencyTarget;
+};
+
+enum class AdmissionOutcome
+{
+	/// Start it now, a slot was taken
+	Admitted,
+	/// Queued, comes back from TakeAdmitted
+	Deferred,
+	Rejected
+};
+
+struct AdmissionCounters
+{
+	AdmissionCounters()
+		: admitted(0),
+		  deferred(0),
+		  rejected(0),
+		  expired(0),
+		  evicted(0)
+	{}
+
+	/// Admitted on arrival or later from the queue
+	uint64_t admitted;
+	uint64_t deferred;
+	uint64_t rejected;
+	/// Deferred requests that waited too long, also counted in rejected
+	uint64_t expired;
+	/// Deferred requests from unknown peers that made way for a known one, also counted in rejected
+	uint64_t evicted;
+};
+
+/// Admission control in front of the connection listener: a token bucket bounds the admission
+/// rate, a slot count bounds pairings in flight, and requests that cannot start yet wait in a
+/// queue where known peers go ahead of unknown ones. Backpressure comes from the queue depth
+/// (full means reject) and from completion latency (slow completions lower the in-flight
+/// limit). Takes the current time as a parameter; not thread-safe, callers serialize access.
+template <typename TRequest>
+class AdmissionController
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	AdmissionController()
+		: _tokens(0),
+		  _inFlight(0),
+		  _averageLatency(0),
+		  _primed(false)
+	{}
+
+	void Configure(const AdmissionSettings& settings)
+	{
+		_settings = settings;
+		if (_tokens > _settings.burst)
+		{
+			_tokens = _settings.burst;
+		}
+	}
+
+	const AdmissionSettings& GetSettings() const
+	{
+		return _settings;
+	}
+
+	/// Admit, queue or reject request. A known peer arriving at a full queue takes the place of the
+	/// newest unknown one, which is appended to evicted for the caller to turn away.
+	AdmissionOutcome Offer(const TRequest& request, bool known, Clock::time_point now, std::vector<TRequest>& evicted)
+	{
+		Refill(now);
+
+		// Queued requests are older, they go first
+		if (_queue.empty() && TryTake())
+		{
+			_counters.admitted++;
+			return AdmissionOutcome::Admitted;
+		}
+
+		if (_queue.size() >= _settings.maxQueued)
+		{
+			// A known peer takes the place of the newest unknown one
+			if (!known || !EvictNewestUnknown(evicted))
+			{
+				_counters.rejected++;
+				return AdmissionOutcome::Rejected;
+			}
+		}
+
+		Waiting waiting;
+		waiting.request = request;
+		waiting.known = known;
+		waiting.queued = now;
+
+		if (known)
+		{
+			// Behind other known peers, ahead of every unknown one
+			auto it = _queue.begin();
+			while (it != _queue.end() && it->known)
+			{
+				++it;
+			}
+			_queue.insert(it, waiting);
+		}
+		else
+		{
+			_queue.push_back(waiting);
+		}
+
+		_counters.deferred++;
+		return AdmissionOutcome::Deferred;
+	}
+
+	/// An admitted request finished, successfully or not
+	void OnCompleted(Clock::duration latency)
+	{
+		if (_inFlight > 0)
+		{
+			_inFlight--;
+		}
+
+		// Exponentially weighted, recent completions count most
+		if (!_primed)
+		{
+			_averageLatency = latency;
+			_primed = true;
+		}
+		else
+		{
+			_averageLatency = _averageLatency - _averageLatency / 4 + latency / 4;
+		}
+	}
+
+	/// Queued requests that may start now, each with a slot taken; expired ones are dropped
+	std::vector<TRequest> TakeAdmitted(Clock::time_point now)
+	{
+		Refill(now);
+
+		std::vector<TRequest> admitted;
+		for (auto it = _queue.begin(); it != _queue.end();)
+		{
+			if (now - it->queued > _settings.maxQueueDelay)
+			{
+				_counters.rejected++;
+				_counters.expired++;
+				it = _queue.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+
+		while (!_queue.empty() && TryTake())
+		{
+			admitted.push_back(_queue.front().request);
+			_queue.pop_front();
+			_counters.admitted++;
+		}
+
+		return admitted;
+	}
+
+	/// Drop every queued request, counting it as rejected; returns them for the caller to turn away
+	std::vector<TRequest> Clear()
+	{
+		std::vector<TRequest> cleared;
+		for (auto& waiting : _queue)
+		{
+			cleared.push_back(waiting.request);
+		}
+		_counters.rejected += _queue.size();
+		_queue.clear();
+		return cleared;
+	}
+
+	bool HasQueued() const
+	{
+		return !_queue.empty();
+	}
+
+	size_t GetQueueDepth() const
+	{
+		return _queue.size();
+	}
+
+	uint32_t GetInFlight() const
+	{
+		return _inFlight;
+	}
+
+	/// In-flight limit after latency backpressure
+	uint32_t GetEffectiveInFlightLimit() const
+	{
+		if (!_primed || _averageLatency <= _settings.latencyTarget || _settings.maxInFlight == 0)
+		{
+			return _settings.maxInFlight;
+		}
+
+		// Scale down in proportion to how far over target completions are, keep at least one
+		double scale = std::chrono::duration<double>(_settings.latencyTarget).count() / std::chrono::duration<double>(_averageLatency).count();
+		uint32_t limit = static_cast<uint32_t>(_settings.maxInFlight * scale);
+		return (limit < 1) ? 1 : limit;
+	}
+
+	std::chrono::milliseconds GetAverageLatency() const
+	{
+		return std::chrono::duration_cast<std::chrono::milliseconds>(_averageLatency);
+	}
+
+	AdmissionCounters GetCounters() const
+	{
+		return _counters;
+	}
+
+private:
+	struct Waiting
+	{
+		TRequest request;
+		bool known;
+		Clock::time_point queued;
+	};
+
+	void Refill(Clock::time_point now)
+	{
+		if (_lastRefill == Clock::time_point())
+		{
+			// Start with a full bucket
+			_tokens = _settings.burst;
+			_lastRefill = now;
+			return;
+		}
+
+		double elapsed = std::chrono::duration<double>(now - _lastRefill).count();
+		_lastRefill = now;
+
+		_tokens += elapsed * _settings.ratePerSecond;
+		if (_tokens > _settings.burst)
+		{
+			_tokens = _settings.burst;
+		}
+	}
+
+	bool TryTake()
+	{
+		if (_tokens < 1.0 || _inFlight >= GetEffectiveInFlightLimit())
+		{
+			return false;
+		}
+
+		_tokens -= 1.0;
+		_inFlight++;
+		return true;
+	}
+
+	bool EvictNewestUnknown(std::vector<TRequest>& evicted)
+	{
+		for (auto it = _queue.rbegin(); it != _queue.rend(); ++it)
+		{
+			if (!it->known)
+			{
+				evicted.push_back(it->request);
+				_queue.erase(std::next(it).base());
+				_counters.rejected++;
+				_counters.evicted++;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	AdmissionSettings _settings;
+	std::deque<Waiting> _queue;
+	Clock::time_point _lastRefill;
+	double _tokens;
+	uint32_t _inFlight;
+	Clock::duration _averageLatency;
+	bool _primed;
+	AdmissionCounters _counters;
+};
@@ -0,0 +1,245 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <coroutine>
+#include <exception>
+
+#include "FramePool.h"
+
+/// How an awaited operation ended
+struct AsyncCompletion
+{
+	AsyncCompletion()
+		: status(ABI::Windows::Foundation::AsyncStatus::Started),
+		  error(S_OK)
+	{}
+
+	ABI::Windows::Foundation::AsyncStatus status;
+	/// S_OK if Completed, E_ABORT if Canceled, the operation's error code if Error, or why the
+	/// completion handler could not be registered
+	HRESULT error;
+};
+
+inline const wchar_t* GetAsyncStatusName(ABI::Windows::Foundation::AsyncStatus status)
+{
+	switch (status)
+	{
+	case ABI::Windows::Foundation::AsyncStatus::Started:
+		return L"Started";
+	case ABI::Windows::Foundation::AsyncStatus::Completed:
+		return L"Completed";
+	case ABI::Windows::Foundation::AsyncStatus::Canceled:
+		return L"Canceled";
+	case ABI::Windows::Foundation::AsyncStatus::Error:
+		return L"Error";
+	}
+	return L"Unknown";
+}
+
+/// Return type of a coroutine nobody waits for, e.g. the rest of a connect once FromIdAsync has
+/// been issued. It runs until its first co_await on the caller's thread and then on whichever
+/// thread completes what it awaits. Frames come from FramePool. Exceptions must not leave the
+/// coroutine: there is no one to rethrow them to.
+struct AsyncTask
+{
+	struct promise_type
+	{
+		AsyncTask get_return_object()
+		{
+			return AsyncTask();
+		}
+
+		std::suspend_never initial_suspend() noexcept
+		{
+			return std::suspend_never();
+		}
+
+		std::suspend_never final_suspend() noexcept
+		{
+			return std::suspend_never();
+		}
+
+		void return_void()
+		{}
+
+		void unhandled_exception()
+		{
+			std::terminate();
+		}
+
+		static void* operator new(size_t size)
+		{
+			return FramePool::Get().Allocate(size);
+		}
+
+		static void operator delete(void* frame, size_t size)
+		{
+			FramePool::Get().Release(frame, size);
+		}
+	};
+};
+
+template <typename TResult>
+class OperationAwaiter;
+
+/// Completion handler that resumes the coroutine awaiting an operation. Written out rather than
+/// made with Callback so it can come from FramePool like the frame it resumes.
+template <typename TResult>
+class OperationResumer final : public ABI::Windows::Foundation::IAsyncOperationCompletedHandler<TResult>
+{
+public:
+	explicit OperationResumer(OperationAwaiter<TResult>* awaiter)
+		: _refCount(1),
+		  _awaiter(awaiter)
+	{}
+
+	static void* operator new(size_t size)
+	{
+		return FramePool::Get().Allocate(size);
+	}
+
+	static void operator delete(void* block, size_t size)
+	{
+		FramePool::Get().Release(block, size);
+	}
+
+	virtual HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override
+	{
+		if (object == nullptr)
+		{
+			return E_POINTER;
+		}
+
+		if (riid == __uuidof(IUnknown) ||
+			riid == __uuidof(ABI::Windows::Foundation::IAsyncOperationCompletedHandler<TResult>) ||
+			riid == __uuidof(IAgileObject))
+		{
+			*object = static_cast<ABI::Windows::Foundation::IAsyncOperationCompletedHandler<TResult>*>(this);
+			AddRef();
+			return S_OK;
+		}
+
+		*object = nullptr;
+		return E_NOINTERFACE;
+	}
+
+	virtual ULONG STDMETHODCALLTYPE AddRef() override
+	{
+		return InterlockedIncrement(&_refCount);
+	}
+
+	virtual ULONG STDMETHODCALLTYPE Release() override
+	{
+		ULONG refCount = InterlockedDecrement(&_refCount);
+		if (refCount == 0)
+		{
+			delete this;
+		}
+		return refCount;
+	}
+
+	virtual HRESULT STDMETHODCALLTYPE Invoke(ABI::Windows::Foundation::IAsyncOperation<TResult>* operation, ABI::Windows::Foundation::AsyncStatus status) override
+	{
+		// Completions fire once; the awaiter is gone once it has resumed
+		OperationAwaiter<TResult>* awaiter = _awaiter;
+		_awaiter = nullptr;
+		if (awaiter != nullptr)
+		{
+			awaiter->Complete(operation, status);
+		}
+		return S_OK;
+	}
+
+private:
+	volatile ULONG _refCount;
+	OperationAwaiter<TResult>* _awaiter;
+};
+
+/// co_await AwaitOperation(operation) suspends until the operation completes and yields how it
+/// ended; GetResults is left to the caller. An operation that has completed already continues the
+/// coroutine on the awaiting thread instead of resuming it from inside put_Completed.
+template <typename TResult>
+class OperationAwaiter
+{
+public:
+	explicit OperationAwaiter(ABI::Windows::Foundation::IAsyncOperation<TResult>* operation)
+		: _operation(operation),
+		  _ready(false)
+	{}
+
+	bool await_ready() const
+	{
+		return false;
+	}
+
+	bool await_suspend(std::coroutine_handle<> coroutine)
+	{
+		_coroutine = coroutine;
+
+		Microsoft::WRL::ComPtr<OperationResumer<TResult>> handler;
+		handler.Attach(new OperationResumer<TResult>(this));
+
+		HRESULT hr = _operation->put_Completed(handler.Get());
+		if (FAILED(hr))
+		{
+			_completion.status = ABI::Windows::Foundation::AsyncStatus::Error;
+			_completion.error = hr;
+			return false;
+		}
+
+		// Whoever of this thread and the completion gets here second carries on with the coroutine
+		return !_ready.exchange(true, std::memory_order_acq_rel);
+	}
+
+	AsyncCompletion await_resume() const
+	{
+		return _completion;
+	}
+
+	void Complete(ABI::Windows::Foundation::IAsyncOperation<TResult>* operation, ABI::Windows::Foundation::AsyncStatus status)
+	{
+		_completion.status = status;
+		if (status == ABI::Windows::Foundation::AsyncStatus::Canceled)
+		{
+			_completion.error = E_ABORT;
+		}
+		else if (status == ABI::Windows::Foundation::AsyncStatus::Error)
+		{
+			_completion.error = E_FAIL;
+
+			Microsoft::WRL::ComPtr<ABI::Windows::Foundation::IAsyncInfo> asyncInfo;
+			if (SUCCEEDED(operation->QueryInterface(IID_PPV_ARGS(&asyncInfo))))
+			{
+				asyncInfo->get_ErrorCode(&_completion.error);
+			}
+		}
+
+		if (_ready.exchange(true, std::memory_order_acq_rel))
+		{
+			_coroutine.resume();
+		}
+	}
+
+private:
+	ABI::Windows::Foundation::IAsyncOperation<TResult>* _operation;
+	std::coroutine_handle<> _coroutine;
+	AsyncCompletion _completion;
+	std::atomic<bool> _ready;
+};
+
+/// The caller keeps operation alive until the co_await returns
+template <typename TResult>
+OperationAwaiter<TResult> AwaitOperation(ABI::Windows::Foundation::IAsyncOperation<TResult>* operation)
+{
+	return OperationAwaiter<TResult>(operation);
+}
@@ -0,0 +1,191 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include <wrl\async.h>
+#ifdef _DEBUG
+#include <crtdbg.h>
+#endif
+#include "AsyncAwait.h"
+#include "AsyncBenchmark.h"
+
+using namespace ABI::Windows::Devices::WiFiDirect;
+using namespace Microsoft::WRL;
+using namespace Microsoft::WRL::Wrappers;
+
+#include "StubInternal.h"
+
+typedef __FIAsyncOperationCompletedHandler_1_Windows__CDevices__CWiFiDirect__CWiFiDirectDevice FromIdAsyncHandler;
+typedef AsyncOperationStub<WiFiDirectDevice*, IWiFiDirectDevice*> FromIdAsyncStub;
+
+/// Allocations made by this thread while an AllocationCounting was in scope
+static thread_local uint64_t t_allocations = 0;
+
+#ifdef _DEBUG
+static std::mutex s_countingLock;
+static unsigned int s_countingScopes = 0;
+static _CRT_ALLOC_HOOK s_previousHook = nullptr;
+
+static int __cdecl CountAllocation(int allocType, void* userData, size_t size, int blockType, long requestNumber, const unsigned char* fileName, int lineNumber)
+{
+	// The CRT's own blocks are not the app's, and must not be looked at from a hook
+	if (allocType == _HOOK_ALLOC && blockType != _CRT_BLOCK)
+	{
+		t_allocations++;
+	}
+	return (s_previousHook != nullptr) ? s_previousHook(allocType, userData, size, blockType, requestNumber, fileName, lineNumber) : TRUE;
+}
+#endif
+
+AllocationCounting::AllocationCounting()
+{
+#ifdef _DEBUG
+	std::lock_guard<std::mutex> lock(s_countingLock);
+	if (s_countingScopes++ == 0)
+	{
+		s_previousHook = _CrtSetAllocHook(CountAllocation);
+	}
+#endif
+}
+
+AllocationCounting::~AllocationCounting()
+{
+#ifdef _DEBUG
+	std::lock_guard<std::mutex> lock(s_countingLock);
+	if (--s_countingScopes == 0)
+	{
+		_CrtSetAllocHook(s_previousHook);
+		s_previousHook = nullptr;
+	}
+#endif
+}
+
+bool AllocationCounting::IsAvailable()
+{
+#ifdef _DEBUG
+	return true;
+#else
+	return false;
+#endif
+}
+
+uint64_t GetThreadAllocations()
+{
+	return t_allocations;
+}
+
+namespace
+{
+	/// What a connect carries from issuing FromIdAsync to its completion
+	struct ConnectState
+	{
+		std::function<void(HRESULT)> report;
+		uint64_t deadline;
+		std::chrono::steady_clock::time_point started;
+		std::chrono::steady_clock::time_point issued;
+	};
+
+	void CompleteWithCallback(const ComPtr<IAsyncOperation<WiFiDirectDevice*>>& operation, const ConnectState& state)
+	{
+		std::function<void(HRESULT)> report = state.report;
+		uint64_t deadline = state.deadline;
+		std::chrono::steady_clock::time_point started = state.started;
+		std::chrono::steady_clock::time_point issued = state.issued;
+
+		operation->put_Completed(Callback<FromIdAsyncHandler>([report, deadline, started, issued](IAsyncOperation<WiFiDirectDevice*>* pHandler, AsyncStatus status) -> HRESULT
+		{
+			ComPtr<IWiFiDirectDevice> device;
+			if (status == AsyncStatus::Completed)
+			{
+				pHandler->GetResults(device.GetAddressOf());
+			}
+			report(S_OK);
+			return S_OK;
+		}).Get());
+	}
+
+	AsyncTask CompleteWithCoroutine(ComPtr<IAsyncOperation<WiFiDirectDevice*>> operation, std::function<void(HRESULT)> report, uint64_t deadline,
+		std::chrono::steady_clock::time_point started, std::chrono::steady_clock::time_point issued)
+	{
+		AsyncCompletion completion = co_await AwaitOperation(operation.Get());
+
+		ComPtr<IWiFiDirectDevice> device;
+		if (completion.status == AsyncStatus::Completed)
+		{
+			operation->GetResults(device.GetAddressOf());
+		}
+		report(S_OK);
+	}
+
+	template <typename TComplete>
+	AsyncBenchmarkPath Measure(const wchar_t* label, unsigned int operations, TComplete complete)
+	{
+		AsyncBenchmarkPath path;
+		path.label = label;
+		path.latencies.reserve(operations);
+
+		std::chrono::steady_clock::time_point completedAt;
+		ConnectState state;
+		state.report = [&completedAt](HRESULT)
+		{
+			completedAt = std::chrono::steady_clock::now();
+		};
+		state.deadline = 0;
+		state.started = std::chrono::steady_clock::now();
+		state.issued = state.started;
+
+		// Stubs complete as they are made; what is measured is only getting to the code after them
+		std::vector<ComPtr<IAsyncOperation<WiFiDirectDevice*>>> stubs(operations);
+		for (auto& stub : stubs)
+		{
+			stub = Make<FromIdAsyncStub>(ComPtr<IWiFiDirectDevice>());
+		}
+
+		uint64_t allocations = 0;
+		for (auto& stub : stubs)
+		{
+			uint64_t allocationsBefore = GetThreadAllocations();
+			auto started = std::chrono::steady_clock::now();
+			complete(stub, state);
+			allocations += GetThreadAllocations() - allocationsBefore;
+
+			path.latencies.push_back(static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(completedAt - started).count()));
+
+			// Lets go of the completion handler, as a finished connect does
+			stub.Reset();
+		}
+
+		path.allocations = operations != 0 ? static_cast<double>(allocations) / operations : 0.0;
+		return path;
+	}
+}
+
+std::vector<AsyncBenchmarkPath> RunAsyncBenchmark(unsigned int operations)
+{
+	auto callback = [](const ComPtr<IAsyncOperation<WiFiDirectDevice*>>& operation, const ConnectState& state)
+	{
+		CompleteWithCallback(operation, state);
+	};
+	auto coroutine = [](const ComPtr<IAsyncOperation<WiFiDirectDevice*>>& operation, const ConnectState& state)
+	{
+		CompleteWithCoroutine(operation, state.report, state.deadline, state.started, state.issued);
+	};
+
+	AllocationCounting counting;
+
+	// A short run first so the frame pool holds what the steady state needs
+	Measure(L"warm-up", 64, coroutine);
+
+	std::vector<AsyncBenchmarkPath> paths;
+	paths.push_back(Measure(L"callback", operations, callback));
+	paths.push_back(Measure(L"coroutine", operations, coroutine));
+	return paths;
+}
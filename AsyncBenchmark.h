@@ -0,0 +1,48 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+/// How one way of waiting for an operation did over a benchmark run
+struct AsyncBenchmarkPath
+{
+	const wchar_t* label;
+	/// From the general allocator, per operation, on the thread completing the operations; 0 if
+	/// AllocationCounting is not available
+	double allocations;
+	/// Nanoseconds from registering for completion until the code after it ran, one per operation
+	std::vector<uint32_t> latencies;
+};
+
+/// Complete already finished operations (AsyncOperationStub) the way the connect flow completes
+/// FromIdAsync: once through a Callback completion handler as the helper used to, once
+/// through a pooled AsyncTask coroutine as it does now. Both carry the state a connect carries.
+std::vector<AsyncBenchmarkPath> RunAsyncBenchmark(unsigned int operations);
+
+/// While in scope, counts the allocations each thread makes from the general allocator, through
+/// the debug CRT's allocation hook; operator new itself is left alone. Only Debug builds have the
+/// hook, elsewhere nothing is counted. Scopes may overlap, also on different threads.
+class AllocationCounting
+{
+public:
+	AllocationCounting();
+	~AllocationCounting();
+
+	/// False if this build cannot count allocations
+	static bool IsAvailable();
+
+private:
+	AllocationCounting(const AllocationCounting&) = delete;
+	AllocationCounting& operator=(const AllocationCounting&) = delete;
+};
+
+/// Allocations the calling thread has made while an AllocationCounting was in scope
+uint64_t GetThreadAllocations();
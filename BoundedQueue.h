@@ -0,0 +1,138 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+/// Fixed-capacity ring buffer for any number of producers and consumers (Vyukov). Each cell
+/// carries a sequence number telling whose turn it is, so TryPush and TryPop are one
+/// compare-exchange on the happy path and never allocate. Capacity is rounded up to a power of two.
+template <typename T>
+class BoundedQueue
+{
+public:
+	explicit BoundedQueue(size_t capacity)
+		: _mask(RoundUp(capacity) - 1),
+		  _cells(new Cell[_mask + 1]),
+		  _enqueue(0),
+		  _dequeue(0)
+	{
+		for (size_t i = 0; i <= _mask; i++)
+		{
+			_cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	/// False if the queue is full
+	bool TryPush(T value)
+	{
+		size_t position = _enqueue.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			Cell& cell = _cells[position & _mask];
+			size_t sequence = cell.sequence.load(std::memory_order_acquire);
+			intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+			if (difference == 0)
+			{
+				if (_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				{
+					cell.value = std::move(value);
+					cell.sequence.store(position + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (difference < 0)
+			{
+				return false;
+			}
+			else
+			{
+				position = _enqueue.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	/// False if the queue is empty
+	bool TryPop(T& value)
+	{
+		size_t position = _dequeue.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			Cell& cell = _cells[position & _mask];
+			size_t sequence = cell.sequence.load(std::memory_order_acquire);
+			intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+
+			if (difference == 0)
+			{
+				if (_dequeue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				{
+					value = std::move(cell.value);
+					cell.value = T();
+					cell.sequence.store(position + _mask + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (difference < 0)
+			{
+				return false;
+			}
+			else
+			{
+				position = _dequeue.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	/// Approximate while producers or consumers are running
+	size_t GetSize() const
+	{
+		size_t enqueued = _enqueue.load(std::memory_order_relaxed);
+		size_t dequeued = _dequeue.load(std::memory_order_relaxed);
+		return (enqueued > dequeued) ? enqueued - dequeued : 0;
+	}
+
+	size_t GetCapacity() const
+	{
+		return _mask + 1;
+	}
+
+private:
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	static size_t RoundUp(size_t capacity)
+	{
+		size_t rounded = 2;
+		while (rounded < capacity)
+		{
+			rounded <<= 1;
+		}
+		return rounded;
+	}
+
+	BoundedQueue(const BoundedQueue&) = delete;
+	BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+	const size_t _mask;
+	std::unique_ptr<Cell[]> _cells;
+
+	/// Producers and consumers advance different counters, keep them on separate cache lines
+	alignas(64) std::atomic<size_t> _enqueue;
+	alignas(64) std::atomic<size_t> _dequeue;
+};
@@ -0,0 +1,64 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include "BusBenchmark.h"
+
+std::vector<BusBenchmarkPath> RunBusBenchmark(unsigned int events)
+{
+	struct Run
+	{
+		unsigned int listeners;
+		bool slow;
+	};
+	const Run runs[] = { { 1, false }, { 4, false }, { 16, false }, { 4, true } };
+
+	std::vector<BusBenchmarkPath> paths;
+	for (const Run& run : runs)
+	{
+		ListenerBus bus;
+		BenchmarkListener fast;
+		BenchmarkListener slow(std::chrono::microseconds(1000));
+		std::vector<uint64_t> ids;
+		for (unsigned int i = 0; i < run.listeners; i++)
+		{
+			ids.push_back(bus.Subscribe((run.slow && i == 0) ? &slow : &fast));
+		}
+
+		BusBenchmarkPath path;
+		path.listeners = run.listeners;
+		path.slow = run.slow;
+		path.latencies.reserve(events);
+		for (unsigned int i = 0; i < events; i++)
+		{
+			auto published = std::chrono::steady_clock::now();
+			bus.LogMessage(L"bench");
+			auto elapsed = std::chrono::steady_clock::now() - published;
+			path.latencies.push_back(static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+		}
+
+		// Stats before unsubscribing, which waits for what is still buffered
+		path.dropped = 0;
+		for (auto& stats : bus.GetStats())
+		{
+			path.dropped += stats.dropped;
+		}
+		for (uint64_t id : ids)
+		{
+			bus.Unsubscribe(id);
+		}
+		path.delivered = static_cast<uint64_t>(events) * run.listeners - path.dropped;
+
+		std::sort(path.latencies.begin(), path.latencies.end());
+		paths.push_back(std::move(path));
+	}
+	return paths;
+}
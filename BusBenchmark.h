@@ -0,0 +1,64 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "WlanHostedNetworkWinRT.h"
+
+/// Listener that ignores everything, or takes its time over it to stand in for a slow consumer
+class BenchmarkListener : public IWlanHostedNetworkListener
+{
+public:
+	explicit BenchmarkListener(std::chrono::microseconds delay = std::chrono::microseconds(0))
+		: _delay(delay)
+	{}
+
+	virtual void OnDeviceConnected(std::wstring) override {}
+	virtual void OnDevicesConnected(const ConnectBatchResult&) override {}
+	virtual void OnDeviceDisconnected(std::wstring) override {}
+	virtual void OnAdvertisementStarted() override {}
+	virtual void OnAdvertisementStopped(std::wstring) override {}
+	virtual void OnAdvertisementAborted(std::wstring) override {}
+	virtual void OnEnumerationCompleted(std::wstring) override {}
+	virtual void OnEnumerationStopped(std::wstring) override {}
+	virtual void OnPeersChanged(const PeerDelta&) override {}
+	virtual void OnDeviceUnpaired(std::wstring) override {}
+	virtual void OnDevicePaired(std::wstring) override {}
+	virtual void OnDevicePairedError(std::wstring, int) override {}
+	virtual void OnAsyncException(std::wstring) override {}
+
+	virtual void LogMessage(std::wstring) override
+	{
+		if (_delay.count() != 0)
+		{
+			std::this_thread::sleep_for(_delay);
+		}
+	}
+
+private:
+	std::chrono::microseconds _delay;
+};
+
+/// How the listener bus did fanning events out to one set of listeners
+struct BusBenchmarkPath
+{
+	unsigned int listeners;
+	/// One of the listeners takes a millisecond over each event
+	bool slow;
+	/// Nanoseconds of each Publish, sorted
+	std::vector<uint32_t> latencies;
+	uint64_t delivered;
+	uint64_t dropped;
+};
+
+/// Publish events log messages to 1, 4 and 16 listeners, then to 4 with one slow one among them,
+/// timing every Publish the way a WinRT callback would pay for it
+std::vector<BusBenchmarkPath> RunBusBenchmark(unsigned int events);
@@ -0,0 +1,406 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// Wait without a timeout
+const std::chrono::milliseconds InfiniteWait = std::chrono::milliseconds::max();
+
+/// WaitAny found nothing done in time
+const size_t WaitTimedOut = static_cast<size_t>(-1);
+
+/// Untyped part of a completion: whether it is done, and who to tell when it is. Thread-safe.
+class CompletionState
+{
+public:
+	CompletionState()
+		: _done(false)
+	{}
+
+	virtual ~CompletionState()
+	{}
+
+	bool IsDone() const
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		return _done;
+	}
+
+	/// False if timeout passed first
+	bool Wait(std::chrono::milliseconds timeout) const
+	{
+		std::unique_lock<std::mutex> lock(_lock);
+		if (timeout == InfiniteWait)
+		{
+			_changed.wait(lock, [this]() { return _done; });
+			return true;
+		}
+		return _changed.wait_for(lock, timeout, [this]() { return _done; });
+	}
+
+	/// Run continuation once done, right away on this thread if it already is. Continuations run
+	/// on the thread that completes, after the result is visible.
+	void OnCompleted(std::function<void()> continuation)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			if (!_done)
+			{
+				_continuations.push_back(std::move(continuation));
+				return;
+			}
+		}
+		continuation();
+	}
+
+protected:
+	/// Calls store under the lock unless done already; false if it was
+	template <typename TStore>
+	bool Finish(TStore store)
+	{
+		std::vector<std::function<void()>> continuations;
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			if (_done)
+			{
+				return false;
+			}
+			store();
+			_done = true;
+			continuations.swap(_continuations);
+		}
+		_changed.notify_all();
+
+		for (auto& continuation : continuations)
+		{
+			continuation();
+		}
+		return true;
+	}
+
+private:
+	CompletionState(const CompletionState&) = delete;
+	CompletionState& operator=(const CompletionState&) = delete;
+
+	mutable std::mutex _lock;
+	mutable std::condition_variable _changed;
+	bool _done;
+	std::vector<std::function<void()>> _continuations;
+};
+
+template <typename T>
+class TypedCompletionState : public CompletionState
+{
+public:
+	bool Complete(T result)
+	{
+		return Finish([this, &result]() { _result = std::move(result); });
+	}
+
+	/// Only once done
+	const T& GetResult() const
+	{
+		return _result;
+	}
+
+private:
+	T _result;
+};
+
+/// Completion of any type, for waiting on several operations with different results at once
+class CompletionHandle
+{
+public:
+	CompletionHandle()
+	{}
+
+	explicit CompletionHandle(std::shared_ptr<CompletionState> state)
+		: _state(std::move(state))
+	{}
+
+	bool IsValid() const
+	{
+		return _state != nullptr;
+	}
+
+	bool IsDone() const
+	{
+		return _state && _state->IsDone();
+	}
+
+	bool Wait(std::chrono::milliseconds timeout = InfiniteWait) const
+	{
+		return _state && _state->Wait(timeout);
+	}
+
+	void OnCompleted(std::function<void()> continuation) const
+	{
+		_state->OnCompleted(std::move(continuation));
+	}
+
+private:
+	std::shared_ptr<CompletionState> _state;
+};
+
+/// Result of an operation that is still running, or has finished. Copies share the result. Wait
+/// for it, ask whether it is done, have a continuation called, or co_await it from a coroutine.
+template <typename T>
+class Completion
+{
+public:
+	Completion()
+	{}
+
+	explicit Completion(std::shared_ptr<TypedCompletionState<T>> state)
+		: _state(std::move(state))
+	{}
+
+	bool IsValid() const
+	{
+		return _state != nullptr;
+	}
+
+	bool IsDone() const
+	{
+		return _state && _state->IsDone();
+	}
+
+	/// False if timeout passed first
+	bool Wait(std::chrono::milliseconds timeout = InfiniteWait) const
+	{
+		return _state && _state->Wait(timeout);
+	}
+
+	/// Waits for the result
+	const T& Get() const
+	{
+		_state->Wait(InfiniteWait);
+		return _state->GetResult();
+	}
+
+	void OnCompleted(std::function<void()> continuation) const
+	{
+		_state->OnCompleted(std::move(continuation));
+	}
+
+	operator CompletionHandle() const
+	{
+		return CompletionHandle(_state);
+	}
+
+	bool await_ready() const
+	{
+		return _state->IsDone();
+	}
+
+	void await_suspend(std::coroutine_handle<> coroutine) const
+	{
+		_state->OnCompleted([coroutine]() { coroutine.resume(); });
+	}
+
+	const T& await_resume() const
+	{
+		return _state->GetResult();
+	}
+
+private:
+	std::shared_ptr<TypedCompletionState<T>> _state;
+};
+
+/// The producer side of a Completion: whoever finishes the operation completes it, once
+template <typename T>
+class CompletionSource
+{
+public:
+	CompletionSource()
+		: _state(std::make_shared<TypedCompletionState<T>>())
+	{}
+
+	/// False if it was completed before, e.g. by a deadline
+	bool Complete(T result) const
+	{
+		return _state->Complete(std::move(result));
+	}
+
+	bool IsDone() const
+	{
+		return _state->IsDone();
+	}
+
+	Completion<T> GetCompletion() const
+	{
+		return Completion<T>(_state);
+	}
+
+private:
+	std::shared_ptr<TypedCompletionState<T>> _state;
+};
+
+/// Pending completions of one kind of operation by key, e.g. pairings by device ID, so whatever
+/// reports the outcome completes everyone waiting for it. Thread-safe.
+template <typename T>
+class CompletionRegistry
+{
+public:
+	void Add(const std::wstring& key, const CompletionSource<T>& source)
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+
+		// Drop the ones finished some other way, e.g. by their deadline
+		std::vector<CompletionSource<T>>& sources = _pending[key];
+		sources.erase(std::remove_if(sources.begin(), sources.end(), [](const CompletionSource<T>& pending) { return pending.IsDone(); }), sources.end());
+		sources.push_back(source);
+	}
+
+	/// Complete everything waiting for key; returns how many were
+	size_t Complete(const std::wstring& key, const T& result)
+	{
+		std::vector<CompletionSource<T>> sources;
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			auto it = _pending.find(key);
+			if (it == _pending.end())
+			{
+				return 0;
+			}
+			sources.swap(it->second);
+			_pending.erase(it);
+		}
+
+		// Outside the lock, continuations may start the next operation
+		size_t completed = 0;
+		for (auto& source : sources)
+		{
+			completed += source.Complete(result) ? 1 : 0;
+		}
+		return completed;
+	}
+
+	size_t CompleteAll(const T& result)
+	{
+		std::map<std::wstring, std::vector<CompletionSource<T>>> pending;
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			pending.swap(_pending);
+		}
+
+		size_t completed = 0;
+		for (auto& entry : pending)
+		{
+			for (auto& source : entry.second)
+			{
+				completed += source.Complete(result) ? 1 : 0;
+			}
+		}
+		return completed;
+	}
+
+private:
+	std::mutex _lock;
+	std::map<std::wstring, std::vector<CompletionSource<T>>> _pending;
+};
+
+/// Index of the first of completions that is done, waiting up to timeout for one to be; WaitTimedOut
+/// if none is by then
+inline size_t WaitAny(const std::vector<CompletionHandle>& completions, std::chrono::milliseconds timeout = InfiniteWait)
+{
+	struct Signal
+	{
+		Signal()
+			: fired(false)
+		{}
+
+		std::mutex lock;
+		std::condition_variable changed;
+		bool fired;
+	};
+
+	auto done = [&completions]() -> size_t
+	{
+		for (size_t i = 0; i < completions.size(); i++)
+		{
+			if (completions[i].IsDone())
+			{
+				return i;
+			}
+		}
+		return WaitTimedOut;
+	};
+
+	size_t index = done();
+	if (index != WaitTimedOut || completions.empty() || timeout.count() == 0)
+	{
+		return index;
+	}
+
+	std::shared_ptr<Signal> signal = std::make_shared<Signal>();
+	for (auto& completion : completions)
+	{
+		completion.OnCompleted([signal]()
+		{
+			{
+				std::lock_guard<std::mutex> lock(signal->lock);
+				signal->fired = true;
+			}
+			signal->changed.notify_all();
+		});
+	}
+
+	std::unique_lock<std::mutex> lock(signal->lock);
+	if (timeout == InfiniteWait)
+	{
+		signal->changed.wait(lock, [&signal]() { return signal->fired; });
+	}
+	else
+	{
+		signal->changed.wait_for(lock, timeout, [&signal]() { return signal->fired; });
+	}
+	lock.unlock();
+
+	return done();
+}
+
+/// True once every one of completions is done, false if timeout passed first
+inline bool WaitAll(const std::vector<CompletionHandle>& completions, std::chrono::milliseconds timeout = InfiniteWait)
+{
+	if (timeout == InfiniteWait)
+	{
+		for (auto& completion : completions)
+		{
+			completion.Wait(InfiniteWait);
+		}
+		return true;
+	}
+
+	auto deadline = std::chrono::steady_clock::now() + timeout;
+	for (auto& completion : completions)
+	{
+		auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+		if (!completion.Wait(remaining.count() > 0 ? remaining : std::chrono::milliseconds(0)))
+		{
+			return false;
+		}
+	}
+	return true;
+}
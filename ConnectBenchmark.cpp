@@ -0,0 +1,405 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include <wrl\async.h>
+#include "ConnectBenchmark.h"
+
+#include <queue>
+#include <random>
+
+using namespace ABI::Windows::Devices::WiFiDirect;
+using namespace Microsoft::WRL;
+using namespace Microsoft::WRL::Wrappers;
+
+#include "StubInternal.h"
+
+typedef __FIAsyncOperationCompletedHandler_1_Windows__CDevices__CWiFiDirect__CWiFiDirectDevice FromIdAsyncHandler;
+typedef AsyncOperationStub<WiFiDirectDevice*, IWiFiDirectDevice*> FromIdAsyncStub;
+
+/// Batch timeout; long enough for every answering device at the simulated latencies
+static const std::chrono::milliseconds BenchmarkTimeout(250);
+
+namespace
+{
+	/// Runs scheduled work on one thread at the time it is due: device answers and batch deadlines
+	class SimulatedRadio
+	{
+	public:
+		typedef std::chrono::steady_clock Clock;
+
+		SimulatedRadio()
+			: _sequence(0),
+			  _stopping(false)
+		{
+			_thread = std::thread([this]() { Run(); });
+		}
+
+		~SimulatedRadio()
+		{
+			{
+				std::lock_guard<std::mutex> lock(_lock);
+				_stopping = true;
+			}
+			_wake.notify_one();
+			_thread.join();
+		}
+
+		void Schedule(Clock::time_point due, std::function<void()> work)
+		{
+			{
+				std::lock_guard<std::mutex> lock(_lock);
+				_work.push(Work{ due, _sequence++, std::move(work) });
+			}
+			_wake.notify_one();
+		}
+
+	private:
+		struct Work
+		{
+			Clock::time_point due;
+			uint64_t sequence;
+			std::function<void()> run;
+
+			/// Earliest first in the priority queue, in scheduling order when equally due
+			bool operator<(const Work& other) const
+			{
+				return (due != other.due) ? due > other.due : sequence > other.sequence;
+			}
+		};
+
+		void Run()
+		{
+			std::unique_lock<std::mutex> lock(_lock);
+			while (!_stopping)
+			{
+				if (_work.empty())
+				{
+					_wake.wait(lock);
+					continue;
+				}
+
+				if (_work.top().due > Clock::now())
+				{
+					_wake.wait_until(lock, _work.top().due);
+					continue;
+				}
+
+				std::function<void()> run = _work.top().run;
+				_work.pop();
+
+				// Work schedules more work
+				lock.unlock();
+				run();
+				lock.lock();
+			}
+		}
+
+		std::mutex _lock;
+		std::condition_variable _wake;
+		std::priority_queue<Work> _work;
+		uint64_t _sequence;
+		bool _stopping;
+		std::thread _thread;
+	};
+
+	/// FromIdAsync of a device that takes a while to answer: shaped like AsyncOperationStub, but
+	/// completes when Answer is called instead of as it is made
+	class PendingConnectOperation : public RuntimeClass<AsyncBase<FromIdAsyncHandler>, IAsyncOperation<WiFiDirectDevice*>>
+	{
+	public:
+		PendingConnectOperation()
+		{
+			Start();
+		}
+
+		/// S_OK completes the operation, an error fails it
+		void Answer(HRESULT error)
+		{
+			if (FAILED(error))
+			{
+				TryTransitionToError(error);
+			}
+			FireCompletion();
+		}
+
+		IFACEMETHODIMP put_Completed(FromIdAsyncHandler* handler) override
+		{
+			return PutOnComplete(handler);
+		}
+
+		IFACEMETHODIMP get_Completed(FromIdAsyncHandler** handler) override
+		{
+			return GetOnComplete(handler);
+		}
+
+		IFACEMETHODIMP GetResults(IWiFiDirectDevice** results) override
+		{
+			*results = nullptr;
+			return S_OK;
+		}
+
+	protected:
+		HRESULT OnStart() override
+		{
+			return S_OK;
+		}
+
+		void OnClose() override
+		{}
+
+		void OnCancel() override
+		{}
+	};
+
+	/// IWiFiDirectDeviceStatics2 whose devices answer after latency, give or take a quarter
+	class SimulatedDeviceStatics : public RuntimeClass<IWiFiDirectDeviceStatics2>
+	{
+		InspectableClass(L"WiFiDirectLegacyAPDemo.SimulatedWiFiDirectDeviceStatics", BaseTrust)
+
+	public:
+		SimulatedDeviceStatics(SimulatedRadio& radio, std::chrono::milliseconds latency)
+			: _radio(radio),
+			  _latency(latency),
+			  _issued(0),
+			  _random(5)
+		{}
+
+		IFACEMETHODIMP GetDeviceSelector(WiFiDirectDeviceSelectorType, HSTRING* result) override
+		{
+			*result = nullptr;
+			return E_NOTIMPL;
+		}
+
+		IFACEMETHODIMP FromIdAsync(HSTRING, IWiFiDirectConnectionParameters*, IAsyncOperation<WiFiDirectDevice*>** result) override
+		{
+			uint64_t issued = _issued++;
+
+			if (_latency.count() == 0)
+			{
+				return Make<FromIdAsyncStub>(ComPtr<IWiFiDirectDevice>()).CopyTo(result);
+			}
+
+			ComPtr<PendingConnectOperation> operation = Make<PendingConnectOperation>();
+			if (issued % 50 != 49)
+			{
+				HRESULT error = (issued % 20 == 19) ? HRESULT_FROM_WIN32(ERROR_GEN_FAILURE) : S_OK;
+				std::chrono::microseconds latency;
+				{
+					std::lock_guard<std::mutex> lock(_randomLock);
+					std::uniform_int_distribution<int64_t> jitter(-_latency.count() * 250, _latency.count() * 250);
+					latency = std::chrono::duration_cast<std::chrono::microseconds>(_latency) + std::chrono::microseconds(jitter(_random));
+				}
+
+				_radio.Schedule(SimulatedRadio::Clock::now() + latency, [operation, error]()
+				{
+					operation->Answer(error);
+				});
+			}
+			return operation.CopyTo(result);
+		}
+
+	private:
+		SimulatedRadio& _radio;
+		const std::chrono::milliseconds _latency;
+		std::atomic<uint64_t> _issued;
+		std::mutex _randomLock;
+		std::mt19937 _random;
+	};
+
+	/// What LaunchConnections and FinishConnection keep per batch
+	struct BenchmarkBatch
+	{
+		BenchmarkBatch()
+			: maxInFlight(1),
+			  next(0),
+			  inFlight(0),
+			  finished(0),
+			  launching(false),
+			  radio(nullptr)
+		{}
+
+		std::mutex lock;
+		std::condition_variable done;
+		ConnectBatchResult result;
+		size_t maxInFlight;
+		std::chrono::steady_clock::time_point start;
+		size_t next;
+		size_t inFlight;
+		size_t finished;
+		bool launching;
+
+		ComPtr<IWiFiDirectDeviceStatics2> statics;
+		ComPtr<IWiFiDirectConnectionParameters> parameters;
+		SimulatedRadio* radio;
+	};
+
+	void LaunchConnections(const std::shared_ptr<BenchmarkBatch>& batch);
+
+	/// False if the connection already finished, i.e. this is a completion after the deadline
+	bool FinishConnection(const std::shared_ptr<BenchmarkBatch>& batch, size_t index, ConnectOutcome outcome, HRESULT error)
+	{
+		bool done;
+		{
+			std::lock_guard<std::mutex> lock(batch->lock);
+
+			ConnectBatchEntry& entry = batch->result.devices[index];
+			if (entry.outcome != ConnectOutcome::Pending)
+			{
+				return false;
+			}
+
+			entry.outcome = outcome;
+			entry.error = error;
+			switch (outcome)
+			{
+			case ConnectOutcome::Succeeded:
+				batch->result.succeeded++;
+				break;
+			case ConnectOutcome::TimedOut:
+				batch->result.timedOut++;
+				break;
+			default:
+				batch->result.failed++;
+				break;
+			}
+
+			batch->inFlight--;
+			batch->finished++;
+
+			done = (batch->finished == batch->result.devices.size());
+			if (done)
+			{
+				batch->result.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - batch->start);
+			}
+		}
+
+		if (done)
+		{
+			batch->done.notify_all();
+		}
+		else
+		{
+			LaunchConnections(batch);
+		}
+		return true;
+	}
+
+	void LaunchConnections(const std::shared_ptr<BenchmarkBatch>& batch)
+	{
+		std::unique_lock<std::mutex> lock(batch->lock);
+
+		if (batch->launching)
+		{
+			return;
+		}
+		batch->launching = true;
+
+		while (batch->inFlight < batch->maxInFlight && batch->next < batch->result.devices.size())
+		{
+			size_t index = batch->next++;
+			batch->inFlight++;
+
+			HString deviceId;
+			deviceId.Set(batch->result.devices[index].deviceId.c_str());
+
+			lock.unlock();
+
+			ComPtr<IAsyncOperation<WiFiDirectDevice*>> operation;
+			HRESULT hr = batch->statics->FromIdAsync(deviceId.Get(), batch->parameters.Get(), &operation);
+			if (FAILED(hr))
+			{
+				FinishConnection(batch, index, ConnectOutcome::Failed, hr);
+			}
+			else
+			{
+				ComPtr<IAsyncInfo> info;
+				operation.As(&info);
+				batch->radio->Schedule(std::chrono::steady_clock::now() + BenchmarkTimeout, [batch, index, info]()
+				{
+					if (FinishConnection(batch, index, ConnectOutcome::TimedOut, HRESULT_FROM_WIN32(ERROR_TIMEOUT)))
+					{
+						info->Cancel();
+					}
+				});
+
+				operation->put_Completed(Callback<FromIdAsyncHandler>([batch, index](IAsyncOperation<WiFiDirectDevice*>* pHandler, AsyncStatus status) -> HRESULT
+				{
+					ComPtr<IWiFiDirectDevice> device;
+					HRESULT hr = (status == AsyncStatus::Completed) ? pHandler->GetResults(device.GetAddressOf()) : E_FAIL;
+					FinishConnection(batch, index, SUCCEEDED(hr) ? ConnectOutcome::Succeeded : ConnectOutcome::Failed, hr);
+					return S_OK;
+				}).Get());
+			}
+
+			lock.lock();
+		}
+
+		batch->launching = false;
+	}
+
+	ConnectBenchmarkPath Measure(unsigned int devices, unsigned int latencyMs, size_t maxInFlight)
+	{
+		SimulatedRadio radio;
+
+		std::shared_ptr<BenchmarkBatch> batch = std::make_shared<BenchmarkBatch>();
+		batch->maxInFlight = maxInFlight;
+		batch->radio = &radio;
+		batch->statics = Make<SimulatedDeviceStatics>(radio, std::chrono::milliseconds(latencyMs));
+
+		for (unsigned int i = 0; i < devices; i++)
+		{
+			wchar_t id[64];
+			swprintf_s(id, L"\\\\?\\SWD#WiFiDirect#02:1a:2b:3c:%02x:%02x", (i >> 8) & 0xFF, i & 0xFF);
+
+			ConnectBatchEntry entry;
+			entry.deviceId = id;
+			entry.outcome = ConnectOutcome::Pending;
+			entry.error = S_OK;
+			batch->result.devices.push_back(entry);
+		}
+
+		batch->start = std::chrono::steady_clock::now();
+		LaunchConnections(batch);
+
+		ConnectBenchmarkPath path;
+		{
+			std::unique_lock<std::mutex> lock(batch->lock);
+			batch->done.wait(lock, [&batch]() { return batch->finished == batch->result.devices.size(); });
+			path.result = batch->result;
+		}
+		path.latencyMs = latencyMs;
+		path.maxInFlight = maxInFlight;
+		path.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - batch->start).count();
+		path.connectionsPerSecond = (path.seconds > 0) ? path.result.succeeded / path.seconds : 0.0;
+
+		// The radio stops with deadlines still queued; they hold the batch, not the other way round
+		return path;
+	}
+}
+
+std::vector<ConnectBenchmarkPath> RunConnectBenchmark(unsigned int devices)
+{
+	std::vector<ConnectBenchmarkPath> paths;
+
+	// Answered at once, only what the pipeline itself costs
+	for (size_t maxInFlight : { 1, 16 })
+	{
+		paths.push_back(Measure(devices, 0, maxInFlight));
+	}
+
+	for (size_t maxInFlight : { 1, 4, 16, 64 })
+	{
+		paths.push_back(Measure(devices, 20, maxInFlight));
+	}
+
+	return paths;
+}
@@ -0,0 +1,32 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "WlanHostedNetworkWinRT.h"
+
+/// One batch against the simulated statics
+struct ConnectBenchmarkPath
+{
+	/// Simulated time for a device to answer FromIdAsync; 0 answers as the operation is made
+	unsigned int latencyMs;
+	size_t maxInFlight;
+	ConnectBatchResult result;
+	/// Whole batch; result.elapsed is too coarse for the batches answered at once
+	double seconds;
+	double connectionsPerSecond;
+};
+
+/// Connect devices devices in batches the way ConnectDevices does, against a simulated
+/// IWiFiDirectDeviceStatics2: FromIdAsync returns an AsyncOperationStub that has already completed,
+/// or an operation that completes once a simulated latency has passed. One device in 20 fails to
+/// connect and one in 50 never answers, so the batch timeout cancels it.
+std::vector<ConnectBenchmarkPath> RunConnectBenchmark(unsigned int devices);
@@ -0,0 +1,69 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include "DecisionBenchmark.h"
+
+DecisionBenchmarkResult RunDecisionBenchmark(unsigned int requests)
+{
+	DecisionQueue queue;
+	std::atomic<unsigned int> resolved(0);
+	std::vector<uint32_t> parkLatencies(requests);
+	std::vector<std::thread> threads;
+
+	auto start = std::chrono::steady_clock::now();
+
+	std::thread decider([&]()
+	{
+		while (resolved < requests)
+		{
+			std::vector<PendingDecision> pending = queue.GetPending();
+			for (auto& decision : pending)
+			{
+				queue.Resolve(decision.id, true);
+			}
+			if (pending.empty())
+			{
+				std::this_thread::yield();
+			}
+		}
+	});
+
+	for (unsigned int r = 0; r < requests; r++)
+	{
+		threads.emplace_back([&, r]()
+		{
+			PendingDecision decision;
+			decision.kind = DecisionKind::Connection;
+			decision.deviceId = L"bench";
+			decision.pairingKinds = 0;
+
+			auto parked = std::chrono::steady_clock::now();
+			queue.Add(decision, [&resolved](bool, const std::wstring&) { resolved++; });
+			auto elapsed = std::chrono::steady_clock::now() - parked;
+			parkLatencies[r] = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+		});
+	}
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+	decider.join();
+
+	DecisionBenchmarkResult result;
+	result.requests = requests;
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	result.stats = queue.GetStats();
+	result.latencies = std::move(parkLatencies);
+	std::sort(result.latencies.begin(), result.latencies.end());
+	return result;
+}
@@ -0,0 +1,32 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "DecisionQueue.h"
+
+#include <cstdint>
+#include <vector>
+
+/// How a decision queue did with requests arriving all at once
+struct DecisionBenchmarkResult
+{
+	unsigned int requests;
+	/// From the first request to the last answer
+	double seconds;
+	DecisionStats stats;
+	/// Nanoseconds each handler was blocked parking its request, sorted
+	std::vector<uint32_t> latencies;
+};
+
+/// Park requests requests at once, each from a thread of its own that returns right away as a
+/// WinRT handler would, while one decider thread answers them as they show up
+DecisionBenchmarkResult RunDecisionBenchmark(unsigned int requests);
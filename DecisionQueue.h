@@ -0,0 +1,249 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum class DecisionKind
+{
+	/// A peer asked to connect to the legacy AP
+	Connection,
+	/// A pairing ceremony needs confirmation or a PIN
+	Pairing
+};
+
+/// A request parked until someone decides on it
+struct PendingDecision
+{
+	uint64_t id;
+	DecisionKind kind;
+	std::wstring deviceId;
+	/// DevicePairingKinds of a pairing request, 0 for connections
+	uint32_t pairingKinds;
+	/// PIN to display for DisplayPin pairing
+	std::wstring pin;
+	std::chrono::steady_clock::time_point received;
+	std::chrono::steady_clock::time_point deadline;
+};
+
+/// How long a request may wait and what happens when nobody decides in time
+struct DecisionPolicy
+{
+	DecisionPolicy()
+		: timeout(30000),
+		  acceptOnTimeout(false)
+	{}
+
+	std::chrono::milliseconds timeout;
+	bool acceptOnTimeout;
+};
+
+struct DecisionStats
+{
+	DecisionStats()
+		: accepted(0),
+		  declined(0),
+		  timedOut(0),
+		  totalWait(0)
+	{}
+
+	uint64_t accepted;
+	uint64_t declined;
+	/// Resolved by the policy's default action, also counted in accepted or declined
+	uint64_t timedOut;
+	std::chrono::milliseconds totalWait;
+};
+
+/// Connection and pairing requests waiting for a decision. Whoever receives a request parks it
+/// here with a resolver and returns at once; a prompt, policy or API call decides later, from any
+/// thread, or ExpireDue applies the default action once the timeout passes. Each request is
+/// resolved exactly once. Resolvers run on the deciding thread without the lock held. Thread-safe.
+class DecisionQueue
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	/// Called with the decision and, for ProvidePin pairing, the PIN entered
+	typedef std::function<void(bool accept, const std::wstring& pin)> Resolver;
+
+	DecisionQueue()
+		: _nextId(1)
+	{}
+
+	void SetPolicy(const DecisionPolicy& policy)
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		_policy = policy;
+	}
+
+	DecisionPolicy GetPolicy()
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		return _policy;
+	}
+
+	/// Park a request; id, received and deadline are filled in. Returns the id to decide with.
+	uint64_t Add(PendingDecision& decision, Resolver resolver)
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+
+		decision.id = _nextId++;
+		decision.received = Clock::now();
+		decision.deadline = decision.received + _policy.timeout;
+
+		Entry& entry = _pending[decision.id];
+		entry.decision = decision;
+		entry.resolver = std::move(resolver);
+		return decision.id;
+	}
+
+	/// Decide on a request; false if it was already decided or timed out
+	bool Resolve(uint64_t id, bool accept, const std::wstring& pin = std::wstring())
+	{
+		Resolver resolver;
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+
+			auto it = _pending.find(id);
+			if (it == _pending.end())
+			{
+				return false;
+			}
+
+			resolver = std::move(it->second.resolver);
+			Count(it->second.decision, accept, false);
+			_pending.erase(it);
+		}
+
+		resolver(accept, pin);
+		return true;
+	}
+
+	/// Apply the default action to requests past their deadline; returns how many
+	size_t ExpireDue(Clock::time_point now)
+	{
+		std::vector<Resolver> expired;
+		bool accept;
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+
+			accept = _policy.acceptOnTimeout;
+			for (auto it = _pending.begin(); it != _pending.end();)
+			{
+				if (it->second.decision.deadline <= now)
+				{
+					expired.push_back(std::move(it->second.resolver));
+					Count(it->second.decision, accept, true);
+					it = _pending.erase(it);
+				}
+				else
+				{
+					++it;
+				}
+			}
+		}
+
+		for (auto& resolver : expired)
+		{
+			resolver(accept, std::wstring());
+		}
+		return expired.size();
+	}
+
+	/// Decline everything still waiting, e.g. because the listener is going away
+	size_t DeclineAll()
+	{
+		std::vector<Resolver> declined;
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+
+			for (auto& entry : _pending)
+			{
+				declined.push_back(std::move(entry.second.resolver));
+				Count(entry.second.decision, false, false);
+			}
+			_pending.clear();
+		}
+
+		for (auto& resolver : declined)
+		{
+			resolver(false, std::wstring());
+		}
+		return declined.size();
+	}
+
+	/// Oldest first
+	std::vector<PendingDecision> GetPending()
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+
+		std::vector<PendingDecision> pending;
+		pending.reserve(_pending.size());
+		for (auto& entry : _pending)
+		{
+			pending.push_back(entry.second.decision);
+		}
+		return pending;
+	}
+
+	bool HasPending()
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		return !_pending.empty();
+	}
+
+	DecisionStats GetStats()
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		return _stats;
+	}
+
+private:
+	struct Entry
+	{
+		PendingDecision decision;
+		Resolver resolver;
+	};
+
+	/// Called with _lock held
+	void Count(const PendingDecision& decision, bool accept, bool timedOut)
+	{
+		if (accept)
+		{
+			_stats.accepted++;
+		}
+		else
+		{
+			_stats.declined++;
+		}
+
+		if (timedOut)
+		{
+			_stats.timedOut++;
+		}
+
+		_stats.totalWait += std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - decision.received);
+	}
+
+	std::mutex _lock;
+	DecisionPolicy _policy;
+	/// Ids increase, so map order is arrival order
+	std::map<uint64_t, Entry> _pending;
+	uint64_t _nextId;
+	DecisionStats _stats;
+};
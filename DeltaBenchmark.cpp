@@ -0,0 +1,433 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include "PeerDeltaTracker.h"
+#include "DeltaBenchmark.h"
+
+#include <cstdio>
+#include <map>
+#include <random>
+
+/// Stand-in for the helper's PeerState: discovery is the only thing referring to a peer
+struct SyntheticPeer
+{
+	PeerDiscoveryRecord discovery;
+
+	bool IsIdle() const
+	{
+		return !discovery.present;
+	}
+};
+
+typedef PeerRegistry<SyntheticPeer> SyntheticRegistry;
+typedef PeerDeltaTracker<SyntheticPeer> SyntheticTracker;
+
+static std::wstring MakeDeviceId(unsigned int i)
+{
+	wchar_t id[64];
+	swprintf(id, sizeof(id) / sizeof(id[0]), L"\\\\?\\SWD#WiFiDirect#02:1a:%02x:%02x:%02x:%02x", (i >> 24) & 0xFF, (i >> 16) & 0xFF, (i >> 8) & 0xFF, i & 0xFF);
+	return id;
+}
+
+static std::wstring MakeDeviceName(unsigned int i, unsigned int revision)
+{
+	return L"Device " + std::to_wstring(i) + L" rev " + std::to_wstring(revision);
+}
+
+static const wchar_t* GetChangeKindName(PeerChangeKind kind)
+{
+	switch (kind)
+	{
+	case PeerChangeKind::Added:
+		return L"added";
+	case PeerChangeKind::Updated:
+		return L"updated";
+	default:
+		return L"removed";
+	}
+}
+
+/// "added <id>, removed <id>", in delta order, to compare against what a scenario expects
+static std::wstring DescribeDelta(const PeerDelta& delta)
+{
+	std::wstring text;
+	for (auto& change : delta.changes)
+	{
+		if (!text.empty())
+		{
+			text += L", ";
+		}
+		text += GetChangeKindName(change.kind);
+		text += L" ";
+		text += change.id;
+		if (change.kind != PeerChangeKind::Removed)
+		{
+			text += L"=" + change.name;
+		}
+	}
+	return text;
+}
+
+namespace
+{
+	/// One scripted scenario: events go to the tracker, Expect compares the delta they produce
+	class Scenario
+	{
+	public:
+		explicit Scenario(const wchar_t* label)
+			: _tracker(_registry),
+			  _lastGeneration(0)
+		{
+			_check.label = label;
+			_check.passed = true;
+		}
+
+		SyntheticTracker& GetTracker()
+		{
+			return _tracker;
+		}
+
+		/// expected as DescribeDelta writes it, empty for no delta at all
+		void Expect(const std::wstring& expected)
+		{
+			PeerDelta delta;
+			bool changed = _tracker.TakeDelta(delta);
+			std::wstring actual = DescribeDelta(delta);
+
+			if (changed != !expected.empty() || actual != expected)
+			{
+				Fail(L"expected [" + expected + L"], got [" + actual + L"]");
+			}
+			else if (changed && delta.generation != _lastGeneration + 1)
+			{
+				Fail(L"generation " + std::to_wstring(delta.generation) + L" after " + std::to_wstring(_lastGeneration));
+			}
+			_lastGeneration = _tracker.GetGeneration();
+		}
+
+		void ExpectPeers(size_t present, size_t interned)
+		{
+			if (_tracker.GetPeerCount() != present || _registry.GetCount() != interned)
+			{
+				Fail(std::to_wstring(_tracker.GetPeerCount()) + L" present, " + std::to_wstring(_registry.GetCount()) + L" interned; expected " +
+					std::to_wstring(present) + L", " + std::to_wstring(interned));
+			}
+		}
+
+		void Fail(const std::wstring& detail)
+		{
+			// The first failure explains the rest
+			if (_check.passed)
+			{
+				_check.passed = false;
+				_check.detail = detail;
+			}
+		}
+
+		DeltaCheck GetResult() const
+		{
+			return _check;
+		}
+
+	private:
+		SyntheticRegistry _registry;
+		SyntheticTracker _tracker;
+		DeltaCheck _check;
+		uint64_t _lastGeneration;
+	};
+}
+
+/// Random watcher events against a map of what the watcher has reported; after every delta the
+/// listener's view, built from the deltas alone, has to match it
+static DeltaCheck CheckRandomEvents(unsigned int events)
+{
+	Scenario scenario(L"random events");
+	SyntheticTracker& tracker = scenario.GetTracker();
+
+	const unsigned int peers = 64;
+	std::map<std::wstring, std::wstring> reported;
+	std::map<std::wstring, std::wstring> listener;
+	std::map<std::wstring, uint64_t> versions;
+	std::mt19937 random(7);
+	unsigned int revision = 0;
+
+	for (unsigned int e = 0; e < events && scenario.GetResult().passed; e++)
+	{
+		unsigned int peer = random() % peers;
+		std::wstring id = MakeDeviceId(peer);
+
+		switch (random() % 8)
+		{
+		case 0:
+		case 1:
+		case 2:
+		{
+			// Mostly re-reports of the same name, as a rescan produces
+			std::wstring name = MakeDeviceName(peer, (random() % 4 == 0) ? ++revision : 0);
+			tracker.OnAdded(id, name);
+			reported[id] = name;
+			break;
+		}
+		case 3:
+			if (tracker.OnUpdated(id, MakeDeviceName(peer, ++revision)))
+			{
+				reported[id] = MakeDeviceName(peer, revision);
+			}
+			break;
+		case 4:
+		case 5:
+			tracker.OnRemoved(id);
+			reported.erase(id);
+			break;
+		case 6:
+			if (random() % 16 == 0)
+			{
+				tracker.BeginEnumeration();
+				for (auto& entry : reported)
+				{
+					tracker.OnAdded(entry.first, entry.second);
+				}
+				tracker.EndEnumeration();
+			}
+			break;
+		default:
+		{
+			PeerDelta delta;
+			tracker.TakeDelta(delta);
+			for (auto& change : delta.changes)
+			{
+				bool known = listener.find(change.id) != listener.end();
+				if (known != (change.kind != PeerChangeKind::Added))
+				{
+					scenario.Fail(std::wstring(GetChangeKindName(change.kind)) + L" " + change.id + (known ? L", already listed" : L", never listed"));
+				}
+				if (change.version <= versions[change.id] && change.kind != PeerChangeKind::Removed)
+				{
+					scenario.Fail(L"version of " + change.id + L" went back to " + std::to_wstring(change.version));
+				}
+
+				// A removed peer may be released and start over at version 1
+				if (change.kind == PeerChangeKind::Removed)
+				{
+					listener.erase(change.id);
+					versions.erase(change.id);
+				}
+				else
+				{
+					listener[change.id] = change.name;
+					versions[change.id] = change.version;
+				}
+			}
+
+			if (listener != reported)
+			{
+				scenario.Fail(L"listener lists " + std::to_wstring(listener.size()) + L" peers after generation " +
+					std::to_wstring(delta.generation) + L", the watcher " + std::to_wstring(reported.size()));
+			}
+			break;
+		}
+		}
+	}
+
+	// Once everything is gone and reported, nothing may be left interned
+	for (auto& entry : reported)
+	{
+		tracker.OnRemoved(entry.first);
+	}
+	PeerDelta last;
+	tracker.TakeDelta(last);
+	scenario.ExpectPeers(0, 0);
+
+	return scenario.GetResult();
+}
+
+std::vector<DeltaCheck> RunDeltaChecks()
+{
+	std::vector<DeltaCheck> checks;
+
+	const std::wstring a = MakeDeviceId(1);
+	const std::wstring b = MakeDeviceId(2);
+	const std::wstring c = MakeDeviceId(3);
+
+	{
+		Scenario scenario(L"enumerate");
+		SyntheticTracker& tracker = scenario.GetTracker();
+		tracker.BeginEnumeration();
+		tracker.OnAdded(a, L"A");
+		tracker.OnAdded(b, L"B");
+		tracker.OnAdded(c, L"C");
+		tracker.EndEnumeration();
+		scenario.Expect(L"added " + a + L"=A, added " + b + L"=B, added " + c + L"=C");
+		scenario.ExpectPeers(3, 3);
+		checks.push_back(scenario.GetResult());
+	}
+
+	{
+		Scenario scenario(L"rescan unchanged");
+		SyntheticTracker& tracker = scenario.GetTracker();
+		tracker.OnAdded(a, L"A");
+		tracker.OnAdded(b, L"B");
+		scenario.Expect(L"added " + a + L"=A, added " + b + L"=B");
+		tracker.BeginEnumeration();
+		tracker.OnAdded(b, L"B");
+		tracker.OnAdded(a, L"A");
+		tracker.EndEnumeration();
+		scenario.Expect(L"");
+		checks.push_back(scenario.GetResult());
+	}
+
+	{
+		Scenario scenario(L"rename");
+		SyntheticTracker& tracker = scenario.GetTracker();
+		tracker.OnAdded(a, L"A");
+		scenario.Expect(L"added " + a + L"=A");
+		tracker.OnAdded(a, L"A2");
+		scenario.Expect(L"updated " + a + L"=A2");
+		tracker.OnUpdated(a, L"A3");
+		tracker.OnUpdated(a, L"A4");
+		scenario.Expect(L"updated " + a + L"=A4");
+		checks.push_back(scenario.GetResult());
+	}
+
+	{
+		Scenario scenario(L"sweep missing");
+		SyntheticTracker& tracker = scenario.GetTracker();
+		tracker.OnAdded(a, L"A");
+		tracker.OnAdded(b, L"B");
+		tracker.OnAdded(c, L"C");
+		scenario.Expect(L"added " + a + L"=A, added " + b + L"=B, added " + c + L"=C");
+		tracker.BeginEnumeration();
+		tracker.OnAdded(a, L"A");
+		tracker.OnAdded(c, L"C");
+		tracker.EndEnumeration();
+		scenario.Expect(L"removed " + b);
+		scenario.ExpectPeers(2, 2);
+		checks.push_back(scenario.GetResult());
+	}
+
+	{
+		Scenario scenario(L"added and removed");
+		SyntheticTracker& tracker = scenario.GetTracker();
+		tracker.OnAdded(a, L"A");
+		tracker.OnAdded(b, L"B");
+		tracker.OnRemoved(a);
+		scenario.Expect(L"added " + b + L"=B");
+		scenario.ExpectPeers(1, 1);
+		checks.push_back(scenario.GetResult());
+	}
+
+	{
+		Scenario scenario(L"removed and back");
+		SyntheticTracker& tracker = scenario.GetTracker();
+		tracker.OnAdded(a, L"A");
+		scenario.Expect(L"added " + a + L"=A");
+		tracker.OnRemoved(a);
+		tracker.OnAdded(a, L"A");
+		scenario.Expect(L"updated " + a + L"=A");
+		scenario.ExpectPeers(1, 1);
+		checks.push_back(scenario.GetResult());
+	}
+
+	{
+		Scenario scenario(L"unknown peers");
+		SyntheticTracker& tracker = scenario.GetTracker();
+		tracker.OnUpdated(a, L"A");
+		tracker.OnRemoved(b);
+		scenario.Expect(L"");
+		scenario.ExpectPeers(0, 0);
+		checks.push_back(scenario.GetResult());
+	}
+
+	checks.push_back(CheckRandomEvents(200000));
+	return checks;
+}
+
+DeltaBenchmarkResult RunDeltaBenchmark(unsigned int peers, unsigned int rescans)
+{
+	typedef std::chrono::steady_clock Clock;
+
+	SyntheticRegistry registry;
+	SyntheticTracker tracker(registry);
+
+	// Each rescan 2% are renamed, 1% leave and as many others arrive; the room keeps its size
+	std::vector<std::wstring> ids;
+	std::vector<unsigned int> revisions;
+	std::vector<unsigned int> present;
+	for (unsigned int i = 0; i < peers * 2; i++)
+	{
+		ids.push_back(MakeDeviceId(i));
+		revisions.push_back(0);
+	}
+	for (unsigned int i = 0; i < peers; i++)
+	{
+		present.push_back(i);
+	}
+	std::vector<unsigned int> absent;
+	for (unsigned int i = peers; i < peers * 2; i++)
+	{
+		absent.push_back(i);
+	}
+
+	std::vector<std::wstring> names;
+	for (unsigned int i = 0; i < peers * 2; i++)
+	{
+		names.push_back(MakeDeviceName(i, 0));
+	}
+
+	std::mt19937 random(11);
+	uint64_t events = 0;
+	uint64_t changes = 0;
+	Clock::duration elapsed(0);
+	PeerDelta delta;
+
+	for (unsigned int rescan = 0; rescan <= rescans; rescan++)
+	{
+		// The first pass only fills the room
+		if (rescan != 0)
+		{
+			for (unsigned int i = 0; i < peers / 50; i++)
+			{
+				unsigned int peer = present[random() % present.size()];
+				names[peer] = MakeDeviceName(peer, ++revisions[peer]);
+			}
+			for (unsigned int i = 0; i < peers / 100 && !absent.empty(); i++)
+			{
+				size_t leaving = random() % present.size();
+				size_t arriving = random() % absent.size();
+				std::swap(present[leaving], absent[arriving]);
+			}
+		}
+
+		auto started = Clock::now();
+		tracker.BeginEnumeration();
+		for (unsigned int peer : present)
+		{
+			tracker.OnAdded(ids[peer], names[peer]);
+		}
+		tracker.EndEnumeration();
+		tracker.TakeDelta(delta);
+		if (rescan != 0)
+		{
+			elapsed += Clock::now() - started;
+			events += present.size();
+			changes += delta.changes.size();
+		}
+	}
+
+	DeltaBenchmarkResult result;
+	result.peers = peers;
+	result.rescans = rescans;
+	result.nanoseconds = (events != 0) ? std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / static_cast<double>(events) : 0.0;
+	result.changes = (rescans != 0) ? static_cast<double>(changes) / rescans : 0.0;
+	result.rescanChanges = 2.0 * peers;
+	return result;
+}
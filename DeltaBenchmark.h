@@ -0,0 +1,46 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// Outcome of one scenario of synthetic watcher events
+struct DeltaCheck
+{
+	const wchar_t* label;
+	bool passed;
+	/// What differed from the expected deltas, empty if passed
+	std::wstring detail;
+};
+
+/// How the delta tracker did on repeated rescans of a busy room
+struct DeltaBenchmarkResult
+{
+	unsigned int peers;
+	unsigned int rescans;
+	/// Per watcher event, the TakeDelta after each rescan included
+	double nanoseconds;
+	/// Changes listeners heard about per rescan
+	double changes;
+	/// What clear-and-rescan reported per rescan: every peer removed and added again
+	double rescanChanges;
+};
+
+/// Feed PeerDeltaTracker scripted watcher events (enumerations, renames, departures, a peer
+/// appearing and vanishing within one delta) and a long random sequence checked against a plain
+/// map of what the watcher reported
+std::vector<DeltaCheck> RunDeltaChecks();
+
+/// Rescan a room of peers rescans times, a few of them renamed, leaving or arriving each time
+DeltaBenchmarkResult RunDeltaBenchmark(unsigned int peers, unsigned int rescans);
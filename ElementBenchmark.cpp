@@ -0,0 +1,275 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include "InformationElements.h"
+#include "ElementBenchmark.h"
+
+#if defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define WFD_IE_USE_SSE2 1
+#endif
+
+static volatile size_t s_sink;
+
+/// OUI of the vendor element looked for; AC-DE-48 is reserved for private use
+static const uint32_t BenchmarkOui = 0xACDE48;
+static const uint8_t BenchmarkVendorType = 0x01;
+
+namespace
+{
+	/// Builds element buffers the way peers lay them out
+	class ElementWriter
+	{
+	public:
+		void Add(uint8_t id, const std::vector<uint8_t>& body)
+		{
+			_buffer.push_back(id);
+			_buffer.push_back(static_cast<uint8_t>(body.size()));
+			_buffer.insert(_buffer.end(), body.begin(), body.end());
+		}
+
+		/// Vendor element with a body of length bytes, the OUI and vendor type included
+		void AddVendor(uint32_t oui, uint8_t vendorType, size_t length)
+		{
+			std::vector<uint8_t> body = { static_cast<uint8_t>(oui >> 16), static_cast<uint8_t>(oui >> 8), static_cast<uint8_t>(oui), vendorType };
+			for (size_t i = body.size(); i < length; i++)
+			{
+				body.push_back(static_cast<uint8_t>(i * 7));
+			}
+			Add(VendorSpecificElementId, body);
+		}
+
+		/// P2P attributes, split over as many P2P elements as they need
+		void AddP2P(const std::vector<uint8_t>& attributes, size_t maxPayload)
+		{
+			for (size_t offset = 0; offset < attributes.size(); offset += maxPayload)
+			{
+				size_t length = (attributes.size() - offset < maxPayload) ? attributes.size() - offset : maxPayload;
+				std::vector<uint8_t> body = { 0x50, 0x6F, 0x9A, P2PVendorType };
+				body.insert(body.end(), attributes.begin() + offset, attributes.begin() + offset + length);
+				Add(VendorSpecificElementId, body);
+			}
+		}
+
+		/// Element of the given ID with a filler body
+		void AddFiller(uint8_t id, size_t length)
+		{
+			Add(id, std::vector<uint8_t>(length, static_cast<uint8_t>(id)));
+		}
+
+		const std::vector<uint8_t>& GetBuffer() const
+		{
+			return _buffer;
+		}
+
+	private:
+		std::vector<uint8_t> _buffer;
+	};
+
+	void AddAttribute(std::vector<uint8_t>& attributes, uint8_t id, const std::vector<uint8_t>& body)
+	{
+		attributes.push_back(id);
+		attributes.push_back(static_cast<uint8_t>(body.size()));
+		attributes.push_back(static_cast<uint8_t>(body.size() >> 8));
+		attributes.insert(attributes.end(), body.begin(), body.end());
+	}
+
+	/// P2P Capability, Device Info for a phone, and clients more Group Info descriptors
+	std::vector<uint8_t> MakeP2PAttributes(unsigned int clients)
+	{
+		std::vector<uint8_t> attributes;
+		AddAttribute(attributes, 2, { 0x25, 0x00 });
+
+		// Address, config methods, category 10 (telephone) / OUI / sub category 5, no secondary
+		// types, then the WSC device name attribute
+		std::vector<uint8_t> deviceInfo = { 0x02, 0x1A, 0x2B, 0x3C, 0x4D, 0x5E, 0x01, 0x88, 0x00, 0x0A, 0x00, 0x50, 0xF2, 0x04, 0x00, 0x05, 0x00, 0x10, 0x11, 0x00, 0x0C };
+		for (const char* name = "Galaxy S23 5"; *name != '\0'; name++)
+		{
+			deviceInfo.push_back(static_cast<uint8_t>(*name));
+		}
+		AddAttribute(attributes, P2PDeviceInfoAttributeId, deviceInfo);
+
+		if (clients != 0)
+		{
+			std::vector<uint8_t> groupInfo;
+			for (unsigned int c = 0; c < clients; c++)
+			{
+				std::vector<uint8_t> descriptor(24 + 12, static_cast<uint8_t>(c));
+				descriptor[0] = static_cast<uint8_t>(descriptor.size() - 1);
+				groupInfo.insert(groupInfo.end(), descriptor.begin(), descriptor.end());
+			}
+			AddAttribute(attributes, 14, groupInfo);
+		}
+		return attributes;
+	}
+
+	/// What a phone advertising as a group owner sends: SSID, rates, HT, RSN, WMM, WPS and P2P
+	std::vector<uint8_t> MakePhoneBuffer()
+	{
+		ElementWriter writer;
+		const char ssid[] = "DIRECT-4f-Galaxy S23";
+		writer.Add(0, std::vector<uint8_t>(ssid, ssid + sizeof(ssid) - 1));
+		writer.Add(1, { 0x8C, 0x12, 0x98, 0x24, 0xB0, 0x48, 0x60, 0x6C });
+		writer.AddFiller(3, 1);
+		writer.AddFiller(45, 26);
+		writer.AddFiller(61, 22);
+		writer.AddFiller(48, 20);
+		writer.AddVendor(0x0050F2, 0x02, 24);
+		writer.AddVendor(0x0050F2, 0x04, 96);
+		writer.AddP2P(MakeP2PAttributes(0), 251);
+		return writer.GetBuffer();
+	}
+
+	/// An AP with VHT, HE and the vendor elements of several chipset and OS vendors
+	std::vector<uint8_t> MakeBusyBuffer()
+	{
+		ElementWriter writer;
+		const char ssid[] = "Warehouse-Floor-2";
+		writer.Add(0, std::vector<uint8_t>(ssid, ssid + sizeof(ssid) - 1));
+		writer.Add(1, { 0x8C, 0x12, 0x98, 0x24, 0xB0, 0x48, 0x60, 0x6C });
+		writer.AddFiller(3, 1);
+		writer.AddFiller(5, 4);
+		writer.AddFiller(7, 42);
+		writer.AddFiller(45, 26);
+		writer.AddFiller(61, 22);
+		writer.AddFiller(48, 26);
+		writer.AddFiller(127, 10);
+		writer.AddFiller(191, 12);
+		writer.AddFiller(192, 5);
+		writer.AddFiller(255, 40);
+		writer.AddVendor(0x0050F2, 0x02, 24);
+		writer.AddVendor(0x0050F2, 0x04, 180);
+		writer.AddVendor(0x001018, 0x02, 9);
+		writer.AddVendor(0x00037F, 0x01, 10);
+		writer.AddVendor(0x0017F2, 0x0A, 200);
+		writer.AddVendor(0x8CFDF0, 0x01, 150);
+		writer.AddVendor(0x000C43, 0x03, 120);
+		writer.AddVendor(0x00904C, 0x33, 30);
+		writer.AddVendor(0x00904C, 0x34, 26);
+		writer.AddVendor(0x001392, 0x01, 180);
+		writer.AddVendor(0x00E04C, 0x02, 100);
+		writer.AddP2P(MakeP2PAttributes(0), 251);
+		return writer.GetBuffer();
+	}
+
+	/// A group owner with many clients; the Group Info attribute pushes the payload past one element
+	std::vector<uint8_t> MakeSplitBuffer()
+	{
+		ElementWriter writer;
+		const char ssid[] = "DIRECT-9a-Printer";
+		writer.Add(0, std::vector<uint8_t>(ssid, ssid + sizeof(ssid) - 1));
+		writer.Add(1, { 0x8C, 0x12, 0x98, 0x24, 0xB0, 0x48, 0x60, 0x6C });
+		writer.AddFiller(45, 26);
+		writer.AddVendor(0x0050F2, 0x04, 96);
+		writer.AddP2P(MakeP2PAttributes(8), 251);
+		writer.AddVendor(BenchmarkOui, BenchmarkVendorType, 40);
+		return writer.GetBuffer();
+	}
+
+#ifdef WFD_IE_USE_SSE2
+	/// True if the three OUI bytes occur anywhere in the buffer, 16 starting positions at a time:
+	/// byte j of the three loads is buffer[i + j + 0/1/2]. The byte scan FindVendorElement does not
+	/// use, kept to show what it would cost in front of the element walk.
+	bool MayContainOui(const uint8_t* buffer, size_t length, uint32_t oui)
+	{
+		const uint8_t b0 = static_cast<uint8_t>(oui >> 16);
+		const uint8_t b1 = static_cast<uint8_t>(oui >> 8);
+		const uint8_t b2 = static_cast<uint8_t>(oui);
+
+		const __m128i first = _mm_set1_epi8(static_cast<char>(b0));
+		const __m128i second = _mm_set1_epi8(static_cast<char>(b1));
+		const __m128i third = _mm_set1_epi8(static_cast<char>(b2));
+
+		size_t i = 0;
+		for (; i + 18 <= length; i += 16)
+		{
+			__m128i match = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer + i)), first);
+			match = _mm_and_si128(match, _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer + i + 1)), second));
+			match = _mm_and_si128(match, _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer + i + 2)), third));
+			if (_mm_movemask_epi8(match) != 0)
+			{
+				return true;
+			}
+		}
+
+		for (; i + 3 <= length; i++)
+		{
+			if (buffer[i] == b0 && buffer[i + 1] == b1 && buffer[i + 2] == b2)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+#endif
+
+	template <typename TLookup>
+	ElementBenchmarkPath Measure(const wchar_t* label, const wchar_t* name, const std::vector<uint8_t>& buffer, unsigned int lookups, TLookup lookup)
+	{
+		typedef std::chrono::steady_clock Clock;
+
+		size_t found = 0;
+		auto started = Clock::now();
+		for (unsigned int i = 0; i < lookups; i++)
+		{
+			found += lookup(buffer.data(), buffer.size()) ? 1 : 0;
+		}
+		double elapsed = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - started).count());
+		s_sink = found;
+
+		ElementBenchmarkPath path;
+		path.label = label;
+		path.buffer = name;
+		path.bytes = buffer.size();
+		path.nanoseconds = (lookups != 0) ? elapsed / lookups : 0.0;
+		path.megabytes = (elapsed > 0) ? buffer.size() * static_cast<double>(lookups) / elapsed * 1000.0 : 0.0;
+		return path;
+	}
+}
+
+std::vector<ElementBenchmarkPath> RunElementBenchmark(unsigned int lookups)
+{
+	std::vector<ElementBenchmarkPath> paths;
+
+	const struct
+	{
+		const wchar_t* name;
+		std::vector<uint8_t> buffer;
+	} buffers[] = { { L"phone", MakePhoneBuffer() }, { L"busy AP", MakeBusyBuffer() }, { L"split P2P", MakeSplitBuffer() } };
+
+	for (const auto& entry : buffers)
+	{
+		paths.push_back(Measure(L"device type", entry.name, entry.buffer, lookups, [](const uint8_t* buffer, size_t length)
+		{
+			uint16_t category = 0;
+			uint16_t subCategory = 0;
+			return FindPrimaryDeviceType(buffer, length, category, subCategory);
+		}));
+
+		// Only the split buffer carries the OUI; on the others this is the lookup every peer pays
+		paths.push_back(Measure(L"oui", entry.name, entry.buffer, lookups, [](const uint8_t* buffer, size_t length)
+		{
+			InformationElement element;
+			return FindVendorElement(buffer, length, BenchmarkOui, BenchmarkVendorType, element);
+		}));
+#ifdef WFD_IE_USE_SSE2
+		paths.push_back(Measure(L"oui sse2", entry.name, entry.buffer, lookups, [](const uint8_t* buffer, size_t length)
+		{
+			InformationElement element;
+			return MayContainOui(buffer, length, BenchmarkOui) && FindVendorElement(buffer, length, BenchmarkOui, BenchmarkVendorType, element);
+		}));
+#endif
+	}
+
+	return paths;
+}
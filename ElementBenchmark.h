@@ -0,0 +1,34 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/// How one lookup did on one kind of element buffer
+struct ElementBenchmarkPath
+{
+	const wchar_t* label;
+	const wchar_t* buffer;
+	size_t bytes;
+	/// Per buffer
+	double nanoseconds;
+	/// Buffer bytes looked through per second, in MB
+	double megabytes;
+};
+
+/// Look up the primary device type and a vendor element in element buffers laid out as peers
+/// send them: a phone's probe response, a busy AP's with a dozen vendor elements, and one whose
+/// P2P payload is split over two elements. The OUI lookup runs as the element walk
+/// FindVendorElement does and, where SSE2 is available, behind a vectorized byte scan for the OUI
+/// to show what that prefilter would cost.
+std::vector<ElementBenchmarkPath> RunElementBenchmark(unsigned int lookups);
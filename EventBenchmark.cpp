@@ -0,0 +1,221 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include "AsyncBenchmark.h"
+#include "BusBenchmark.h"
+#include "EventBenchmark.h"
+
+namespace
+{
+	/// v1 listener that counts the allocations its thread makes from one disconnect to the next, the
+	/// copy ListenerAdapter makes of the device ID included
+	class AllocationCountingListener : public BenchmarkListener
+	{
+	public:
+		AllocationCountingListener()
+			: allocations(0),
+			  _last(0),
+			  _started(false)
+		{}
+
+		virtual void OnDeviceDisconnected(std::wstring) override
+		{
+			Count(allocations, _last, _started);
+		}
+
+		/// Shared with the v2 listener below: the first call only starts counting, the thread had
+		/// allocations of its own before it
+		static void Count(uint64_t& allocations, uint64_t& last, bool& started)
+		{
+			uint64_t now = GetThreadAllocations();
+			if (started)
+			{
+				allocations += now - last;
+			}
+			last = now;
+			started = true;
+		}
+
+		uint64_t allocations;
+
+	private:
+		uint64_t _last;
+		bool _started;
+	};
+
+	/// v2 listener that reads events in place, or asks for an owning copy of the text of each
+	class AllocationCountingListener2 : public IWlanHostedNetworkListener2
+	{
+	public:
+		explicit AllocationCountingListener2(bool copy)
+			: allocations(0),
+			  _copy(copy),
+			  _last(0),
+			  _started(false),
+			  _characters(0)
+		{}
+
+		virtual void OnEvent(const ListenerEventView& event) override
+		{
+			if (_copy)
+			{
+				std::wstring text = event.CopyText();
+				_characters += text.length();
+			}
+			else
+			{
+				_characters += event.text.length();
+			}
+			AllocationCountingListener::Count(allocations, _last, _started);
+		}
+
+		uint64_t allocations;
+
+	private:
+		bool _copy;
+		uint64_t _last;
+		bool _started;
+		size_t _characters;
+	};
+}
+
+std::vector<EventBenchmarkPath> RunEventBenchmark(unsigned int events)
+{
+	const unsigned int Listeners = 4;
+	const wchar_t* const DeviceId = L"\\\\?\\SWD#WiFiDirect#02:1a:2b:3c:4d:5e";
+	const std::wstring_view RawDeviceId(DeviceId);
+
+	enum class Path
+	{
+		SharedEvents,
+		Version1,
+		Version2,
+		Version2Copy
+	};
+	const struct
+	{
+		Path path;
+		const wchar_t* label;
+	} paths[] = { { Path::SharedEvents, L"before" }, { Path::Version1, L"v1" }, { Path::Version2, L"v2" }, { Path::Version2Copy, L"v2 copy" } };
+
+	std::vector<EventBenchmarkPath> results;
+
+	// Counts on every thread, the listeners' delivery threads included
+	AllocationCounting counting;
+
+	for (const auto& run : paths)
+	{
+		std::vector<std::unique_ptr<AllocationCountingListener>> listeners;
+		std::vector<std::unique_ptr<AllocationCountingListener2>> listeners2;
+		std::vector<uint32_t> samples;
+		samples.reserve(events);
+		uint64_t raised = 0;
+		uint64_t dropped = 0;
+
+		// Runs the events through, timing each raise; stats are read before unsubscribing, which
+		// waits for what is still buffered
+		auto measure = [&](auto raise, auto stats)
+		{
+			uint64_t before = GetThreadAllocations();
+			for (unsigned int i = 0; i < events; i++)
+			{
+				auto started = std::chrono::steady_clock::now();
+				raise();
+				auto elapsed = std::chrono::steady_clock::now() - started;
+				samples.push_back(static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+			}
+			raised = GetThreadAllocations() - before;
+
+			for (auto& entry : stats())
+			{
+				dropped += entry.dropped;
+			}
+		};
+
+		if (run.path == Path::SharedEvents)
+		{
+			EventBus<std::shared_ptr<const ListenerEvent>> bus;
+			std::vector<uint64_t> ids;
+			for (unsigned int i = 0; i < Listeners; i++)
+			{
+				listeners.emplace_back(new AllocationCountingListener());
+				ListenerAdapter adapter(listeners.back().get());
+				ids.push_back(bus.Subscribe([adapter](const std::shared_ptr<const ListenerEvent>& event) mutable { adapter.OnEvent(event->GetView()); }));
+			}
+
+			measure([&]()
+			{
+				std::wstring deviceId(RawDeviceId.data(), RawDeviceId.length());
+				std::shared_ptr<ListenerEvent> event = std::make_shared<ListenerEvent>();
+				event->kind = ListenerEventKind::DeviceDisconnected;
+				event->text = std::move(deviceId);
+				bus.Publish(event);
+			}, [&]() { return bus.GetStats(); });
+
+			for (uint64_t id : ids)
+			{
+				bus.Unsubscribe(id);
+			}
+		}
+		else
+		{
+			ListenerBus bus;
+			std::vector<uint64_t> ids;
+			for (unsigned int i = 0; i < Listeners; i++)
+			{
+				if (run.path == Path::Version1)
+				{
+					listeners.emplace_back(new AllocationCountingListener());
+					ids.push_back(bus.Subscribe(listeners.back().get()));
+				}
+				else
+				{
+					listeners2.emplace_back(new AllocationCountingListener2(run.path == Path::Version2Copy));
+					ids.push_back(bus.Subscribe(listeners2.back().get()));
+				}
+			}
+
+			measure([&]()
+			{
+				bus.Raise(ListenerEventKind::DeviceDisconnected, RawDeviceId);
+			}, [&]() { return bus.GetStats(); });
+
+			for (uint64_t id : ids)
+			{
+				bus.Unsubscribe(id);
+			}
+		}
+
+		uint64_t delivering = 0;
+		for (auto& listener : listeners)
+		{
+			delivering += listener->allocations;
+		}
+		for (auto& listener : listeners2)
+		{
+			delivering += listener->allocations;
+		}
+
+		EventBenchmarkPath result;
+		result.label = run.label;
+		result.listeners = Listeners;
+		result.delivered = static_cast<uint64_t>(events) * Listeners - dropped;
+		result.dropped = dropped;
+		result.raiseAllocations = (events != 0) ? static_cast<double>(raised) / events : 0.0;
+		result.deliveryAllocations = (result.delivered != 0) ? static_cast<double>(delivering) / result.delivered : 0.0;
+		std::sort(samples.begin(), samples.end());
+		result.latencies = std::move(samples);
+		results.push_back(std::move(result));
+	}
+
+	return results;
+}
@@ -0,0 +1,35 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/// What raising an event cost on one delivery path
+struct EventBenchmarkPath
+{
+	const wchar_t* label;
+	unsigned int listeners;
+	/// Heap allocations per raise on the raising thread, and per delivery on the listeners'
+	/// threads; both 0 where AllocationCounting is not available
+	double raiseAllocations;
+	double deliveryAllocations;
+	/// Nanoseconds of each raise, sorted
+	std::vector<uint32_t> latencies;
+	uint64_t delivered;
+	uint64_t dropped;
+};
+
+/// Raise events disconnects carrying a device ID to 4 listeners: as the bus did before event
+/// records (the caller's string, a shared ListenerEvent per event, a string per v1 call), then
+/// through the pooled records to v1 listeners, v2 listeners, and v2 listeners that copy the text
+std::vector<EventBenchmarkPath> RunEventBenchmark(unsigned int events);
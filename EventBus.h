@@ -0,0 +1,313 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "BoundedQueue.h"
+#include "SnapshotPublisher.h"
+
+/// What a subscriber's buffer does when it is full
+enum class OverflowPolicy
+{
+	/// Keep what is buffered, lose the new event
+	DropNewest,
+	/// Make room by losing the oldest buffered event
+	DropOldest
+};
+
+struct SubscriberOptions
+{
+	SubscriberOptions()
+		: capacity(256),
+		  overflow(OverflowPolicy::DropOldest)
+	{}
+
+	size_t capacity;
+	OverflowPolicy overflow;
+};
+
+struct SubscriberStats
+{
+	uint64_t id;
+	uint64_t delivered;
+	uint64_t dropped;
+	size_t buffered;
+};
+
+/// Publish/subscribe fan-out. Each subscriber gets a bounded ring buffer and a thread of its own
+/// that hands it events in publish order, so a slow subscriber only ever loses its own events and
+/// Publish never waits on one. The subscriber list is an immutable snapshot: Publish reads it
+/// without a lock, Subscribe and Unsubscribe replace it. Events are copied once per subscriber,
+/// use a cheap-to-copy type such as a shared_ptr.
+template <typename TEvent>
+class EventBus
+{
+public:
+	typedef std::function<void(const TEvent&)> Handler;
+
+	EventBus()
+		: _nextId(1)
+	{
+		_subscribers.Publish(std::unique_ptr<SubscriberList>(new SubscriberList()));
+	}
+
+	~EventBus()
+	{
+		// Join outside the lock, a handler may still subscribe or unsubscribe while its thread
+		// finishes; go round again for anything it subscribed
+		for (;;)
+		{
+			SubscriberList stopping;
+			{
+				std::lock_guard<std::mutex> lock(_subscribeLock);
+
+				stopping = *_subscribers.Read();
+				if (stopping.empty())
+				{
+					break;
+				}
+				_subscribers.Publish(std::unique_ptr<SubscriberList>(new SubscriberList()));
+			}
+
+			for (auto& subscriber : stopping)
+			{
+				subscriber->Stop();
+			}
+		}
+	}
+
+	/// Start delivering events published from now on to handler; returns the id to unsubscribe with
+	uint64_t Subscribe(Handler handler, const SubscriberOptions& options = SubscriberOptions())
+	{
+		std::lock_guard<std::mutex> lock(_subscribeLock);
+
+		std::shared_ptr<Subscriber> subscriber = std::make_shared<Subscriber>(_nextId++, std::move(handler), options);
+		subscriber->Start();
+
+		std::unique_ptr<SubscriberList> list(new SubscriberList(*_subscribers.Read()));
+		list->push_back(subscriber);
+		_subscribers.Publish(std::move(list));
+
+		return subscriber->id;
+	}
+
+	/// Stop delivering to a subscriber. Events already buffered are delivered first; once this
+	/// returns the handler is not called again. Called from the handler itself it returns at once
+	/// and the buffered events are delivered after the handler returns.
+	void Unsubscribe(uint64_t id)
+	{
+		std::shared_ptr<Subscriber> removed;
+		{
+			std::lock_guard<std::mutex> lock(_subscribeLock);
+
+			std::unique_ptr<SubscriberList> list(new SubscriberList());
+			auto current = _subscribers.Read();
+			for (auto& subscriber : *current)
+			{
+				if (subscriber->id == id)
+				{
+					removed = subscriber;
+				}
+				else
+				{
+					list->push_back(subscriber);
+				}
+			}
+
+			if (!removed)
+			{
+				return;
+			}
+
+			_subscribers.Publish(std::move(list));
+		}
+
+		removed->Stop();
+	}
+
+	void Publish(const TEvent& event)
+	{
+		auto list = _subscribers.Read();
+		for (auto& subscriber : *list)
+		{
+			subscriber->Push(event);
+		}
+	}
+
+	size_t GetSubscriberCount() const
+	{
+		return _subscribers.Read()->size();
+	}
+
+	std::vector<SubscriberStats> GetStats() const
+	{
+		std::vector<SubscriberStats> stats;
+
+		auto list = _subscribers.Read();
+		for (auto& subscriber : *list)
+		{
+			SubscriberStats entry;
+			entry.id = subscriber->id;
+			entry.delivered = subscriber->delivered.load(std::memory_order_relaxed);
+			entry.dropped = subscriber->dropped.load(std::memory_order_relaxed);
+			entry.buffered = subscriber->buffer.GetSize();
+			stats.push_back(entry);
+		}
+
+		return stats;
+	}
+
+private:
+	/// Its thread holds a reference until it exits, so a subscriber that stops itself from its
+	/// own handler outlives the Unsubscribe call that removed it
+	struct Subscriber : std::enable_shared_from_this<Subscriber>
+	{
+		Subscriber(uint64_t subscriberId, Handler eventHandler, const SubscriberOptions& options)
+			: id(subscriberId),
+			  handler(std::move(eventHandler)),
+			  overflow(options.overflow),
+			  buffer(options.capacity),
+			  delivered(0),
+			  dropped(0),
+			  sleeping(false),
+			  stopping(false)
+		{}
+
+		~Subscriber()
+		{
+			Stop();
+		}
+
+		void Start()
+		{
+			std::shared_ptr<Subscriber> self = this->shared_from_this();
+			thread = std::thread([self]() { self->Run(); });
+		}
+
+		void Push(const TEvent& event)
+		{
+			if (!buffer.TryPush(event))
+			{
+				dropped.fetch_add(1, std::memory_order_relaxed);
+
+				// Overwrite the oldest; a second failure means other producers refilled it, give up
+				TEvent oldest;
+				if (overflow == OverflowPolicy::DropNewest || !buffer.TryPop(oldest) || !buffer.TryPush(event))
+				{
+					return;
+				}
+			}
+
+			// Same handshake as EventLoop: either Run sees the event or we see it asleep. The queue
+			// itself uses weaker ordering, the fence keeps the push from moving past the check.
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (sleeping.load(std::memory_order_seq_cst))
+			{
+				{
+					std::lock_guard<std::mutex> lock(wakeLock);
+					sleeping.store(false, std::memory_order_seq_cst);
+				}
+				wake.notify_one();
+			}
+		}
+
+		void Stop()
+		{
+			if (!thread.joinable())
+			{
+				return;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(wakeLock);
+				stopping = true;
+				sleeping.store(false, std::memory_order_seq_cst);
+			}
+			wake.notify_one();
+
+			if (std::this_thread::get_id() == thread.get_id())
+			{
+				thread.detach();
+			}
+			else
+			{
+				thread.join();
+			}
+		}
+
+		void Run()
+		{
+			TEvent event;
+			for (;;)
+			{
+				while (buffer.TryPop(event))
+				{
+					handler(event);
+					event = TEvent();
+					delivered.fetch_add(1, std::memory_order_relaxed);
+				}
+
+				std::unique_lock<std::mutex> lock(wakeLock);
+				sleeping.store(true, std::memory_order_seq_cst);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+
+				if (buffer.GetSize() != 0)
+				{
+					// Pushed but not yet published by its producer, or pushed just now
+					sleeping.store(false, std::memory_order_seq_cst);
+					lock.unlock();
+					std::this_thread::yield();
+					continue;
+				}
+
+				if (stopping)
+				{
+					return;
+				}
+
+				wake.wait(lock, [this]() { return !sleeping.load(std::memory_order_seq_cst); });
+			}
+		}
+
+		const uint64_t id;
+		Handler handler;
+		const OverflowPolicy overflow;
+		BoundedQueue<TEvent> buffer;
+		std::atomic<uint64_t> delivered;
+		std::atomic<uint64_t> dropped;
+
+		std::thread thread;
+		std::mutex wakeLock;
+		std::condition_variable wake;
+		std::atomic<bool> sleeping;
+		bool stopping;
+	};
+
+	typedef std::vector<std::shared_ptr<Subscriber>> SubscriberList;
+
+	EventBus(const EventBus&) = delete;
+	EventBus& operator=(const EventBus&) = delete;
+
+	SnapshotPublisher<SubscriberList> _subscribers;
+	/// Serializes changes to the subscriber list
+	std::mutex _subscribeLock;
+	uint64_t _nextId;
+};
@@ -0,0 +1,473 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include "EventLog.h"
+
+#include <cstdio>
+
+static std::atomic<uint64_t> s_nextLogId(1);
+
+/// Append value formatted by conversion, a single printf conversion
+template <typename T>
+static void AppendFormatted(std::string& line, const char* conversion, T value)
+{
+	char buffer[128];
+	int length = snprintf(buffer, sizeof(buffer), conversion, value);
+	if (length < 0)
+	{
+		return;
+	}
+
+	if (static_cast<size_t>(length) < sizeof(buffer))
+	{
+		line.append(buffer, length);
+		return;
+	}
+
+	size_t at = line.size();
+	line.resize(at + length + 1);
+	snprintf(&line[at], length + 1, conversion, value);
+	line.resize(at + length);
+}
+
+static void AppendUtf8(std::string& text, uint32_t codePoint)
+{
+	if (codePoint < 0x80)
+	{
+		text += static_cast<char>(codePoint);
+	}
+	else if (codePoint < 0x800)
+	{
+		text += static_cast<char>(0xC0 | (codePoint >> 6));
+		text += static_cast<char>(0x80 | (codePoint & 0x3F));
+	}
+	else if (codePoint < 0x10000)
+	{
+		text += static_cast<char>(0xE0 | (codePoint >> 12));
+		text += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+		text += static_cast<char>(0x80 | (codePoint & 0x3F));
+	}
+	else
+	{
+		text += static_cast<char>(0xF0 | (codePoint >> 18));
+		text += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+		text += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+		text += static_cast<char>(0x80 | (codePoint & 0x3F));
+	}
+}
+
+/// Recorded wide characters (unaligned) as UTF-8; unpaired surrogates become U+FFFD
+static void AppendWide(std::string& text, const unsigned char* characters, uint32_t length)
+{
+	for (uint32_t i = 0; i < length; i++)
+	{
+		wchar_t unit;
+		memcpy(&unit, characters + i * sizeof(wchar_t), sizeof(unit));
+		uint32_t codePoint = static_cast<uint32_t>(unit);
+
+		if (sizeof(wchar_t) == 2 && codePoint >= 0xD800 && codePoint <= 0xDFFF)
+		{
+			wchar_t low = 0;
+			if (codePoint < 0xDC00 && i + 1 < length)
+			{
+				memcpy(&low, characters + (i + 1) * sizeof(wchar_t), sizeof(low));
+			}
+
+			if (low >= 0xDC00 && low <= 0xDFFF)
+			{
+				codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (static_cast<uint32_t>(low) - 0xDC00);
+				i++;
+			}
+			else
+			{
+				codePoint = 0xFFFD;
+			}
+		}
+		else if (codePoint > 0x10FFFF)
+		{
+			codePoint = 0xFFFD;
+		}
+
+		AppendUtf8(text, codePoint);
+	}
+}
+
+EventLog::EventLog()
+	: _id(s_nextLogId.fetch_add(1)),
+	  _created(Clock::now()),
+	  _retiredDropped(0),
+	  _running(false),
+	  _stopping(false),
+	  _flushRequested(0),
+	  _flushed(0),
+	  _written(0),
+	  _oversized(0)
+{
+}
+
+EventLog::~EventLog()
+{
+	Stop();
+}
+
+EventLog& EventLog::Instance()
+{
+	static EventLog* log = new EventLog();
+	return *log;
+}
+
+void EventLog::Start(Sink sink, std::chrono::milliseconds interval)
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	if (_running)
+	{
+		return;
+	}
+
+	_sink = std::move(sink);
+	_running = true;
+	_stopping = false;
+	_thread = std::thread([this, interval]() { Run(interval); });
+}
+
+void EventLog::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		if (!_running || _stopping)
+		{
+			return;
+		}
+		_stopping = true;
+	}
+	_changed.notify_all();
+
+	// Run formats what is left before it returns
+	_thread.join();
+
+	std::lock_guard<std::mutex> lock(_lock);
+	_running = false;
+}
+
+void EventLog::Flush()
+{
+	std::unique_lock<std::mutex> lock(_lock);
+	if (!_running || _stopping)
+	{
+		return;
+	}
+
+	uint64_t ticket = ++_flushRequested;
+	_changed.notify_all();
+	_changed.wait(lock, [this, ticket]() { return _flushed >= ticket || !_running; });
+}
+
+LogStats EventLog::GetStats()
+{
+	LogStats stats;
+	stats.written = _written.load(std::memory_order_relaxed);
+	stats.dropped = _oversized.load(std::memory_order_relaxed);
+
+	std::lock_guard<std::mutex> lock(_lock);
+	stats.dropped += _retiredDropped;
+	for (auto& ring : _rings)
+	{
+		stats.dropped += ring->GetDropped();
+		stats.threads += ring->IsAbandoned() ? 0 : 1;
+	}
+	return stats;
+}
+
+void EventLog::Register(ThreadRing& cached)
+{
+	// The ring the thread had in another log goes as if the thread had exited
+	if (cached.ring)
+	{
+		cached.ring->Abandon();
+	}
+
+	std::shared_ptr<LogRing> ring = std::make_shared<LogRing>();
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		_rings.push_back(ring);
+	}
+
+	cached.log = _id;
+	cached.ring = std::move(ring);
+}
+
+void EventLog::Run(std::chrono::milliseconds interval)
+{
+	std::unique_lock<std::mutex> lock(_lock);
+	for (;;)
+	{
+		bool stopping = _stopping;
+		uint64_t flush = _flushRequested;
+		lock.unlock();
+
+		bool drained = Drain();
+
+		lock.lock();
+		_flushed = flush;
+		_changed.notify_all();
+
+		if (stopping)
+		{
+			break;
+		}
+
+		// Under load go straight on to the records that came in meanwhile
+		if (!drained)
+		{
+			_changed.wait_for(lock, interval, [this, flush]() { return _stopping || _flushRequested != flush; });
+		}
+	}
+}
+
+bool EventLog::Drain()
+{
+	std::vector<std::shared_ptr<LogRing>> rings;
+	std::vector<size_t> heads;
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		for (auto it = _rings.begin(); it != _rings.end(); )
+		{
+			LogRing& ring = **it;
+			// Abandoned first: its thread wrote nothing after that
+			bool abandoned = ring.IsAbandoned();
+			size_t head = ring.GetHead();
+			if (abandoned && ring.Peek(head) == nullptr)
+			{
+				_retiredDropped += ring.GetDropped();
+				it = _rings.erase(it);
+				continue;
+			}
+
+			rings.push_back(*it);
+			heads.push_back(head);
+			++it;
+		}
+	}
+
+	// Merge the rings by timestamp; each is in order already
+	std::vector<const LogRecordHeader*> next(rings.size());
+	for (size_t i = 0; i < rings.size(); i++)
+	{
+		next[i] = rings[i]->Peek(heads[i]);
+	}
+
+	bool drained = false;
+	for (;;)
+	{
+		size_t oldest = rings.size();
+		for (size_t i = 0; i < rings.size(); i++)
+		{
+			if (next[i] != nullptr && (oldest == rings.size() || next[i]->timestamp < next[oldest]->timestamp))
+			{
+				oldest = i;
+			}
+		}
+
+		if (oldest == rings.size())
+		{
+			break;
+		}
+
+		const LogRecordHeader* record = next[oldest];
+		Format(*record, _line);
+		_sink(record->site->level, _line.c_str(), _line.length());
+		_written.fetch_add(1, std::memory_order_relaxed);
+
+		rings[oldest]->Pop(record);
+		next[oldest] = rings[oldest]->Peek(heads[oldest]);
+		drained = true;
+	}
+
+	return drained;
+}
+
+void EventLog::Format(const LogRecordHeader& record, std::string& line)
+{
+	static const char levels[] = "TIWE";
+
+	line.clear();
+	double seconds = std::chrono::duration<double>(Clock::duration(record.timestamp) - _created.time_since_epoch()).count();
+	char prefix[48];
+	int length = snprintf(prefix, sizeof(prefix), "%10.6f %c ", seconds, levels[static_cast<size_t>(record.site->level) & 3]);
+	line.append(prefix, (length > 0) ? length : 0);
+
+	const unsigned char* cursor = reinterpret_cast<const unsigned char*>(&record + 1);
+	uint32_t remaining = record.arguments;
+	std::string text;
+
+	const char* format = record.site->format;
+	while (*format != '\0')
+	{
+		if (*format != '%')
+		{
+			const char* literal = format;
+			while (*format != '\0' && *format != '%')
+			{
+				format++;
+			}
+			line.append(literal, format - literal);
+			continue;
+		}
+
+		if (format[1] == '%')
+		{
+			line += '%';
+			format += 2;
+			continue;
+		}
+
+		// Keep flags, width and precision; the length modifier comes from the recorded argument
+		const char* spec = format++;
+		char conversion[32] = "%";
+		size_t used = 1;
+		while (*format != '\0' && strchr("-+ #0123456789.", *format) != nullptr && used < 24)
+		{
+			conversion[used++] = *format++;
+		}
+		while (*format != '\0' && strchr("hlLjztqwI", *format) != nullptr)
+		{
+			if (*format++ == 'I')
+			{
+				// I32, I64
+				while (*format >= '0' && *format <= '9')
+				{
+					format++;
+				}
+			}
+		}
+
+		char type = *format;
+		if (type != '\0')
+		{
+			format++;
+		}
+
+		// An argument short: show the conversion itself
+		if (type == '\0' || remaining == 0)
+		{
+			line.append(spec, format - spec);
+			continue;
+		}
+
+		remaining--;
+		LogArgumentKind kind = static_cast<LogArgumentKind>(*cursor++);
+		bool integer = (strchr("diouxXc", type) != nullptr);
+		bool real = (strchr("fFeEgGaA", type) != nullptr);
+
+		switch (kind)
+		{
+		case LogArgumentKind::Int32:
+		case LogArgumentKind::UInt32:
+		{
+			uint32_t value;
+			memcpy(&value, cursor, sizeof(value));
+			cursor += sizeof(value);
+
+			conversion[used++] = integer ? type : ((kind == LogArgumentKind::Int32) ? 'd' : 'u');
+			conversion[used] = '\0';
+			if (kind == LogArgumentKind::Int32)
+			{
+				AppendFormatted(line, conversion, static_cast<int>(static_cast<int32_t>(value)));
+			}
+			else
+			{
+				AppendFormatted(line, conversion, static_cast<unsigned int>(value));
+			}
+			break;
+		}
+		case LogArgumentKind::Int64:
+		case LogArgumentKind::UInt64:
+		case LogArgumentKind::Pointer:
+		{
+			uint64_t value;
+			memcpy(&value, cursor, sizeof(value));
+			cursor += sizeof(value);
+
+			if (kind == LogArgumentKind::Pointer && !integer)
+			{
+				conversion[used++] = 'p';
+				conversion[used] = '\0';
+				AppendFormatted(line, conversion, reinterpret_cast<void*>(static_cast<uintptr_t>(value)));
+				break;
+			}
+
+			conversion[used++] = 'l';
+			conversion[used++] = 'l';
+			conversion[used++] = integer ? type : ((kind == LogArgumentKind::Int64) ? 'd' : 'u');
+			conversion[used] = '\0';
+			if (kind == LogArgumentKind::Int64)
+			{
+				AppendFormatted(line, conversion, static_cast<long long>(value));
+			}
+			else
+			{
+				AppendFormatted(line, conversion, static_cast<unsigned long long>(value));
+			}
+			break;
+		}
+		case LogArgumentKind::Double:
+		{
+			double value;
+			memcpy(&value, cursor, sizeof(value));
+			cursor += sizeof(value);
+
+			conversion[used++] = real ? type : 'g';
+			conversion[used] = '\0';
+			AppendFormatted(line, conversion, value);
+			break;
+		}
+		case LogArgumentKind::String:
+		case LogArgumentKind::WideString:
+		{
+			uint32_t characters;
+			memcpy(&characters, cursor, sizeof(characters));
+			cursor += sizeof(characters);
+
+			text.clear();
+			if (kind == LogArgumentKind::String)
+			{
+				text.assign(reinterpret_cast<const char*>(cursor), characters);
+				cursor += characters;
+			}
+			else
+			{
+				AppendWide(text, cursor, characters);
+				cursor += characters * sizeof(wchar_t);
+			}
+
+			if (used == 1)
+			{
+				line += text;
+			}
+			else
+			{
+				conversion[used++] = 's';
+				conversion[used] = '\0';
+				AppendFormatted(line, conversion, text.c_str());
+			}
+			break;
+		}
+		default:
+			// Not a record this build wrote; show the rest of the format as is
+			remaining = 0;
+			line.append(spec, format - spec);
+			break;
+		}
+	}
+
+	line += '\n';
+}
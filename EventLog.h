@@ -0,0 +1,551 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+enum class LogLevel : uint8_t
+{
+	Trace,
+	Info,
+	Warning,
+	Error
+};
+
+/// Lowest level that is compiled in; statements below it compile to nothing and their arguments
+/// are not evaluated. Define it in the project to change it.
+#ifndef WFD_LOG_LEVEL
+#ifdef _DEBUG
+#define WFD_LOG_LEVEL 0
+#else
+#define WFD_LOG_LEVEL 1
+#endif
+#endif
+
+/// One logging statement. Its address is the format ID of the records it writes.
+struct LogSite
+{
+	LogLevel level;
+	/// printf style; the formatter picks length modifiers from the recorded arguments, so "%d"
+	/// prints an int64_t and "%s" a wide string. No trailing newline.
+	const char* format;
+	const char* file;
+	int line;
+};
+
+/// Log a statement at level with the given arguments: integers, enums, floating point, pointers and
+/// narrow or wide strings (C strings, std::string, std::wstring, std::wstring_view). Strings are copied, up to
+/// EventLog::MaxStringLength characters.
+#define WFD_LOG(level, format, ...) \
+	do \
+	{ \
+		static const LogSite logSite = { level, format, __FILE__, __LINE__ }; \
+		EventLog::Instance().Write(logSite, ##__VA_ARGS__); \
+	} while (0)
+
+#if WFD_LOG_LEVEL <= 0
+#define WFD_LOG_TRACE(format, ...) WFD_LOG(LogLevel::Trace, format, ##__VA_ARGS__)
+#else
+#define WFD_LOG_TRACE(format, ...) ((void)0)
+#endif
+
+#if WFD_LOG_LEVEL <= 1
+#define WFD_LOG_INFO(format, ...) WFD_LOG(LogLevel::Info, format, ##__VA_ARGS__)
+#else
+#define WFD_LOG_INFO(format, ...) ((void)0)
+#endif
+
+#if WFD_LOG_LEVEL <= 2
+#define WFD_LOG_WARNING(format, ...) WFD_LOG(LogLevel::Warning, format, ##__VA_ARGS__)
+#else
+#define WFD_LOG_WARNING(format, ...) ((void)0)
+#endif
+
+#define WFD_LOG_ERROR(format, ...) WFD_LOG(LogLevel::Error, format, ##__VA_ARGS__)
+
+/// Type of one recorded argument; a byte of it precedes the argument's value in a record
+enum class LogArgumentKind : uint8_t
+{
+	Int32,
+	UInt32,
+	Int64,
+	UInt64,
+	Double,
+	Pointer,
+	/// uint32_t length, then that many chars
+	String,
+	/// uint32_t length, then that many wchar_t
+	WideString
+};
+
+/// Fixed part of a record; the arguments follow it
+struct LogRecordHeader
+{
+	/// Of the whole record, a multiple of 8
+	uint32_t size;
+	/// Set on the filler that skips the end of the ring when a record does not fit there
+	uint16_t filler;
+	uint16_t arguments;
+	/// steady_clock ticks
+	int64_t timestamp;
+	const LogSite* site;
+};
+
+/// Bytes of records from one thread to the formatter thread. Single producer, single consumer:
+/// each side owns one counter and reads the other's, so neither ever waits. A record that does
+/// not fit is dropped and counted instead of blocking the thread that logs.
+class LogRing
+{
+public:
+	static const size_t Capacity = 64 * 1024;
+
+	LogRing()
+		: _data(new uint64_t[Capacity / sizeof(uint64_t)]),
+		  _head(0),
+		  _reserved(0),
+		  _cachedTail(0),
+		  _tail(0),
+		  _abandoned(false),
+		  _dropped(0)
+	{}
+
+	/// Room for a record of size bytes (a multiple of 8), or nullptr if the ring is full. Commit
+	/// hands it to the consumer.
+	unsigned char* Reserve(size_t size)
+	{
+		size_t head = _head.load(std::memory_order_relaxed);
+		size_t offset = head & (Capacity - 1);
+		size_t contiguous = Capacity - offset;
+		size_t needed = (size <= contiguous) ? size : contiguous + size;
+
+		if (head + needed - _cachedTail > Capacity)
+		{
+			_cachedTail = _tail.load(std::memory_order_acquire);
+			if (head + needed - _cachedTail > Capacity)
+			{
+				_dropped.fetch_add(1, std::memory_order_relaxed);
+				return nullptr;
+			}
+		}
+
+		if (size > contiguous)
+		{
+			// Records stay contiguous: fill the rest of the ring and start over at its beginning
+			LogRecordHeader* filler = reinterpret_cast<LogRecordHeader*>(Bytes() + offset);
+			filler->size = static_cast<uint32_t>(contiguous);
+			filler->filler = 1;
+			head += contiguous;
+			offset = 0;
+		}
+
+		_reserved = head + size;
+		return Bytes() + offset;
+	}
+
+	void Commit()
+	{
+		_head.store(_reserved, std::memory_order_release);
+	}
+
+	/// Consumer: where the records committed so far end
+	size_t GetHead() const
+	{
+		return _head.load(std::memory_order_acquire);
+	}
+
+	/// Consumer: the oldest record before head (from GetHead), or nullptr if there is none
+	const LogRecordHeader* Peek(size_t head)
+	{
+		size_t tail = _tail.load(std::memory_order_relaxed);
+		while (tail != head)
+		{
+			const LogRecordHeader* record = reinterpret_cast<const LogRecordHeader*>(Bytes() + (tail & (Capacity - 1)));
+			if (!record->filler)
+			{
+				return record;
+			}
+			tail += record->size;
+			_tail.store(tail, std::memory_order_release);
+		}
+		return nullptr;
+	}
+
+	/// Consumer: done with the record Peek returned
+	void Pop(const LogRecordHeader* record)
+	{
+		_tail.store(_tail.load(std::memory_order_relaxed) + record->size, std::memory_order_release);
+	}
+
+	/// Its thread exited; freed once drained
+	void Abandon()
+	{
+		_abandoned.store(true, std::memory_order_release);
+	}
+
+	bool IsAbandoned() const
+	{
+		return _abandoned.load(std::memory_order_acquire);
+	}
+
+	uint64_t GetDropped() const
+	{
+		return _dropped.load(std::memory_order_relaxed);
+	}
+
+private:
+	LogRing(const LogRing&) = delete;
+	LogRing& operator=(const LogRing&) = delete;
+
+	unsigned char* Bytes()
+	{
+		return reinterpret_cast<unsigned char*>(_data.get());
+	}
+
+	/// uint64_t keeps every record header 8 byte aligned
+	std::unique_ptr<uint64_t[]> _data;
+
+	// Producer side
+	alignas(64) std::atomic<size_t> _head;
+	size_t _reserved;
+	/// Last tail seen, so the producer reads the consumer's counter only when the ring looks full
+	size_t _cachedTail;
+
+	// Consumer side
+	alignas(64) std::atomic<size_t> _tail;
+
+	std::atomic<bool> _abandoned;
+	std::atomic<uint64_t> _dropped;
+};
+
+struct LogStats
+{
+	LogStats()
+		: written(0),
+		  dropped(0),
+		  threads(0)
+	{}
+
+	/// Records formatted and handed to the sink
+	uint64_t written;
+	/// Records lost to a full ring or an oversized record
+	uint64_t dropped;
+	/// Threads with a ring right now
+	size_t threads;
+};
+
+/// Structured logger. The thread that logs copies a compact binary record (timestamp, LogSite,
+/// raw arguments) into a ring of its own, which takes no lock and, once the thread has its ring,
+/// allocates nothing. A background thread formats the records in timestamp order and hands each
+/// line to a sink. Records written before Start wait in their ring until it is called.
+class EventLog
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+	/// Gets a formatted line, newline included, on the formatter thread
+	typedef std::function<void(LogLevel level, const char* line, size_t length)> Sink;
+
+	static const size_t MaxStringLength = 512;
+	/// Larger records are dropped
+	static const size_t MaxRecordSize = LogRing::Capacity / 4;
+
+	EventLog();
+	/// Stops, formatting what is left
+	~EventLog();
+
+	/// The log WFD_LOG writes to; never destroyed, so threads may log until the process exits
+	static EventLog& Instance();
+
+	/// Start the formatter thread, polling the rings every interval
+	void Start(Sink sink, std::chrono::milliseconds interval = std::chrono::milliseconds(20));
+	/// Format what is in the rings and stop the formatter thread
+	void Stop();
+	/// Wait until what this thread logged so far has reached the sink; returns at once if stopped
+	void Flush();
+
+	LogStats GetStats();
+
+	template <typename... TArgs>
+	void Write(const LogSite& site, const TArgs&... args)
+	{
+		size_t size = (sizeof(LogRecordHeader) + ... + ArgumentSize(args));
+		size = (size + 7) & ~static_cast<size_t>(7);
+		if (size > MaxRecordSize)
+		{
+			_oversized.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		LogRing* ring = GetRing();
+		unsigned char* record = ring->Reserve(size);
+		if (record == nullptr)
+		{
+			return;
+		}
+
+		LogRecordHeader* header = reinterpret_cast<LogRecordHeader*>(record);
+		header->size = static_cast<uint32_t>(size);
+		header->filler = 0;
+		header->arguments = static_cast<uint16_t>(sizeof...(TArgs));
+		header->timestamp = Clock::now().time_since_epoch().count();
+		header->site = &site;
+
+		unsigned char* cursor = record + sizeof(LogRecordHeader);
+		((cursor = Encode(cursor, args)), ...);
+		(void)cursor;
+
+		ring->Commit();
+	}
+
+private:
+	EventLog(const EventLog&) = delete;
+	EventLog& operator=(const EventLog&) = delete;
+
+	/// The ring of the calling thread, registered on its first record
+	LogRing* GetRing()
+	{
+		ThreadRing& cached = t_ring;
+		if (cached.log != _id)
+		{
+			Register(cached);
+		}
+		return cached.ring.get();
+	}
+
+	/// A thread's ring in the log it last wrote to; abandoned when the thread exits
+	struct ThreadRing
+	{
+		ThreadRing()
+			: log(0)
+		{}
+
+		~ThreadRing()
+		{
+			if (ring)
+			{
+				ring->Abandon();
+			}
+		}
+
+		uint64_t log;
+		std::shared_ptr<LogRing> ring;
+	};
+
+	inline static thread_local ThreadRing t_ring;
+
+	void Register(ThreadRing& cached);
+	void Run(std::chrono::milliseconds interval);
+	/// Format the records committed to the rings so far; false if there was none
+	bool Drain();
+	void Format(const LogRecordHeader& record, std::string& line);
+
+	template <typename T>
+	static LogArgumentKind KindOf()
+	{
+		if (std::is_floating_point<T>::value)
+		{
+			return LogArgumentKind::Double;
+		}
+		if (std::is_pointer<T>::value)
+		{
+			return LogArgumentKind::Pointer;
+		}
+		if (sizeof(T) <= 4)
+		{
+			return std::is_signed<T>::value ? LogArgumentKind::Int32 : LogArgumentKind::UInt32;
+		}
+		return std::is_signed<T>::value ? LogArgumentKind::Int64 : LogArgumentKind::UInt64;
+	}
+
+	template <typename T>
+	static size_t ArgumentSize(const T& value)
+	{
+		static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value,
+			"log numbers, pointers and strings");
+		(void)value;
+		return 1 + ((std::is_floating_point<T>::value || std::is_pointer<T>::value || sizeof(T) > 4) ? 8 : 4);
+	}
+
+	static size_t StringSize(size_t length, size_t unit)
+	{
+		return 1 + sizeof(uint32_t) + unit * ((length < MaxStringLength) ? length : MaxStringLength);
+	}
+
+	static size_t ArgumentSize(const char* value)
+	{
+		return StringSize((value != nullptr) ? strlen(value) : 0, sizeof(char));
+	}
+
+	static size_t ArgumentSize(char* value)
+	{
+		return ArgumentSize(static_cast<const char*>(value));
+	}
+
+	static size_t ArgumentSize(const wchar_t* value)
+	{
+		return StringSize((value != nullptr) ? wcslen(value) : 0, sizeof(wchar_t));
+	}
+
+	static size_t ArgumentSize(wchar_t* value)
+	{
+		return ArgumentSize(static_cast<const wchar_t*>(value));
+	}
+
+	static size_t ArgumentSize(const std::string& value)
+	{
+		return StringSize(value.length(), sizeof(char));
+	}
+
+	static size_t ArgumentSize(const std::wstring& value)
+	{
+		return StringSize(value.length(), sizeof(wchar_t));
+	}
+
+	static size_t ArgumentSize(std::wstring_view value)
+	{
+		return StringSize(value.length(), sizeof(wchar_t));
+	}
+
+	template <typename T>
+	static unsigned char* Encode(unsigned char* cursor, const T& value)
+	{
+		LogArgumentKind kind = KindOf<typename std::conditional<std::is_enum<T>::value, uint32_t, T>::type>();
+		*cursor++ = static_cast<unsigned char>(kind);
+
+		switch (kind)
+		{
+		case LogArgumentKind::Int32:
+		case LogArgumentKind::UInt32:
+		{
+			uint32_t bits = static_cast<uint32_t>(Widen(value));
+			memcpy(cursor, &bits, sizeof(bits));
+			return cursor + sizeof(bits);
+		}
+		case LogArgumentKind::Double:
+		{
+			double bits = static_cast<double>(Widen(value));
+			memcpy(cursor, &bits, sizeof(bits));
+			return cursor + sizeof(bits);
+		}
+		default:
+		{
+			uint64_t bits = static_cast<uint64_t>(Widen(value));
+			memcpy(cursor, &bits, sizeof(bits));
+			return cursor + sizeof(bits);
+		}
+		}
+	}
+
+	static unsigned char* EncodeString(unsigned char* cursor, LogArgumentKind kind, const void* value, size_t length, size_t unit)
+	{
+		uint32_t stored = static_cast<uint32_t>((length < MaxStringLength) ? length : MaxStringLength);
+		*cursor++ = static_cast<unsigned char>(kind);
+		memcpy(cursor, &stored, sizeof(stored));
+		cursor += sizeof(stored);
+		if (stored != 0)
+		{
+			memcpy(cursor, value, stored * unit);
+		}
+		return cursor + stored * unit;
+	}
+
+	static unsigned char* Encode(unsigned char* cursor, const char* value)
+	{
+		return EncodeString(cursor, LogArgumentKind::String, value, (value != nullptr) ? strlen(value) : 0, sizeof(char));
+	}
+
+	static unsigned char* Encode(unsigned char* cursor, char* value)
+	{
+		return Encode(cursor, static_cast<const char*>(value));
+	}
+
+	static unsigned char* Encode(unsigned char* cursor, const wchar_t* value)
+	{
+		return EncodeString(cursor, LogArgumentKind::WideString, value, (value != nullptr) ? wcslen(value) : 0, sizeof(wchar_t));
+	}
+
+	static unsigned char* Encode(unsigned char* cursor, wchar_t* value)
+	{
+		return Encode(cursor, static_cast<const wchar_t*>(value));
+	}
+
+	static unsigned char* Encode(unsigned char* cursor, const std::string& value)
+	{
+		return EncodeString(cursor, LogArgumentKind::String, value.data(), value.length(), sizeof(char));
+	}
+
+	static unsigned char* Encode(unsigned char* cursor, const std::wstring& value)
+	{
+		return EncodeString(cursor, LogArgumentKind::WideString, value.data(), value.length(), sizeof(wchar_t));
+	}
+
+	static unsigned char* Encode(unsigned char* cursor, std::wstring_view value)
+	{
+		return EncodeString(cursor, LogArgumentKind::WideString, value.data(), value.length(), sizeof(wchar_t));
+	}
+
+	/// Arithmetic value of an argument, whatever its type
+	template <typename T>
+	static typename std::enable_if<std::is_arithmetic<T>::value, T>::type Widen(const T& value)
+	{
+		return value;
+	}
+
+	template <typename T>
+	static typename std::enable_if<std::is_enum<T>::value, uint32_t>::type Widen(const T& value)
+	{
+		return static_cast<uint32_t>(value);
+	}
+
+	template <typename T>
+	static typename std::enable_if<std::is_pointer<T>::value, uintptr_t>::type Widen(const T& value)
+	{
+		return reinterpret_cast<uintptr_t>(value);
+	}
+
+	/// Tells this log from others in ThreadRing, which outlives the log it points into
+	const uint64_t _id;
+	const Clock::time_point _created;
+
+	std::mutex _lock;
+	std::condition_variable _changed;
+	/// Every thread's ring; the formatter thread frees the ones abandoned and drained
+	std::vector<std::shared_ptr<LogRing>> _rings;
+	/// Dropped by rings already freed
+	uint64_t _retiredDropped;
+	Sink _sink;
+	std::thread _thread;
+	bool _running;
+	bool _stopping;
+	/// Flush asks for a pass with _flushRequested; the formatter thread reports it in _flushed
+	uint64_t _flushRequested;
+	uint64_t _flushed;
+
+	std::atomic<uint64_t> _written;
+	std::atomic<uint64_t> _oversized;
+
+	/// Reused by the formatter thread
+	std::string _line;
+};
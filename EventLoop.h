@@ -0,0 +1,194 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+
+#include "MpscQueue.h"
+
+/// One thread that owns some state and runs the messages posted to it, in order, one at a time.
+/// Posting never blocks on the owning thread; the lock below is only taken to wake it from sleep.
+/// Messages are drained in batches and the batch handler runs after each, so work that can be
+/// coalesced (e.g. publishing changes) happens once per burst. Messages must not throw.
+class EventLoop
+{
+public:
+	typedef std::function<void()> Message;
+
+	EventLoop()
+		: _sleeping(false),
+		  _stopping(false),
+		  _posted(0),
+		  _processed(0),
+		  _batches(0)
+	{}
+
+	~EventLoop()
+	{
+		Stop();
+	}
+
+	/// Start the owning thread; batchDone, if set, runs on it after each drained batch
+	void Start(std::function<void()> batchDone = nullptr)
+	{
+		_batchDone = std::move(batchDone);
+		_stopping = false;
+		_thread = std::thread([this]() { Run(); });
+	}
+
+	/// Run what was already posted, then end the owning thread. Messages posted afterwards are dropped.
+	void Stop()
+	{
+		if (!_thread.joinable())
+		{
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(_wakeLock);
+			_stopping = true;
+			_sleeping.store(false, std::memory_order_seq_cst);
+		}
+		_wake.notify_one();
+
+		if (IsOwningThread())
+		{
+			_thread.detach();
+		}
+		else
+		{
+			_thread.join();
+		}
+	}
+
+	void Post(Message message)
+	{
+		_queue.Push(std::move(message));
+		_posted.fetch_add(1, std::memory_order_relaxed);
+
+		// Pairs with the sleeping check in Run: either the loop sees the message or we see it asleep
+		if (_sleeping.load(std::memory_order_seq_cst))
+		{
+			{
+				std::lock_guard<std::mutex> lock(_wakeLock);
+				_sleeping.store(false, std::memory_order_seq_cst);
+			}
+			_wake.notify_one();
+		}
+	}
+
+	/// Wait until everything posted so far has run; returns at once on the owning thread
+	void Flush()
+	{
+		if (!_thread.joinable() || IsOwningThread())
+		{
+			return;
+		}
+
+		std::promise<void> done;
+		std::future<void> flushed = done.get_future();
+		Post([&done]() { done.set_value(); });
+		flushed.wait();
+	}
+
+	bool IsOwningThread() const
+	{
+		return std::this_thread::get_id() == _thread.get_id();
+	}
+
+	uint64_t GetPostedCount() const
+	{
+		return _posted.load(std::memory_order_relaxed);
+	}
+
+	uint64_t GetProcessedCount() const
+	{
+		return _processed.load(std::memory_order_relaxed);
+	}
+
+	uint64_t GetBatchCount() const
+	{
+		return _batches.load(std::memory_order_relaxed);
+	}
+
+private:
+	/// Bounds how long the batch handler can be held off by a steady stream of messages
+	static const size_t MaxBatch = 64;
+
+	void Run()
+	{
+		Message message;
+		for (;;)
+		{
+			size_t count = 0;
+			while (count < MaxBatch && _queue.TryPop(message))
+			{
+				message();
+				message = nullptr;
+				count++;
+			}
+
+			if (count != 0)
+			{
+				_processed.fetch_add(count, std::memory_order_relaxed);
+				_batches.fetch_add(1, std::memory_order_relaxed);
+				if (_batchDone)
+				{
+					_batchDone();
+				}
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(_wakeLock);
+			_sleeping.store(true, std::memory_order_seq_cst);
+
+			if (!_queue.IsEmpty())
+			{
+				// A producer is mid-push, its message is about to become visible
+				_sleeping.store(false, std::memory_order_seq_cst);
+				lock.unlock();
+				std::this_thread::yield();
+				continue;
+			}
+
+			if (_stopping)
+			{
+				_sleeping.store(false, std::memory_order_seq_cst);
+				return;
+			}
+
+			_wake.wait(lock, [this]() { return !_sleeping.load(std::memory_order_seq_cst); });
+		}
+	}
+
+	EventLoop(const EventLoop&) = delete;
+	EventLoop& operator=(const EventLoop&) = delete;
+
+	MpscQueue<Message> _queue;
+	std::function<void()> _batchDone;
+	std::thread _thread;
+
+	std::mutex _wakeLock;
+	std::condition_variable _wake;
+	std::atomic<bool> _sleeping;
+	bool _stopping;
+
+	std::atomic<uint64_t> _posted;
+	std::atomic<uint64_t> _processed;
+	std::atomic<uint64_t> _batches;
+};
@@ -0,0 +1,165 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+
+struct FramePoolStats
+{
+	/// Blocks handed out from the pool, and ones that had to come from the general allocator
+	uint64_t reused;
+	uint64_t allocated;
+	/// Blocks given back to the general allocator because their size class was full or too big
+	uint64_t freed;
+	/// Blocks waiting in the pool
+	uint64_t cached;
+};
+
+/// Recycles the short-lived blocks of the async flows (coroutine frames and completion handlers),
+/// so once the pool has warmed up a connect or pair allocates nothing from the general allocator.
+/// Blocks are kept on a free list per 64-byte size class; a block may be released on another thread
+/// than the one that allocated it. Blocks above MaxBlockSize bypass the pool. Thread-safe.
+class FramePool
+{
+public:
+	static const size_t Granularity = 64;
+	static const size_t MaxBlockSize = 4096;
+	/// Blocks kept per size class; a burst beyond this goes back to the allocator when it ends
+	static const size_t MaxCachedPerClass = 256;
+
+	FramePool()
+		: _reused(0),
+		  _allocated(0),
+		  _freed(0)
+	{
+		for (auto& sizeClass : _classes)
+		{
+			sizeClass.head = nullptr;
+			sizeClass.cached = 0;
+		}
+	}
+
+	~FramePool()
+	{
+		for (auto& sizeClass : _classes)
+		{
+			while (sizeClass.head != nullptr)
+			{
+				FreeBlock* block = sizeClass.head;
+				sizeClass.head = block->next;
+				::operator delete(block);
+			}
+		}
+	}
+
+	/// The pool the coroutine promises and completion handlers allocate from
+	static FramePool& Get()
+	{
+		static FramePool pool;
+		return pool;
+	}
+
+	/// Throws std::bad_alloc like operator new
+	void* Allocate(size_t size)
+	{
+		if (size == 0 || size > MaxBlockSize)
+		{
+			_allocated.fetch_add(1, std::memory_order_relaxed);
+			return ::operator new(size);
+		}
+
+		size_t index = (size - 1) / Granularity;
+		SizeClass& sizeClass = _classes[index];
+		{
+			std::lock_guard<std::mutex> lock(sizeClass.lock);
+			FreeBlock* block = sizeClass.head;
+			if (block != nullptr)
+			{
+				sizeClass.head = block->next;
+				sizeClass.cached--;
+				_reused.fetch_add(1, std::memory_order_relaxed);
+				return block;
+			}
+		}
+
+		_allocated.fetch_add(1, std::memory_order_relaxed);
+		return ::operator new((index + 1) * Granularity);
+	}
+
+	/// size must be the one the block was allocated with
+	void Release(void* block, size_t size)
+	{
+		if (block == nullptr)
+		{
+			return;
+		}
+
+		if (size != 0 && size <= MaxBlockSize)
+		{
+			SizeClass& sizeClass = _classes[(size - 1) / Granularity];
+
+			std::lock_guard<std::mutex> lock(sizeClass.lock);
+			if (sizeClass.cached < MaxCachedPerClass)
+			{
+				FreeBlock* freeBlock = static_cast<FreeBlock*>(block);
+				freeBlock->next = sizeClass.head;
+				sizeClass.head = freeBlock;
+				sizeClass.cached++;
+				return;
+			}
+		}
+
+		_freed.fetch_add(1, std::memory_order_relaxed);
+		::operator delete(block);
+	}
+
+	FramePoolStats GetStats()
+	{
+		FramePoolStats stats;
+		stats.reused = _reused.load(std::memory_order_relaxed);
+		stats.allocated = _allocated.load(std::memory_order_relaxed);
+		stats.freed = _freed.load(std::memory_order_relaxed);
+		stats.cached = 0;
+		for (auto& sizeClass : _classes)
+		{
+			std::lock_guard<std::mutex> lock(sizeClass.lock);
+			stats.cached += sizeClass.cached;
+		}
+		return stats;
+	}
+
+private:
+	struct FreeBlock
+	{
+		FreeBlock* next;
+	};
+
+	struct SizeClass
+	{
+		std::mutex lock;
+		FreeBlock* head;
+		size_t cached;
+	};
+
+	FramePool(const FramePool&) = delete;
+	FramePool& operator=(const FramePool&) = delete;
+
+	SizeClass _classes[MaxBlockSize / Granularity];
+
+	std::atomic<uint64_t> _reused;
+	std::atomic<uint64_t> _allocated;
+	std::atomic<uint64_t> _freed;
+};
@@ -0,0 +1,253 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Parsing of the raw 802.11 information elements a peer advertises (the
+// System.Devices.WiFiDirect.InformationElements property). Elements and attributes are views into
+// the caller's buffer and stay valid only as long as it does; the one copy made is of a P2P
+// payload split over several elements.
+
+/// Element ID of vendor specific elements
+const uint8_t VendorSpecificElementId = 0xDD;
+
+/// Wi-Fi Alliance OUI and the vendor type of the P2P element
+const uint32_t WiFiAllianceOui = 0x506F9A;
+const uint8_t P2PVendorType = 0x09;
+
+/// P2P attribute carrying the device address, config methods and primary device type
+const uint8_t P2PDeviceInfoAttributeId = 13;
+
+/// One element: ID, length and a view of its body
+struct InformationElement
+{
+	uint8_t id;
+	uint8_t length;
+	const uint8_t* data;
+
+	/// Vendor specific element with room for an OUI and a vendor type
+	bool IsVendorSpecific() const
+	{
+		return id == VendorSpecificElementId && length >= 4;
+	}
+
+	/// 24-bit OUI of a vendor specific element
+	uint32_t GetOui() const
+	{
+		return (static_cast<uint32_t>(data[0]) << 16) | (static_cast<uint32_t>(data[1]) << 8) | data[2];
+	}
+
+	uint8_t GetVendorType() const
+	{
+		return data[3];
+	}
+
+	/// Vendor payload after the OUI and vendor type
+	const uint8_t* GetVendorPayload() const
+	{
+		return data + 4;
+	}
+
+	size_t GetVendorPayloadLength() const
+	{
+		return length - 4;
+	}
+};
+
+/// Walks a buffer of [id][length][body] elements. Stops at the first element that runs past the
+/// end of the buffer and reports the buffer as malformed.
+class InformationElementReader
+{
+public:
+	InformationElementReader(const uint8_t* buffer, size_t length)
+		: _position(buffer),
+		  _end(buffer + length),
+		  _malformed(false)
+	{}
+
+	bool Next(InformationElement& element)
+	{
+		if (_position == _end)
+		{
+			return false;
+		}
+
+		if (_end - _position < 2 || static_cast<size_t>(_end - _position - 2) < _position[1])
+		{
+			_malformed = true;
+			_position = _end;
+			return false;
+		}
+
+		element.id = _position[0];
+		element.length = _position[1];
+		element.data = _position + 2;
+		_position += 2 + element.length;
+		return true;
+	}
+
+	bool IsMalformed() const
+	{
+		return _malformed;
+	}
+
+private:
+	const uint8_t* _position;
+	const uint8_t* _end;
+	bool _malformed;
+};
+
+/// One P2P attribute: ID, length and a view of its body
+struct P2PAttribute
+{
+	uint8_t id;
+	uint16_t length;
+	const uint8_t* data;
+};
+
+/// Walks the [id][length, 2 bytes little endian][body] attributes in the payload of a P2P element
+class P2PAttributeReader
+{
+public:
+	P2PAttributeReader(const uint8_t* payload, size_t length)
+		: _position(payload),
+		  _end(payload + length),
+		  _malformed(false)
+	{}
+
+	bool Next(P2PAttribute& attribute)
+	{
+		if (_position == _end)
+		{
+			return false;
+		}
+
+		if (_end - _position < 3)
+		{
+			_malformed = true;
+			_position = _end;
+			return false;
+		}
+
+		uint16_t length = static_cast<uint16_t>(_position[1] | (_position[2] << 8));
+		if (static_cast<size_t>(_end - _position - 3) < length)
+		{
+			_malformed = true;
+			_position = _end;
+			return false;
+		}
+
+		attribute.id = _position[0];
+		attribute.length = length;
+		attribute.data = _position + 3;
+		_position += 3 + length;
+		return true;
+	}
+
+	bool IsMalformed() const
+	{
+		return _malformed;
+	}
+
+private:
+	const uint8_t* _position;
+	const uint8_t* _end;
+	bool _malformed;
+};
+
+/// First vendor specific element with the given OUI and vendor type. Walking the elements skips
+/// their bodies, which beats scanning every byte for the OUI (see ElementBenchmark) unless the
+/// elements average under about 24 bytes, far smaller than what peers send.
+inline bool FindVendorElement(const uint8_t* buffer, size_t length, uint32_t oui, uint8_t vendorType, InformationElement& found)
+{
+	InformationElementReader reader(buffer, length);
+	InformationElement element;
+	while (reader.Next(element))
+	{
+		if (element.IsVendorSpecific() && element.GetOui() == oui && element.GetVendorType() == vendorType)
+		{
+			found = element;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/// Payload of the peer's P2P element. A payload too long for one element continues in the P2P
+/// elements after it and an attribute may straddle the boundary, so the payloads only parse once
+/// joined. A single element is returned in place; several are copied, in order, into joined.
+inline bool FindP2PPayload(const uint8_t* buffer, size_t length, std::vector<uint8_t>& joined, const uint8_t*& payload, size_t& payloadLength)
+{
+	size_t found = 0;
+	InformationElementReader reader(buffer, length);
+	InformationElement element;
+	while (reader.Next(element))
+	{
+		if (!element.IsVendorSpecific() || element.GetOui() != WiFiAllianceOui || element.GetVendorType() != P2PVendorType)
+		{
+			continue;
+		}
+
+		if (found == 0)
+		{
+			payload = element.GetVendorPayload();
+			payloadLength = element.GetVendorPayloadLength();
+		}
+		else
+		{
+			if (found == 1)
+			{
+				joined.assign(payload, payload + payloadLength);
+			}
+			joined.insert(joined.end(), element.GetVendorPayload(), element.GetVendorPayload() + element.GetVendorPayloadLength());
+		}
+		found++;
+	}
+
+	if (found > 1)
+	{
+		payload = joined.data();
+		payloadLength = joined.size();
+	}
+	return found != 0;
+}
+
+/// Primary device type (category and sub category) from the P2P Device Info attribute
+inline bool FindPrimaryDeviceType(const uint8_t* buffer, size_t length, uint16_t& category, uint16_t& subCategory)
+{
+	std::vector<uint8_t> joined;
+	const uint8_t* payload = nullptr;
+	size_t payloadLength = 0;
+	if (!FindP2PPayload(buffer, length, joined, payload, payloadLength))
+	{
+		return false;
+	}
+
+	P2PAttributeReader reader(payload, payloadLength);
+	P2PAttribute attribute;
+	while (reader.Next(attribute))
+	{
+		// Device address (6), config methods (2), then category (2), OUI (4), sub category (2); big endian
+		if (attribute.id == P2PDeviceInfoAttributeId && attribute.length >= 16)
+		{
+			category = static_cast<uint16_t>((attribute.data[8] << 8) | attribute.data[9]);
+			subCategory = static_cast<uint16_t>((attribute.data[14] << 8) | attribute.data[15]);
+			return true;
+		}
+	}
+
+	return false;
+}
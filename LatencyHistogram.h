@@ -0,0 +1,248 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/// Fixed-size histogram of durations in microseconds with bounded relative error (HDR style):
+/// values below 32 us get a bucket each, above that every power of two is split into 16 buckets,
+/// so a reported percentile is within 1/16 of the recorded value. Record is a lock-free increment
+/// and never allocates; readers may run concurrently and see a slightly stale picture.
+class LatencyHistogram
+{
+public:
+	LatencyHistogram()
+	{
+		Reset();
+	}
+
+	void Record(std::chrono::steady_clock::duration elapsed)
+	{
+		int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+		uint64_t value = (us < 0) ? 0 : static_cast<uint64_t>(us);
+		if (value > MaxValue)
+		{
+			value = MaxValue;
+		}
+
+		_buckets[GetBucket(value)].fetch_add(1, std::memory_order_relaxed);
+		_count.fetch_add(1, std::memory_order_relaxed);
+		_total.fetch_add(value, std::memory_order_relaxed);
+
+		uint64_t max = _max.load(std::memory_order_relaxed);
+		while (value > max && !_max.compare_exchange_weak(max, value, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	uint64_t GetCount() const
+	{
+		return _count.load(std::memory_order_relaxed);
+	}
+
+	std::chrono::microseconds GetMean() const
+	{
+		uint64_t count = GetCount();
+		if (count == 0)
+		{
+			return std::chrono::microseconds(0);
+		}
+		return std::chrono::microseconds(_total.load(std::memory_order_relaxed) / count);
+	}
+
+	std::chrono::microseconds GetMax() const
+	{
+		return std::chrono::microseconds(_max.load(std::memory_order_relaxed));
+	}
+
+	/// Smallest recorded value that at least fraction (0..1) of the values do not exceed, reported
+	/// as the upper edge of its bucket
+	std::chrono::microseconds GetPercentile(double fraction) const
+	{
+		uint64_t counts[BucketCount];
+		uint64_t count = 0;
+		for (size_t i = 0; i < BucketCount; i++)
+		{
+			counts[i] = _buckets[i].load(std::memory_order_relaxed);
+			count += counts[i];
+		}
+
+		if (count == 0)
+		{
+			return std::chrono::microseconds(0);
+		}
+
+		uint64_t rank = static_cast<uint64_t>(fraction * count + 0.5);
+		if (rank < 1)
+		{
+			rank = 1;
+		}
+
+		uint64_t seen = 0;
+		for (size_t i = 0; i < BucketCount; i++)
+		{
+			seen += counts[i];
+			if (seen >= rank)
+			{
+				uint64_t value = GetBucketUpperEdge(i);
+				uint64_t max = _max.load(std::memory_order_relaxed);
+				return std::chrono::microseconds(value < max ? value : max);
+			}
+		}
+
+		return GetMax();
+	}
+
+	void Reset()
+	{
+		for (auto& bucket : _buckets)
+		{
+			bucket.store(0, std::memory_order_relaxed);
+		}
+		_count.store(0, std::memory_order_relaxed);
+		_total.store(0, std::memory_order_relaxed);
+		_max.store(0, std::memory_order_relaxed);
+	}
+
+private:
+	static const unsigned SubBucketBits = 5;
+	static const uint64_t SubBucketCount = 1 << SubBucketBits;
+	static const uint64_t SubBucketHalf = SubBucketCount / 2;
+
+	/// About 19 hours; longer values are clamped
+	static const unsigned MaxValueBits = 36;
+	static const uint64_t MaxValue = (1ULL << MaxValueBits) - 1;
+
+	static const size_t BucketCount = SubBucketCount + (MaxValueBits - SubBucketBits) * SubBucketHalf;
+
+	static unsigned GetBitLength(uint64_t value)
+	{
+		unsigned length = 0;
+		if (value >> 32) { value >>= 32; length += 32; }
+		if (value >> 16) { value >>= 16; length += 16; }
+		if (value >> 8) { value >>= 8; length += 8; }
+		if (value >> 4) { value >>= 4; length += 4; }
+		if (value >> 2) { value >>= 2; length += 2; }
+		if (value >> 1) { value >>= 1; length += 1; }
+		return length + static_cast<unsigned>(value);
+	}
+
+	static size_t GetBucket(uint64_t value)
+	{
+		if (value < SubBucketCount)
+		{
+			return static_cast<size_t>(value);
+		}
+
+		// The top SubBucketBits bits select the bucket within the power of two
+		unsigned shift = GetBitLength(value) - SubBucketBits;
+		uint64_t top = value >> shift;
+		return static_cast<size_t>(SubBucketCount + (shift - 1) * SubBucketHalf + (top - SubBucketHalf));
+	}
+
+	static uint64_t GetBucketUpperEdge(size_t bucket)
+	{
+		if (bucket < SubBucketCount)
+		{
+			return bucket;
+		}
+
+		unsigned shift = static_cast<unsigned>((bucket - SubBucketCount) / SubBucketHalf) + 1;
+		uint64_t top = (bucket - SubBucketCount) % SubBucketHalf + SubBucketHalf;
+		return ((top + 1) << shift) - 1;
+	}
+
+	std::atomic<uint64_t> _buckets[BucketCount];
+	std::atomic<uint64_t> _count;
+	std::atomic<uint64_t> _total;
+	std::atomic<uint64_t> _max;
+};
+
+/// Phases of the connect and pair flows that get timed
+enum class LatencyPhase
+{
+	/// FromIdAsync call until it returns the operation
+	ConnectIssue,
+	/// FromIdAsync issued until its completion handler runs
+	ConnectCompletion,
+	/// GetConnectionEndpointPairs and picking the first pair
+	ConnectEndpoints,
+	/// Remote host name and its display name
+	ConnectHostName,
+	/// add_ConnectionStatusChanged
+	ConnectStatusHandler,
+	/// Connect requested until the peer is stored as connected
+	ConnectTotal,
+	/// Pairing started until PairingRequested fires
+	PairRequested,
+	/// The user or policy deciding on the request
+	PairDecision,
+	/// Pairing started until PairWithProtectionLevelAndSettingsAsync completes
+	PairTotal,
+	/// Incoming request until admission, for a peer the trust store accepts without asking
+	RequestTrusted,
+	/// Incoming request until admission, for any other peer (auto-accept or prompt)
+	RequestDecided,
+	Count
+};
+
+inline const wchar_t* GetLatencyPhaseName(LatencyPhase phase)
+{
+	switch (phase)
+	{
+	case LatencyPhase::ConnectIssue: return L"connect: issue";
+	case LatencyPhase::ConnectCompletion: return L"connect: completion";
+	case LatencyPhase::ConnectEndpoints: return L"connect: endpoints";
+	case LatencyPhase::ConnectHostName: return L"connect: host name";
+	case LatencyPhase::ConnectStatusHandler: return L"connect: status handler";
+	case LatencyPhase::ConnectTotal: return L"connect: total";
+	case LatencyPhase::PairRequested: return L"pair: requested";
+	case LatencyPhase::PairDecision: return L"pair: decision";
+	case LatencyPhase::PairTotal: return L"pair: total";
+	case LatencyPhase::RequestTrusted: return L"request: trusted";
+	case LatencyPhase::RequestDecided: return L"request: decided";
+	default: return L"?";
+	}
+}
+
+/// One histogram per phase
+class LatencyRecorder
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	/// Record the time from start until now; returns now so consecutive phases can chain
+	Clock::time_point Record(LatencyPhase phase, Clock::time_point start)
+	{
+		Clock::time_point now = Clock::now();
+		_histograms[static_cast<size_t>(phase)].Record(now - start);
+		return now;
+	}
+
+	const LatencyHistogram& Get(LatencyPhase phase) const
+	{
+		return _histograms[static_cast<size_t>(phase)];
+	}
+
+	void Reset()
+	{
+		for (auto& histogram : _histograms)
+		{
+			histogram.Reset();
+		}
+	}
+
+private:
+	LatencyHistogram _histograms[static_cast<size_t>(LatencyPhase::Count)];
+};
@@ -0,0 +1,135 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include "EventLog.h"
+#include "LogBenchmark.h"
+
+#include <cstdio>
+
+/// Fits a ring with room to spare, even with 4 byte wchar_t
+static const unsigned int BurstLength = 64;
+
+static const wchar_t* const BenchmarkDeviceId = L"\\\\?\\SWD#WiFiDirect#02:1a:2b:3c:4d:5e";
+
+static const LogSite BenchmarkSite = { LogLevel::Info, "WFDStartOpenSession completed: error %x, reason %x, peer %s", __FILE__, __LINE__ };
+static const LogSite CodesSite = { LogLevel::Info, "WFDStartOpenSession completed: error %x, reason %x", __FILE__, __LINE__ };
+
+/// Run statement records times on each of threads threads, in bursts; between bursts flush, which
+/// is not timed
+template <typename TStatement, typename TFlush>
+static LogBenchmarkPath Measure(const wchar_t* label, unsigned int records, unsigned int threads, TStatement statement, TFlush flush)
+{
+	typedef std::chrono::steady_clock Clock;
+
+	std::vector<Clock::duration> elapsed(threads);
+	std::vector<std::vector<uint32_t>> latencies(threads);
+	std::vector<std::thread> workers;
+
+	for (unsigned int t = 0; t < threads; t++)
+	{
+		workers.push_back(std::thread([&, t]()
+		{
+			Clock::duration total(0);
+			for (unsigned int done = 0; done < records; done += BurstLength)
+			{
+				unsigned int burst = (records - done < BurstLength) ? records - done : BurstLength;
+				auto started = Clock::now();
+				for (unsigned int i = 0; i < burst; i++)
+				{
+					statement(done + i);
+				}
+				total += Clock::now() - started;
+				flush();
+			}
+			elapsed[t] = total;
+
+			// Once more, each statement on its own
+			latencies[t].reserve(records);
+			for (unsigned int done = 0; done < records; done += BurstLength)
+			{
+				unsigned int burst = (records - done < BurstLength) ? records - done : BurstLength;
+				for (unsigned int i = 0; i < burst; i++)
+				{
+					auto started = Clock::now();
+					statement(done + i);
+					latencies[t].push_back(static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - started).count()));
+				}
+				flush();
+			}
+		}));
+	}
+
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+
+	LogBenchmarkPath path;
+	path.label = label;
+	path.threads = threads;
+	path.dropped = 0;
+
+	Clock::duration total(0);
+	for (unsigned int t = 0; t < threads; t++)
+	{
+		total += elapsed[t];
+		path.latencies.insert(path.latencies.end(), latencies[t].begin(), latencies[t].end());
+	}
+	path.mean = std::chrono::duration_cast<std::chrono::nanoseconds>(total).count() / (static_cast<double>(records) * threads);
+	return path;
+}
+
+std::vector<LogBenchmarkPath> RunLogBenchmark(unsigned int records, unsigned int threads)
+{
+	std::vector<LogBenchmarkPath> paths;
+
+	// What OD_LOGA did short of OutputDebugStringA, which only adds to it
+	std::atomic<uint64_t> formatted(0);
+	paths.push_back(Measure(L"snprintf", records, threads, [&formatted](unsigned int i)
+	{
+		char buffer[1024];
+		int length = snprintf(buffer, sizeof(buffer), "WFDStartOpenSession completed: error %x, reason %x, peer %ls\n", i, i & 0xFF, BenchmarkDeviceId);
+		formatted.fetch_add(static_cast<uint64_t>(length), std::memory_order_relaxed);
+	}, []() {}));
+
+	EventLog log;
+	std::atomic<uint64_t> written(0);
+	log.Start([&written](LogLevel, const char*, size_t)
+	{
+		written.fetch_add(1, std::memory_order_relaxed);
+	});
+
+	// Measure runs every statement twice, and flushes after the last
+	auto measureLog = [&](const wchar_t* label, std::function<void(unsigned int)> statement)
+	{
+		uint64_t before = written.load();
+		paths.push_back(Measure(label, records, threads, statement, [&log]()
+		{
+			log.Flush();
+		}));
+		paths.back().dropped = 2 * static_cast<uint64_t>(records) * threads - (written.load() - before);
+	};
+
+	measureLog(L"ring", [&log](unsigned int i)
+	{
+		log.Write(BenchmarkSite, i, i & 0xFF, BenchmarkDeviceId);
+	});
+
+	// Without the ID most of the cost is the timestamp
+	measureLog(L"ring codes", [&log](unsigned int i)
+	{
+		log.Write(CodesSite, i, i & 0xFF);
+	});
+
+	log.Stop();
+	return paths;
+}
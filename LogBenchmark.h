@@ -0,0 +1,34 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/// How one way of logging a statement did over a benchmark run
+struct LogBenchmarkPath
+{
+	const wchar_t* label;
+	unsigned int threads;
+	/// Nanoseconds per statement, from timing whole bursts of them
+	double mean;
+	/// Nanoseconds of single statements timed one by one, the clock read included
+	std::vector<uint32_t> latencies;
+	/// Statements that never reached the sink
+	uint64_t dropped;
+};
+
+/// Log the statement the session open completion logs (two codes and a device ID), records times
+/// on each of threads at once: formatted with snprintf into a stack buffer as OD_LOGA did, and
+/// recorded into EventLog rings. Statements go in bursts that fit a ring, with a Flush between
+/// them, so the hot path is measured rather than dropping. Uses its own EventLog, not Instance().
+std::vector<LogBenchmarkPath> RunLogBenchmark(unsigned int records, unsigned int threads);
@@ -0,0 +1,109 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// No MAC address; what the parsers return for anything that is not one. An all-zero MAC is not
+/// a peer's, so it doubles as the "none" value wherever a MAC is stored.
+const uint64_t InvalidMacAddress = 0;
+
+/// Characters in "xx:xx:xx:xx:xx:xx"
+const size_t MacAddressLength = 17;
+
+/// Value of a hex digit of either case, or a value with bit 4 set for any other character.
+/// Selects rather than branches on the character.
+constexpr uint32_t HexDigitValue(wchar_t c)
+{
+	uint32_t digit = static_cast<uint32_t>(c) - L'0';
+	// Folds 'A'-'F' onto 'a'-'f'; nothing else lands in that range
+	uint32_t letter = (static_cast<uint32_t>(c) | 0x20) - L'a';
+	return (digit < 10) ? digit : ((letter < 6) ? letter + 10 : 0x10);
+}
+
+/// "xx:xx:xx:xx:xx:xx" to a 48-bit MAC, first octet in the high byte, InvalidMacAddress for
+/// anything else. Every character is checked and the only branch is on the length, so a malformed
+/// address costs as much as a good one.
+constexpr uint64_t ParseMacAddress(const wchar_t* text, size_t length)
+{
+	if (length != MacAddressLength)
+	{
+		return InvalidMacAddress;
+	}
+
+	uint64_t mac = 0;
+	uint32_t invalid = 0;
+	for (size_t octet = 0; octet < 6; octet++)
+	{
+		uint32_t high = HexDigitValue(text[octet * 3]);
+		uint32_t low = HexDigitValue(text[octet * 3 + 1]);
+		invalid |= (high | low) & 0x10;
+		mac = (mac << 8) | ((high & 0xF) << 4) | (low & 0xF);
+	}
+
+	for (size_t separator = 2; separator < MacAddressLength; separator += 3)
+	{
+		invalid |= static_cast<uint32_t>(text[separator] ^ L':');
+	}
+
+	return (invalid == 0) ? mac : InvalidMacAddress;
+}
+
+/// 48-bit MAC from the "#xx:xx:xx:xx:xx:xx" suffix of a device ID, InvalidMacAddress if the ID has
+/// none. Only the suffix is read, however long the ID.
+constexpr uint64_t ParseMacSuffix(const wchar_t* id, size_t length)
+{
+	return (length > MacAddressLength && id[length - MacAddressLength - 1] == L'#') ?
+		ParseMacAddress(id + length - MacAddressLength, MacAddressLength) : InvalidMacAddress;
+}
+
+/// Spreads a MAC over 64 bits for hash tables (the splitmix64 finalizer). A bijection, so equal
+/// hashes mean equal MACs.
+constexpr uint64_t HashMacAddress(uint64_t mac)
+{
+	mac ^= mac >> 30;
+	mac *= 0xBF58476D1CE4E5B9ULL;
+	mac ^= mac >> 27;
+	mac *= 0x94D049BB133111EBULL;
+	mac ^= mac >> 31;
+	return mac;
+}
+
+/// "xx:xx:xx:xx:xx:xx" in lower case, as device IDs spell it
+inline void FormatMacAddress(uint64_t mac, wchar_t (&text)[MacAddressLength + 1])
+{
+	static const wchar_t digits[] = L"0123456789abcdef";
+	for (size_t octet = 0; octet < 6; octet++)
+	{
+		uint32_t value = static_cast<uint32_t>(mac >> (40 - 8 * octet)) & 0xFF;
+		text[octet * 3] = digits[value >> 4];
+		text[octet * 3 + 1] = digits[value & 0xF];
+		text[octet * 3 + 2] = L':';
+	}
+	text[MacAddressLength] = L'\0';
+}
+
+// Parsed at compile time, so a parser that accepts a malformed address does not build
+static_assert(ParseMacAddress(L"02:1a:2B:3c:4D:5e", 17) == 0x021A2B3C4D5EULL, "mixed case");
+static_assert(ParseMacAddress(L"ff:ff:ff:ff:ff:ff", 17) == 0xFFFFFFFFFFFFULL, "all ones");
+static_assert(ParseMacSuffix(L"WiFiDirect#02:1a:2b:3c:4d:5e", 28) == 0x021A2B3C4D5EULL, "suffix");
+static_assert(ParseMacSuffix(L"#02:1a:2b:3c:4d:5e", 18) == 0x021A2B3C4D5EULL, "suffix only");
+static_assert(ParseMacSuffix(L"02:1a:2b:3c:4d:5e", 17) == InvalidMacAddress, "no '#'");
+static_assert(ParseMacSuffix(L"WiFiDirect#02:1a:2b:3c:4d", 25) == InvalidMacAddress, "five octets");
+static_assert(ParseMacSuffix(L"WiFiDirect#02:1a:2b:3c:4d:5e:", 29) == InvalidMacAddress, "trailing separator");
+static_assert(ParseMacSuffix(L"WiFiDirect#02-1a-2b-3c-4d-5e", 28) == InvalidMacAddress, "'-' separators");
+static_assert(ParseMacSuffix(L"WiFiDirect#02:1a:2b:3c:4d:5g", 28) == InvalidMacAddress, "not hex");
+static_assert(ParseMacSuffix(L"WiFiDirect#02:1a:2b:3c:4d: e", 28) == InvalidMacAddress, "space");
+static_assert(ParseMacSuffix(L"WiFiDirect#02:1a:2b#3c:4d:5e", 28) == InvalidMacAddress, "'#' inside");
+static_assert(ParseMacSuffix(L"WiFiDirect#02:1a:2b:3c:4d:5\x0130", 28) == InvalidMacAddress, "past ASCII");
+static_assert(ParseMacSuffix(L"WiFiDirect#00:00:00:00:00:00", 28) == InvalidMacAddress, "all zero");
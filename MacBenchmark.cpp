@@ -0,0 +1,91 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include "MacAddress.h"
+#include "PeerRegistry.h"
+#include "MacBenchmark.h"
+
+MacBenchmarkResult RunMacBenchmark(unsigned int ids)
+{
+	// Few enough IDs to stay in cache, so the parsers are measured rather than memory
+	std::mt19937 random(12345);
+	std::vector<std::wstring> deviceIds(std::min(ids, 1024u));
+	for (size_t i = 0; i < deviceIds.size(); i++)
+	{
+		wchar_t address[MacAddressLength + 1];
+		FormatMacAddress((static_cast<uint64_t>(random()) << 16) ^ random(), address);
+		if (i % 8 == 7)
+		{
+			address[random() % MacAddressLength] = L'g';
+		}
+		deviceIds[i] = std::wstring(L"\\\\?\\SWD#WiFiDirect#{2c9c7f32-7b1c-4a1f-9b59-0f1a3e5d6c7b}#") + address;
+	}
+
+	// What Connect did before: find the suffix, scan it, pack the octets by hand
+	auto scanned = [](const std::wstring& id) -> uint64_t
+	{
+		const wchar_t* suffix = wcsrchr(id.c_str(), L'#');
+		unsigned int octets[6];
+		if (suffix == nullptr ||
+			swscanf_s(suffix, L"#%x:%x:%x:%x:%x:%x", &octets[0], &octets[1], &octets[2], &octets[3], &octets[4], &octets[5]) != 6)
+		{
+			return InvalidMacAddress;
+		}
+
+		uint64_t mac = 0;
+		for (size_t i = 0; i < 6; i++)
+		{
+			mac = (mac << 8) | (octets[i] & 0xFF);
+		}
+		return mac;
+	};
+
+	struct Case
+	{
+		const wchar_t* label;
+		std::function<uint64_t(const std::wstring&)> run;
+	};
+
+	const Case cases[] =
+	{
+		{ L"swscanf_s", scanned },
+		{ L"parse", [](const std::wstring& id) { return ParseMacSuffix(id.c_str(), id.length()); } },
+		// What a peer table pays to hash a key, by whole ID and by MAC
+		{ L"hash id", [](const std::wstring& id) { return HashPeerId(id.c_str(), id.length()); } },
+		{ L"hash mac", [](const std::wstring& id) { uint64_t mac = ParseMacSuffix(id.c_str(), id.length()); return HashPeerKey(mac, id.c_str(), id.length()); } },
+	};
+
+	MacBenchmarkResult result;
+	result.idLength = deviceIds[0].length();
+
+	for (const Case& benchmarkCase : cases)
+	{
+		MacBenchmarkPath path;
+		path.label = benchmarkCase.label;
+		path.checksum = 0;
+		path.accepted = 0;
+
+		auto started = std::chrono::steady_clock::now();
+		for (unsigned int i = 0; i < ids; i++)
+		{
+			uint64_t value = benchmarkCase.run(deviceIds[i % deviceIds.size()]);
+			path.checksum ^= value;
+			path.accepted += (value != InvalidMacAddress) ? 1 : 0;
+		}
+		auto elapsed = std::chrono::steady_clock::now() - started;
+
+		path.nanoseconds = (ids != 0) ? std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / static_cast<double>(ids) : 0.0;
+		result.paths.push_back(path);
+	}
+
+	return result;
+}
@@ -0,0 +1,40 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// How one way of getting at the MAC in a device ID did
+struct MacBenchmarkPath
+{
+	const wchar_t* label;
+	/// Per ID
+	double nanoseconds;
+	/// IDs the path produced a valid MAC or hash for
+	unsigned int accepted;
+	/// XOR of every result, so the work cannot be skipped and paths can be compared
+	uint64_t checksum;
+};
+
+struct MacBenchmarkResult
+{
+	/// Characters in each device ID
+	size_t idLength;
+	std::vector<MacBenchmarkPath> paths;
+};
+
+/// Parse the MAC out of ids device IDs as the watcher reports them, every eighth with a broken
+/// MAC, with swscanf_s as Connect used to and with ParseMacSuffix, and hash them by whole ID and
+/// by MAC as a peer table does
+MacBenchmarkResult RunMacBenchmark(unsigned int ids);
@@ -0,0 +1,101 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+/// Unbounded multi-producer single-consumer queue (Vyukov). Push is one atomic exchange and never
+/// waits for other producers or the consumer; only one thread may call TryPop and IsEmpty. A
+/// producer preempted between its exchange and linking its node briefly hides the messages pushed
+/// after it, so TryPop can fail while IsEmpty is false; the consumer just tries again.
+template <typename T>
+class MpscQueue
+{
+public:
+	MpscQueue()
+		: _head(&_stub),
+		  _tail(&_stub)
+	{
+		_stub.next.store(nullptr, std::memory_order_relaxed);
+	}
+
+	~MpscQueue()
+	{
+		T value;
+		while (TryPop(value))
+		{
+		}
+
+		if (_tail != &_stub)
+		{
+			delete _tail;
+		}
+	}
+
+	void Push(T value)
+	{
+		Node* node = new Node(std::move(value));
+		Node* previous = _head.exchange(node, std::memory_order_seq_cst);
+		previous->next.store(node, std::memory_order_release);
+	}
+
+	/// Consumer only
+	bool TryPop(T& value)
+	{
+		Node* tail = _tail;
+		Node* next = tail->next.load(std::memory_order_acquire);
+		if (next == nullptr)
+		{
+			return false;
+		}
+
+		// next becomes the new stub; its value is moved out and the old stub freed
+		value = std::move(next->value);
+		_tail = next;
+		if (tail != &_stub)
+		{
+			delete tail;
+		}
+		return true;
+	}
+
+	/// Consumer only
+	bool IsEmpty() const
+	{
+		return _head.load(std::memory_order_seq_cst) == _tail;
+	}
+
+private:
+	struct Node
+	{
+		Node()
+		{}
+
+		explicit Node(T&& v)
+			: value(std::move(v))
+		{
+			next.store(nullptr, std::memory_order_relaxed);
+		}
+
+		std::atomic<Node*> next;
+		T value;
+	};
+
+	MpscQueue(const MpscQueue&) = delete;
+	MpscQueue& operator=(const MpscQueue&) = delete;
+
+	/// Producers swap themselves in here; on its own cache line so they do not bounce the consumer's
+	alignas(64) std::atomic<Node*> _head;
+	alignas(64) Node* _tail;
+	Node _stub;
+};
@@ -0,0 +1,150 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include "PairingBenchmark.h"
+
+namespace
+{
+	/// Stands in for WinRT pairing: completes each pairing after a random 5-15 ms, failing one in
+	/// twenty, on a thread of its own like an async completion would
+	class SimulatedPairingBackend
+	{
+	public:
+		typedef std::chrono::steady_clock Clock;
+		typedef std::function<void(bool paired)> Completion;
+
+		SimulatedPairingBackend()
+			: _random(42),
+			  _stopping(false)
+		{
+			_thread = std::thread([this]() { Run(); });
+		}
+
+		~SimulatedPairingBackend()
+		{
+			{
+				std::lock_guard<std::mutex> lock(_lock);
+				_stopping = true;
+			}
+			_wake.notify_one();
+			_thread.join();
+		}
+
+		void StartPairing(Completion completion)
+		{
+			{
+				std::lock_guard<std::mutex> lock(_lock);
+
+				std::uniform_int_distribution<int> latency(5000, 15000);
+				std::uniform_int_distribution<int> outcome(0, 19);
+
+				Pending pending;
+				pending.due = Clock::now() + std::chrono::microseconds(latency(_random));
+				pending.paired = (outcome(_random) != 0);
+				pending.completion = std::move(completion);
+				_pending.insert(std::make_pair(pending.due, std::move(pending)));
+			}
+			_wake.notify_one();
+		}
+
+	private:
+		struct Pending
+		{
+			Clock::time_point due;
+			bool paired;
+			Completion completion;
+		};
+
+		void Run()
+		{
+			std::unique_lock<std::mutex> lock(_lock);
+			while (!_stopping)
+			{
+				if (_pending.empty())
+				{
+					_wake.wait(lock);
+					continue;
+				}
+
+				auto next = _pending.begin();
+				if (next->first > Clock::now())
+				{
+					_wake.wait_until(lock, next->first);
+					continue;
+				}
+
+				Pending due = std::move(next->second);
+				_pending.erase(next);
+
+				// Completing starts the next pairing, which comes back here for its slot
+				lock.unlock();
+				due.completion(due.paired);
+				lock.lock();
+			}
+		}
+
+		std::mt19937 _random;
+		std::multimap<Clock::time_point, Pending> _pending;
+		std::mutex _lock;
+		std::condition_variable _wake;
+		bool _stopping;
+		std::thread _thread;
+	};
+}
+
+std::vector<PairingBenchmarkPath> RunPairingBenchmark(unsigned int devices)
+{
+	std::vector<PairingBenchmarkPath> paths;
+
+	const uint32_t limits[] = { 1, 4, 16, 64 };
+	for (uint32_t limit : limits)
+	{
+		SimulatedPairingBackend backend;
+		PairingPipeline<int> pipeline(limit);
+		std::mutex doneLock;
+		std::condition_variable doneWake;
+		unsigned int finished = 0;
+
+		auto start = std::chrono::steady_clock::now();
+		for (unsigned int i = 0; i < devices; i++)
+		{
+			std::wostringstream id;
+			id << L"sim-" << i;
+			std::wstring deviceId = id.str();
+
+			pipeline.Request(deviceId, [&, deviceId]()
+			{
+				backend.StartPairing([&, deviceId](bool paired)
+				{
+					pipeline.Complete(deviceId, paired);
+
+					std::lock_guard<std::mutex> lock(doneLock);
+					finished++;
+					doneWake.notify_one();
+				});
+			});
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(doneLock);
+			doneWake.wait(lock, [&]() { return finished == devices; });
+		}
+
+		PairingBenchmarkPath path;
+		path.maxConcurrent = limit;
+		path.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		path.pairingsPerSecond = devices / path.seconds;
+		path.counters = pipeline.GetCounters();
+		paths.push_back(path);
+	}
+	return paths;
+}
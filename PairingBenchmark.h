@@ -0,0 +1,31 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "PairingPipeline.h"
+
+#include <cstdint>
+#include <vector>
+
+/// How the pipeline did pairing simulated devices with one concurrency limit
+struct PairingBenchmarkPath
+{
+	uint32_t maxConcurrent;
+	double seconds;
+	double pairingsPerSecond;
+	PairingCounters counters;
+};
+
+/// Pair devices simulated devices through a PairingPipeline allowing 1, 4, 16 and 64 at once.
+/// Each pairing completes after a random 5-15 ms, one in twenty failing, on a thread of its own
+/// like a WinRT completion would.
+std::vector<PairingBenchmarkPath> RunPairingBenchmark(unsigned int devices);
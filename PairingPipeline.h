@@ -0,0 +1,360 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// Where a device's pairing is until it finishes
+enum class PairingStage
+{
+	/// Waiting for a free slot, or started and not yet heard back from
+	Requested,
+	/// The ceremony is waiting for a prompt or policy to decide
+	AwaitingDecision,
+	Pairing
+};
+
+inline const wchar_t* GetPairingStageName(PairingStage stage)
+{
+	switch (stage)
+	{
+	case PairingStage::Requested:
+		return L"requested";
+	case PairingStage::AwaitingDecision:
+		return L"awaiting decision";
+	case PairingStage::Pairing:
+		return L"pairing";
+	}
+	return L"unknown";
+}
+
+struct PairingCounters
+{
+	PairingCounters()
+		: requested(0),
+		  duplicates(0),
+		  paired(0),
+		  failed(0),
+		  totalTime(0)
+	{}
+
+	/// Share of finished pairings that paired
+	double GetCompletionRate() const
+	{
+		uint64_t finished = paired + failed;
+		return (finished != 0) ? static_cast<double>(paired) / finished : 0.0;
+	}
+
+	double GetFailureRate() const
+	{
+		uint64_t finished = paired + failed;
+		return (finished != 0) ? static_cast<double>(failed) / finished : 0.0;
+	}
+
+	std::chrono::milliseconds GetMeanTime() const
+	{
+		uint64_t finished = paired + failed;
+		if (finished == 0)
+		{
+			return std::chrono::milliseconds(0);
+		}
+		return std::chrono::duration_cast<std::chrono::milliseconds>(totalTime / finished);
+	}
+
+	uint64_t requested;
+	/// Requests for a device that already had a pairing in progress
+	uint64_t duplicates;
+	uint64_t paired;
+	uint64_t failed;
+	/// Requested to finished, summed over finished pairings
+	std::chrono::milliseconds totalTime;
+};
+
+struct PairingStatus
+{
+	std::wstring deviceId;
+	PairingStage stage;
+	std::chrono::steady_clock::time_point requested;
+	std::chrono::steady_clock::time_point changed;
+};
+
+/// Pairings of many devices at once, each with a state machine of its own. At most
+/// maxConcurrent are started at a time, the rest wait in arrival order. Whoever starts a pairing
+/// attaches a session holding what it needs kept alive (references, event tokens) and gets it
+/// back from Complete to clean up. Starters run without the lock held, on the requesting thread
+/// or on the thread that completed the previous pairing, and starters and sessions are only
+/// destroyed with it released too, as what they hold may call back into the pipeline. Finished
+/// pairings are forgotten, only the counters keep them. Thread-safe.
+template <typename TSession>
+class PairingPipeline
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+	typedef std::function<void()> Starter;
+
+	explicit PairingPipeline(uint32_t maxConcurrent = 4)
+		: _maxConcurrent(maxConcurrent),
+		  _active(0)
+	{}
+
+	/// Start waiting pairings right away if the limit went up
+	void SetMaxConcurrent(uint32_t maxConcurrent)
+	{
+		std::vector<Starter> starters;
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			_maxConcurrent = maxConcurrent;
+			TakeStartable(starters);
+		}
+		Run(starters);
+	}
+
+	uint32_t GetMaxConcurrent()
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		return _maxConcurrent;
+	}
+
+	/// Queue a pairing; start is called once a slot is free and must end in Complete, also when it
+	/// fails. False if the device already has a pairing requested or running.
+	bool Request(const std::wstring& deviceId, Starter start)
+	{
+		std::vector<Starter> starters;
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+
+			if (_devices.find(deviceId) != _devices.end())
+			{
+				_counters.duplicates++;
+				return false;
+			}
+
+			Entry& entry = _devices[deviceId];
+			entry.requested = Clock::now();
+			entry.changed = entry.requested;
+			entry.start = std::move(start);
+
+			_waiting.push_back(deviceId);
+			_counters.requested++;
+			TakeStartable(starters);
+		}
+		Run(starters);
+		return true;
+	}
+
+	/// Keep session alive until the pairing completes; false if the device has no pairing running
+	bool Attach(const std::wstring& deviceId, TSession session)
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+
+		auto it = _devices.find(deviceId);
+		if (it == _devices.end())
+		{
+			return false;
+		}
+
+		it->second.session = std::move(session);
+		return true;
+	}
+
+	/// Move a running pairing between AwaitingDecision and Pairing
+	bool SetStage(const std::wstring& deviceId, PairingStage stage)
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+
+		auto it = _devices.find(deviceId);
+		if (it == _devices.end() || !it->second.started ||
+			(stage != PairingStage::AwaitingDecision && stage != PairingStage::Pairing))
+		{
+			return false;
+		}
+
+		it->second.stage = stage;
+		it->second.changed = Clock::now();
+		return true;
+	}
+
+	/// Finish a started pairing and start the next waiting ones. The attached session is moved to
+	/// session, if given. False if the device has no pairing running, e.g. it was cancelled.
+	bool Complete(const std::wstring& deviceId, bool paired, TSession* session = nullptr)
+	{
+		std::vector<Starter> starters;
+		std::vector<Starter> released;
+		TSession finished;
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+
+			auto it = _devices.find(deviceId);
+			if (it == _devices.end() || !it->second.started)
+			{
+				return false;
+			}
+
+			finished = std::move(it->second.session);
+			Finish(it, paired, released);
+			_active--;
+
+			TakeStartable(starters);
+		}
+
+		if (session != nullptr)
+		{
+			*session = std::move(finished);
+		}
+		Run(starters);
+		return true;
+	}
+
+	/// Fail every pairing that has not finished; returns the sessions of the started ones. The
+	/// starters of waiting ones are destroyed once the lock is released.
+	std::vector<TSession> CancelAll()
+	{
+		std::vector<TSession> sessions;
+		std::vector<Starter> released;
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+
+			for (auto it = _devices.begin(); it != _devices.end();)
+			{
+				if (it->second.started)
+				{
+					sessions.push_back(std::move(it->second.session));
+				}
+				Finish(it++, false, released);
+			}
+			_waiting.clear();
+			_active = 0;
+		}
+
+		return sessions;
+	}
+
+	/// Every pairing requested or running, by device ID
+	std::vector<PairingStatus> GetStatus()
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+
+		std::vector<PairingStatus> status;
+		status.reserve(_devices.size());
+		for (auto& device : _devices)
+		{
+			PairingStatus entry;
+			entry.deviceId = device.first;
+			entry.stage = device.second.stage;
+			entry.requested = device.second.requested;
+			entry.changed = device.second.changed;
+			status.push_back(entry);
+		}
+		return status;
+	}
+
+	/// Started and not yet completed
+	uint32_t GetActiveCount()
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		return _active;
+	}
+
+	size_t GetWaitingCount()
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		return _waiting.size();
+	}
+
+	PairingCounters GetCounters()
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		return _counters;
+	}
+
+private:
+	/// A pairing requested and not yet finished
+	struct Entry
+	{
+		Entry()
+			: stage(PairingStage::Requested),
+			  started(false)
+		{}
+
+		PairingStage stage;
+		/// Holds a slot
+		bool started;
+		Clock::time_point requested;
+		Clock::time_point changed;
+		Starter start;
+		TSession session;
+	};
+
+	typedef typename std::map<std::wstring, Entry>::iterator EntryIterator;
+
+	/// Count a pairing as finished and forget it. A starter that never ran goes to released for
+	/// the caller to destroy once it dropped _lock; called with _lock held.
+	void Finish(EntryIterator it, bool paired, std::vector<Starter>& released)
+	{
+		Entry& entry = it->second;
+		if (entry.start)
+		{
+			released.push_back(std::move(entry.start));
+		}
+
+		if (paired)
+		{
+			_counters.paired++;
+		}
+		else
+		{
+			_counters.failed++;
+		}
+		_counters.totalTime += std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - entry.requested);
+
+		_devices.erase(it);
+	}
+
+	/// Take slots for waiting pairings; called with _lock held
+	void TakeStartable(std::vector<Starter>& starters)
+	{
+		while (_active < _maxConcurrent && !_waiting.empty())
+		{
+			Entry& entry = _devices[_waiting.front()];
+			_waiting.pop_front();
+
+			entry.started = true;
+			entry.changed = Clock::now();
+			starters.push_back(std::move(entry.start));
+			entry.start = nullptr;
+			_active++;
+		}
+	}
+
+	static void Run(std::vector<Starter>& starters)
+	{
+		for (auto& start : starters)
+		{
+			start();
+		}
+	}
+
+	std::mutex _lock;
+	uint32_t _maxConcurrent;
+	uint32_t _active;
+	std::map<std::wstring, Entry> _devices;
+	std::deque<std::wstring> _waiting;
+	PairingCounters _counters;
+};
@@ -0,0 +1,347 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include "PairingPolicy.h"
+#include "MacAddress.h"
+
+/// Rule files beyond this are refused rather than read into memory
+static const LONGLONG MaxRulesFileSize = 64LL * 1024 * 1024;
+
+PairingPolicy::PairingPolicy()
+	: _stamp(0),
+	  _pollTimer(nullptr)
+{
+	// Until something is loaded every request is left to ask
+	_rules.Publish(std::unique_ptr<PairingRuleSet>(new PairingRuleSet()));
+}
+
+PairingPolicy::~PairingPolicy()
+{
+	StopWatching();
+
+	if (_pollTimer != nullptr)
+	{
+		CloseThreadpoolTimer(_pollTimer);
+		_pollTimer = nullptr;
+	}
+}
+
+HRESULT PairingPolicy::Load(const wchar_t* path)
+{
+	{
+		std::lock_guard<std::mutex> lock(_reloadLock);
+
+		HRESULT hr = Reload(path);
+		if (FAILED(hr))
+		{
+			return hr;
+		}
+		_path = path;
+
+		if (_pollTimer == nullptr)
+		{
+			_pollTimer = CreateThreadpoolTimer(PollCallback, this, nullptr);
+			if (_pollTimer == nullptr)
+			{
+				return HRESULT_FROM_WIN32(GetLastError());
+			}
+		}
+	}
+
+	ULARGE_INTEGER relative;
+	relative.QuadPart = static_cast<ULONGLONG>(-static_cast<LONGLONG>(PollIntervalMs) * 10000);
+
+	FILETIME dueTime;
+	dueTime.dwLowDateTime = relative.LowPart;
+	dueTime.dwHighDateTime = relative.HighPart;
+	SetThreadpoolTimer(_pollTimer, &dueTime, PollIntervalMs, 0);
+
+	return S_OK;
+}
+
+void PairingPolicy::StopWatching()
+{
+	if (_pollTimer != nullptr)
+	{
+		SetThreadpoolTimer(_pollTimer, nullptr, 0, 0);
+		WaitForThreadpoolTimerCallbacks(_pollTimer, TRUE);
+	}
+
+	std::lock_guard<std::mutex> lock(_reloadLock);
+	_path.clear();
+}
+
+bool PairingPolicy::SetRules(const std::wstring& text, std::wstring& error)
+{
+	std::unique_ptr<PairingRuleSet> rules(new PairingRuleSet());
+
+	size_t line = 0;
+	if (!rules->Compile(text.c_str(), text.length(), line, error))
+	{
+		std::wostringstream ss;
+		ss << L"line " << line << L": " << error;
+		error = ss.str();
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(_reloadLock);
+	_stats.reloads++;
+	_stats.rules = rules->GetRuleCount();
+	_stats.provisioned = rules->GetProvisionedCount();
+	_loadError.clear();
+	_rules.Publish(std::move(rules));
+	return true;
+}
+
+PairingPolicyStats PairingPolicy::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(_reloadLock);
+	return _stats;
+}
+
+std::wstring PairingPolicy::GetLoadError() const
+{
+	std::lock_guard<std::mutex> lock(_reloadLock);
+	return _loadError;
+}
+
+std::wstring PairingPolicy::GetPath() const
+{
+	std::lock_guard<std::mutex> lock(_reloadLock);
+	return _path;
+}
+
+VOID CALLBACK PairingPolicy::PollCallback(PTP_CALLBACK_INSTANCE instance, PVOID context, PTP_TIMER timer)
+{
+	PairingPolicy* policy = static_cast<PairingPolicy*>(context);
+
+	std::lock_guard<std::mutex> lock(policy->_reloadLock);
+	if (policy->_path.empty())
+	{
+		return;
+	}
+
+	// A file that is missing or being replaced is picked up on a later poll
+	uint64_t stamp;
+	if (!GetFileStamp(policy->_path.c_str(), stamp) || stamp == policy->_stamp)
+	{
+		return;
+	}
+
+	policy->Reload(policy->_path);
+}
+
+bool PairingPolicy::GetFileStamp(const wchar_t* path, uint64_t& stamp)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesExW(path, GetFileExInfoStandard, &attributes))
+	{
+		return false;
+	}
+
+	uint64_t written = (static_cast<uint64_t>(attributes.ftLastWriteTime.dwHighDateTime) << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+	uint64_t size = (static_cast<uint64_t>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+
+	// Editors that save within the timestamp resolution usually change the size
+	stamp = written ^ (size * 0x9E3779B97F4A7C15ULL);
+	return true;
+}
+
+HRESULT PairingPolicy::ReadRules(const wchar_t* path, std::wstring& text, std::wstring& error)
+{
+	HANDLE file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		error = L"cannot open rules file";
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	HRESULT hr = S_OK;
+	std::vector<char> bytes;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size))
+	{
+		hr = HRESULT_FROM_WIN32(GetLastError());
+		error = L"cannot read rules file";
+	}
+	else if (size.QuadPart > MaxRulesFileSize)
+	{
+		hr = HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE);
+		error = L"rules file too large";
+	}
+	else
+	{
+		bytes.resize(static_cast<size_t>(size.QuadPart));
+
+		DWORD read = 0;
+		if (!bytes.empty() && !ReadFile(file, bytes.data(), static_cast<DWORD>(bytes.size()), &read, nullptr))
+		{
+			hr = HRESULT_FROM_WIN32(GetLastError());
+			error = L"cannot read rules file";
+		}
+		else if (read != bytes.size())
+		{
+			// Truncated while reading; the next poll sees the new size
+			hr = HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+			error = L"rules file changed while reading";
+		}
+	}
+
+	CloseHandle(file);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	text.clear();
+	if (bytes.size() >= 2 && static_cast<uint8_t>(bytes[0]) == 0xFF && static_cast<uint8_t>(bytes[1]) == 0xFE)
+	{
+		text.assign(reinterpret_cast<const wchar_t*>(bytes.data() + 2), (bytes.size() - 2) / sizeof(wchar_t));
+		return S_OK;
+	}
+
+	size_t offset = 0;
+	if (bytes.size() >= 3 && static_cast<uint8_t>(bytes[0]) == 0xEF && static_cast<uint8_t>(bytes[1]) == 0xBB && static_cast<uint8_t>(bytes[2]) == 0xBF)
+	{
+		offset = 3;
+	}
+
+	int length = static_cast<int>(bytes.size() - offset);
+	if (length == 0)
+	{
+		return S_OK;
+	}
+
+	int converted = MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, bytes.data() + offset, length, nullptr, 0);
+	if (converted == 0)
+	{
+		error = L"rules file is not valid UTF-8";
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	text.resize(converted);
+	MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, bytes.data() + offset, length, &text[0], converted);
+	return S_OK;
+}
+
+HRESULT PairingPolicy::Reload(const std::wstring& path)
+{
+	// Taken before reading so a change made while reading is seen by the next poll
+	uint64_t stamp = 0;
+	GetFileStamp(path.c_str(), stamp);
+
+	std::wstring text;
+	std::wstring error;
+	HRESULT hr = ReadRules(path.c_str(), text, error);
+
+	std::unique_ptr<PairingRuleSet> rules(new PairingRuleSet());
+	size_t line = 0;
+	if (SUCCEEDED(hr) && !rules->Compile(text.c_str(), text.length(), line, error))
+	{
+		std::wostringstream ss;
+		ss << L"line " << line << L": " << error;
+		error = ss.str();
+		hr = E_INVALIDARG;
+	}
+
+	_stamp = stamp;
+	if (FAILED(hr))
+	{
+		_stats.failedReloads++;
+		_loadError = path + L": " + error;
+		return hr;
+	}
+
+	_stats.reloads++;
+	_stats.rules = rules->GetRuleCount();
+	_stats.provisioned = rules->GetProvisionedCount();
+	_loadError.clear();
+	_rules.Publish(std::move(rules));
+	return S_OK;
+}
+
+PolicyPairRequest::PolicyPairRequest(WlanHostedNetworkHelper& helper, PairingPolicy& policy, IWlanHostedNetworkDevicePairRequest* fallback)
+	: _helper(helper),
+	  _policy(policy),
+	  _fallback(fallback),
+	  _accepted(0),
+	  _rejected(0),
+	  _forwarded(0)
+{}
+
+void PolicyPairRequest::OnPairingDecisionPending(const PendingDecision& decision)
+{
+	PolicyVerdict verdict;
+	{
+		// The facts point into the snapshot, keep it pinned until the rules have run
+		auto snapshot = _helper.GetPeerSnapshot();
+		const PeerSnapshotEntry* peer = snapshot ? snapshot->Find(decision.deviceId.c_str(), decision.deviceId.length()) : nullptr;
+
+		PairingFacts facts;
+		facts.mac = ParseMacSuffix(decision.deviceId.c_str(), decision.deviceId.length());
+		facts.pairingKinds = decision.pairingKinds;
+		if (peer != nullptr)
+		{
+			facts.name = peer->name.c_str();
+			facts.nameLength = peer->name.length();
+			facts.hasDeviceType = peer->elements.hasDeviceType;
+			facts.deviceCategory = peer->elements.deviceCategory;
+			facts.deviceSubCategory = peer->elements.deviceSubCategory;
+			facts.hasVendorElement = peer->elements.hasVendorElement;
+		}
+
+		verdict = _policy.Evaluate(facts);
+	}
+
+	if (verdict.action == PolicyAction::Accept && (decision.pairingKinds & PairingKindProvidePin))
+	{
+		verdict.action = PolicyAction::Ask;
+	}
+
+	switch (verdict.action)
+	{
+	case PolicyAction::Accept:
+		_accepted.fetch_add(1, std::memory_order_relaxed);
+		_helper.ResolveDecision(decision.id, true);
+		break;
+	case PolicyAction::ProvisionedPin:
+		_accepted.fetch_add(1, std::memory_order_relaxed);
+		_helper.ResolveDecision(decision.id, true, std::wstring(verdict.pin, verdict.pinLength));
+		break;
+	case PolicyAction::Reject:
+		_rejected.fetch_add(1, std::memory_order_relaxed);
+		_helper.ResolveDecision(decision.id, false);
+		break;
+	case PolicyAction::Ask:
+		if (_fallback != nullptr)
+		{
+			_forwarded.fetch_add(1, std::memory_order_relaxed);
+			_fallback->OnPairingDecisionPending(decision);
+		}
+		else
+		{
+			_rejected.fetch_add(1, std::memory_order_relaxed);
+			_helper.ResolveDecision(decision.id, false);
+		}
+		break;
+	}
+}
+
+PolicyRequestCounters PolicyPairRequest::GetCounters() const
+{
+	PolicyRequestCounters counters;
+	counters.accepted = _accepted.load(std::memory_order_relaxed);
+	counters.rejected = _rejected.load(std::memory_order_relaxed);
+	counters.forwarded = _forwarded.load(std::memory_order_relaxed);
+	return counters;
+}
@@ -0,0 +1,137 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "PairingRules.h"
+#include "SnapshotPublisher.h"
+#include "WlanHostedNetworkWinRT.h"
+
+struct PairingPolicyStats
+{
+	PairingPolicyStats()
+		: reloads(0),
+		  failedReloads(0),
+		  rules(0),
+		  provisioned(0)
+	{}
+
+	/// Rule sets compiled and swapped in, and files that failed to compile
+	uint64_t reloads;
+	uint64_t failedReloads;
+	/// Of the rules in force
+	size_t rules;
+	size_t provisioned;
+};
+
+/// Pairing rules loaded from a file and swapped in whenever it changes. A thread-pool timer polls
+/// the file's size and write time; a file that does not compile leaves the rules in force and
+/// its error is kept for GetLoadError. Readers evaluate against a SnapshotPublisher snapshot, so a
+/// reload never waits for or invalidates an evaluation in progress. Thread-safe.
+class PairingPolicy
+{
+public:
+	PairingPolicy();
+	~PairingPolicy();
+
+	/// Compile the rules in path and watch it for changes. On failure the rules in force and the
+	/// file watched stay as they were.
+	HRESULT Load(const wchar_t* path);
+
+	/// Stop watching the file; the rules in force stay
+	void StopWatching();
+
+	/// Replace the rules with ones not kept in a file; false with the reason if they do not compile
+	bool SetRules(const std::wstring& text, std::wstring& error);
+
+	PolicyVerdict Evaluate(const PairingFacts& facts) const
+	{
+		return _rules.Read()->Evaluate(facts);
+	}
+
+	/// Pin the rules in force, e.g. to evaluate several peers against the same rules
+	SnapshotPublisher<PairingRuleSet>::ReadGuard GetRules() const
+	{
+		return _rules.Read();
+	}
+
+	PairingPolicyStats GetStats() const;
+
+	/// Why the last load or reload failed, empty if it succeeded
+	std::wstring GetLoadError() const;
+
+	std::wstring GetPath() const;
+
+private:
+	/// How often the watched file is checked for changes
+	static const DWORD PollIntervalMs = 2000;
+
+	static VOID CALLBACK PollCallback(PTP_CALLBACK_INSTANCE instance, PVOID context, PTP_TIMER timer);
+
+	/// Size and write time of a file folded into one value, false if it cannot be read
+	static bool GetFileStamp(const wchar_t* path, uint64_t& stamp);
+
+	/// Whole file as text, UTF-8 or UTF-16 with a byte order mark
+	static HRESULT ReadRules(const wchar_t* path, std::wstring& text, std::wstring& error);
+
+	/// Read and compile path and publish the result; called with _reloadLock held
+	HRESULT Reload(const std::wstring& path);
+
+	PairingPolicy(const PairingPolicy&) = delete;
+	PairingPolicy& operator=(const PairingPolicy&) = delete;
+
+	SnapshotPublisher<PairingRuleSet> _rules;
+
+	/// Serializes loads and guards everything below
+	mutable std::mutex _reloadLock;
+	std::wstring _path;
+	/// Of the file when last loaded, whether or not it compiled, so a broken file is reported once
+	uint64_t _stamp;
+	std::wstring _loadError;
+	PairingPolicyStats _stats;
+	PTP_TIMER _pollTimer;
+};
+
+struct PolicyRequestCounters
+{
+	uint64_t accepted;
+	uint64_t rejected;
+	/// Left to the fallback because the rules said ask
+	uint64_t forwarded;
+};
+
+/// Decides pairing requests by a PairingPolicy so devices pair unattended. Facts come from the
+/// helper's peer snapshot (name, information elements) and the MAC in the device ID. Requests the
+/// rules leave open go to fallback, or are declined without one; so are ProvidePin ceremonies
+/// matched by an accept rule, as only a provisioned PIN can answer those.
+class PolicyPairRequest : public IWlanHostedNetworkDevicePairRequest
+{
+public:
+	PolicyPairRequest(WlanHostedNetworkHelper& helper, PairingPolicy& policy, IWlanHostedNetworkDevicePairRequest* fallback = nullptr);
+
+	virtual void OnPairingDecisionPending(const PendingDecision& decision) override;
+
+	PolicyRequestCounters GetCounters() const;
+
+private:
+	WlanHostedNetworkHelper& _helper;
+	PairingPolicy& _policy;
+	IWlanHostedNetworkDevicePairRequest* _fallback;
+
+	std::atomic<uint64_t> _accepted;
+	std::atomic<uint64_t> _rejected;
+	std::atomic<uint64_t> _forwarded;
+};
@@ -0,0 +1,515 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include "PairingRules.h"
+#include "MacAddress.h"
+
+#include <algorithm>
+#include <cwctype>
+
+static inline wchar_t FoldCase(wchar_t c)
+{
+	if (c < 0x80)
+	{
+		return (c >= L'A' && c <= L'Z') ? static_cast<wchar_t>(c + (L'a' - L'A')) : c;
+	}
+	return static_cast<wchar_t>(towlower(c));
+}
+
+static bool IsSpace(wchar_t c)
+{
+	return c == L' ' || c == L'\t' || c == L'\r';
+}
+
+/// Split a line on whitespace; a double-quoted run, also inside a token, keeps its spaces
+static bool Tokenize(const std::wstring& line, std::vector<std::wstring>& tokens, std::wstring& error)
+{
+	size_t i = 0;
+	while (i < line.length())
+	{
+		while (i < line.length() && IsSpace(line[i]))
+		{
+			i++;
+		}
+		if (i == line.length() || line[i] == L'#')
+		{
+			break;
+		}
+
+		std::wstring token;
+		while (i < line.length() && !IsSpace(line[i]))
+		{
+			if (line[i] == L'"')
+			{
+				size_t close = line.find(L'"', i + 1);
+				if (close == std::wstring::npos)
+				{
+					error = L"unterminated quote";
+					return false;
+				}
+				token.append(line, i + 1, close - i - 1);
+				i = close + 1;
+			}
+			else
+			{
+				token += line[i++];
+			}
+		}
+		tokens.push_back(token);
+	}
+	return true;
+}
+
+static bool ParseHexByte(const wchar_t* text, uint64_t& value)
+{
+	uint32_t high = HexDigitValue(text[0]);
+	uint32_t low = HexDigitValue(text[1]);
+	value = (high << 4) | low;
+	return ((high | low) & 0x10) == 0;
+}
+
+/// "aa:bb:cc" (or with '-') to the MAC bits it fixes, aligned like ParseMacSuffix; 1 to 6 octets
+static bool ParseMacPrefix(const std::wstring& text, uint64_t& prefix, uint64_t& mask, size_t& octets)
+{
+	prefix = 0;
+	octets = 0;
+
+	size_t i = 0;
+	for (;;)
+	{
+		uint64_t octet;
+		if (octets == 6 || text.length() < i + 2 || !ParseHexByte(text.c_str() + i, octet))
+		{
+			return false;
+		}
+		prefix = (prefix << 8) | octet;
+		octets++;
+		i += 2;
+
+		if (i == text.length())
+		{
+			break;
+		}
+		if (text[i] != L':' && text[i] != L'-')
+		{
+			return false;
+		}
+		i++;
+	}
+
+	const unsigned int shift = static_cast<unsigned int>(8 * (6 - octets));
+	prefix <<= shift;
+	mask = ((static_cast<uint64_t>(1) << (8 * octets)) - 1) << shift;
+	return true;
+}
+
+static bool ParseNumber(const std::wstring& text, uint32_t limit, uint32_t& value)
+{
+	if (text.empty() || text.length() > 10)
+	{
+		return false;
+	}
+
+	uint64_t parsed = 0;
+	for (wchar_t c : text)
+	{
+		if (c < L'0' || c > L'9')
+		{
+			return false;
+		}
+		parsed = parsed * 10 + (c - L'0');
+	}
+
+	if (parsed > limit)
+	{
+		return false;
+	}
+	value = static_cast<uint32_t>(parsed);
+	return true;
+}
+
+static bool ParseAction(const std::wstring& text, PolicyAction& action)
+{
+	if (text == L"accept")
+	{
+		action = PolicyAction::Accept;
+	}
+	else if (text == L"reject")
+	{
+		action = PolicyAction::Reject;
+	}
+	else if (text == L"ask")
+	{
+		action = PolicyAction::Ask;
+	}
+	else if (text == L"pin")
+	{
+		action = PolicyAction::ProvisionedPin;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+PairingRuleSet::PairingRuleSet()
+	: _defaultAction(PolicyAction::Ask)
+{}
+
+bool PairingRuleSet::Compile(const wchar_t* text, size_t length, size_t& errorLine, std::wstring& error)
+{
+	_rules.clear();
+	_names.clear();
+	_provisioned.clear();
+	_defaultAction = PolicyAction::Ask;
+
+	size_t lineNumber = 0;
+	size_t start = 0;
+	while (start < length)
+	{
+		size_t end = start;
+		while (end < length && text[end] != L'\n')
+		{
+			end++;
+		}
+		lineNumber++;
+
+		if (!CompileLine(std::wstring(text + start, end - start), error))
+		{
+			errorLine = lineNumber;
+			_rules.clear();
+			_names.clear();
+			_provisioned.clear();
+			_defaultAction = PolicyAction::Ask;
+			return false;
+		}
+
+		start = end + 1;
+	}
+
+	_rules.shrink_to_fit();
+	_names.shrink_to_fit();
+	return true;
+}
+
+bool PairingRuleSet::CompileLine(const std::wstring& line, std::wstring& error)
+{
+	std::vector<std::wstring> tokens;
+	if (!Tokenize(line, tokens, error))
+	{
+		return false;
+	}
+	if (tokens.empty())
+	{
+		return true;
+	}
+
+	if (tokens[0] == L"default")
+	{
+		if (tokens.size() != 2 || !ParseAction(tokens[1], _defaultAction) || _defaultAction == PolicyAction::ProvisionedPin)
+		{
+			error = L"expected 'default accept|reject|ask'";
+			return false;
+		}
+		return true;
+	}
+
+	if (tokens[0] == L"provision")
+	{
+		uint64_t mac;
+		uint64_t mask;
+		size_t octets;
+		if (tokens.size() != 3 || !ParseMacPrefix(tokens[1], mac, mask, octets) || octets != 6)
+		{
+			error = L"expected 'provision <aa:bb:cc:dd:ee:ff> <pin>'";
+			return false;
+		}
+		if (tokens[2].empty() || tokens[2].length() > PolicyVerdict::PinCapacity)
+		{
+			error = L"PIN must be 1 to 32 characters";
+			return false;
+		}
+		_provisioned[mac] = tokens[2];
+		return true;
+	}
+
+	PolicyAction action;
+	if (!ParseAction(tokens[0], action))
+	{
+		error = L"unknown action '" + tokens[0] + L"'";
+		return false;
+	}
+	return CompileRule(action, tokens, error);
+}
+
+bool PairingRuleSet::CompileRule(PolicyAction action, const std::vector<std::wstring>& tokens, std::wstring& error)
+{
+	Rule rule = {};
+	rule.action = action;
+
+	for (size_t i = 1; i < tokens.size(); i++)
+	{
+		const std::wstring& token = tokens[i];
+		size_t equals = token.find(L'=');
+		if (equals == std::wstring::npos)
+		{
+			error = L"expected key=value, got '" + token + L"'";
+			return false;
+		}
+
+		std::wstring key = token.substr(0, equals);
+		std::wstring value = token.substr(equals + 1);
+		uint32_t number;
+
+		if (key == L"name")
+		{
+			if (value.empty() || _names.length() + value.length() > UINT32_MAX)
+			{
+				error = L"empty name pattern";
+				return false;
+			}
+			rule.nameOffset = static_cast<uint32_t>(_names.length());
+			rule.nameLength = static_cast<uint32_t>(value.length());
+			for (wchar_t c : value)
+			{
+				_names += FoldCase(c);
+			}
+
+			size_t firstStar = value.find(L'*');
+			if (firstStar == std::wstring::npos)
+			{
+				rule.namePrefix = rule.nameLength;
+				rule.nameSuffix = 0;
+			}
+			else
+			{
+				rule.namePrefix = static_cast<uint32_t>(firstStar);
+				rule.nameSuffix = static_cast<uint32_t>(value.length() - value.rfind(L'*') - 1);
+			}
+			rule.nameMinimum = rule.nameLength - static_cast<uint32_t>(std::count(value.begin(), value.end(), L'*'));
+			rule.checks |= CheckName;
+		}
+		else if (key == L"mac")
+		{
+			size_t octets;
+			if (!ParseMacPrefix(value, rule.macPrefix, rule.macMask, octets))
+			{
+				error = L"bad MAC prefix '" + value + L"'";
+				return false;
+			}
+			rule.checks |= CheckMac;
+		}
+		else if (key == L"kind")
+		{
+			if (value == L"confirm")
+			{
+				rule.kinds |= PairingKindConfirmOnly;
+			}
+			else if (value == L"displaypin")
+			{
+				rule.kinds |= PairingKindDisplayPin;
+			}
+			else if (value == L"providepin")
+			{
+				rule.kinds |= PairingKindProvidePin;
+			}
+			else
+			{
+				error = L"unknown pairing kind '" + value + L"'";
+				return false;
+			}
+			rule.checks |= CheckKinds;
+		}
+		else if (key == L"category")
+		{
+			if (!ParseNumber(value, UINT16_MAX, number))
+			{
+				error = L"bad category '" + value + L"'";
+				return false;
+			}
+			rule.category = static_cast<uint16_t>(number);
+			rule.checks |= CheckCategory;
+		}
+		else if (key == L"subcategory")
+		{
+			if (!ParseNumber(value, UINT16_MAX, number))
+			{
+				error = L"bad subcategory '" + value + L"'";
+				return false;
+			}
+			rule.subCategory = static_cast<uint16_t>(number);
+			rule.checks |= CheckSubCategory;
+		}
+		else if (key == L"vendor")
+		{
+			if (!ParseNumber(value, 1, number))
+			{
+				error = L"expected vendor=0 or vendor=1";
+				return false;
+			}
+			rule.vendor = (number != 0);
+			rule.checks |= CheckVendor;
+		}
+		else
+		{
+			error = L"unknown condition '" + key + L"'";
+			return false;
+		}
+	}
+
+	if (_rules.size() >= INT32_MAX)
+	{
+		error = L"too many rules";
+		return false;
+	}
+
+	_rules.push_back(rule);
+	return true;
+}
+
+PolicyVerdict PairingRuleSet::Evaluate(const PairingFacts& facts) const
+{
+	PolicyVerdict verdict;
+	verdict.action = _defaultAction;
+
+	const wchar_t* names = _names.c_str();
+	const size_t count = _rules.size();
+	for (size_t i = 0; i < count; i++)
+	{
+		const Rule& rule = _rules[i];
+
+		// Cheapest first; most rules are ruled out before their name is looked at
+		if ((rule.checks & CheckMac) && (facts.mac == 0 || (facts.mac & rule.macMask) != rule.macPrefix))
+		{
+			continue;
+		}
+		if ((rule.checks & CheckKinds) && (facts.pairingKinds & rule.kinds) == 0)
+		{
+			continue;
+		}
+		if ((rule.checks & CheckCategory) && (!facts.hasDeviceType || facts.deviceCategory != rule.category))
+		{
+			continue;
+		}
+		if ((rule.checks & CheckSubCategory) && (!facts.hasDeviceType || facts.deviceSubCategory != rule.subCategory))
+		{
+			continue;
+		}
+		if ((rule.checks & CheckVendor) && facts.hasVendorElement != rule.vendor)
+		{
+			continue;
+		}
+		if ((rule.checks & CheckName) && !MatchName(rule, names, facts.name, facts.nameLength))
+		{
+			continue;
+		}
+
+		verdict.action = rule.action;
+		verdict.rule = static_cast<int32_t>(i);
+		break;
+	}
+
+	if (verdict.action == PolicyAction::ProvisionedPin)
+	{
+		auto it = (facts.mac != 0) ? _provisioned.find(facts.mac) : _provisioned.end();
+		if (it == _provisioned.end())
+		{
+			verdict.action = PolicyAction::Reject;
+		}
+		else
+		{
+			verdict.pinLength = it->second.copy(verdict.pin, PolicyVerdict::PinCapacity);
+			verdict.pin[verdict.pinLength] = L'\0';
+		}
+	}
+
+	return verdict;
+}
+
+bool PairingRuleSet::MatchName(const Rule& rule, const wchar_t* names, const wchar_t* name, size_t nameLength)
+{
+	if (nameLength < rule.nameMinimum)
+	{
+		return false;
+	}
+
+	const wchar_t* pattern = names + rule.nameOffset;
+	if (rule.namePrefix == rule.nameLength && nameLength != rule.nameLength)
+	{
+		return false;
+	}
+
+	for (uint32_t i = 0; i < rule.namePrefix; i++)
+	{
+		if (pattern[i] != L'?' && pattern[i] != FoldCase(name[i]))
+		{
+			return false;
+		}
+	}
+
+	const wchar_t* patternSuffix = pattern + rule.nameLength - rule.nameSuffix;
+	const wchar_t* nameSuffix = name + nameLength - rule.nameSuffix;
+	for (uint32_t i = 0; i < rule.nameSuffix; i++)
+	{
+		if (patternSuffix[i] != L'?' && patternSuffix[i] != FoldCase(nameSuffix[i]))
+		{
+			return false;
+		}
+	}
+
+	// Without a '*' the prefix was the whole pattern; with one only the middle is left to match
+	if (rule.namePrefix == rule.nameLength)
+	{
+		return true;
+	}
+	return MatchGlob(pattern + rule.namePrefix, rule.nameLength - rule.namePrefix - rule.nameSuffix,
+		name + rule.namePrefix, nameLength - rule.namePrefix - rule.nameSuffix);
+}
+
+bool PairingRuleSet::MatchGlob(const wchar_t* pattern, size_t patternLength, const wchar_t* name, size_t nameLength)
+{
+	// Greedy with one backtrack point: on a mismatch retry from the last '*' one character later
+	size_t p = 0;
+	size_t n = 0;
+	size_t star = SIZE_MAX;
+	size_t resume = 0;
+
+	while (n < nameLength)
+	{
+		if (p < patternLength && pattern[p] == L'*')
+		{
+			star = p++;
+			resume = n;
+		}
+		else if (p < patternLength && (pattern[p] == L'?' || pattern[p] == FoldCase(name[n])))
+		{
+			p++;
+			n++;
+		}
+		else if (star != SIZE_MAX)
+		{
+			p = star + 1;
+			n = ++resume;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	while (p < patternLength && pattern[p] == L'*')
+	{
+		p++;
+	}
+	return p == patternLength;
+}
@@ -0,0 +1,177 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// DevicePairingKinds values rules match on, repeated here so rules compile without WinRT headers
+const uint32_t PairingKindConfirmOnly = 0x1;
+const uint32_t PairingKindDisplayPin = 0x2;
+const uint32_t PairingKindProvidePin = 0x4;
+
+enum class PolicyAction : uint8_t
+{
+	/// Leave the request to whoever handles it without a policy
+	Ask,
+	Accept,
+	Reject,
+	/// Accept peers in the provisioning table, with their PIN if the ceremony asks for one;
+	/// reject everyone else
+	ProvisionedPin
+};
+
+inline const wchar_t* GetPolicyActionName(PolicyAction action)
+{
+	switch (action)
+	{
+	case PolicyAction::Ask:
+		return L"ask";
+	case PolicyAction::Accept:
+		return L"accept";
+	case PolicyAction::Reject:
+		return L"reject";
+	case PolicyAction::ProvisionedPin:
+		return L"pin";
+	}
+	return L"unknown";
+}
+
+/// What rules match on, gathered about a peer before evaluating. Points into storage owned by
+/// the caller, e.g. a peer snapshot held for the duration of Evaluate.
+struct PairingFacts
+{
+	PairingFacts()
+		: name(nullptr),
+		  nameLength(0),
+		  mac(0),
+		  pairingKinds(0),
+		  hasDeviceType(false),
+		  deviceCategory(0),
+		  deviceSubCategory(0),
+		  hasVendorElement(false)
+	{}
+
+	const wchar_t* name;
+	size_t nameLength;
+	/// 48-bit MAC, 0 if unknown
+	uint64_t mac;
+	/// DevicePairingKinds of the ceremony
+	uint32_t pairingKinds;
+	bool hasDeviceType;
+	uint16_t deviceCategory;
+	uint16_t deviceSubCategory;
+	bool hasVendorElement;
+};
+
+struct PolicyVerdict
+{
+	static const size_t PinCapacity = 32;
+
+	PolicyVerdict()
+		: action(PolicyAction::Ask),
+		  rule(-1),
+		  pinLength(0)
+	{
+		pin[0] = L'\0';
+	}
+
+	PolicyAction action;
+	/// Index of the rule that matched, -1 if the default action applied
+	int32_t rule;
+	/// Provisioned PIN, copied so the verdict outlives the rule set it came from
+	wchar_t pin[PinCapacity + 1];
+	size_t pinLength;
+};
+
+/// Pairing rules compiled from text. Each line is one of
+///
+///     # comment
+///     default accept|reject|ask
+///     provision <aa:bb:cc:dd:ee:ff> <pin>
+///     <accept|reject|pin|ask> [name=<glob>] [mac=<aa:bb:cc prefix>] [kind=confirm|displaypin|providepin]
+///                             [category=<n>] [subcategory=<n>] [vendor=0|1]
+///
+/// A rule matches when all of its conditions do; the first matching rule decides. Name globs take
+/// '*' and '?', ignore case and may be quoted to hold spaces. Rules compile to flat records with
+/// the name patterns in one pool, so Evaluate is a linear scan that never allocates. Immutable
+/// once compiled, so any number of threads may evaluate at once.
+class PairingRuleSet
+{
+public:
+	PairingRuleSet();
+
+	/// False with the 1-based line and reason of the first error, leaving the set empty
+	bool Compile(const wchar_t* text, size_t length, size_t& errorLine, std::wstring& error);
+
+	PolicyVerdict Evaluate(const PairingFacts& facts) const;
+
+	size_t GetRuleCount() const
+	{
+		return _rules.size();
+	}
+
+	size_t GetProvisionedCount() const
+	{
+		return _provisioned.size();
+	}
+
+	PolicyAction GetDefaultAction() const
+	{
+		return _defaultAction;
+	}
+
+private:
+	enum RuleCheck : uint8_t
+	{
+		CheckName = 0x01,
+		CheckMac = 0x02,
+		CheckKinds = 0x04,
+		CheckCategory = 0x08,
+		CheckSubCategory = 0x10,
+		CheckVendor = 0x20
+	};
+
+	struct Rule
+	{
+		uint64_t macPrefix;
+		uint64_t macMask;
+		uint32_t nameOffset;
+		uint32_t nameLength;
+		/// Characters a name needs at least, and the literal runs the pattern starts and ends
+		/// with; checked before the full glob match so most names are turned away in a few compares
+		uint32_t nameMinimum;
+		uint32_t namePrefix;
+		uint32_t nameSuffix;
+		uint32_t kinds;
+		uint16_t category;
+		uint16_t subCategory;
+		uint8_t checks;
+		bool vendor;
+		PolicyAction action;
+	};
+
+	bool CompileLine(const std::wstring& line, std::wstring& error);
+	bool CompileRule(PolicyAction action, const std::vector<std::wstring>& tokens, std::wstring& error);
+
+	static bool MatchName(const Rule& rule, const wchar_t* names, const wchar_t* name, size_t nameLength);
+	static bool MatchGlob(const wchar_t* pattern, size_t patternLength, const wchar_t* name, size_t nameLength);
+
+	std::vector<Rule> _rules;
+	/// Lowercased name patterns of all rules back to back
+	std::wstring _names;
+	/// PIN by MAC
+	std::unordered_map<uint64_t, std::wstring> _provisioned;
+	PolicyAction _defaultAction;
+};
@@ -0,0 +1,195 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include "PeerCache.h"
+#include "PeerRegistry.h"
+
+static_assert(sizeof(wchar_t) == 2, "cache file stores UTF-16 device IDs");
+
+static const uint32_t PeerCacheMagic = 0x43444657; // "WFDC"
+static const uint32_t PeerCacheVersion = 2;
+
+static void CopyBounded(wchar_t* destination, size_t capacity, const wchar_t* source, size_t length)
+{
+	if (length >= capacity)
+	{
+		length = capacity - 1;
+	}
+	wmemcpy(destination, source, length);
+	destination[length] = L'\0';
+}
+
+PeerCache::PeerCache()
+	: _file(INVALID_HANDLE_VALUE),
+	  _mapping(NULL),
+	  _header(nullptr),
+	  _entries(nullptr)
+{
+}
+
+PeerCache::~PeerCache()
+{
+	Close();
+}
+
+HRESULT PeerCache::Open(const wchar_t* path)
+{
+	Close();
+
+	const DWORD fileSize = sizeof(Header) + Capacity * sizeof(PeerCacheEntry);
+
+	_file = CreateFileW(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (_file == INVALID_HANDLE_VALUE)
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	// Mapping with an explicit size grows a new or truncated file to the full table
+	_mapping = CreateFileMappingW(_file, nullptr, PAGE_READWRITE, 0, fileSize, nullptr);
+	if (_mapping == NULL)
+	{
+		HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+		Close();
+		return hr;
+	}
+
+	void* view = MapViewOfFile(_mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, fileSize);
+	if (view == nullptr)
+	{
+		HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+		Close();
+		return hr;
+	}
+
+	_header = static_cast<Header*>(view);
+	_entries = reinterpret_cast<PeerCacheEntry*>(_header + 1);
+
+	if (_header->magic != PeerCacheMagic ||
+		_header->version != PeerCacheVersion ||
+		_header->capacity != Capacity ||
+		_header->entrySize != sizeof(PeerCacheEntry))
+	{
+		ZeroMemory(view, fileSize);
+		_header->magic = PeerCacheMagic;
+		_header->version = PeerCacheVersion;
+		_header->capacity = Capacity;
+		_header->entrySize = sizeof(PeerCacheEntry);
+	}
+
+	return S_OK;
+}
+
+void PeerCache::Close()
+{
+	if (_header != nullptr)
+	{
+		FlushViewOfFile(_header, 0);
+		UnmapViewOfFile(_header);
+		_header = nullptr;
+		_entries = nullptr;
+	}
+
+	if (_mapping != NULL)
+	{
+		CloseHandle(_mapping);
+		_mapping = NULL;
+	}
+
+	if (_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(_file);
+		_file = INVALID_HANDLE_VALUE;
+	}
+}
+
+uint32_t PeerCache::GetCount() const
+{
+	return IsOpen() ? _header->count : 0;
+}
+
+PeerCacheEntry* PeerCache::Locate(const wchar_t* id, size_t length, bool insert) const
+{
+	if (!IsOpen() || length == 0 || length >= PeerCacheEntry::IdCapacity)
+	{
+		return nullptr;
+	}
+
+	PeerCacheEntry* victim = nullptr;
+	uint64_t mac = ParseMacSuffix(id, length);
+	uint32_t start = static_cast<uint32_t>(HashPeerKey(mac, id, length) % Capacity);
+
+	for (uint32_t probe = 0; probe < MaxProbe; probe++)
+	{
+		PeerCacheEntry* entry = &_entries[(start + probe) % Capacity];
+		if (!entry->inUse)
+		{
+			// Entries are never removed, so the first free slot ends the probe sequence
+			return insert ? entry : nullptr;
+		}
+
+		// The stored MAC rejects other peers without reading their IDs
+		if (entry->mac == mac && wcsncmp(entry->id, id, length) == 0 && entry->id[length] == L'\0')
+		{
+			return entry;
+		}
+
+		if (victim == nullptr || entry->lastSeen < victim->lastSeen)
+		{
+			victim = entry;
+		}
+	}
+
+	// Probe window is full, make room by evicting the peer seen longest ago
+	return insert ? victim : nullptr;
+}
+
+const PeerCacheEntry* PeerCache::Find(const wchar_t* id, size_t length) const
+{
+	return Locate(id, length, false);
+}
+
+void PeerCache::Touch(const wchar_t* id, size_t length, const wchar_t* name)
+{
+	PeerCacheEntry* entry = Locate(id, length, true);
+	if (entry == nullptr)
+	{
+		return;
+	}
+
+	if (!entry->inUse || wcsncmp(entry->id, id, length) != 0 || entry->id[length] != L'\0')
+	{
+		if (!entry->inUse)
+		{
+			_header->count++;
+		}
+
+		CopyBounded(entry->id, PeerCacheEntry::IdCapacity, id, length);
+		entry->mac = ParseMacSuffix(id, length);
+		entry->pairing = 0;
+		entry->inUse = 1;
+	}
+
+	CopyBounded(entry->name, PeerCacheEntry::NameCapacity, name, wcslen(name));
+
+	FILETIME now;
+	GetSystemTimeAsFileTime(&now);
+	entry->lastSeen = (static_cast<uint64_t>(now.dwHighDateTime) << 32) | now.dwLowDateTime;
+}
+
+void PeerCache::SetPairing(const wchar_t* id, size_t length, uint32_t pairing)
+{
+	PeerCacheEntry* entry = Locate(id, length, false);
+	if (entry != nullptr)
+	{
+		entry->pairing = pairing;
+	}
+}
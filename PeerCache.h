@@ -0,0 +1,104 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+
+#include "MacAddress.h"
+
+/// One known peer as laid out in the cache file
+struct PeerCacheEntry
+{
+	static const size_t IdCapacity = 128;
+	static const size_t NameCapacity = 64;
+
+	/// 48-bit MAC from the "#xx:xx:xx:xx:xx:xx" suffix of the ID, 0 if the ID has none
+	uint64_t mac;
+	/// FILETIME of the last time discovery reported the peer
+	uint64_t lastSeen;
+	/// Last known PeerPairingState
+	uint32_t pairing;
+	uint32_t inUse;
+	wchar_t id[IdCapacity];
+	wchar_t name[NameCapacity];
+};
+
+/// Known peers kept in a memory-mapped file so they are usable as soon as the process starts.
+/// The file is a fixed-size open-addressing table read and written in place; nothing is parsed
+/// or copied on startup. Not thread-safe, callers serialize access.
+class PeerCache
+{
+public:
+	PeerCache();
+	~PeerCache();
+
+	/// Map the cache file, creating or resetting it when missing or from an incompatible build
+	HRESULT Open(const wchar_t* path);
+	void Close();
+
+	bool IsOpen() const
+	{
+		return _entries != nullptr;
+	}
+
+	/// Number of peers in the file
+	uint32_t GetCount() const;
+
+	/// Cached entry for an ID, or nullptr
+	const PeerCacheEntry* Find(const wchar_t* id, size_t length) const;
+
+	/// Record that discovery reported a peer now
+	void Touch(const wchar_t* id, size_t length, const wchar_t* name);
+
+	/// Record the pairing outcome for a peer that is already cached
+	void SetPairing(const wchar_t* id, size_t length, uint32_t pairing);
+
+	/// Call func(entry) for every cached peer
+	template <typename TFunc>
+	void ForEach(TFunc func) const
+	{
+		if (!IsOpen())
+		{
+			return;
+		}
+
+		for (uint32_t i = 0; i < Capacity; i++)
+		{
+			if (_entries[i].inUse)
+			{
+				func(_entries[i]);
+			}
+		}
+	}
+
+private:
+	static const uint32_t Capacity = 1024;
+	static const uint32_t MaxProbe = 16;
+
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t capacity;
+		uint32_t entrySize;
+		uint32_t count;
+		uint32_t reserved;
+	};
+
+	/// Slot holding id, or the slot to (re)use for it when insert is true; nullptr if none
+	PeerCacheEntry* Locate(const wchar_t* id, size_t length, bool insert) const;
+
+	HANDLE _file;
+	HANDLE _mapping;
+	Header* _header;
+	PeerCacheEntry* _entries;
+};
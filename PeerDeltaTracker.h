@@ -0,0 +1,352 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "PeerRegistry.h"
+
+#include <cstdint>
+#include <cwchar>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// Kind of change reported for a discovered peer
+enum class PeerChangeKind
+{
+	Added,
+	Updated,
+	Removed
+};
+
+/// A single change to the discovered peer table
+struct PeerChange
+{
+	PeerChangeKind kind;
+	PeerHandle handle;
+	std::wstring id;
+	std::wstring name;
+	/// Version of the peer record after the change (bumped on every add/update)
+	uint64_t version;
+};
+
+/// Changes published together, tagged with the table generation they produce
+struct PeerDelta
+{
+	PeerDelta() : generation(0) {}
+
+	uint64_t generation;
+	std::vector<PeerChange> changes;
+};
+
+/// Discovery bookkeeping the delta tracker keeps inside each registry entry
+struct PeerDiscoveryRecord
+{
+	PeerDiscoveryRecord()
+		: version(0),
+		  seenEpoch(0),
+		  present(false),
+		  pendingIndex(0)
+	{}
+
+	Utf8String name;
+	uint64_t version;
+	uint64_t seenEpoch;
+	/// Currently reported by the device watcher
+	bool present;
+	/// Position + 1 of this peer's change in the pending list, 0 if none
+	uint32_t pendingIndex;
+};
+
+/// Applies device watcher events to the discovery records of a PeerRegistry and accumulates the
+/// resulting changes as versioned deltas. Events that do not change the table (e.g. a rescan
+/// re-reporting a known peer) produce nothing. Contains no WinRT types so it can be driven by
+/// synthetic watcher events.
+///
+/// TState needs a PeerDiscoveryRecord member named discovery and a bool IsIdle() const method that
+/// reports when nothing but discovery refers to the peer; idle peers are released from the registry.
+template <typename TState>
+class PeerDeltaTracker
+{
+public:
+	explicit PeerDeltaTracker(PeerRegistry<TState>& registry)
+		: _registry(registry),
+		  _pendingCount(0),
+		  _generation(0),
+		  _epoch(0),
+		  _presentCount(0),
+		  _enumerating(false)
+	{}
+
+	/// Start of a (re-)enumeration; peers not reported again before EndEnumeration are swept
+	void BeginEnumeration()
+	{
+		_epoch++;
+		_enumerating = true;
+	}
+
+	/// End of an enumeration; queues a removal for every peer not seen since BeginEnumeration
+	void EndEnumeration()
+	{
+		if (!_enumerating)
+		{
+			return;
+		}
+		_enumerating = false;
+
+		_registry.ForEach([this](PeerHandle handle, TState& state)
+		{
+			if (state.discovery.present && state.discovery.seenEpoch != _epoch)
+			{
+				MarkGone(handle, state.discovery);
+			}
+		});
+	}
+
+	bool IsEnumerating() const
+	{
+		return _enumerating;
+	}
+
+	/// Watcher reported a peer; returns true if the table changed
+	bool OnAdded(const wchar_t* id, size_t idLength, const wchar_t* name)
+	{
+		PeerHandle handle = _registry.Intern(id, idLength);
+		PeerDiscoveryRecord& record = _registry.Get(handle)->discovery;
+		size_t nameLength = wcslen(name);
+
+		record.seenEpoch = _epoch;
+		if (!record.present)
+		{
+			record.present = true;
+			record.name.AssignWide(name, nameLength);
+			record.version++;
+			_presentCount++;
+
+			Queue(PeerChangeKind::Added, handle, record);
+			return true;
+		}
+
+		if (record.name.EqualsWide(name, nameLength))
+		{
+			return false;
+		}
+
+		record.name.AssignWide(name, nameLength);
+		record.version++;
+		Queue(PeerChangeKind::Updated, handle, record);
+		return true;
+	}
+
+	bool OnAdded(const std::wstring& id, const std::wstring& name)
+	{
+		return OnAdded(id.c_str(), id.length(), name.c_str());
+	}
+
+	/// Watcher reported new properties for a peer; unknown peers are ignored
+	bool OnUpdated(const wchar_t* id, size_t idLength, const wchar_t* name)
+	{
+		PeerHandle handle = _registry.Find(id, idLength);
+		TState* state = _registry.Get(handle);
+		if (state == nullptr || !state->discovery.present)
+		{
+			return false;
+		}
+
+		PeerDiscoveryRecord& record = state->discovery;
+		record.seenEpoch = _epoch;
+		record.name.AssignWide(name, wcslen(name));
+		record.version++;
+		Queue(PeerChangeKind::Updated, handle, record);
+		return true;
+	}
+
+	bool OnUpdated(const std::wstring& id, const std::wstring& name)
+	{
+		return OnUpdated(id.c_str(), id.length(), name.c_str());
+	}
+
+	/// Watcher reported a peer is gone; returns true if the table changed
+	bool OnRemoved(const wchar_t* id, size_t idLength)
+	{
+		PeerHandle handle = _registry.Find(id, idLength);
+		TState* state = _registry.Get(handle);
+		if (state == nullptr || !state->discovery.present)
+		{
+			return false;
+		}
+
+		MarkGone(handle, state->discovery);
+		return true;
+	}
+
+	bool OnRemoved(const std::wstring& id)
+	{
+		return OnRemoved(id.c_str(), id.length());
+	}
+
+	/// Mark every peer gone, queueing a removal for each
+	void Clear()
+	{
+		_registry.ForEach([this](PeerHandle handle, TState& state)
+		{
+			if (state.discovery.present)
+			{
+				MarkGone(handle, state.discovery);
+			}
+		});
+		_enumerating = false;
+	}
+
+	bool HasPendingChanges() const
+	{
+		return _pendingCount != 0;
+	}
+
+	/// Number of changes the next delta would carry
+	size_t GetPendingCount() const
+	{
+		return _pendingCount;
+	}
+
+	/// Move the pending changes into delta under a new generation; returns false if nothing changed.
+	/// Peers left idle by the delta are released from the registry.
+	bool TakeDelta(PeerDelta& delta)
+	{
+		delta.changes.clear();
+		if (_pendingCount == 0)
+		{
+			delta.generation = _generation;
+			ReleaseIdlePending();
+			return false;
+		}
+
+		delta.generation = ++_generation;
+		delta.changes.reserve(_pendingCount);
+		for (auto& pending : _pending)
+		{
+			if (pending.second)
+			{
+				TState* state = _registry.Get(pending.first.handle);
+				if (state != nullptr)
+				{
+					state->discovery.pendingIndex = 0;
+				}
+				delta.changes.push_back(pending.first);
+			}
+		}
+
+		ReleaseIdlePending();
+		return true;
+	}
+
+	/// Release a peer from the registry if neither discovery nor its owner still need it
+	void ReleaseIfIdle(PeerHandle handle)
+	{
+		TState* state = _registry.Get(handle);
+		if (state != nullptr && state->discovery.pendingIndex == 0 && state->IsIdle())
+		{
+			_registry.Release(handle);
+		}
+	}
+
+	uint64_t GetGeneration() const
+	{
+		return _generation;
+	}
+
+	/// Number of peers currently reported by the watcher
+	size_t GetPeerCount() const
+	{
+		return _presentCount;
+	}
+
+	bool Contains(const std::wstring& id) const
+	{
+		const TState* state = _registry.Get(_registry.Find(id));
+		return state != nullptr && state->discovery.present;
+	}
+
+private:
+	void MarkGone(PeerHandle handle, PeerDiscoveryRecord& record)
+	{
+		record.present = false;
+		_presentCount--;
+		Queue(PeerChangeKind::Removed, handle, record);
+	}
+
+	/// Fold a change into the pending list so each peer appears at most once per delta
+	void Queue(PeerChangeKind kind, PeerHandle handle, PeerDiscoveryRecord& record)
+	{
+		if (record.pendingIndex == 0)
+		{
+			PeerChange change;
+			change.kind = kind;
+			change.handle = handle;
+			_registry.GetId(handle)->CopyTo(change.id);
+			record.name.CopyTo(change.name);
+			change.version = record.version;
+
+			_pending.push_back(std::make_pair(std::move(change), true));
+			record.pendingIndex = static_cast<uint32_t>(_pending.size());
+			_pendingCount++;
+			return;
+		}
+
+		auto& pending = _pending[record.pendingIndex - 1];
+		PeerChangeKind previous = pending.first.kind;
+
+		if (kind == PeerChangeKind::Removed && previous == PeerChangeKind::Added)
+		{
+			// Appeared and vanished within one delta, listeners never need to hear about it
+			pending.second = false;
+			record.pendingIndex = 0;
+			_pendingCount--;
+			return;
+		}
+
+		if (kind == PeerChangeKind::Removed)
+		{
+			pending.first.kind = PeerChangeKind::Removed;
+		}
+		else if (previous == PeerChangeKind::Removed)
+		{
+			// Vanished and came back, report it as changed
+			pending.first.kind = PeerChangeKind::Updated;
+		}
+
+		record.name.CopyTo(pending.first.name);
+		pending.first.version = record.version;
+	}
+
+	/// Drop the pending list, releasing peers that were removed or cancelled out and are now idle
+	void ReleaseIdlePending()
+	{
+		for (auto& pending : _pending)
+		{
+			ReleaseIfIdle(pending.first.handle);
+		}
+
+		_pending.clear();
+		_pendingCount = 0;
+	}
+
+	PeerRegistry<TState>& _registry;
+
+	/// Pending changes in arrival order; second is false once a change has been cancelled out
+	std::vector<std::pair<PeerChange, bool>> _pending;
+	size_t _pendingCount;
+
+	uint64_t _generation;
+	uint64_t _epoch;
+	size_t _presentCount;
+	bool _enumerating;
+};
@@ -0,0 +1,366 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+#include <string>
+#include <vector>
+
+#include "MacAddress.h"
+#include "Utf8String.h"
+
+/// Compact handle for an interned peer: slot index + 1 in the low 24 bits, slot reuse count above
+typedef uint32_t PeerHandle;
+
+const PeerHandle InvalidPeerHandle = 0;
+
+/// FNV-1a over the UTF-16 code units of a device ID
+inline uint64_t HashPeerId(const wchar_t* id, size_t length)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < length; i++)
+	{
+		hash ^= static_cast<uint64_t>(id[i]);
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+/// Hash for a peer table: of mac, the MAC suffix of id, when it has one, so hashing skips the long
+/// interface prefix; FNV-1a over the whole ID otherwise
+inline uint64_t HashPeerKey(uint64_t mac, const wchar_t* id, size_t length)
+{
+	return (mac != InvalidMacAddress) ? HashMacAddress(mac) : HashPeerId(id, length);
+}
+
+/// Flat table of peers keyed by device ID. Each ID is interned once into a PeerHandle; lookups by
+/// ID go through an open-addressing index and lookups by handle are a direct slot access, so
+/// callbacks never allocate a string just to find a peer.
+///
+/// An ID ending in a MAC address ("...#xx:xx:xx:xx:xx:xx") is hashed by the MAC alone, so hashing
+/// skips the long interface prefix and a mismatching entry is usually ruled out by comparing one
+/// integer. A match is still confirmed against the whole ID: IDs that differ only before the MAC
+/// are different peers.
+template <typename TState>
+class PeerRegistry
+{
+public:
+	PeerRegistry()
+		: _count(0),
+		  _indexUsed(0)
+	{
+		_index.resize(InitialIndexSize);
+	}
+
+	/// Look up a peer by ID, adding it with a default state if unknown
+	PeerHandle Intern(const wchar_t* id, size_t length)
+	{
+		uint64_t mac = ParseMacSuffix(id, length);
+		uint64_t hash = HashPeerKey(mac, id, length);
+		size_t position = Probe(mac, id, length, hash);
+		if (IsOccupied(_index[position]))
+		{
+			return MakeHandle(_index[position].slot);
+		}
+
+		if ((_indexUsed + 1) * 2 > _index.size())
+		{
+			// Grow when mostly live, otherwise just purge the tombstones
+			Rehash(_count * 4 > _index.size() ? _index.size() * 2 : _index.size());
+			position = Probe(mac, id, length, hash);
+		}
+
+		uint32_t slot;
+		if (!_freeSlots.empty())
+		{
+			slot = _freeSlots.back();
+			_freeSlots.pop_back();
+		}
+		else
+		{
+			slot = static_cast<uint32_t>(_slots.size());
+			_slots.push_back(Slot());
+		}
+
+		Slot& entry = _slots[slot];
+		entry.id.AssignWide(id, length);
+		entry.mac = mac;
+		entry.hash = hash;
+		entry.live = true;
+
+		if (_index[position].slot == EmptyEntry)
+		{
+			_indexUsed++;
+		}
+		_index[position].slot = slot;
+		_index[position].tag = static_cast<uint32_t>(hash >> 32);
+		_count++;
+
+		return MakeHandle(slot);
+	}
+
+	PeerHandle Intern(const std::wstring& id)
+	{
+		return Intern(id.c_str(), id.length());
+	}
+
+	PeerHandle Find(const wchar_t* id, size_t length) const
+	{
+		uint64_t mac = ParseMacSuffix(id, length);
+		size_t position = Probe(mac, id, length, HashPeerKey(mac, id, length));
+		if (!IsOccupied(_index[position]))
+		{
+			return InvalidPeerHandle;
+		}
+		return MakeHandle(_index[position].slot);
+	}
+
+	/// Peer whose ID ends in mac, without an ID at hand; the first one found if several IDs end in it
+	PeerHandle FindByMac(uint64_t mac) const
+	{
+		if (mac == InvalidMacAddress)
+		{
+			return InvalidPeerHandle;
+		}
+
+		size_t position = Probe(mac, nullptr, 0, HashMacAddress(mac));
+		if (!IsOccupied(_index[position]))
+		{
+			return InvalidPeerHandle;
+		}
+		return MakeHandle(_index[position].slot);
+	}
+
+	PeerHandle Find(const wchar_t* id) const
+	{
+		return Find(id, wcslen(id));
+	}
+
+	PeerHandle Find(const std::wstring& id) const
+	{
+		return Find(id.c_str(), id.length());
+	}
+
+	/// State for a handle, or nullptr if the handle is stale. Valid until the next Intern.
+	TState* Get(PeerHandle handle)
+	{
+		Slot* slot = Resolve(handle);
+		return slot != nullptr ? &slot->state : nullptr;
+	}
+
+	const TState* Get(PeerHandle handle) const
+	{
+		return const_cast<PeerRegistry*>(this)->Get(handle);
+	}
+
+	/// Interned device ID for a handle, or nullptr if the handle is stale
+	const Utf8String* GetId(PeerHandle handle) const
+	{
+		Slot* slot = const_cast<PeerRegistry*>(this)->Resolve(handle);
+		return slot != nullptr ? &slot->id : nullptr;
+	}
+
+	/// MAC the interned ID ends in; InvalidMacAddress if it has none or the handle is stale
+	uint64_t GetMac(PeerHandle handle) const
+	{
+		Slot* slot = const_cast<PeerRegistry*>(this)->Resolve(handle);
+		return slot != nullptr ? slot->mac : InvalidMacAddress;
+	}
+
+	/// Forget a peer; its handle becomes stale and the slot is reused by a later Intern
+	void Release(PeerHandle handle)
+	{
+		Slot* slot = Resolve(handle);
+		if (slot == nullptr)
+		{
+			return;
+		}
+
+		uint32_t index = SlotIndex(handle);
+		size_t mask = _index.size() - 1;
+		for (size_t position = static_cast<size_t>(slot->hash) & mask; ; position = (position + 1) & mask)
+		{
+			if (_index[position].slot == index)
+			{
+				_index[position].slot = Tombstone;
+				break;
+			}
+		}
+
+		slot->id.Clear();
+		slot->mac = InvalidMacAddress;
+		slot->state = TState();
+		slot->live = false;
+		slot->reuse++;
+		_freeSlots.push_back(index);
+		_count--;
+	}
+
+	void Clear()
+	{
+		_slots.clear();
+		_freeSlots.clear();
+		_index.assign(InitialIndexSize, IndexEntry());
+		_count = 0;
+		_indexUsed = 0;
+	}
+
+	size_t GetCount() const
+	{
+		return _count;
+	}
+
+	/// Call func(handle, state) for every live peer; func must not intern or release peers
+	template <typename TFunc>
+	void ForEach(TFunc func)
+	{
+		for (size_t i = 0; i < _slots.size(); i++)
+		{
+			if (_slots[i].live)
+			{
+				func(MakeHandle(static_cast<uint32_t>(i)), _slots[i].state);
+			}
+		}
+	}
+
+private:
+	static const uint32_t EmptyEntry = 0xFFFFFFFF;
+	static const uint32_t Tombstone = 0xFFFFFFFE;
+	static const uint32_t SlotMask = 0x00FFFFFF;
+	static const size_t InitialIndexSize = 64;
+
+	struct Slot
+	{
+		Slot() : mac(InvalidMacAddress), hash(0), reuse(0), live(false) {}
+
+		/// Stored as UTF-8, which also keeps IDs of the usual length inside the slot
+		Utf8String id;
+		/// MAC suffix of the ID, InvalidMacAddress if none; narrows matches before the ID compare
+		uint64_t mac;
+		uint64_t hash;
+		uint32_t reuse;
+		bool live;
+		TState state;
+	};
+
+	/// 8 byte index entry; the tag (upper hash bits) rejects most mismatches without touching the slot
+	struct IndexEntry
+	{
+		IndexEntry() : slot(EmptyEntry), tag(0) {}
+
+		uint32_t slot;
+		uint32_t tag;
+	};
+
+	static bool IsOccupied(const IndexEntry& entry)
+	{
+		return entry.slot != EmptyEntry && entry.slot != Tombstone;
+	}
+
+	static uint32_t SlotIndex(PeerHandle handle)
+	{
+		return (handle & SlotMask) - 1;
+	}
+
+	PeerHandle MakeHandle(uint32_t slot) const
+	{
+		return ((_slots[slot].reuse & 0xFF) << 24) | (slot + 1);
+	}
+
+	Slot* Resolve(PeerHandle handle)
+	{
+		if (handle == InvalidPeerHandle)
+		{
+			return nullptr;
+		}
+
+		uint32_t index = SlotIndex(handle);
+		if (index >= _slots.size() || !_slots[index].live || MakeHandle(index) != handle)
+		{
+			return nullptr;
+		}
+		return &_slots[index];
+	}
+
+	/// Position of the peer with id, or of the first peer whose ID ends in mac when id is nullptr,
+	/// in the index; or of the empty/tombstone entry where it would be inserted
+	size_t Probe(uint64_t mac, const wchar_t* id, size_t length, uint64_t hash) const
+	{
+		size_t mask = _index.size() - 1;
+		uint32_t tag = static_cast<uint32_t>(hash >> 32);
+		size_t insertAt = static_cast<size_t>(-1);
+
+		for (size_t position = static_cast<size_t>(hash) & mask; ; position = (position + 1) & mask)
+		{
+			const IndexEntry& entry = _index[position];
+			if (entry.slot == EmptyEntry)
+			{
+				return insertAt != static_cast<size_t>(-1) ? insertAt : position;
+			}
+
+			if (entry.slot == Tombstone)
+			{
+				if (insertAt == static_cast<size_t>(-1))
+				{
+					insertAt = position;
+				}
+				continue;
+			}
+
+			if (entry.tag == tag)
+			{
+				// The MAC rules out most other peers before the ID is compared
+				const Slot& slot = _slots[entry.slot];
+				if (slot.hash == hash && slot.mac == mac &&
+					(id == nullptr || slot.id.EqualsWide(id, length)))
+				{
+					return position;
+				}
+			}
+		}
+	}
+
+	void Rehash(size_t size)
+	{
+		_index.assign(size, IndexEntry());
+		_indexUsed = 0;
+
+		size_t mask = size - 1;
+		for (size_t i = 0; i < _slots.size(); i++)
+		{
+			if (!_slots[i].live)
+			{
+				continue;
+			}
+
+			size_t position = static_cast<size_t>(_slots[i].hash) & mask;
+			while (_index[position].slot != EmptyEntry)
+			{
+				position = (position + 1) & mask;
+			}
+
+			_index[position].slot = static_cast<uint32_t>(i);
+			_index[position].tag = static_cast<uint32_t>(_slots[i].hash >> 32);
+			_indexUsed++;
+		}
+	}
+
+	std::vector<Slot> _slots;
+	std::vector<uint32_t> _freeSlots;
+	std::vector<IndexEntry> _index;
+	size_t _count;
+
+	/// Index entries that are live or tombstones; kept under half the index size
+	size_t _indexUsed;
+};
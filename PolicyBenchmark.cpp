@@ -0,0 +1,99 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include "PairingRules.h"
+#include "PolicyBenchmark.h"
+
+PolicyBenchmarkResult RunPolicyBenchmark(unsigned int rules)
+{
+	// A mix of the conditions rule files use, each kind a quarter of the rules
+	std::wostringstream text;
+	text << L"default ask" << std::endl;
+	for (unsigned int i = 0; i < rules; i++)
+	{
+		switch (i % 4)
+		{
+		case 0:
+			text << L"accept name=\"Device " << i << L" *\" kind=confirm" << std::endl;
+			break;
+		case 1:
+			text << L"reject mac=" << std::hex << std::setfill(L'0') << std::setw(2) << ((i >> 16) & 0xFF) << L':' << std::setw(2) << ((i >> 8) & 0xFF)
+				<< L':' << std::setw(2) << (i & 0xFF) << std::dec << std::setfill(L' ') << std::endl;
+			break;
+		case 2:
+			text << L"accept category=" << (100 + i % 500) << L" subcategory=" << (10 + i % 7) << std::endl;
+			break;
+		default:
+			text << L"pin name=*-" << i << L" vendor=1" << std::endl;
+			break;
+		}
+	}
+
+	PolicyBenchmarkResult result;
+	result.errorLine = 0;
+
+	std::wstring source = text.str();
+	PairingRuleSet ruleSet;
+
+	auto compileStarted = std::chrono::steady_clock::now();
+	if (!ruleSet.Compile(source.c_str(), source.length(), result.errorLine, result.error))
+	{
+		result.compileTime = std::chrono::microseconds(0);
+		return result;
+	}
+	result.compileTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - compileStarted);
+
+	// The last one is checked against every condition but the last before the default applies
+	struct Case
+	{
+		const wchar_t* label;
+		std::wstring name;
+	};
+	Case cases[] = {
+		{ L"first rule", L"Device 0 lobby" },
+		{ L"middle rule", L"Device " + std::to_wstring((rules / 2) & ~3u) + L" kitchen" },
+		{ L"no match", L"Living Room TV" }
+	};
+
+	const unsigned int evaluations = 2000;
+
+	for (const Case& benchmarkCase : cases)
+	{
+		PairingFacts facts;
+		facts.name = benchmarkCase.name.c_str();
+		facts.nameLength = benchmarkCase.name.length();
+		facts.mac = 0x02AABBCCDDEEULL;
+		facts.pairingKinds = PairingKindConfirmOnly;
+		facts.hasDeviceType = true;
+		facts.deviceCategory = 7;
+		facts.deviceSubCategory = 1;
+		facts.hasVendorElement = true;
+
+		PolicyVerdict verdict;
+		PolicyBenchmarkCase measured;
+		measured.label = benchmarkCase.label;
+		measured.latencies.reserve(evaluations);
+		for (unsigned int i = 0; i < evaluations; i++)
+		{
+			auto started = std::chrono::steady_clock::now();
+			verdict = ruleSet.Evaluate(facts);
+			auto elapsed = std::chrono::steady_clock::now() - started;
+			measured.latencies.push_back(static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+		}
+
+		std::sort(measured.latencies.begin(), measured.latencies.end());
+		measured.rule = verdict.rule;
+		result.cases.push_back(std::move(measured));
+	}
+
+	return result;
+}
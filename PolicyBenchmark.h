@@ -0,0 +1,42 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// How one peer fared against the generated rules
+struct PolicyBenchmarkCase
+{
+	const wchar_t* label;
+	/// Nanoseconds of every evaluation, sorted
+	std::vector<uint32_t> latencies;
+	/// Rule that decided, -1 for the default
+	int32_t rule;
+};
+
+struct PolicyBenchmarkResult
+{
+	/// Empty if the generated rules compiled
+	std::wstring error;
+	size_t errorLine;
+	std::chrono::microseconds compileTime;
+	std::vector<PolicyBenchmarkCase> cases;
+};
+
+/// Compile rules generated rules, a quarter each of name globs with a literal prefix, MAC
+/// prefixes, device types and name globs with a leading '*', then time evaluations of a peer the
+/// first rule matches, one the rule halfway down matches and one no rule matches
+PolicyBenchmarkResult RunPolicyBenchmark(unsigned int rules);
@@ -0,0 +1,74 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include "EventLoop.h"
+#include "QueueBenchmark.h"
+
+QueueBenchmarkResult RunQueueBenchmark(unsigned int messages)
+{
+	unsigned int producerCount = std::thread::hardware_concurrency();
+	producerCount = (producerCount > 2) ? producerCount - 1 : 2;
+	unsigned int perProducer = messages / producerCount;
+	if (perProducer == 0)
+	{
+		perProducer = 1;
+	}
+
+	EventLoop loop;
+	uint64_t received = 0;
+	loop.Start();
+
+	std::vector<std::vector<uint32_t>> latencies(producerCount);
+	std::vector<std::thread> threads;
+
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned int p = 0; p < producerCount; p++)
+	{
+		threads.emplace_back([&, p]()
+		{
+			std::vector<uint32_t>& samples = latencies[p];
+			for (unsigned int i = 0; i < perProducer; i++)
+			{
+				if ((i & 63) != 0)
+				{
+					loop.Post([&received]() { received++; });
+					continue;
+				}
+
+				auto posted = std::chrono::steady_clock::now();
+				loop.Post([&received]() { received++; });
+				auto elapsed = std::chrono::steady_clock::now() - posted;
+				samples.push_back(static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+			}
+		});
+	}
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+	loop.Flush();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	loop.Stop();
+
+	QueueBenchmarkResult result;
+	result.producers = producerCount;
+	result.received = received;
+	result.batches = loop.GetBatchCount();
+	result.messagesPerSecond = received / seconds;
+	for (auto& samples : latencies)
+	{
+		result.latencies.insert(result.latencies.end(), samples.begin(), samples.end());
+	}
+	std::sort(result.latencies.begin(), result.latencies.end());
+	return result;
+}
@@ -0,0 +1,31 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/// How an event loop kept up with producers posting to it
+struct QueueBenchmarkResult
+{
+	unsigned int producers;
+	/// Messages the loop ran
+	uint64_t received;
+	uint64_t batches;
+	double messagesPerSecond;
+	/// Nanoseconds of every 64th Post, sorted
+	std::vector<uint32_t> latencies;
+};
+
+/// Post about messages counting messages to an EventLoop of its own from one producer thread per
+/// core but one, timing every 64th Post
+QueueBenchmarkResult RunQueueBenchmark(unsigned int messages);
@@ -0,0 +1,173 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include "ReconnectBenchmark.h"
+
+typedef ReconnectScheduler::Clock Clock;
+
+static const std::chrono::milliseconds SimulatedRun(10 * 60 * 1000);
+static const std::chrono::milliseconds PollInterval(100);
+static const std::chrono::milliseconds ConnectLatency(300);
+static const std::chrono::milliseconds ConnectTimeout(2000);
+
+namespace
+{
+	/// How long devices stay up and stay down, in milliseconds
+	struct FlapSchedule
+	{
+		const wchar_t* label;
+		int64_t minUp;
+		int64_t maxUp;
+		int64_t minDown;
+		int64_t maxDown;
+		/// Down periods start at the same moment for every device
+		bool together;
+		/// Devices never come back after their first drop
+		bool gone;
+	};
+
+	struct SimulatedDevice
+	{
+		SimulatedDevice()
+			: reachable(true),
+			  connected(true),
+			  attempting(false),
+			  attemptSucceeds(false)
+		{}
+
+		std::wstring id;
+		/// In range of the radio; a connect attempt only succeeds while it is
+		bool reachable;
+		bool connected;
+		/// When reachable next flips
+		Clock::time_point nextFlip;
+		bool attempting;
+		bool attemptSucceeds;
+		Clock::time_point attemptDone;
+	};
+
+	FlapSimulationResult Simulate(const FlapSchedule& schedule, bool reconnect, unsigned int count)
+	{
+		std::mt19937 random(9);
+		std::uniform_int_distribution<int64_t> up(schedule.minUp, schedule.maxUp);
+		std::uniform_int_distribution<int64_t> down(schedule.minDown, schedule.maxDown);
+
+		ReconnectSettings settings;
+		settings.enabled = reconnect;
+		ReconnectScheduler scheduler(9);
+		scheduler.Configure(settings);
+
+		const Clock::time_point start;
+		const Clock::time_point end = start + SimulatedRun;
+
+		// A shared first drop for the room that drops together, staggered ones otherwise
+		Clock::time_point sharedDrop = start + std::chrono::milliseconds(up(random));
+
+		std::vector<SimulatedDevice> devices(count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			devices[i].id = L"device-" + std::to_wstring(i);
+			devices[i].nextFlip = schedule.together ? sharedDrop : start + std::chrono::milliseconds(up(random));
+		}
+
+		FlapSimulationResult result;
+		result.label = schedule.label;
+		result.reconnect = reconnect;
+		result.devices = count;
+		result.drops = 0;
+
+		uint64_t connectedPolls = 0;
+		uint64_t polls = 0;
+
+		for (Clock::time_point now = start; now < end; now += PollInterval)
+		{
+			if (schedule.together && now >= sharedDrop)
+			{
+				// Devices come back on their own schedules; the next shared drop follows
+				sharedDrop = now + std::chrono::milliseconds(down(random) + up(random));
+			}
+
+			for (auto& device : devices)
+			{
+				if (now >= device.nextFlip)
+				{
+					device.reachable = !device.reachable;
+					if (device.reachable)
+					{
+						device.nextFlip = schedule.together ? sharedDrop : now + std::chrono::milliseconds(up(random));
+					}
+					else
+					{
+						device.nextFlip = schedule.gone ? Clock::time_point::max() : now + std::chrono::milliseconds(down(random));
+						if (device.connected)
+						{
+							device.connected = false;
+							result.drops++;
+							scheduler.OnDisconnected(device.id, now);
+						}
+					}
+				}
+
+				if (device.attempting && now >= device.attemptDone)
+				{
+					device.attempting = false;
+					if (device.attemptSucceeds && device.reachable)
+					{
+						device.connected = true;
+						scheduler.OnConnected(device.id, now);
+					}
+					else
+					{
+						scheduler.OnAttemptFailed(device.id, now);
+					}
+				}
+
+				if (device.connected)
+				{
+					connectedPolls++;
+				}
+			}
+			polls += count;
+
+			for (auto& id : scheduler.TakeDue(now))
+			{
+				SimulatedDevice& device = devices[std::stoul(id.substr(7))];
+				device.attempting = true;
+				device.attemptSucceeds = device.reachable;
+				device.attemptDone = now + (device.reachable ? ConnectLatency : ConnectTimeout);
+			}
+		}
+
+		result.stats = scheduler.GetStats();
+		result.connectedPercent = polls == 0 ? 0 : 100.0 * connectedPolls / polls;
+		return result;
+	}
+}
+
+std::vector<FlapSimulationResult> RunFlapSimulation(unsigned int devices)
+{
+	static const FlapSchedule schedules[] =
+	{
+		{ L"brief drops", 20000, 60000, 1000, 5000, false, false },
+		{ L"long drops", 30000, 90000, 20000, 120000, false, false },
+		{ L"all at once", 30000, 90000, 3000, 6000, true, false },
+		{ L"gone", 5000, 60000, 0, 0, false, true },
+	};
+
+	std::vector<FlapSimulationResult> results;
+	for (const auto& schedule : schedules)
+	{
+		results.push_back(Simulate(schedule, false, devices));
+		results.push_back(Simulate(schedule, true, devices));
+	}
+	return results;
+}
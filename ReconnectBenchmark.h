@@ -0,0 +1,36 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "ReconnectScheduler.h"
+
+#include <cstdint>
+#include <vector>
+
+/// How a room of flapping devices fared over one simulated run
+struct FlapSimulationResult
+{
+	const wchar_t* label;
+	bool reconnect;
+	unsigned int devices;
+	/// Times a connected device dropped
+	uint64_t drops;
+	ReconnectStats stats;
+	/// Share of device time spent connected
+	double connectedPercent;
+};
+
+/// Run devices simulated devices for ten simulated minutes through ReconnectScheduler, polled every
+/// 100 ms as RunDueReconnects is. Each device stays up and drops on its own schedule: brief drops,
+/// long drops, drops that never end and a room that drops all at once. A connect attempt to a
+/// device that is back succeeds after 300 ms; one to a device that is still down fails after 2 s.
+std::vector<FlapSimulationResult> RunFlapSimulation(unsigned int devices);
@@ -0,0 +1,253 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+/// When and how often to try reconnecting a peer that dropped
+struct ReconnectSettings
+{
+	ReconnectSettings()
+		: enabled(false),
+		  initialDelay(500),
+		  maxDelay(30000),
+		  multiplier(2.0),
+		  jitter(0.2),
+		  maxConcurrent(2),
+		  maxAttempts(8)
+	{}
+
+	bool enabled;
+	/// Delay before the first attempt; each failed attempt multiplies it, up to maxDelay
+	std::chrono::milliseconds initialDelay;
+	std::chrono::milliseconds maxDelay;
+	double multiplier;
+	/// Each delay is randomized by +/- this fraction so peers that dropped together spread out
+	double jitter;
+	/// Reconnects allowed in flight at once
+	size_t maxConcurrent;
+	/// Failed attempts after which a peer is given up on
+	uint32_t maxAttempts;
+};
+
+struct ReconnectStats
+{
+	ReconnectStats()
+		: reconnected(0),
+		  gaveUp(0),
+		  attempts(0),
+		  totalTimeToReconnect(0)
+	{}
+
+	/// Mean time from disconnect to being connected again
+	std::chrono::milliseconds GetMeanTimeToReconnect() const
+	{
+		if (reconnected == 0)
+		{
+			return std::chrono::milliseconds(0);
+		}
+		return std::chrono::milliseconds(totalTimeToReconnect.count() / static_cast<int64_t>(reconnected));
+	}
+
+	uint64_t reconnected;
+	uint64_t gaveUp;
+	uint64_t attempts;
+	std::chrono::milliseconds totalTimeToReconnect;
+};
+
+/// Per-peer reconnect state machine: Waiting until the backoff delay expires, then Connecting
+/// until the attempt reports back, then either done or Waiting again with a longer delay. Takes
+/// the current time as a parameter and holds no WinRT types, so it can be driven by a simulated
+/// clock and device. Not thread-safe, callers serialize access.
+class ReconnectScheduler
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	explicit ReconnectScheduler(uint32_t seed = std::random_device()())
+		: _random(seed),
+		  _connecting(0)
+	{}
+
+	void Configure(const ReconnectSettings& settings)
+	{
+		_settings = settings;
+		if (!_settings.enabled)
+		{
+			_peers.clear();
+			_connecting = 0;
+		}
+	}
+
+	const ReconnectSettings& GetSettings() const
+	{
+		return _settings;
+	}
+
+	/// A peer dropped; schedule its first attempt. Ignored when reconnecting is disabled.
+	void OnDisconnected(const std::wstring& id, Clock::time_point now)
+	{
+		if (!_settings.enabled)
+		{
+			return;
+		}
+
+		auto it = _peers.find(id);
+		if (it == _peers.end())
+		{
+			Entry entry;
+			entry.disconnectedAt = now;
+			it = _peers.insert(std::make_pair(id, entry)).first;
+		}
+		else if (it->second.connecting)
+		{
+			// Dropped again while an attempt was still running; treat that attempt as failed
+			it->second.connecting = false;
+			_connecting--;
+		}
+
+		it->second.due = now + GetDelay(it->second.attempts);
+	}
+
+	/// A peer is connected, by a reconnect attempt or otherwise
+	void OnConnected(const std::wstring& id, Clock::time_point now)
+	{
+		auto it = _peers.find(id);
+		if (it == _peers.end())
+		{
+			return;
+		}
+
+		_stats.reconnected++;
+		_stats.totalTimeToReconnect += std::chrono::duration_cast<std::chrono::milliseconds>(now - it->second.disconnectedAt);
+		Remove(it);
+	}
+
+	/// A reconnect attempt failed; returns true if the peer was given up on
+	bool OnAttemptFailed(const std::wstring& id, Clock::time_point now)
+	{
+		auto it = _peers.find(id);
+		if (it == _peers.end() || !it->second.connecting)
+		{
+			return false;
+		}
+
+		it->second.connecting = false;
+		_connecting--;
+
+		if (it->second.attempts >= _settings.maxAttempts)
+		{
+			_stats.gaveUp++;
+			_peers.erase(it);
+			return true;
+		}
+
+		it->second.due = now + GetDelay(it->second.attempts);
+		return false;
+	}
+
+	/// Stop reconnecting a peer, e.g. because it was disconnected on purpose
+	void Cancel(const std::wstring& id)
+	{
+		auto it = _peers.find(id);
+		if (it != _peers.end())
+		{
+			Remove(it);
+		}
+	}
+
+	/// Peers whose delay has expired, as many as the concurrency cap allows; they move to Connecting
+	std::vector<std::wstring> TakeDue(Clock::time_point now)
+	{
+		std::vector<std::wstring> due;
+		for (auto& peer : _peers)
+		{
+			if (_connecting >= _settings.maxConcurrent)
+			{
+				break;
+			}
+
+			if (!peer.second.connecting && peer.second.due <= now)
+			{
+				peer.second.connecting = true;
+				peer.second.attempts++;
+				_connecting++;
+				_stats.attempts++;
+				due.push_back(peer.first);
+			}
+		}
+		return due;
+	}
+
+	bool HasPending() const
+	{
+		return !_peers.empty();
+	}
+
+	ReconnectStats GetStats() const
+	{
+		return _stats;
+	}
+
+private:
+	struct Entry
+	{
+		Entry()
+			: attempts(0),
+			  connecting(false)
+		{}
+
+		Clock::time_point disconnectedAt;
+		Clock::time_point due;
+		uint32_t attempts;
+		bool connecting;
+	};
+
+	/// Backoff before attempt number attempts + 1
+	Clock::duration GetDelay(uint32_t attempts)
+	{
+		double delay = static_cast<double>(_settings.initialDelay.count());
+		for (uint32_t i = 0; i < attempts && delay < _settings.maxDelay.count(); i++)
+		{
+			delay *= _settings.multiplier;
+		}
+		if (delay > _settings.maxDelay.count())
+		{
+			delay = static_cast<double>(_settings.maxDelay.count());
+		}
+
+		std::uniform_real_distribution<double> spread(1.0 - _settings.jitter, 1.0 + _settings.jitter);
+		delay *= spread(_random);
+
+		return std::chrono::milliseconds(static_cast<int64_t>(delay));
+	}
+
+	void Remove(std::map<std::wstring, Entry>::iterator it)
+	{
+		if (it->second.connecting)
+		{
+			_connecting--;
+		}
+		_peers.erase(it);
+	}
+
+	ReconnectSettings _settings;
+	std::map<std::wstring, Entry> _peers;
+	std::mt19937 _random;
+	size_t _connecting;
+	ReconnectStats _stats;
+};
@@ -0,0 +1,154 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include "PeerRegistry.h"
+#include "RegistryBenchmark.h"
+
+#include <cstdio>
+#include <map>
+#include <random>
+
+static volatile uintptr_t s_sink;
+
+/// What the helper keeps per peer, short of the WinRT objects; pointers stand in for the ComPtrs
+struct BenchmarkPeerState
+{
+	BenchmarkPeerState()
+		: information(nullptr),
+		  device(nullptr),
+		  statusToken(0)
+	{}
+
+	void* information;
+	void* device;
+	int64_t statusToken;
+};
+
+static std::wstring MakeDeviceId(unsigned int i)
+{
+	wchar_t id[64];
+	swprintf(id, sizeof(id) / sizeof(id[0]), L"\\\\?\\SWD#WiFiDirect#02:1a:%02x:%02x:%02x:%02x", (i >> 24) & 0xFF, (i >> 16) & 0xFF, (i >> 8) & 0xFF, i & 0xFF);
+	return id;
+}
+
+static double GetNanosecondsPer(std::chrono::steady_clock::duration elapsed, unsigned int count)
+{
+	return (count != 0) ? std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / static_cast<double>(count) : 0.0;
+}
+
+std::vector<RegistryBenchmarkPath> RunRegistryBenchmark(unsigned int peers, unsigned int lookups)
+{
+	typedef std::chrono::steady_clock Clock;
+
+	std::vector<RegistryBenchmarkPath> paths;
+
+	std::vector<std::wstring> ids;
+	for (unsigned int i = 0; i < peers; i++)
+	{
+		ids.push_back(MakeDeviceId(i));
+	}
+
+	// Callbacks arrive in no particular order
+	std::vector<unsigned int> order;
+	std::mt19937 random(3);
+	for (unsigned int i = 0; i < lookups && peers != 0; i++)
+	{
+		order.push_back(random() % peers);
+	}
+
+	{
+		// As the helper did: the callbacks had the raw HSTRING buffer, so every find built a key
+		std::map<std::wstring, void*> discoverDevices;
+		std::map<std::wstring, void*> connectedDevices;
+		std::map<std::wstring, int64_t> statusTokens;
+
+		auto started = Clock::now();
+		for (unsigned int i = 0; i < peers; i++)
+		{
+			const wchar_t* id = ids[i].c_str();
+			discoverDevices.insert(std::make_pair(id, &ids[i]));
+			connectedDevices.insert(std::make_pair(id, &ids[i]));
+			statusTokens.insert(std::make_pair(id, static_cast<int64_t>(i)));
+		}
+		Clock::duration inserted = Clock::now() - started;
+
+		started = Clock::now();
+		for (unsigned int i : order)
+		{
+			const wchar_t* id = ids[i].c_str();
+			auto device = connectedDevices.find(id);
+			auto token = statusTokens.find(id);
+			if (device != connectedDevices.end() && token != statusTokens.end())
+			{
+				s_sink = reinterpret_cast<uintptr_t>(device->second) + static_cast<uintptr_t>(token->second);
+			}
+		}
+		Clock::duration looked = Clock::now() - started;
+
+		RegistryBenchmarkPath path;
+		path.label = L"std::map x3";
+		path.peers = peers;
+		path.insert = GetNanosecondsPer(inserted, peers);
+		path.lookup = GetNanosecondsPer(looked, static_cast<unsigned int>(order.size()));
+		path.handleLookup = 0.0;
+		paths.push_back(path);
+	}
+
+	{
+		PeerRegistry<BenchmarkPeerState> registry;
+		std::vector<PeerHandle> handles(peers);
+
+		auto started = Clock::now();
+		for (unsigned int i = 0; i < peers; i++)
+		{
+			handles[i] = registry.Intern(ids[i].c_str(), ids[i].length());
+			BenchmarkPeerState* state = registry.Get(handles[i]);
+			state->information = &ids[i];
+			state->device = &ids[i];
+			state->statusToken = i;
+		}
+		Clock::duration inserted = Clock::now() - started;
+
+		started = Clock::now();
+		for (unsigned int i : order)
+		{
+			const BenchmarkPeerState* state = registry.Get(registry.Find(ids[i].c_str(), ids[i].length()));
+			if (state != nullptr)
+			{
+				s_sink = reinterpret_cast<uintptr_t>(state->device) + static_cast<uintptr_t>(state->statusToken);
+			}
+		}
+		Clock::duration looked = Clock::now() - started;
+
+		// Once the peer is interned, later work carries the handle instead of the ID
+		started = Clock::now();
+		for (unsigned int i : order)
+		{
+			const BenchmarkPeerState* state = registry.Get(handles[i]);
+			if (state != nullptr)
+			{
+				s_sink = reinterpret_cast<uintptr_t>(state->device) + static_cast<uintptr_t>(state->statusToken);
+			}
+		}
+		Clock::duration handled = Clock::now() - started;
+
+		RegistryBenchmarkPath path;
+		path.label = L"PeerRegistry";
+		path.peers = peers;
+		path.insert = GetNanosecondsPer(inserted, peers);
+		path.lookup = GetNanosecondsPer(looked, static_cast<unsigned int>(order.size()));
+		path.handleLookup = GetNanosecondsPer(handled, static_cast<unsigned int>(order.size()));
+		paths.push_back(path);
+	}
+
+	return paths;
+}
@@ -0,0 +1,32 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <vector>
+
+/// How one peer table layout did at one size
+struct RegistryBenchmarkPath
+{
+	const wchar_t* label;
+	unsigned int peers;
+	/// Nanoseconds to add a peer to every table that tracks it
+	double insert;
+	/// Nanoseconds for what a status callback does: find the peer's device and token by raw ID
+	double lookup;
+	/// Nanoseconds to get at a peer's state by handle; 0 for layouts without handles
+	double handleLookup;
+};
+
+/// Fill peers peers into the three std::map<std::wstring, ...> tables the helper used to keep
+/// (discovered devices, connected devices, status tokens) and into one PeerRegistry, then look
+/// them up in random order as the WinRT callbacks do
+std::vector<RegistryBenchmarkPath> RunRegistryBenchmark(unsigned int peers, unsigned int lookups);
@@ -0,0 +1,216 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include "WfdSessionManager.h"
+#include "SessionBenchmark.h"
+
+/// Win32 error codes the stand-in completes with, spelled out so it builds without the Windows headers
+static const uint32_t SimulatedGenFailure = 31;
+static const uint32_t SimulatedNotFound = 1168;
+static const uint32_t SimulatedCancelled = 1223;
+
+namespace
+{
+	/// Stands in for the Wi-Fi Direct API: completes each session open after a random 2-10 ms,
+	/// failing one in ten, on a thread of its own like the API's callback thread. Cancelled opens
+	/// complete right away with ERROR_CANCELLED. Counts the sessions it holds so leaks show.
+	class SimulatedSessionBackend : public IWfdSessionBackend
+	{
+	public:
+		typedef std::chrono::steady_clock Clock;
+
+		SimulatedSessionBackend()
+			: _random(42),
+			  _nextHandle(1),
+			  _held(0),
+			  _stopping(false)
+		{
+			_thread = std::thread([this]() { Run(); });
+		}
+
+		~SimulatedSessionBackend()
+		{
+			{
+				std::lock_guard<std::mutex> lock(_lock);
+				_stopping = true;
+			}
+			_wake.notify_one();
+			_thread.join();
+		}
+
+		virtual uint32_t StartOpenSession(uint64_t address, OpenCompleted completed, SessionHandle* session) override
+		{
+			{
+				std::lock_guard<std::mutex> lock(_lock);
+
+				std::uniform_int_distribution<int> latency(2000, 10000);
+				std::uniform_int_distribution<int> outcome(0, 9);
+
+				Pending pending;
+				pending.handle = reinterpret_cast<SessionHandle>(_nextHandle++);
+				pending.due = Clock::now() + std::chrono::microseconds(latency(_random));
+				pending.error = (outcome(_random) != 0) ? 0 : SimulatedGenFailure;
+				pending.completed = std::move(completed);
+
+				*session = pending.handle;
+				_byHandle[pending.handle] = _pending.insert(std::make_pair(pending.due, std::move(pending)));
+			}
+			_wake.notify_one();
+			return 0;
+		}
+
+		virtual uint32_t CancelOpenSession(SessionHandle session) override
+		{
+			{
+				std::lock_guard<std::mutex> lock(_lock);
+				auto it = _byHandle.find(session);
+				if (it == _byHandle.end())
+				{
+					return SimulatedNotFound;
+				}
+
+				// Due right away
+				Pending cancelled = std::move(it->second->second);
+				_pending.erase(it->second);
+				cancelled.due = Clock::now();
+				cancelled.error = SimulatedCancelled;
+				it->second = _pending.insert(std::make_pair(cancelled.due, std::move(cancelled)));
+			}
+			_wake.notify_one();
+			return 0;
+		}
+
+		virtual uint32_t CloseSession(SessionHandle session) override
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			_held--;
+			return 0;
+		}
+
+		/// Sessions opened and not closed yet
+		int64_t GetHeldSessions()
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			return _held;
+		}
+
+	private:
+		struct Pending
+		{
+			SessionHandle handle;
+			Clock::time_point due;
+			uint32_t error;
+			OpenCompleted completed;
+		};
+
+		void Run()
+		{
+			std::unique_lock<std::mutex> lock(_lock);
+			while (!_stopping)
+			{
+				if (_pending.empty())
+				{
+					_wake.wait(lock);
+					continue;
+				}
+
+				auto next = _pending.begin();
+				if (next->first > Clock::now())
+				{
+					_wake.wait_until(lock, next->first);
+					continue;
+				}
+
+				Pending due = std::move(next->second);
+				_pending.erase(next);
+				_byHandle.erase(due.handle);
+				if (due.error == 0)
+				{
+					_held++;
+				}
+
+				lock.unlock();
+				due.completed(due.error, 0);
+				lock.lock();
+			}
+		}
+
+		std::mt19937 _random;
+		std::multimap<Clock::time_point, Pending> _pending;
+		std::map<SessionHandle, std::multimap<Clock::time_point, Pending>::iterator> _byHandle;
+		uintptr_t _nextHandle;
+		int64_t _held;
+		std::mutex _lock;
+		std::condition_variable _wake;
+		bool _stopping;
+		std::thread _thread;
+	};
+}
+
+SessionBenchmarkResult RunSessionBenchmark(unsigned int sessions)
+{
+	SessionBenchmarkResult result;
+	result.sessions = sessions;
+	result.closedWhileOpening = 0;
+	result.unreported = 0;
+	result.slowestOpen = std::chrono::microseconds(0);
+
+	SimulatedSessionBackend backend;
+	{
+		WfdSessionManager manager(backend);
+		std::mutex doneLock;
+		std::condition_variable doneWake;
+		unsigned int finished = 0;
+
+		auto opened = [&](uint64_t, uint32_t, uint32_t)
+		{
+			std::lock_guard<std::mutex> lock(doneLock);
+			finished++;
+			doneWake.notify_one();
+		};
+
+		auto start = std::chrono::steady_clock::now();
+		unsigned int reporting = 0;
+		for (unsigned int i = 0; i < sessions; i++)
+		{
+			// Open must not wait for the session, only for the backend to take the request
+			auto issued = std::chrono::steady_clock::now();
+			manager.Open(i, opened);
+			result.slowestOpen = (std::max)(result.slowestOpen, std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - issued));
+
+			// A session closed while opening is cancelled, its callback is not called
+			if (i % 4 == 3)
+			{
+				manager.Close(i);
+				result.closedWhileOpening++;
+			}
+			else
+			{
+				reporting++;
+			}
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(doneLock);
+			doneWake.wait_for(lock, std::chrono::seconds(30), [&]() { return finished >= reporting; });
+			result.unreported = reporting - finished;
+		}
+		result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		manager.CloseAll();
+		result.counters = manager.GetCounters();
+	}
+
+	// The manager is gone, every session it opened must have been closed
+	result.leaked = backend.GetHeldSessions();
+	return result;
+}
@@ -0,0 +1,39 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "WfdSessionManager.h"
+
+#include <chrono>
+#include <cstdint>
+
+/// How a WfdSessionManager fared against a stand-in backend
+struct SessionBenchmarkResult
+{
+	unsigned int sessions;
+	/// Closed again right after Open, while still opening
+	unsigned int closedWhileOpening;
+	/// Open callbacks still outstanding when the wait gave up after 30 s; 0 unless one was lost
+	unsigned int unreported;
+	double seconds;
+	/// Longest a single Open call took
+	std::chrono::microseconds slowestOpen;
+	WfdSessionCounters counters;
+	/// Sessions the backend opened that were never closed once the manager was destroyed; 0
+	/// unless a handle leaked
+	int64_t leaked;
+};
+
+/// Open sessions legacy sessions through a WfdSessionManager backed by a stand-in for the
+/// Wi-Fi Direct API that completes each open after 2-10 ms on a thread of its own, failing one in
+/// ten. Every fourth session is closed while it opens, the rest once all have reported.
+SessionBenchmarkResult RunSessionBenchmark(unsigned int sessions);
@@ -1,365 +1,1687 @@
-//*********************************************************
-//
-// Copyright (c) Microsoft. All rights reserved.
-// This code is licensed under the MIT License (MIT).
-// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
-// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
-// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
-// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
-//
-//*********************************************************
-
-#include "stdafx.h"
-#include "SimpleConsole.h"
-#include "WlanHostedNetworkWinRT.h"
-
-SimpleConsole::SimpleConsole()
-    : _apEvent(CreateEventEx(nullptr, nullptr, 0, WRITE_OWNER | EVENT_ALL_ACCESS))
-{
-    HRESULT hr = _apEvent.IsValid() ? S_OK : HRESULT_FROM_WIN32(GetLastError());
-    if (FAILED(hr))
-    {
-        std::wcout << "Failed to create AP event: " << hr << std::endl;
-        throw WlanHostedNetworkException("Create event failed", hr);
-    }
-
-    _hostedNetwork.RegisterListener(this);
-    _hostedNetwork.RegisterPrompt(this);
-	_hostedNetwork.RegisterPairRequest(this);
-
-    m_WFDHelper.Init();
-}
-
-SimpleConsole::~SimpleConsole()
-{
-    _hostedNetwork.RegisterListener(nullptr);
-    _hostedNetwork.RegisterPrompt(nullptr);
-	_hostedNetwork.RegisterPairRequest(nullptr);
-
-    m_WFDHelper.Close();
-}
-
-void SimpleConsole::RunConsole()
-{
-    std::wstring command;
-    bool running = true;
-
-    while (running)
-    {
-        // Show prompt and get input
-        ShowPrompt();
-        getline(std::wcin, command);
-
-        if (command.length() > 0)
-        {
-            // Run the command, return false if the command was to quit
-            try
-            {
-                running = ExecuteCommand(command);
-            }
-            catch (WlanHostedNetworkException& e)
-            {
-                std::wcout << "Caught Exception: " << e.what() << std::endl;
-            }
-        }
-    }
-}
-
-void SimpleConsole::OnDeviceConnected(std::wstring remoteHostName)
-{
-    std::wcout << std::endl << "Peer connected: " << remoteHostName << std::endl;
-}
-
-void SimpleConsole::OnDeviceDisconnected(std::wstring deviceId)
-{
-    std::wcout << std::endl << "Peer disconnected: " << deviceId << std::endl;
-}
-
-void SimpleConsole::OnAdvertisementStarted()
-{
-    std::wcout << "Soft AP started!" << std::endl
-        << "Peers can connect to: " << _hostedNetwork.GetSSID() << std::endl
-        << "Passphrase: " << _hostedNetwork.GetPassphrase() << std::endl;
-    SetEvent(_apEvent.Get());
-}
-
-void SimpleConsole::OnAdvertisementStopped(std::wstring message)
-{
-    std::wcout << "Soft AP stopped." << std::endl;
-    SetEvent(_apEvent.Get());
-}
-
-void SimpleConsole::OnAdvertisementAborted(std::wstring message)
-{
-    std::wcout << "Soft AP aborted: " << message << std::endl;
-    SetEvent(_apEvent.Get());
-}
-
-void SimpleConsole::OnEnumerationCompleted(std::wstring message)
-{
-	std::wcout << "Soft AP enumeration Completed: " << message << std::endl;
-	SetEvent(_apEvent.Get());
-}
-
-void SimpleConsole::OnEnumerationStopped(std::wstring message)
-{
-	std::wcout << "Soft AP enumeration Stopped: " << message << std::endl;
-	SetEvent(_apEvent.Get());
-}
-
-void SimpleConsole::OnDeviceAdded(std::wstring id, std::wstring name)
-{
-	std::wcout << "OnDeviceAdded: " << name << " " << id << std::endl;
-}
-
-void SimpleConsole::OnDeviceRemoved(std::wstring message)
-{
-	std::wcout << "OnDeviceRemoved: " << message << std::endl;
-}
-
-void SimpleConsole::OnDeviceUnpaired(std::wstring message)
-{
-	std::wcout << "OnDeviceUnpaired: " << message << std::endl;
-	SetEvent(_apEvent.Get());
-}
-
-void SimpleConsole::OnDevicePaired(std::wstring message)
-{
-	std::wcout << "OnDevicePaired: " << message << std::endl;
-	SetEvent(_apEvent.Get());
-}
-
-void SimpleConsole::OnDevicePairedError(std::wstring message, int errorCode)
-{
-    std::wcout << "OnDevicePaired: " << message << " " <<errorCode << std::endl;
-    SetEvent(_apEvent.Get());
-}
-
-void SimpleConsole::OnAsyncException(std::wstring message)
-{
-    std::wcout << std::endl << "Caught exception in asynchronous method: " << message << std::endl;
-}
-
-void SimpleConsole::LogMessage(std::wstring message)
-{
-    std::wcout << std::endl << message << std::endl;
-}
-
-bool SimpleConsole::AcceptIncommingConnection()
-{
-	std::wcout << std::endl << "Accept peer connection? (y/n)" << std::endl;
-
-	std::wstring response;
-	getline(std::wcin, response);
-
-	if (response.length() > 0 &&
-		(response[0] == 'y' || response[0] == 'Y'))
-	{
-		return true;
-	}
-
-	return false;
-}
-
-bool SimpleConsole::PairRequest(ABI::Windows::Devices::Enumeration::DevicePairingKinds kinds, std::wstring& strPin)
-{
-	if (kinds & ABI::Windows::Devices::Enumeration::DevicePairingKinds::DevicePairingKinds_ConfirmOnly)
-	{
-		std::wcout << std::endl << "Accept peer connection? (y/n)" << std::endl;
-
-		std::wstring response;
-		getline(std::wcin, response);
-
-		if (response.length() > 0 &&
-			(response[0] == 'y' || response[0] == 'Y'))
-		{
-			return true;
-		}
-	}
-	else if (kinds & ABI::Windows::Devices::Enumeration::DevicePairingKinds::DevicePairingKinds_DisplayPin)
-	{
-		std::wcout << std::endl << "Pin: " << strPin << " Accept peer connection? (y/n)" << std::endl;
-
-		std::wstring response;
-		getline(std::wcin, response);
-
-		if (response.length() > 0 &&
-			(response[0] == 'y' || response[0] == 'Y'))
-		{
-			return true;
-		}
-	}
-	else if (kinds & ABI::Windows::Devices::Enumeration::DevicePairingKinds::DevicePairingKinds_ProvidePin)
-	{
-		std::wcout << std::endl << "Please input Pin:" << std::endl;
-
-		std::wstring response;
-		getline(std::wcin, response);
-
-		if (response.length() >= 6)
-		{
-			return true;
-		}
-	}
-
-	return false;
-}
-
-void SimpleConsole::ShowPrompt()
-{
-    std::wcout << std::endl << ">";
-}
-
-void SimpleConsole::ShowHelp()
-{
-    std::wcout << std::endl
-        << "Wi-Fi Direct Legacy AP Demo Usage:" << std::endl
-        << "----------------------------------" << std::endl
-		<< "scan              : scan wifi direct device" << std::endl
-        << "start             : Start the legacy AP to accept connections" << std::endl
-        << "stop              : Stop the legacy AP" << std::endl
-        << "ssid <ssid>       : Configure the SSID before starting the legacy AP" << std::endl
-        << "pass <passphrase> : Configure the passphrase before starting the legacy AP" << std::endl
-        << "autoaccept <0|1>  : Configure the legacy AP to accept connections (default) or prompt the user" << std::endl
-        << "quit|exit         : Exit" << std::endl
-        << std::endl;
-}
-
-bool SimpleConsole::ExecuteCommand(std::wstring command)
-{
-    // Simple command parsing logic
-
-    if (command == L"quit" ||
-        command == L"exit")
-    {
-        std::wcout << std::endl << "Exiting" << std::endl;
-        return false;
-    }
-	else if (command == L"scan")
-	{
-		std::wcout << std::endl << "Scanning soft AP..." << std::endl;
-		_hostedNetwork.Scan();
-		WaitForSingleObjectEx(_apEvent.Get(), INFINITE, FALSE);
-	}
-    else if (command == L"start")
-    {
-        std::wcout << std::endl << "Starting soft AP..." << std::endl;
-        _hostedNetwork.Start();
-        WaitForSingleObjectEx(_apEvent.Get(), INFINITE, FALSE);
-    }
-    else if (command == L"stop")
-    {
-        std::wcout << std::endl << "Stopping soft AP..." << std::endl;
-        _hostedNetwork.Stop();
-        WaitForSingleObjectEx(_apEvent.Get(), INFINITE, FALSE);
-    }
-	else if (0 == command.compare(0, 7, L"connect"))
-	{
-		std::wstring::size_type found = command.find_first_of(' ', 0);
-		if (found != std::wstring::npos && found < command.length())
-		{
-			std::wstring id = command.substr(found + 1);
-			
-			_hostedNetwork.ConnectDevice(id.c_str());
-
-            //m_WFDHelper.Connect(id.c_str());
-		}
-	}
-	else if (0 == command.compare(0, 10, L"disconnect"))
-	{
-		std::wstring::size_type found = command.find_first_of(' ', 0);
-		if (found != std::wstring::npos && found < command.length())
-		{
-			std::wstring id = command.substr(found + 1);
-
-			_hostedNetwork.Disconnect(id.c_str());
-
-			//WaitForSingleObjectEx(_apEvent.Get(), INFINITE, FALSE);
-		}
-	}
-	else if (0 == command.compare(0, 4, L"pair"))
-	{
-		std::wstring::size_type found = command.find_first_of(' ', 0);
-		if (found != std::wstring::npos && found < command.length())
-		{
-			std::wstring id = command.substr(found + 1);
-
-			_hostedNetwork.Pair(id.c_str());
-
-			WaitForSingleObjectEx(_apEvent.Get(), INFINITE, FALSE);
-		}
-	}
-	else if (0 == command.compare(0, 6, L"unpair"))
-	{
-		std::wstring::size_type found = command.find_first_of(' ', 0);
-		if (found != std::wstring::npos && found < command.length())
-		{
-			std::wstring id = command.substr(found + 1);
-
-			_hostedNetwork.Unpair(id.c_str());
-
-			WaitForSingleObjectEx(_apEvent.Get(), INFINITE, FALSE);
-		}
-	}
-    else if (0 == command.compare(0, 4, L"ssid"))
-    {
-        // Parse the SSID as the first non-space character after ssid
-        std::wstring ssid;
-        std::wstring::size_type found = command.find_first_not_of(' ', 4);
-        if (found != std::wstring::npos && found < command.length())
-        {
-            ssid = command.substr(found);
-            std::wcout << std::endl << "Setting SSID to " << ssid << std::endl;
-            _hostedNetwork.SetSSID(ssid);
-        }
-        else
-        {
-            std::wcout << std::endl << "Setting SSID FAILED, bad input" << std::endl;
-        }
-    }
-    else if (0 == command.compare(0, 4, L"pass"))
-    {
-        // Parse the Passphrase as the first non-space character after pass
-        std::wstring passphrase;
-        std::wstring::size_type found = command.find_first_not_of(' ', 4);
-        if (found != std::wstring::npos && found < command.length())
-        {
-            passphrase = command.substr(found);
-            std::wcout << std::endl << "Setting Passphrase to " << passphrase << std::endl;
-            _hostedNetwork.SetPassphrase(passphrase);
-        }
-        else
-        {
-            std::wcout << std::endl << "Setting Passphrase FAILED, bad input" << std::endl;
-        }
-    }
-    else if (0 == command.compare(0, 10, L"autoaccept"))
-    {
-        std::wstring value;
-        std::wstring::size_type found = command.find_first_not_of(' ', 10);
-        if (found != std::wstring::npos && found < command.length())
-        {
-            value = command.substr(found);
-
-            bool autoAccept = true;
-
-            if (value == L"0")
-            {
-                autoAccept = false;
-            }
-
-            std::wcout << std::endl << "Setting AutoAccept to " << autoAccept << " (input was " << value << ")" << std::endl;
-            _hostedNetwork.SetAutoAccept(autoAccept);
-        }
-        else
-        {
-            std::wcout << std::endl << "Setting AutoAccpet FAILED, bad input" << std::endl;
-        }
-    }
-    else
-    {
-        ShowHelp();
-    }
-
-    return true;
-}
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include "SimpleConsole.h"
+#include "WlanHostedNetworkWinRT.h"
+#include "AsyncBenchmark.h"
+#include "MacAddress.h"
+#include "EventLog.h"
+#include "LogBenchmark.h"
+#include "StringBenchmark.h"
+#include "ReconnectBenchmark.h"
+#include "ConnectBenchmark.h"
+#include "ElementBenchmark.h"
+#include "RegistryBenchmark.h"
+#include "DeltaBenchmark.h"
+#include "QueueBenchmark.h"
+#include "DecisionBenchmark.h"
+#include "AdmissionBenchmark.h"
+#include "BusBenchmark.h"
+#include "PairingBenchmark.h"
+#include "SnapshotBenchmark.h"
+#include "PolicyBenchmark.h"
+#include "WheelBenchmark.h"
+#include "SessionBenchmark.h"
+#include "MacBenchmark.h"
+#include "EventBenchmark.h"
+
+/// Starting or stopping the legacy AP has no operation the helper can time out
+static const std::chrono::milliseconds AdvertisementTimeout(30000);
+
+/// The helper reports its own timeouts; on top of those this only catches operations nothing reports on
+static const std::chrono::milliseconds OperationGrace(5000);
+
+static std::wstring DescribeResult(HRESULT error, const std::wstring& message)
+{
+	std::wostringstream ss;
+	if (error == HRESULT_FROM_WIN32(ERROR_TIMEOUT))
+	{
+		ss << "no answer in time";
+	}
+	else if (FAILED(error))
+	{
+		ss << "FAILED " << error;
+	}
+	else
+	{
+		ss << "done";
+	}
+
+	if (!message.empty())
+	{
+		ss << ", " << message;
+	}
+	return ss.str();
+}
+
+static std::wstring DescribeResult(const OperationResult& result)
+{
+	return DescribeResult(result.error, result.message);
+}
+
+static std::wstring DescribeResult(const ScanResult& result)
+{
+	std::wostringstream ss;
+	ss << DescribeResult(result.error, result.message) << ", " << result.peers << " peers";
+	return ss.str();
+}
+
+static std::wstring DescribeResult(const PairResult& result)
+{
+	std::wostringstream ss;
+	ss << DescribeResult(result.error, std::wstring());
+	if (FAILED(result.error))
+	{
+		ss << ", error " << result.errorCode;
+	}
+	return ss.str();
+}
+
+SimpleConsole::SimpleConsole(bool usePeerCache)
+    : _policyPairRequest(_hostedNetwork, _pairingPolicy, this)
+{
+    _hostedNetwork.RegisterListener(this);
+    _hostedNetwork.RegisterPrompt(this);
+	_hostedNetwork.RegisterPairRequest(this);
+
+    if (usePeerCache)
+    {
+        try
+        {
+            _hostedNetwork.OpenPeerCache(L"WiFiDirectPeers.cache");
+        }
+        catch (WlanHostedNetworkException& e)
+        {
+            std::wcout << "Peer cache unavailable: " << e.what() << " " << e.GetErrorCode() << std::endl;
+        }
+
+        try
+        {
+            _hostedNetwork.OpenTrustStore(L"WiFiDirectTrust.log");
+        }
+        catch (WlanHostedNetworkException& e)
+        {
+            std::wcout << "Trust store unavailable: " << e.what() << " " << e.GetErrorCode() << std::endl;
+        }
+    }
+
+    m_WFDHelper.Init();
+}
+
+SimpleConsole::~SimpleConsole()
+{
+    _hostedNetwork.RegisterListener(nullptr);
+    _hostedNetwork.RegisterPrompt(nullptr);
+	_hostedNetwork.RegisterPairRequest(nullptr);
+	_pairingPolicy.StopWatching();
+
+    m_WFDHelper.Close();
+}
+
+void SimpleConsole::RunConsole()
+{
+    std::wstring command;
+    bool running = true;
+
+    while (running)
+    {
+        // Show prompt and get input
+        ShowPrompt();
+        getline(std::wcin, command);
+
+        if (command.length() > 0)
+        {
+            // Run the command, return false if the command was to quit
+            try
+            {
+                running = ExecuteCommand(command);
+            }
+            catch (WlanHostedNetworkException& e)
+            {
+                std::wcout << "Caught Exception: " << e.what() << std::endl;
+            }
+        }
+    }
+}
+
+void SimpleConsole::OnDeviceConnected(std::wstring remoteHostName)
+{
+    std::wcout << std::endl << "Peer connected: " << remoteHostName << std::endl;
+}
+
+void SimpleConsole::OnDevicesConnected(const ConnectBatchResult& result)
+{
+    std::wostringstream ss;
+    ss << std::endl << "Connected " << result.succeeded << " of " << result.devices.size() << " peers in " << result.elapsed.count() << " ms ("
+        << result.GetConnectionsPerSecond() << " per second), " << result.skipped << " already paired, "
+        << result.failed << " failed, " << result.timedOut << " timed out" << std::endl;
+
+    for (auto& device : result.devices)
+    {
+        if (device.outcome == ConnectOutcome::Failed || device.outcome == ConnectOutcome::TimedOut)
+        {
+            ss << (device.outcome == ConnectOutcome::Failed ? "  failed " : "  timed out ") << device.error << " " << device.deviceId << std::endl;
+        }
+    }
+
+    std::wcout << ss.str();
+}
+
+void SimpleConsole::OnDeviceDisconnected(std::wstring deviceId)
+{
+    std::wcout << std::endl << "Peer disconnected: " << deviceId << std::endl;
+}
+
+void SimpleConsole::OnAdvertisementStarted()
+{
+    std::wcout << "Soft AP started!" << std::endl
+        << "Peers can connect to: " << _hostedNetwork.GetSSID() << std::endl
+        << "Passphrase: " << _hostedNetwork.GetPassphrase() << std::endl;
+}
+
+void SimpleConsole::OnAdvertisementStopped(std::wstring message)
+{
+    std::wcout << "Soft AP stopped." << std::endl;
+}
+
+void SimpleConsole::OnAdvertisementAborted(std::wstring message)
+{
+    std::wcout << "Soft AP aborted: " << message << std::endl;
+}
+
+void SimpleConsole::OnEnumerationCompleted(std::wstring message)
+{
+	std::wcout << "Soft AP enumeration Completed: " << message << std::endl;
+}
+
+void SimpleConsole::OnEnumerationStopped(std::wstring message)
+{
+	std::wcout << "Soft AP enumeration Stopped: " << message << std::endl;
+}
+
+void SimpleConsole::OnPeersChanged(const PeerDelta& delta)
+{
+	// Format the whole delta first so a burst of peers costs one console write
+	std::wostringstream ss;
+	for (auto& change : delta.changes)
+	{
+		switch (change.kind)
+		{
+		case PeerChangeKind::Added:
+			ss << "OnDeviceAdded: " << change.name << " " << change.id;
+			break;
+		case PeerChangeKind::Updated:
+			ss << "OnDeviceUpdated: " << change.name << " " << change.id;
+			break;
+		case PeerChangeKind::Removed:
+			ss << "OnDeviceRemoved: " << change.id;
+			break;
+		}
+		ss << " (generation " << delta.generation << ")\n";
+	}
+
+	std::wcout << ss.str() << std::flush;
+}
+
+void SimpleConsole::OnDeviceUnpaired(std::wstring message)
+{
+	std::wcout << "OnDeviceUnpaired: " << message << std::endl;
+}
+
+void SimpleConsole::OnDevicePaired(std::wstring message)
+{
+	std::wcout << "OnDevicePaired: " << message << std::endl;
+}
+
+void SimpleConsole::OnDevicePairedError(std::wstring message, int errorCode)
+{
+    std::wcout << "OnDevicePaired: " << message << " " <<errorCode << std::endl;
+}
+
+void SimpleConsole::OnAsyncException(std::wstring message)
+{
+    std::wcout << std::endl << "Caught exception in asynchronous method: " << message << std::endl;
+}
+
+void SimpleConsole::LogMessage(std::wstring message)
+{
+    std::wcout << std::endl << message << std::endl;
+}
+
+void SimpleConsole::OnConnectionDecisionPending(const PendingDecision& decision)
+{
+	std::wcout << std::endl << "Peer " << decision.deviceId << " wants to connect" << std::endl
+		<< "Type 'accept " << decision.id << "' or 'decline " << decision.id << "'" << std::endl;
+}
+
+void SimpleConsole::OnPairingDecisionPending(const PendingDecision& decision)
+{
+	std::wcout << std::endl;
+
+	if (decision.pairingKinds & ABI::Windows::Devices::Enumeration::DevicePairingKinds::DevicePairingKinds_ConfirmOnly)
+	{
+		std::wcout << "Peer " << decision.deviceId << " wants to pair" << std::endl
+			<< "Type 'accept " << decision.id << "' or 'decline " << decision.id << "'" << std::endl;
+	}
+	else if (decision.pairingKinds & ABI::Windows::Devices::Enumeration::DevicePairingKinds::DevicePairingKinds_DisplayPin)
+	{
+		std::wcout << "Pin: " << decision.pin << " shown for peer " << decision.deviceId << std::endl
+			<< "Type 'accept " << decision.id << "' or 'decline " << decision.id << "'" << std::endl;
+	}
+	else if (decision.pairingKinds & ABI::Windows::Devices::Enumeration::DevicePairingKinds::DevicePairingKinds_ProvidePin)
+	{
+		std::wcout << "Peer " << decision.deviceId << " needs a pin" << std::endl
+			<< "Type 'accept " << decision.id << " <pin>' or 'decline " << decision.id << "'" << std::endl;
+	}
+	else
+	{
+		std::wcout << "Peer " << decision.deviceId << " requested an unsupported pairing kind, declining" << std::endl;
+		_hostedNetwork.ResolveDecision(decision.id, false);
+	}
+}
+
+void SimpleConsole::ShowPrompt()
+{
+    std::wcout << std::endl << ">";
+}
+
+static const wchar_t* PairingStateName(PeerPairingState state)
+{
+    switch (state)
+    {
+    case PeerPairingState::Pairing:
+        return L"pairing";
+    case PeerPairingState::Paired:
+        return L"paired";
+    case PeerPairingState::Failed:
+        return L"failed";
+    case PeerPairingState::Unpaired:
+        return L"unpaired";
+    default:
+        return L"unknown";
+    }
+}
+
+void SimpleConsole::ShowKnownPeers()
+{
+    std::vector<PeerCacheEntry> peers = _hostedNetwork.GetKnownPeers();
+
+    std::wcout << std::endl << peers.size() << " known peers" << std::endl;
+
+    for (auto& peer : peers)
+    {
+        const wchar_t* pairing = PairingStateName(static_cast<PeerPairingState>(peer.pairing));
+
+        FILETIME lastSeen;
+        SYSTEMTIME utc;
+        SYSTEMTIME local;
+        lastSeen.dwLowDateTime = static_cast<DWORD>(peer.lastSeen);
+        lastSeen.dwHighDateTime = static_cast<DWORD>(peer.lastSeen >> 32);
+        FileTimeToSystemTime(&lastSeen, &utc);
+        SystemTimeToTzSpecificLocalTime(nullptr, &utc, &local);
+
+        wchar_t line[64];
+        swprintf_s(line, _countof(line), L"%012llx %04u-%02u-%02u %02u:%02u:%02u %-8s ",
+            peer.mac, local.wYear, local.wMonth, local.wDay, local.wHour, local.wMinute, local.wSecond, pairing);
+
+        std::wcout << line << peer.name << " " << peer.id << std::endl;
+    }
+}
+
+void SimpleConsole::ShowTrustedPeers()
+{
+    std::vector<TrustEntry> entries = _hostedNetwork.GetTrustEntries();
+
+    std::wcout << std::endl << entries.size() << " peers in the trust store" << std::endl;
+
+    for (auto& entry : entries)
+    {
+        const wchar_t* trust = (entry.trust == PeerTrust::Trusted) ? L"trusted" : (entry.trust == PeerTrust::Banned) ? L"banned" : L"unknown";
+        const wchar_t* origin = (entry.origin == TrustOrigin::Pairing) ? L"paired" : L"manual";
+
+        wchar_t line[64];
+        swprintf_s(line, _countof(line), L"%012llx %-8s %-7s kinds %-3u result %-3d ", entry.mac, trust, origin, entry.pairingKinds, entry.pairingResult);
+
+        std::wcout << line << entry.id << std::endl;
+    }
+}
+
+void SimpleConsole::ShowPeerStatus()
+{
+    // Reads a published snapshot, so this never waits on watcher callbacks
+    auto snapshot = _hostedNetwork.GetPeerSnapshot();
+    if (!snapshot)
+    {
+        std::wcout << std::endl << "No peers" << std::endl;
+        return;
+    }
+
+    std::wcout << std::endl << snapshot->peers.size() << " peers (generation " << snapshot->generation << ")" << std::endl;
+
+    for (auto& entry : snapshot->peers)
+    {
+        const PeerSnapshotEntry& peer = *entry;
+        std::wcout << (peer.discovered ? L"discovered " : L"           ")
+            << (peer.connected ? L"connected " : L"          ")
+            << PairingStateName(peer.pairing) << " ";
+
+        if (peer.elements.hasDeviceType)
+        {
+            std::wcout << "type " << peer.elements.deviceCategory << "." << peer.elements.deviceSubCategory << " ";
+        }
+
+        if (peer.elements.hasVendorElement)
+        {
+            std::wcout << "vendor(" << peer.elements.vendorPayload.size() << " bytes) ";
+        }
+
+        std::wcout << peer.name << " " << peer.id << std::endl;
+    }
+}
+
+void SimpleConsole::ShowLegacySessions()
+{
+    std::vector<WfdSessionInfo> sessions = m_WFDHelper.GetSessions();
+    WfdSessionCounters counters = m_WFDHelper.GetCounters();
+
+    std::wcout << std::endl << sessions.size() << " legacy sessions (" << counters.opened << " opened, " << counters.failed << " failed, "
+        << counters.cancelled << " cancelled, " << counters.closed << " closed so far)" << std::endl;
+
+    for (auto& session : sessions)
+    {
+        const wchar_t* state = (session.state == WfdSessionState::Open) ? L"open" : (session.state == WfdSessionState::Opening) ? L"opening" : L"closing";
+
+        wchar_t address[MacAddressLength + 1];
+        FormatMacAddress(session.address, address);
+
+        wchar_t line[64];
+        swprintf_s(line, _countof(line), L"%s %-8s %llu ms", address, state, static_cast<unsigned long long>(session.age.count()));
+
+        std::wcout << line << std::endl;
+    }
+}
+
+void SimpleConsole::ShowStats()
+{
+    ActivationCounters activations = _hostedNetwork.GetActivationCounters();
+
+    std::wcout << std::endl
+        << "Activation factories: " << activations.factoriesResolved << " resolved, " << activations.factoriesReused << " reused" << std::endl
+        << "Connection parameters: " << activations.parametersActivated << " activated, " << activations.parametersReused << " reused" << std::endl;
+
+    AdmissionCounters admission = _hostedNetwork.GetAdmissionCounters();
+
+    std::wcout
+        << "Admission: " << admission.admitted << " admitted, " << admission.deferred << " deferred, " << admission.rejected << " rejected ("
+        << admission.expired << " waited too long, " << admission.evicted << " made way for known peers)" << std::endl;
+
+    PairingCounters pairings = _hostedNetwork.GetPairingCounters();
+
+    std::wcout
+        << "Pairings: " << pairings.paired << " paired, " << pairings.failed << " failed, " << pairings.duplicates << " duplicate requests ("
+        << static_cast<int>(pairings.GetCompletionRate() * 100) << "% completed, " << static_cast<int>(pairings.GetFailureRate() * 100) << "% failed, "
+        << pairings.GetMeanTime().count() << " ms mean)" << std::endl;
+
+    TrustStoreStats trust = _hostedNetwork.GetTrustStats();
+
+    std::wcout
+        << "Trust store: " << trust.lookups << " lookups, " << trust.trustedHits << " trusted, " << trust.bannedHits << " banned; "
+        << trust.records << " log records, " << trust.compactions << " compactions, " << trust.discarded << " torn records dropped" << std::endl;
+
+    PairingPolicyStats policy = _pairingPolicy.GetStats();
+    PolicyRequestCounters policyDecisions = _policyPairRequest.GetCounters();
+
+    std::wcout
+        << "Pairing policy: " << policy.rules << " rules, " << policy.provisioned << " provisioned PINs, " << policy.reloads << " loads ("
+        << policy.failedReloads << " failed); " << policyDecisions.accepted << " accepted, " << policyDecisions.rejected << " rejected, "
+        << policyDecisions.forwarded << " asked" << std::endl;
+
+    std::wstring policyError = _pairingPolicy.GetLoadError();
+    if (!policyError.empty())
+    {
+        std::wcout << "Pairing policy error: " << policyError << std::endl;
+    }
+
+    DecisionStats decisions = _hostedNetwork.GetDecisionStats();
+
+    std::wcout
+        << "Requests: " << decisions.accepted << " accepted, " << decisions.declined << " declined, " << decisions.timedOut << " timed out" << std::endl;
+
+    ReconnectStats reconnects = _hostedNetwork.GetReconnectStats();
+
+    std::wcout
+        << "Reconnects: " << reconnects.reconnected << " reconnected, " << reconnects.gaveUp << " gave up, " << reconnects.attempts << " attempts, "
+        << reconnects.GetMeanTimeToReconnect().count() << " ms mean time to reconnect" << std::endl;
+
+    uint64_t listenerDelivered = 0;
+    uint64_t listenerDropped = 0;
+    std::vector<SubscriberStats> listeners = _hostedNetwork.GetListenerStats();
+    for (auto& stats : listeners)
+    {
+        listenerDelivered += stats.delivered;
+        listenerDropped += stats.dropped;
+    }
+
+    std::wcout
+        << "Listeners: " << listeners.size() << " subscribed, " << listenerDelivered << " events delivered, " << listenerDropped << " dropped" << std::endl;
+
+    size_t deadlinesPending = 0;
+    TimerWheelStats deadlines = _hostedNetwork.GetDeadlineStats(deadlinesPending);
+
+    FramePoolStats frames = FramePool::Get().GetStats();
+
+    std::wcout
+        << "Coroutine frames: " << frames.reused << " reused, " << frames.allocated << " allocated, " << frames.freed << " freed, " << frames.cached << " pooled" << std::endl;
+
+    std::wcout
+        << "Deadlines: " << deadlinesPending << " pending, " << deadlines.armed << " armed, " << deadlines.cancelled << " met, " << deadlines.expired << " timed out" << std::endl;
+
+    LogStats log = EventLog::Instance().GetStats();
+
+    std::wcout
+        << "Log: " << log.written << " records written, " << log.dropped << " dropped, " << log.threads << " threads logging" << std::endl;
+
+    // Milliseconds with one decimal; the histograms keep microseconds
+    std::wostringstream ss;
+    ss << std::endl << "Phase latency (ms):        count      p50      p90      p99      max" << std::endl;
+    ss << std::fixed << std::setprecision(1);
+    for (size_t i = 0; i < static_cast<size_t>(LatencyPhase::Count); i++)
+    {
+        LatencyPhase phase = static_cast<LatencyPhase>(i);
+        const LatencyHistogram& latency = _hostedNetwork.GetLatency(phase);
+
+        ss << std::left << std::setw(24) << GetLatencyPhaseName(phase) << std::right
+            << std::setw(9) << latency.GetCount()
+            << std::setw(9) << latency.GetPercentile(0.50).count() / 1000.0
+            << std::setw(9) << latency.GetPercentile(0.90).count() / 1000.0
+            << std::setw(9) << latency.GetPercentile(0.99).count() / 1000.0
+            << std::setw(9) << latency.GetMax().count() / 1000.0 << std::endl;
+    }
+    std::wcout << ss.str();
+}
+
+void SimpleConsole::ShowPendingDecisions()
+{
+    std::vector<PendingDecision> pending = _hostedNetwork.GetPendingDecisions();
+    auto now = std::chrono::steady_clock::now();
+
+    std::wcout << std::endl << pending.size() << " pending requests" << std::endl;
+    for (auto& decision : pending)
+    {
+        auto remaining = std::chrono::duration_cast<std::chrono::seconds>(decision.deadline - now);
+
+        std::wcout << "  " << decision.id << ": "
+            << (decision.kind == DecisionKind::Connection ? L"connect " : L"pair    ")
+            << decision.deviceId << " (" << remaining.count() << " s left)" << std::endl;
+    }
+}
+
+void SimpleConsole::RunDecisionBenchmark(unsigned int requests)
+{
+    // Each request thread parks a request and returns, like a WinRT handler would; one decider
+    // thread answers them as they show up
+    DecisionBenchmarkResult result = ::RunDecisionBenchmark(requests);
+    const std::vector<uint32_t>& parkLatencies = result.latencies;
+    auto percentile = [&parkLatencies](double p)
+    {
+        return parkLatencies[static_cast<size_t>(p * (parkLatencies.size() - 1))];
+    };
+
+    std::wcout << std::endl
+        << requests << " simultaneous requests decided in " << result.seconds * 1000 << " ms, "
+        << static_cast<uint64_t>(requests / result.seconds) << " decisions/s, "
+        << result.stats.totalWait.count() / requests << " ms mean wait" << std::endl
+        << "handler blocked ns: p50 " << percentile(0.5) << ", p90 " << percentile(0.9)
+        << ", p99 " << percentile(0.99) << ", max " << parkLatencies.back() << std::endl;
+}
+
+void SimpleConsole::RunConnectionStormSimulation(unsigned int requests)
+{
+    ConnectionStormResult uncontrolled = SimulateConnectionStorm(requests, false);
+    ConnectionStormResult controlled = SimulateConnectionStorm(requests, true);
+
+    std::wcout << std::endl
+        << requests << " connection requests within 2 s, default admission settings" << std::endl
+        << "without admission: " << uncontrolled.succeeded << " paired, " << uncontrolled.failed << " failed, "
+        << uncontrolled.maxInFlight << " max in flight, done after " << uncontrolled.drained.count() << " ms" << std::endl
+        << "with admission:    " << controlled.succeeded << " paired, " << controlled.failed << " failed, "
+        << controlled.maxInFlight << " max in flight, done after " << controlled.drained.count() << " ms" << std::endl
+        << "                   " << controlled.counters.deferred << " deferred, " << controlled.counters.rejected << " rejected ("
+        << controlled.counters.expired << " waited too long, " << controlled.counters.evicted << " made way for known peers)" << std::endl;
+}
+
+void SimpleConsole::RunSnapshotStress(unsigned int operations)
+{
+	// Writers add and remove synthetic peers and publish snapshots while readers time lookups
+	SnapshotStressResult result = ::RunSnapshotStress(operations);
+	const std::vector<uint32_t>& all = result.latencies;
+	if (all.empty())
+	{
+		std::wcout << std::endl << "No reads completed" << std::endl;
+		return;
+	}
+
+	auto percentile = [&all](double p)
+	{
+		return all[static_cast<size_t>(p * (all.size() - 1))];
+	};
+
+	std::wcout << std::endl
+		<< operations << " add/remove operations on " << result.writers << " writers, "
+		<< all.size() << " lookups on " << result.readers << " readers" << std::endl
+		<< "read latency ns: p50 " << percentile(0.5) << ", p90 " << percentile(0.9)
+		<< ", p99 " << percentile(0.99) << ", p99.9 " << percentile(0.999)
+		<< ", max " << all.back() << std::endl
+		<< result.retired << " snapshots awaiting reclamation" << std::endl;
+}
+
+void SimpleConsole::RunQueueBenchmark(unsigned int messages)
+{
+    // Producers post counting messages to an event loop of their own and time every 64th Post
+    QueueBenchmarkResult result = ::RunQueueBenchmark(messages);
+    const std::vector<uint32_t>& all = result.latencies;
+    auto percentile = [&all](double p)
+    {
+        return all[static_cast<size_t>(p * (all.size() - 1))];
+    };
+
+    std::wcout << std::endl
+        << result.received << " messages from " << result.producers << " producers in " << result.batches << " batches, "
+        << static_cast<uint64_t>(result.messagesPerSecond) << " messages/s" << std::endl
+        << "enqueue latency ns: p50 " << percentile(0.5) << ", p90 " << percentile(0.9)
+        << ", p99 " << percentile(0.99) << ", p99.9 " << percentile(0.999)
+        << ", max " << all.back() << std::endl;
+}
+
+void SimpleConsole::RunSessionBenchmark(unsigned int sessions)
+{
+	std::wcout << std::endl << "Opening " << sessions << " simulated legacy sessions, closing every fourth while it opens:" << std::endl;
+
+	SessionBenchmarkResult result = ::RunSessionBenchmark(sessions);
+	const WfdSessionCounters& counters = result.counters;
+
+	std::wcout << std::fixed << std::setprecision(2)
+		<< "seconds " << result.seconds << ", sessions/s " << sessions / result.seconds << std::endl;
+	std::wcout.unsetf(std::ios::floatfield);
+	std::wcout << "opened " << counters.opened << ", failed " << counters.failed << ", cancelled " << counters.cancelled
+		<< ", closed " << counters.closed << std::endl
+		<< "slowest Open() " << result.slowestOpen.count() << " us, sessions left open " << result.leaked << std::endl;
+
+	if (result.unreported != 0)
+	{
+		std::wcout << result.unreported << " opens never reported back" << std::endl;
+	}
+}
+
+void SimpleConsole::RunPairingBenchmark(unsigned int devices)
+{
+	std::wcout << std::endl << "Pairing " << devices << " simulated devices:" << std::endl
+		<< "concurrent   seconds   pairings/s   paired   failed   mean ms" << std::endl;
+
+	for (const auto& path : ::RunPairingBenchmark(devices))
+	{
+		std::wcout << std::fixed << std::setprecision(2)
+			<< std::setw(10) << path.maxConcurrent
+			<< std::setw(10) << path.seconds
+			<< std::setw(13) << path.pairingsPerSecond
+			<< std::setw(9) << path.counters.paired
+			<< std::setw(9) << path.counters.failed
+			<< std::setw(10) << path.counters.GetMeanTime().count() << std::endl;
+		std::wcout.unsetf(std::ios::floatfield);
+	}
+}
+
+void SimpleConsole::RunBusBenchmark(unsigned int events)
+{
+	std::wcout << std::endl << "Fan-out of " << events << " events (ns per publish):" << std::endl
+		<< "listeners        p50      p99      max   delivered   dropped" << std::endl;
+
+	for (const auto& path : ::RunBusBenchmark(events))
+	{
+		const std::vector<uint32_t>& samples = path.latencies;
+		std::wostringstream label;
+		label << path.listeners << (path.slow ? L" (1 slow)" : L"");
+
+		std::wcout << std::left << std::setw(12) << label.str() << std::right
+			<< std::setw(9) << samples[samples.size() / 2]
+			<< std::setw(9) << samples[static_cast<size_t>(0.99 * (samples.size() - 1))]
+			<< std::setw(9) << samples.back()
+			<< std::setw(12) << path.delivered
+			<< std::setw(10) << path.dropped << std::endl;
+	}
+}
+
+void SimpleConsole::RunEventBenchmark(unsigned int events)
+{
+	std::vector<EventBenchmarkPath> paths = ::RunEventBenchmark(events);
+
+	std::wcout << std::endl << "Raising " << events << " events to " << paths[0].listeners << " listeners (allocations per raise and per delivery, ns per raise):" << std::endl;
+	if (!AllocationCounting::IsAvailable())
+	{
+		std::wcout << "(allocations are only counted in Debug builds)" << std::endl;
+	}
+	std::wcout << "path       raise  deliver       p50       p99   dropped" << std::endl;
+
+	for (const auto& path : paths)
+	{
+		const std::vector<uint32_t>& samples = path.latencies;
+		std::wcout << std::left << std::setw(8) << path.label << std::right << std::fixed << std::setprecision(2)
+			<< std::setw(8) << path.raiseAllocations
+			<< std::setw(9) << path.deliveryAllocations << std::defaultfloat
+			<< std::setw(10) << samples[samples.size() / 2]
+			<< std::setw(10) << samples[static_cast<size_t>(0.99 * (samples.size() - 1))]
+			<< std::setw(10) << path.dropped << std::endl;
+	}
+}
+
+void SimpleConsole::RunPolicyBenchmark(unsigned int rules)
+{
+	PolicyBenchmarkResult result = ::RunPolicyBenchmark(rules);
+	if (!result.error.empty())
+	{
+		std::wcout << std::endl << "Compiling benchmark rules FAILED at line " << result.errorLine << ": " << result.error << std::endl;
+		return;
+	}
+
+	std::wcout << std::endl << rules << " rules compiled in " << result.compileTime.count() << " us" << std::endl
+		<< "Evaluation (ns):" << std::endl
+		<< "peer                p50       p99       max   rule" << std::endl;
+
+	for (const auto& measured : result.cases)
+	{
+		const std::vector<uint32_t>& samples = measured.latencies;
+		std::wcout << std::left << std::setw(14) << measured.label << std::right
+			<< std::setw(10) << samples[samples.size() / 2]
+			<< std::setw(10) << samples[static_cast<size_t>(0.99 * (samples.size() - 1))]
+			<< std::setw(10) << samples.back()
+			<< std::setw(7) << measured.rule << std::endl;
+	}
+}
+
+void SimpleConsole::RunMacBenchmark(unsigned int ids)
+{
+	MacBenchmarkResult result = ::RunMacBenchmark(ids);
+
+	std::wcout << std::endl << ids << " parses of device IDs of " << result.idLength << " characters (ns per ID):" << std::endl;
+
+	for (const auto& path : result.paths)
+	{
+		std::wcout << std::left << std::setw(10) << path.label << std::right
+			<< std::fixed << std::setprecision(1) << std::setw(10) << path.nanoseconds << std::defaultfloat
+			<< "   " << path.accepted << " accepted, checksum " << std::hex << path.checksum << std::dec << std::endl;
+	}
+}
+
+void SimpleConsole::RunWheelBenchmark(unsigned int timers)
+{
+	WheelBenchmarkResult result = ::RunWheelBenchmark(timers);
+
+	std::wcout << std::endl << timers << " deadlines over " << result.spread << " ticks (ns per timer):" << std::endl
+		<< std::fixed << std::setprecision(1)
+		<< std::left << std::setw(10) << "arm" << std::right << std::setw(10) << result.armNanoseconds << std::endl
+		<< std::left << std::setw(10) << "cancel" << std::right << std::setw(10) << result.cancelNanoseconds << std::endl
+		<< std::left << std::setw(10) << "expire" << std::right << std::setw(10) << result.expireNanoseconds << std::endl
+		<< std::defaultfloat
+		<< result.fired << " expired, " << result.cascaded << " moved down a level on the way" << std::endl;
+}
+
+void SimpleConsole::RunCompletionBenchmark(unsigned int operations)
+{
+	std::vector<AsyncBenchmarkPath> paths = RunAsyncBenchmark(operations);
+
+	std::wcout << std::endl << "Completing " << operations << " connect operations (ns):" << std::endl;
+	if (!AllocationCounting::IsAvailable())
+	{
+		std::wcout << "(allocations are only counted in Debug builds)" << std::endl;
+	}
+	std::wcout << "path        allocs/op       p50       p99       max" << std::endl;
+
+	for (auto& path : paths)
+	{
+		std::vector<uint32_t>& samples = path.latencies;
+		if (samples.empty())
+		{
+			continue;
+		}
+
+		std::sort(samples.begin(), samples.end());
+		std::wcout << std::left << std::setw(10) << path.label << std::right
+			<< std::fixed << std::setprecision(2) << std::setw(11) << path.allocations << std::defaultfloat
+			<< std::setw(10) << samples[samples.size() / 2]
+			<< std::setw(10) << samples[static_cast<size_t>(0.99 * (samples.size() - 1))]
+			<< std::setw(10) << samples.back() << std::endl;
+	}
+}
+
+void SimpleConsole::RunLogBenchmark(unsigned int records)
+{
+	std::wcout << std::endl << "Logging " << records << " statements per thread (ns per statement):" << std::endl
+		<< "path        threads      mean       p50       p99       max   dropped" << std::endl;
+
+	for (unsigned int threads : { 1u, 4u })
+	{
+		std::vector<LogBenchmarkPath> paths = ::RunLogBenchmark(records, threads);
+		for (auto& path : paths)
+		{
+			std::vector<uint32_t>& samples = path.latencies;
+			if (samples.empty())
+			{
+				continue;
+			}
+
+			std::sort(samples.begin(), samples.end());
+			std::wcout << std::left << std::setw(12) << path.label << std::right
+				<< std::setw(7) << path.threads
+				<< std::fixed << std::setprecision(1) << std::setw(10) << path.mean << std::defaultfloat
+				<< std::setw(10) << samples[samples.size() / 2]
+				<< std::setw(10) << samples[static_cast<size_t>(0.99 * (samples.size() - 1))]
+				<< std::setw(10) << samples.back()
+				<< std::setw(10) << path.dropped << std::endl;
+		}
+	}
+}
+
+void SimpleConsole::RunStringBenchmark(unsigned int strings)
+{
+	std::wcout << std::endl << "Transcoding " << strings << " strings each way:" << std::endl
+		<< "path             text         ns     MB/s" << std::endl;
+
+	for (const auto& path : RunTranscodeBenchmark(strings))
+	{
+		std::wcout << std::left << std::setw(17) << path.label << std::setw(6) << path.text << std::right
+			<< std::fixed << std::setprecision(1) << std::setw(11) << path.nanoseconds
+			<< std::setprecision(0) << std::setw(9) << path.megabytes << std::defaultfloat << std::endl;
+	}
+
+	const unsigned int peers = 100000;
+	std::wcout << std::endl << "IDs and names of " << peers << " peers:" << std::endl
+		<< "storage        object MB   heap MB  total MB  allocations" << std::endl;
+
+	for (const auto& path : RunFootprintBenchmark(peers))
+	{
+		const double megabyte = 1024.0 * 1024.0;
+		std::wcout << std::left << std::setw(13) << path.label << std::right
+			<< std::fixed << std::setprecision(2) << std::setw(12) << path.objectBytes / megabyte
+			<< std::setw(10) << path.heapBytes / megabyte
+			<< std::setw(10) << (path.objectBytes + path.heapBytes) / megabyte << std::defaultfloat
+			<< std::setw(13) << path.allocations << std::endl;
+	}
+}
+
+void SimpleConsole::CheckPeerDeltas(unsigned int peers)
+{
+	std::wcout << std::endl << "Synthetic watcher events:" << std::endl;
+	for (const auto& check : RunDeltaChecks())
+	{
+		std::wcout << "  " << std::left << std::setw(18) << check.label << std::right
+			<< (check.passed ? L"passed" : L"FAILED: ") << check.detail << std::endl;
+	}
+
+	const unsigned int rescans = 100;
+	DeltaBenchmarkResult result = RunDeltaBenchmark(peers, rescans);
+	std::wcout << "Rescanning " << result.peers << " peers " << result.rescans << " times: "
+		<< std::fixed << std::setprecision(1) << result.nanoseconds << " ns per watcher event, "
+		<< result.changes << " changes per rescan (" << result.rescanChanges << " with clear-and-rescan)" << std::defaultfloat << std::endl;
+}
+
+void SimpleConsole::RunPeerTableBenchmark(unsigned int lookups)
+{
+	std::wcout << std::endl << "Peer tables, " << lookups << " lookups in random order (ns):" << std::endl
+		<< "layout          peers    insert    lookup  by handle" << std::endl;
+
+	for (unsigned int peers : { 10000u, 100000u })
+	{
+		for (const auto& path : RunRegistryBenchmark(peers, lookups))
+		{
+			std::wcout << std::left << std::setw(13) << path.label << std::right
+				<< std::setw(8) << path.peers
+				<< std::fixed << std::setprecision(1) << std::setw(10) << path.insert
+				<< std::setw(10) << path.lookup << std::defaultfloat;
+			if (path.handleLookup != 0.0)
+			{
+				std::wcout << std::fixed << std::setprecision(1) << std::setw(11) << path.handleLookup << std::defaultfloat;
+			}
+			else
+			{
+				std::wcout << std::setw(11) << L"-";
+			}
+			std::wcout << std::endl;
+		}
+	}
+}
+
+void SimpleConsole::RunElementBenchmark(unsigned int lookups)
+{
+	std::wcout << std::endl << "Looking through element buffers " << lookups << " times each:" << std::endl
+		<< "lookup       buffer      bytes        ns     MB/s" << std::endl;
+
+	for (const auto& path : ::RunElementBenchmark(lookups))
+	{
+		std::wcout << std::left << std::setw(13) << path.label << std::setw(10) << path.buffer << std::right
+			<< std::setw(7) << path.bytes
+			<< std::fixed << std::setprecision(1) << std::setw(10) << path.nanoseconds
+			<< std::setprecision(0) << std::setw(9) << path.megabytes << std::defaultfloat << std::endl;
+	}
+}
+
+void SimpleConsole::RunConnectBenchmark(unsigned int devices)
+{
+	std::wcout << std::endl << "Connecting " << devices << " simulated devices per batch:" << std::endl
+		<< "latency  in flight  succeeded  failed  timed out        ms  connects/s" << std::endl;
+
+	for (const auto& path : ::RunConnectBenchmark(devices))
+	{
+		std::wcout << std::setw(5) << path.latencyMs << " ms" << std::setw(11) << path.maxInFlight
+			<< std::setw(11) << path.result.succeeded << std::setw(8) << path.result.failed << std::setw(11) << path.result.timedOut
+			<< std::fixed << std::setprecision(1) << std::setw(10) << path.seconds * 1000
+			<< std::setprecision(0) << std::setw(12) << path.connectionsPerSecond << std::defaultfloat << std::endl;
+	}
+}
+
+void SimpleConsole::SimulateFlappingPeers(unsigned int devices)
+{
+	std::wcout << std::endl << "Ten simulated minutes of " << devices << " flapping devices:" << std::endl
+		<< "schedule     reconnect  drops  reconnected  gave up  attempts  mean ms  connected" << std::endl;
+
+	for (const auto& result : RunFlapSimulation(devices))
+	{
+		std::wcout << std::left << std::setw(13) << result.label << std::setw(9) << (result.reconnect ? L"on" : L"off") << std::right
+			<< std::setw(7) << result.drops << std::setw(13) << result.stats.reconnected << std::setw(9) << result.stats.gaveUp
+			<< std::setw(10) << result.stats.attempts << std::setw(9) << result.stats.GetMeanTimeToReconnect().count()
+			<< std::fixed << std::setprecision(1) << std::setw(10) << result.connectedPercent << "%" << std::defaultfloat << std::endl;
+	}
+}
+
+template <typename TResult>
+void SimpleConsole::WaitForOperation(const std::wstring& label, const Completion<TResult>& completion, bool background)
+{
+	if (background)
+	{
+		BackgroundOperation operation;
+		operation.label = label;
+		operation.completion = completion;
+		operation.describe = [completion]() { return DescribeResult(completion.Get()); };
+		_background.push_back(operation);
+
+		std::wcout << std::endl << label << ": running in the background, " << _background.size() << " pending" << std::endl;
+		return;
+	}
+
+	// Every operation was started with a deadline, so this returns
+	completion.Wait();
+	std::wcout << label << ": " << DescribeResult(completion.Get()) << std::endl;
+}
+
+void SimpleConsole::WaitForBackground()
+{
+	if (_background.empty())
+	{
+		std::wcout << std::endl << "No operations running in the background" << std::endl;
+		return;
+	}
+
+	// Report each one as it finishes, whichever it is
+	std::wcout << std::endl;
+	while (!_background.empty())
+	{
+		std::vector<CompletionHandle> completions;
+		for (auto& operation : _background)
+		{
+			completions.push_back(operation.completion);
+		}
+
+		size_t index = WaitAny(completions);
+		std::wcout << _background[index].label << ": " << _background[index].describe() << std::endl;
+		_background.erase(_background.begin() + index);
+	}
+}
+
+void SimpleConsole::ShowHelp()
+{
+    std::wcout << std::endl
+        << "Wi-Fi Direct Legacy AP Demo Usage:" << std::endl
+        << "----------------------------------" << std::endl
+		<< "scan              : scan wifi direct device" << std::endl
+		<< "peers             : List peers known from earlier scans (usable before scanning)" << std::endl
+		<< "status            : List currently discovered and connected peers" << std::endl
+		<< "trusted           : List peers in the trust store" << std::endl
+		<< "trust|ban <id>    : Accept a peer without asking from now on, or reject it outright" << std::endl
+		<< "forget <id>       : Remove a peer from the trust store" << std::endl
+		<< "stats             : Show activations avoided by caching, reconnect results and connect/pair phase latencies" << std::endl
+		<< "stress [ops]      : Time lock-free peer lookups while adding and removing synthetic peers" << std::endl
+		<< "tablebench [n]    : Compare inserting 10000 and 100000 peers and <n> (default 1000000) lookups, std::map tables vs the registry" << std::endl
+		<< "queuebench [msgs] : Measure event loop throughput and enqueue latency" << std::endl
+		<< "busbench [n]      : Measure publishing <n> (default 100000) events to 1, 4 and 16 listeners" << std::endl
+		<< "eventbench [n]    : Count allocations per event raising <n> (default 100000) events to v1 and v2 listeners" << std::endl
+		<< "pairbench [n]     : Measure pairing <n> (default 200) simulated devices at several concurrency limits" << std::endl
+		<< "session <id>      : Open a legacy session to a peer in the background" << std::endl
+		<< "endsession <id>   : Close a legacy session, or cancel it while it opens" << std::endl
+		<< "sessions          : List legacy sessions that are open or opening" << std::endl
+		<< "sessionbench [n]  : Open <n> (default 1000) simulated legacy sessions at once and check none is left behind" << std::endl
+		<< "pairlimit <n>     : Pair at most <n> (default 4) devices at once" << std::endl
+		<< "policy <file|off> : Decide pairing requests by the rules in <file>, reloaded when it changes" << std::endl
+		<< "policybench [n]   : Measure evaluating pairing rules against a rule set of <n> (default 10000) rules" << std::endl
+		<< "optimeout <op> <ms> : Cancel connect, pair, resolve, unpair or scan operations still pending after <ms> milliseconds" << std::endl
+		<< "logbench [n]      : Measure logging <n> (default 100000) statements per thread, snprintf as before vs the log rings" << std::endl
+		<< "macbench [n]      : Compare parsing the MAC out of <n> (default 100000) device IDs with swscanf_s and the peer key parser" << std::endl
+		<< "wheelbench [n]    : Measure arming, cancelling and expiring <n> (default 100000) operation deadlines" << std::endl
+		<< "asyncbench [n]    : Compare allocations and latency of <n> (default 10000) connect completions, callback vs coroutine" << std::endl
+		<< "strbench [n]      : Measure transcoding <n> (default 1000000) device IDs and names, and what 100000 peers' IDs and names take" << std::endl
+		<< "pending           : List connection and pairing requests waiting for a decision" << std::endl
+		<< "accept <id> [pin] : Accept a pending request, with the pin if the peer needs one" << std::endl
+		<< "decline <id>      : Decline a pending request" << std::endl
+		<< "timeout <ms> <0|1>: Decide requests left pending for <ms> milliseconds: 1 accepts, 0 declines (default)" << std::endl
+		<< "decisionbench [n] : Measure deciding <n> (default 100) simultaneous requests" << std::endl
+		<< "admission <rate> <burst> <inflight> [queue] : Limit connections to <rate>/s with bursts of <burst>, <inflight> pairing at once" << std::endl
+		<< "stormsim [n]      : Simulate <n> (default 100) connection requests arriving at once, with and without admission" << std::endl
+		<< "connectall [max]  : Connect every discovered peer, at most [max] (default 4) at a time" << std::endl
+		<< "connectbench [n]  : Measure connecting <n> (default 100) devices of a simulated WiFiDirectDevice factory at several concurrency limits" << std::endl
+		<< "oui <hex> [type]  : Report peers advertising a vendor element with this OUI and vendor type, 0 to disable" << std::endl
+		<< "iebench [n]       : Measure finding the device type and a vendor OUI in sample element buffers <n> (default 1000000) times" << std::endl
+		<< "batch <ms> [max]  : Deliver peer changes in batches of up to <ms> milliseconds / [max] changes, 0 to disable" << std::endl
+		<< "continuous <0|1>  : Keep scanning after the first enumeration and report peer changes as they happen" << std::endl
+		<< "deltacheck [n]    : Check the deltas synthetic watcher events produce and time rescans of <n> (default 1000) peers" << std::endl
+		<< "reconnect <0|1> [attempts] : Reconnect peers that drop, giving up after [attempts] (default 8) failures" << std::endl
+		<< "flapsim [n]       : Simulate reconnecting <n> (default 20) devices that drop on a schedule" << std::endl
+        << "start             : Start the legacy AP to accept connections" << std::endl
+		<< "<command> &       : Run scan, start, stop, pair or unpair in the background and return to the prompt" << std::endl
+		<< "wait              : Wait for operations running in the background, reporting each as it finishes" << std::endl
+        << "stop              : Stop the legacy AP" << std::endl
+        << "ssid <ssid>       : Configure the SSID before starting the legacy AP" << std::endl
+        << "pass <passphrase> : Configure the passphrase before starting the legacy AP" << std::endl
+        << "autoaccept <0|1>  : Configure the legacy AP to accept connections (default) or prompt the user" << std::endl
+        << "quit|exit         : Exit" << std::endl
+        << std::endl;
+}
+
+bool SimpleConsole::ExecuteCommand(std::wstring command)
+{
+    // Simple command parsing logic
+
+	// A trailing & leaves the operation running and returns to the prompt; see wait
+	bool background = false;
+	if (command.length() > 2 && 0 == command.compare(command.length() - 2, 2, L" &"))
+	{
+		background = true;
+		command.erase(command.length() - 2);
+	}
+
+    if (command == L"quit" ||
+        command == L"exit")
+    {
+        std::wcout << std::endl << "Exiting" << std::endl;
+        return false;
+    }
+	else if (command == L"wait")
+	{
+		WaitForBackground();
+	}
+	else if (command == L"scan")
+	{
+		std::wcout << std::endl << "Scanning soft AP..." << std::endl;
+		WaitForOperation(L"scan", _hostedNetwork.Scan(_hostedNetwork.GetOperationTimeouts().enumeration + OperationGrace), background);
+	}
+    else if (command == L"start")
+    {
+        std::wcout << std::endl << "Starting soft AP..." << std::endl;
+        WaitForOperation(L"start", _hostedNetwork.Start(AdvertisementTimeout), background);
+    }
+    else if (command == L"stop")
+    {
+        std::wcout << std::endl << "Stopping soft AP..." << std::endl;
+        WaitForOperation(L"stop", _hostedNetwork.Stop(AdvertisementTimeout), background);
+    }
+	else if (0 == command.compare(0, 12, L"connectbench"))
+	{
+		unsigned int devices = 100;
+		if (command.length() > 13)
+		{
+			devices = static_cast<unsigned int>(wcstoul(command.substr(13).c_str(), nullptr, 10));
+		}
+
+		if (devices != 0)
+		{
+			RunConnectBenchmark(devices);
+		}
+	}
+	else if (0 == command.compare(0, 10, L"connectall"))
+	{
+		std::wistringstream input(command.substr(10));
+		size_t maxInFlight;
+		if (!(input >> maxInFlight))
+		{
+			maxInFlight = 4;
+		}
+
+		std::vector<std::wstring> ids;
+		{
+			auto snapshot = _hostedNetwork.GetPeerSnapshot();
+			if (snapshot)
+			{
+				for (auto& peer : snapshot->peers)
+				{
+					if (peer->discovered && !peer->connected)
+					{
+						ids.push_back(peer->id);
+					}
+				}
+			}
+		}
+
+		std::wcout << std::endl << "Connecting " << ids.size() << " peers, " << maxInFlight << " at a time" << std::endl;
+		_hostedNetwork.ConnectDevices(ids, maxInFlight);
+	}
+	else if (0 == command.compare(0, 7, L"connect"))
+	{
+		std::wstring::size_type found = command.find_first_of(' ', 0);
+		if (found != std::wstring::npos && found < command.length())
+		{
+			std::wstring id = command.substr(found + 1);
+			
+			_hostedNetwork.ConnectDevice(id.c_str());
+		}
+	}
+	else if (0 == command.compare(0, 10, L"disconnect"))
+	{
+		std::wstring::size_type found = command.find_first_of(' ', 0);
+		if (found != std::wstring::npos && found < command.length())
+		{
+			std::wstring id = command.substr(found + 1);
+
+			_hostedNetwork.Disconnect(id.c_str());
+		}
+	}
+	else if (0 == command.compare(0, 12, L"sessionbench"))
+	{
+		unsigned int sessions = 1000;
+		if (command.length() > 13)
+		{
+			sessions = static_cast<unsigned int>(wcstoul(command.substr(13).c_str(), nullptr, 10));
+		}
+
+		if (sessions != 0)
+		{
+			RunSessionBenchmark(sessions);
+		}
+	}
+	else if (command == L"sessions")
+	{
+		ShowLegacySessions();
+	}
+	else if (0 == command.compare(0, 8, L"session "))
+	{
+		std::wstring id = command.substr(8);
+
+		// Returns right away; the session opens in the background
+		HRESULT hr = m_WFDHelper.Connect(id.c_str(), [id](uint64_t, uint32_t error, uint32_t reason)
+		{
+			if (error == 0)
+			{
+				std::wcout << std::endl << "Legacy session to " << id << " open" << std::endl;
+			}
+			else
+			{
+				std::wcout << std::endl << "Legacy session to " << id << " FAILED: " << error << ", reason " << reason << std::endl;
+			}
+		});
+
+		if (FAILED(hr))
+		{
+			std::wcout << std::endl << "Opening legacy session FAILED: " << hr << std::endl;
+		}
+	}
+	else if (0 == command.compare(0, 11, L"endsession "))
+	{
+		HRESULT hr = m_WFDHelper.Disconnect(command.substr(11).c_str());
+		if (FAILED(hr))
+		{
+			std::wcout << std::endl << "Closing legacy session FAILED: " << hr << std::endl;
+		}
+	}
+	else if (0 == command.compare(0, 9, L"pairbench"))
+	{
+		unsigned int devices = 200;
+		if (command.length() > 10)
+		{
+			devices = static_cast<unsigned int>(wcstoul(command.substr(10).c_str(), nullptr, 10));
+		}
+
+		if (devices != 0)
+		{
+			RunPairingBenchmark(devices);
+		}
+	}
+	else if (0 == command.compare(0, 9, L"pairlimit"))
+	{
+		std::wistringstream input(command.substr(9));
+		uint32_t limit = 0;
+		if (input >> limit && limit != 0)
+		{
+			_hostedNetwork.SetMaxConcurrentPairings(limit);
+			std::wcout << std::endl << "Pairing up to " << limit << " devices at once" << std::endl;
+		}
+		else
+		{
+			std::wcout << std::endl << "Setting pairing limit FAILED, bad input" << std::endl;
+		}
+	}
+	else if (0 == command.compare(0, 10, L"asyncbench"))
+	{
+		unsigned int operations = 10000;
+		if (command.length() > 11)
+		{
+			operations = static_cast<unsigned int>(wcstoul(command.substr(11).c_str(), nullptr, 10));
+		}
+
+		if (operations != 0)
+		{
+			RunCompletionBenchmark(operations);
+		}
+	}
+	else if (0 == command.compare(0, 8, L"logbench"))
+	{
+		unsigned int records = 100000;
+		if (command.length() > 9)
+		{
+			records = static_cast<unsigned int>(wcstoul(command.substr(9).c_str(), nullptr, 10));
+		}
+
+		if (records != 0)
+		{
+			RunLogBenchmark(records);
+		}
+	}
+	else if (0 == command.compare(0, 10, L"deltacheck"))
+	{
+		unsigned int peers = 1000;
+		if (command.length() > 11)
+		{
+			peers = static_cast<unsigned int>(wcstoul(command.substr(11).c_str(), nullptr, 10));
+		}
+
+		if (peers != 0)
+		{
+			CheckPeerDeltas(peers);
+		}
+	}
+	else if (0 == command.compare(0, 10, L"tablebench"))
+	{
+		unsigned int lookups = 1000000;
+		if (command.length() > 11)
+		{
+			lookups = static_cast<unsigned int>(wcstoul(command.substr(11).c_str(), nullptr, 10));
+		}
+
+		if (lookups != 0)
+		{
+			RunPeerTableBenchmark(lookups);
+		}
+	}
+	else if (0 == command.compare(0, 7, L"iebench"))
+	{
+		unsigned int lookups = 1000000;
+		if (command.length() > 8)
+		{
+			lookups = static_cast<unsigned int>(wcstoul(command.substr(8).c_str(), nullptr, 10));
+		}
+
+		if (lookups != 0)
+		{
+			RunElementBenchmark(lookups);
+		}
+	}
+	else if (0 == command.compare(0, 7, L"flapsim"))
+	{
+		unsigned int devices = 20;
+		if (command.length() > 8)
+		{
+			devices = static_cast<unsigned int>(wcstoul(command.substr(8).c_str(), nullptr, 10));
+		}
+
+		if (devices != 0)
+		{
+			SimulateFlappingPeers(devices);
+		}
+	}
+	else if (0 == command.compare(0, 8, L"strbench"))
+	{
+		unsigned int strings = 1000000;
+		if (command.length() > 9)
+		{
+			strings = static_cast<unsigned int>(wcstoul(command.substr(9).c_str(), nullptr, 10));
+		}
+
+		if (strings != 0)
+		{
+			RunStringBenchmark(strings);
+		}
+	}
+	else if (0 == command.compare(0, 8, L"macbench"))
+	{
+		unsigned int ids = 100000;
+		if (command.length() > 9)
+		{
+			ids = static_cast<unsigned int>(wcstoul(command.substr(9).c_str(), nullptr, 10));
+		}
+
+		if (ids != 0)
+		{
+			RunMacBenchmark(ids);
+		}
+	}
+	else if (0 == command.compare(0, 10, L"wheelbench"))
+	{
+		unsigned int timers = 100000;
+		if (command.length() > 11)
+		{
+			timers = static_cast<unsigned int>(wcstoul(command.substr(11).c_str(), nullptr, 10));
+		}
+
+		if (timers != 0)
+		{
+			RunWheelBenchmark(timers);
+		}
+	}
+	else if (0 == command.compare(0, 10, L"optimeout "))
+	{
+		std::wistringstream input(command.substr(10));
+		std::wstring operation;
+		unsigned long timeoutMs = 0;
+		OperationTimeouts timeouts = _hostedNetwork.GetOperationTimeouts();
+
+		std::chrono::milliseconds* timeout = nullptr;
+		if (input >> operation >> timeoutMs && timeoutMs != 0)
+		{
+			timeout = (operation == L"connect") ? &timeouts.connect :
+				(operation == L"pair") ? &timeouts.pairing :
+				(operation == L"resolve") ? &timeouts.resolve :
+				(operation == L"unpair") ? &timeouts.unpair :
+				(operation == L"scan") ? &timeouts.enumeration : nullptr;
+		}
+
+		if (timeout != nullptr)
+		{
+			*timeout = std::chrono::milliseconds(timeoutMs);
+			_hostedNetwork.SetOperationTimeouts(timeouts);
+			std::wcout << std::endl << "Cancelling " << operation << " operations after " << timeoutMs << " ms" << std::endl;
+		}
+		else
+		{
+			std::wcout << std::endl << "Setting operation timeout FAILED, bad input" << std::endl;
+		}
+	}
+	else if (0 == command.compare(0, 11, L"policybench"))
+	{
+		unsigned int rules = 10000;
+		if (command.length() > 12)
+		{
+			rules = static_cast<unsigned int>(wcstoul(command.substr(12).c_str(), nullptr, 10));
+		}
+
+		if (rules != 0)
+		{
+			RunPolicyBenchmark(rules);
+		}
+	}
+	else if (0 == command.compare(0, 7, L"policy "))
+	{
+		std::wstring path = command.substr(7);
+		if (path == L"off")
+		{
+			_hostedNetwork.RegisterPairRequest(this);
+			_pairingPolicy.StopWatching();
+			std::wcout << std::endl << "Pairing requests are asked here again" << std::endl;
+		}
+		else
+		{
+			HRESULT hr = _pairingPolicy.Load(path.c_str());
+			if (SUCCEEDED(hr))
+			{
+				_hostedNetwork.RegisterPairRequest(&_policyPairRequest);
+
+				PairingPolicyStats stats = _pairingPolicy.GetStats();
+				std::wcout << std::endl << "Pairing by " << stats.rules << " rules from " << path << ", reloaded when it changes" << std::endl;
+			}
+			else
+			{
+				std::wcout << std::endl << "Loading pairing policy FAILED: " << _pairingPolicy.GetLoadError() << " " << hr << std::endl;
+			}
+		}
+	}
+	else if (0 == command.compare(0, 4, L"pair"))
+	{
+		std::wstring::size_type found = command.find_first_of(' ', 0);
+		if (found != std::wstring::npos && found < command.length())
+		{
+			std::wstring id = command.substr(found + 1);
+
+			// A cached peer is looked up before the ceremony starts
+			OperationTimeouts timeouts = _hostedNetwork.GetOperationTimeouts();
+			WaitForOperation(L"pair " + id, _hostedNetwork.Pair(id.c_str(), timeouts.resolve + timeouts.pairing + OperationGrace), background);
+		}
+	}
+	else if (0 == command.compare(0, 6, L"unpair"))
+	{
+		std::wstring::size_type found = command.find_first_of(' ', 0);
+		if (found != std::wstring::npos && found < command.length())
+		{
+			std::wstring id = command.substr(found + 1);
+
+			WaitForOperation(L"unpair " + id, _hostedNetwork.Unpair(id.c_str(), _hostedNetwork.GetOperationTimeouts().unpair + OperationGrace), background);
+		}
+	}
+    else if (0 == command.compare(0, 4, L"ssid"))
+    {
+        // Parse the SSID as the first non-space character after ssid
+        std::wstring ssid;
+        std::wstring::size_type found = command.find_first_not_of(' ', 4);
+        if (found != std::wstring::npos && found < command.length())
+        {
+            ssid = command.substr(found);
+            std::wcout << std::endl << "Setting SSID to " << ssid << std::endl;
+            _hostedNetwork.SetSSID(ssid);
+        }
+        else
+        {
+            std::wcout << std::endl << "Setting SSID FAILED, bad input" << std::endl;
+        }
+    }
+    else if (0 == command.compare(0, 4, L"pass"))
+    {
+        // Parse the Passphrase as the first non-space character after pass
+        std::wstring passphrase;
+        std::wstring::size_type found = command.find_first_not_of(' ', 4);
+        if (found != std::wstring::npos && found < command.length())
+        {
+            passphrase = command.substr(found);
+            std::wcout << std::endl << "Setting Passphrase to " << passphrase << std::endl;
+            _hostedNetwork.SetPassphrase(passphrase);
+        }
+        else
+        {
+            std::wcout << std::endl << "Setting Passphrase FAILED, bad input" << std::endl;
+        }
+    }
+	else if (command == L"peers")
+	{
+		ShowKnownPeers();
+	}
+	else if (command == L"status")
+	{
+		ShowPeerStatus();
+	}
+	else if (command == L"stats")
+	{
+		ShowStats();
+	}
+	else if (command == L"trusted")
+	{
+		ShowTrustedPeers();
+	}
+	else if (0 == command.compare(0, 6, L"trust ") || 0 == command.compare(0, 4, L"ban ") || 0 == command.compare(0, 7, L"forget "))
+	{
+		std::wstring::size_type found = command.find_first_of(' ', 0);
+		std::wstring id = command.substr(found + 1);
+
+		PeerTrust trust = PeerTrust::Unknown;
+		if (command[0] == L't')
+		{
+			trust = PeerTrust::Trusted;
+		}
+		else if (command[0] == L'b')
+		{
+			trust = PeerTrust::Banned;
+		}
+
+		_hostedNetwork.SetPeerTrust(id.c_str(), trust);
+		std::wcout << std::endl << "Updated trust for " << id << std::endl;
+	}
+	else if (0 == command.compare(0, 6, L"stress"))
+	{
+		unsigned int operations = 10000;
+		if (command.length() > 7)
+		{
+			operations = static_cast<unsigned int>(wcstoul(command.substr(7).c_str(), nullptr, 10));
+		}
+
+		RunSnapshotStress(operations);
+	}
+	else if (0 == command.compare(0, 7, L"pending"))
+	{
+		ShowPendingDecisions();
+	}
+	else if (0 == command.compare(0, 6, L"accept") || 0 == command.compare(0, 7, L"decline"))
+	{
+		bool accept = (command[0] == L'a');
+		std::wistringstream input(command.substr(accept ? 6 : 7));
+		uint64_t id = 0;
+		if (input >> id)
+		{
+			std::wstring pin;
+			input >> pin;
+
+			if (!_hostedNetwork.ResolveDecision(id, accept, pin))
+			{
+				std::wcout << std::endl << "Request " << id << " is not pending" << std::endl;
+			}
+		}
+		else
+		{
+			std::wcout << std::endl << "Deciding FAILED, bad input" << std::endl;
+		}
+	}
+	else if (0 == command.compare(0, 7, L"timeout"))
+	{
+		std::wistringstream input(command.substr(7));
+		unsigned int timeoutMs = 0;
+		if (input >> timeoutMs)
+		{
+			int acceptOnTimeout = 0;
+			input >> acceptOnTimeout;
+
+			DecisionPolicy policy;
+			policy.timeout = std::chrono::milliseconds(timeoutMs);
+			policy.acceptOnTimeout = (acceptOnTimeout != 0);
+
+			std::wcout << std::endl << "Requests pending for " << timeoutMs << " ms are " << (policy.acceptOnTimeout ? "accepted" : "declined") << std::endl;
+			_hostedNetwork.SetDecisionPolicy(policy);
+		}
+		else
+		{
+			std::wcout << std::endl << "Setting decision timeout FAILED, bad input" << std::endl;
+		}
+	}
+	else if (0 == command.compare(0, 13, L"decisionbench"))
+	{
+		unsigned int requests = 100;
+		if (command.length() > 14)
+		{
+			requests = static_cast<unsigned int>(wcstoul(command.substr(14).c_str(), nullptr, 10));
+		}
+
+		if (requests != 0)
+		{
+			RunDecisionBenchmark(requests);
+		}
+	}
+	else if (0 == command.compare(0, 9, L"admission"))
+	{
+		std::wistringstream input(command.substr(9));
+		AdmissionSettings settings;
+		if (input >> settings.ratePerSecond >> settings.burst >> settings.maxInFlight)
+		{
+			if (!(input >> settings.maxQueued))
+			{
+				settings.maxQueued = AdmissionSettings().maxQueued;
+			}
+
+			std::wcout << std::endl << "Admitting " << settings.ratePerSecond << "/s, bursts of " << settings.burst << ", "
+				<< settings.maxInFlight << " in flight, " << settings.maxQueued << " queued" << std::endl;
+			_hostedNetwork.SetAdmissionSettings(settings);
+		}
+		else
+		{
+			std::wcout << std::endl << "Setting admission FAILED, bad input" << std::endl;
+		}
+	}
+	else if (0 == command.compare(0, 8, L"stormsim"))
+	{
+		unsigned int requests = 100;
+		if (command.length() > 9)
+		{
+			requests = static_cast<unsigned int>(wcstoul(command.substr(9).c_str(), nullptr, 10));
+		}
+
+		if (requests != 0)
+		{
+			RunConnectionStormSimulation(requests);
+		}
+	}
+	else if (0 == command.compare(0, 10, L"queuebench"))
+	{
+		unsigned int messages = 1000000;
+		if (command.length() > 11)
+		{
+			messages = static_cast<unsigned int>(wcstoul(command.substr(11).c_str(), nullptr, 10));
+		}
+
+		RunQueueBenchmark(messages);
+	}
+	else if (0 == command.compare(0, 8, L"busbench"))
+	{
+		unsigned int events = 100000;
+		if (command.length() > 9)
+		{
+			events = static_cast<unsigned int>(wcstoul(command.substr(9).c_str(), nullptr, 10));
+		}
+
+		if (events != 0)
+		{
+			RunBusBenchmark(events);
+		}
+	}
+	else if (0 == command.compare(0, 10, L"eventbench"))
+	{
+		unsigned int events = 100000;
+		if (command.length() > 11)
+		{
+			events = static_cast<unsigned int>(wcstoul(command.substr(11).c_str(), nullptr, 10));
+		}
+
+		if (events != 0)
+		{
+			RunEventBenchmark(events);
+		}
+	}
+	else if (0 == command.compare(0, 3, L"oui"))
+	{
+		std::wistringstream input(command.substr(3));
+		uint32_t oui = 0;
+		unsigned int vendorType = 0;
+		if (input >> std::hex >> oui)
+		{
+			input >> vendorType;
+
+			std::wcout << std::endl << "Looking for vendor element " << std::hex << oui << " type " << vendorType << std::dec << std::endl;
+			_hostedNetwork.SetVendorElement(oui, static_cast<uint8_t>(vendorType));
+		}
+		else
+		{
+			std::wcout << std::endl << "Setting vendor element FAILED, bad input" << std::endl;
+		}
+	}
+	else if (0 == command.compare(0, 5, L"batch"))
+	{
+		std::wistringstream input(command.substr(5));
+		DWORD windowMs = 0;
+		size_t maxChanges = 0;
+		if (input >> windowMs)
+		{
+			input >> maxChanges;
+
+			std::wcout << std::endl << "Setting peer batching to " << windowMs << " ms, " << maxChanges << " changes" << std::endl;
+			_hostedNetwork.SetPeerBatching(windowMs, maxChanges);
+		}
+		else
+		{
+			std::wcout << std::endl << "Setting peer batching FAILED, bad input" << std::endl;
+		}
+	}
+	else if (0 == command.compare(0, 9, L"reconnect"))
+	{
+		std::wistringstream input(command.substr(9));
+		int enabled = 0;
+		if (input >> enabled)
+		{
+			ReconnectSettings settings;
+			settings.enabled = (enabled != 0);
+			if (!(input >> settings.maxAttempts))
+			{
+				settings.maxAttempts = ReconnectSettings().maxAttempts;
+			}
+
+			std::wcout << std::endl << "Setting reconnect to " << settings.enabled << ", " << settings.maxAttempts << " attempts" << std::endl;
+			_hostedNetwork.SetReconnectSettings(settings);
+		}
+		else
+		{
+			std::wcout << std::endl << "Setting reconnect FAILED, bad input" << std::endl;
+		}
+	}
+	else if (0 == command.compare(0, 10, L"continuous"))
+	{
+		std::wstring value;
+		std::wstring::size_type found = command.find_first_not_of(' ', 10);
+		if (found != std::wstring::npos && found < command.length())
+		{
+			value = command.substr(found);
+
+			bool continuous = (value != L"0");
+
+			std::wcout << std::endl << "Setting continuous discovery to " << continuous << " (input was " << value << ")" << std::endl;
+			_hostedNetwork.SetContinuousDiscovery(continuous);
+		}
+		else
+		{
+			std::wcout << std::endl << "Setting continuous discovery FAILED, bad input" << std::endl;
+		}
+	}
+    else if (0 == command.compare(0, 10, L"autoaccept"))
+    {
+        std::wstring value;
+        std::wstring::size_type found = command.find_first_not_of(' ', 10);
+        if (found != std::wstring::npos && found < command.length())
+        {
+            value = command.substr(found);
+
+            bool autoAccept = true;
+
+            if (value == L"0")
+            {
+                autoAccept = false;
+            }
+
+            std::wcout << std::endl << "Setting AutoAccept to " << autoAccept << " (input was " << value << ")" << std::endl;
+            _hostedNetwork.SetAutoAccept(autoAccept);
+        }
+        else
+        {
+            std::wcout << std::endl << "Setting AutoAccpet FAILED, bad input" << std::endl;
+        }
+    }
+    else
+    {
+        ShowHelp();
+    }
+
+    return true;
+}
@@ -1,64 +1,108 @@
-//*********************************************************
-//
-// Copyright (c) Microsoft. All rights reserved.
-// This code is licensed under the MIT License (MIT).
-// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
-// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
-// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
-// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
-//
-//*********************************************************
-
-#pragma once
-
-#include "WlanHostedNetworkWinRT.h"
-#include "WFDHelper.h"
-
-/// A simple console helper to take commands and start the "soft AP"
-class SimpleConsole : public IWlanHostedNetworkListener, public IWlanHostedNetworkPrompt, public IWlanHostedNetworkDevicePairRequest
-{
-public:
-    SimpleConsole();
-    virtual ~SimpleConsole();
-
-    void RunConsole();
-
-    // IWlanHostedNetworkListener Implementation
-
-    virtual void OnDeviceConnected(std::wstring remoteHostName) override;
-    virtual void OnDeviceDisconnected(std::wstring deviceId) override;
-
-    virtual void OnAdvertisementStarted() override;
-    virtual void OnAdvertisementStopped(std::wstring message) override;
-    virtual void OnAdvertisementAborted(std::wstring message) override;
-
-	virtual void OnEnumerationCompleted(std::wstring message) override;
-	virtual void OnEnumerationStopped(std::wstring message) override;
-
-	virtual void OnDeviceAdded(std::wstring id, std::wstring name) override;
-	virtual void OnDeviceRemoved(std::wstring message) override;
-	virtual void OnDeviceUnpaired(std::wstring message) override;
-	virtual void OnDevicePaired(std::wstring message) override;
-    virtual void OnDevicePairedError(std::wstring message, int errorCode) override;
-
-    virtual void OnAsyncException(std::wstring message) override;
-
-    virtual void LogMessage(std::wstring message) override;
-
-    // IWlanHostedNetworkPrompt Implementation
-
-    virtual bool AcceptIncommingConnection() override;
-	virtual bool PairRequest(ABI::Windows::Devices::Enumeration::DevicePairingKinds kinds, std::wstring& strPin) override;
-
-private:
-    void ShowPrompt();
-    void ShowHelp();
-    bool ExecuteCommand(std::wstring command);
-
-    WlanHostedNetworkHelper _hostedNetwork;
-
-    // Event helper to wait on async operations in console
-    Microsoft::WRL::Wrappers::Event _apEvent;
-
-    CWFDHelper  m_WFDHelper;
-};
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "PairingPolicy.h"
+#include "WlanHostedNetworkWinRT.h"
+#include "WFDHelper.h"
+
+/// A simple console helper to take commands and start the "soft AP"
+class SimpleConsole : public IWlanHostedNetworkListener, public IWlanHostedNetworkPrompt, public IWlanHostedNetworkDevicePairRequest
+{
+public:
+    SimpleConsole(bool usePeerCache = true);
+    virtual ~SimpleConsole();
+
+    void RunConsole();
+
+    // IWlanHostedNetworkListener Implementation
+
+    virtual void OnDeviceConnected(std::wstring remoteHostName) override;
+    virtual void OnDevicesConnected(const ConnectBatchResult& result) override;
+    virtual void OnDeviceDisconnected(std::wstring deviceId) override;
+
+    virtual void OnAdvertisementStarted() override;
+    virtual void OnAdvertisementStopped(std::wstring message) override;
+    virtual void OnAdvertisementAborted(std::wstring message) override;
+
+	virtual void OnEnumerationCompleted(std::wstring message) override;
+	virtual void OnEnumerationStopped(std::wstring message) override;
+
+	virtual void OnPeersChanged(const PeerDelta& delta) override;
+	virtual void OnDeviceUnpaired(std::wstring message) override;
+	virtual void OnDevicePaired(std::wstring message) override;
+    virtual void OnDevicePairedError(std::wstring message, int errorCode) override;
+
+    virtual void OnAsyncException(std::wstring message) override;
+
+    virtual void LogMessage(std::wstring message) override;
+
+    // IWlanHostedNetworkPrompt Implementation
+
+    virtual void OnConnectionDecisionPending(const PendingDecision& decision) override;
+	virtual void OnPairingDecisionPending(const PendingDecision& decision) override;
+
+private:
+    void ShowPrompt();
+    void ShowHelp();
+    void ShowKnownPeers();
+    void ShowTrustedPeers();
+    void ShowPeerStatus();
+    void ShowLegacySessions();
+    void ShowStats();
+    void RunSnapshotStress(unsigned int operations);
+    void RunQueueBenchmark(unsigned int messages);
+    void RunBusBenchmark(unsigned int events);
+    void RunEventBenchmark(unsigned int events);
+    void RunPairingBenchmark(unsigned int devices);
+    void RunSessionBenchmark(unsigned int sessions);
+    void RunPolicyBenchmark(unsigned int rules);
+    void RunMacBenchmark(unsigned int ids);
+    void RunWheelBenchmark(unsigned int timers);
+    void RunCompletionBenchmark(unsigned int operations);
+    void RunLogBenchmark(unsigned int records);
+    void RunStringBenchmark(unsigned int strings);
+    void SimulateFlappingPeers(unsigned int devices);
+    void RunConnectBenchmark(unsigned int devices);
+    void RunElementBenchmark(unsigned int lookups);
+    void RunPeerTableBenchmark(unsigned int lookups);
+    void CheckPeerDeltas(unsigned int peers);
+    /// Wait for an operation and report how it ended, or keep it for wait if background is set
+    template <typename TResult>
+    void WaitForOperation(const std::wstring& label, const Completion<TResult>& completion, bool background);
+    /// Report background operations as they finish until none is left
+    void WaitForBackground();
+    void ShowPendingDecisions();
+    void RunDecisionBenchmark(unsigned int requests);
+    void RunConnectionStormSimulation(unsigned int requests);
+    bool ExecuteCommand(std::wstring command);
+
+    WlanHostedNetworkHelper _hostedNetwork;
+
+    // Decides pairing requests by rules once a policy file is loaded, asking here for the rest
+    PairingPolicy _pairingPolicy;
+    PolicyPairRequest _policyPairRequest;
+
+    /// An operation started with a trailing &
+    struct BackgroundOperation
+    {
+        std::wstring label;
+        CompletionHandle completion;
+        /// How it ended, once it has
+        std::function<std::wstring()> describe;
+    };
+
+    // Operations running in the background, in the order they were started
+    std::vector<BackgroundOperation> _background;
+
+    CWFDHelper  m_WFDHelper;
+};
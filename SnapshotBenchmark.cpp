@@ -0,0 +1,141 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include "SnapshotPublisher.h"
+#include "SnapshotBenchmark.h"
+
+#include <cwchar>
+
+namespace
+{
+	/// Stands in for PeerSnapshot: sorted shared entries, looked up by ID
+	struct StressSnapshot
+	{
+		StressSnapshot()
+			: generation(0)
+		{}
+
+		const std::wstring* Find(const std::wstring& id) const
+		{
+			auto it = std::lower_bound(peers.begin(), peers.end(), id,
+				[](const std::shared_ptr<const std::wstring>& entry, const std::wstring& key)
+			{
+				return *entry < key;
+			});
+
+			if (it == peers.end() || **it != id)
+			{
+				return nullptr;
+			}
+			return it->get();
+		}
+
+		uint64_t generation;
+		std::vector<std::shared_ptr<const std::wstring>> peers;
+	};
+}
+
+SnapshotStressResult RunSnapshotStress(unsigned int operations)
+{
+	const unsigned int peerCount = 256;
+	const unsigned int writerCount = 2;
+	unsigned int readerCount = std::thread::hardware_concurrency();
+	readerCount = (readerCount > writerCount + 2) ? readerCount - writerCount : 2;
+
+	std::vector<std::wstring> ids(peerCount);
+	for (unsigned int i = 0; i < peerCount; i++)
+	{
+		wchar_t id[32];
+		swprintf(id, 32, L"stress#%04u", i);
+		ids[i] = id;
+	}
+
+	SnapshotPublisher<StressSnapshot> publisher;
+	std::mutex tableLock;
+	StressSnapshot table;
+	std::atomic<unsigned int> writersRunning(writerCount);
+	std::vector<std::vector<uint32_t>> latencies(readerCount);
+	std::vector<std::thread> threads;
+
+	for (unsigned int w = 0; w < writerCount; w++)
+	{
+		threads.emplace_back([&, w]()
+		{
+			uint32_t seed = 0x9E3779B9u * (w + 1);
+			for (unsigned int op = 0; op < operations / writerCount; op++)
+			{
+				seed = seed * 1664525u + 1013904223u;
+				const std::wstring& id = ids[(seed >> 8) % peerCount];
+
+				std::lock_guard<std::mutex> lock(tableLock);
+
+				// Add or remove one entry, the others are shared with the previous snapshot
+				auto it = std::lower_bound(table.peers.begin(), table.peers.end(), id,
+					[](const std::shared_ptr<const std::wstring>& entry, const std::wstring& key)
+				{
+					return *entry < key;
+				});
+				if (it != table.peers.end() && **it == id)
+				{
+					table.peers.erase(it);
+				}
+				else
+				{
+					table.peers.insert(it, std::make_shared<const std::wstring>(id));
+				}
+				table.generation++;
+
+				publisher.Publish(std::unique_ptr<StressSnapshot>(new StressSnapshot(table)));
+			}
+			writersRunning--;
+		});
+	}
+
+	for (unsigned int r = 0; r < readerCount; r++)
+	{
+		threads.emplace_back([&, r]()
+		{
+			std::vector<uint32_t>& samples = latencies[r];
+			unsigned int index = r;
+			while (writersRunning > 0)
+			{
+				index = (index + 7919) % peerCount;
+				auto start = std::chrono::steady_clock::now();
+				{
+					auto snapshot = publisher.Read();
+					if (snapshot)
+					{
+						snapshot->Find(ids[index]);
+					}
+				}
+				auto elapsed = std::chrono::steady_clock::now() - start;
+				samples.push_back(static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+			}
+		});
+	}
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	SnapshotStressResult result;
+	result.writers = writerCount;
+	result.readers = readerCount;
+	for (auto& samples : latencies)
+	{
+		result.latencies.insert(result.latencies.end(), samples.begin(), samples.end());
+	}
+	std::sort(result.latencies.begin(), result.latencies.end());
+	result.retired = publisher.GetRetiredCount();
+	return result;
+}
@@ -0,0 +1,32 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// How snapshot readers fared while writers kept replacing the snapshot
+struct SnapshotStressResult
+{
+	unsigned int writers;
+	unsigned int readers;
+	/// Nanoseconds of every lookup, pin and unpin included, sorted
+	std::vector<uint32_t> latencies;
+	/// Snapshots replaced but not yet freed once every thread finished
+	size_t retired;
+};
+
+/// Writers toggle synthetic peers in a sorted table of shared entries and publish a snapshot after
+/// each of operations changes, the way the helper publishes its peer table; one reader per core
+/// but the writers looks peers up in the current snapshot until the writers are done
+SnapshotStressResult RunSnapshotStress(unsigned int operations);
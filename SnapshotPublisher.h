@@ -0,0 +1,212 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/// Publishes immutable snapshots of a T. Readers pin the current snapshot without taking a lock or
+/// allocating; writers swap in a new snapshot and free replaced ones once no reader can still be
+/// looking at them (epoch-based reclamation). Writers are serialized internally.
+template <typename T>
+class SnapshotPublisher
+{
+	struct ReaderSlot;
+
+public:
+	/// Keeps one snapshot alive while in scope. Hold it briefly, a pinned reader delays reclamation.
+	class ReadGuard
+	{
+	public:
+		ReadGuard(ReadGuard&& other)
+			: _slot(other._slot),
+			  _snapshot(other._snapshot)
+		{
+			other._slot = nullptr;
+			other._snapshot = nullptr;
+		}
+
+		~ReadGuard()
+		{
+			if (_slot != nullptr)
+			{
+				_slot->epoch.store(Inactive, std::memory_order_release);
+			}
+		}
+
+		/// Current snapshot at the time of the read, nullptr if nothing was published yet
+		const T* Get() const
+		{
+			return _snapshot;
+		}
+
+		const T* operator->() const
+		{
+			return _snapshot;
+		}
+
+		const T& operator*() const
+		{
+			return *_snapshot;
+		}
+
+		explicit operator bool() const
+		{
+			return _snapshot != nullptr;
+		}
+
+	private:
+		friend class SnapshotPublisher;
+
+		ReadGuard(ReaderSlot* slot, const T* snapshot)
+			: _slot(slot),
+			  _snapshot(snapshot)
+		{}
+
+		ReadGuard(const ReadGuard&) = delete;
+		ReadGuard& operator=(const ReadGuard&) = delete;
+
+		ReaderSlot* _slot;
+		const T* _snapshot;
+	};
+
+	SnapshotPublisher()
+		: _current(nullptr),
+		  _epoch(1)
+	{
+		for (auto& reader : _readers)
+		{
+			reader.epoch.store(Inactive, std::memory_order_relaxed);
+		}
+	}
+
+	/// No reader may still hold a guard
+	~SnapshotPublisher()
+	{
+		delete _current.load(std::memory_order_relaxed);
+		for (auto& retired : _retired)
+		{
+			delete retired.second;
+		}
+	}
+
+	/// Pin the current snapshot
+	ReadGuard Read() const
+	{
+		ReaderSlot* slot = Claim();
+
+		// The slot is visible before the pointer is loaded, so a writer replacing this snapshot
+		// sees the slot and keeps the snapshot alive
+		return ReadGuard(slot, _current.load(std::memory_order_seq_cst));
+	}
+
+	/// Replace the current snapshot; replaced snapshots are freed once no reader pins them
+	void Publish(std::unique_ptr<T> snapshot)
+	{
+		std::lock_guard<std::mutex> lock(_writeLock);
+
+		T* previous = _current.exchange(snapshot.release(), std::memory_order_seq_cst);
+		uint64_t epoch = _epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+
+		if (previous != nullptr)
+		{
+			// Readers that can see previous registered before this epoch began
+			_retired.push_back(std::make_pair(epoch, previous));
+		}
+
+		Reclaim();
+	}
+
+	/// Snapshots replaced but not yet freed
+	size_t GetRetiredCount()
+	{
+		std::lock_guard<std::mutex> lock(_writeLock);
+		return _retired.size();
+	}
+
+private:
+	static const size_t MaxReaders = 64;
+	static const uint64_t Inactive = 0;
+
+	/// Epoch a reader registered in, Inactive when free; one cache line each so readers do not contend
+	struct alignas(64) ReaderSlot
+	{
+		std::atomic<uint64_t> epoch;
+	};
+
+	ReaderSlot* Claim() const
+	{
+		// Start at a per-thread position so concurrent readers rarely race for the same slot
+		size_t start = std::hash<std::thread::id>()(std::this_thread::get_id()) % MaxReaders;
+
+		for (;;)
+		{
+			uint64_t epoch = _epoch.load(std::memory_order_seq_cst);
+
+			for (size_t i = 0; i < MaxReaders; i++)
+			{
+				ReaderSlot& slot = _readers[(start + i) % MaxReaders];
+				uint64_t expected = Inactive;
+				if (slot.epoch.load(std::memory_order_relaxed) == Inactive &&
+					slot.epoch.compare_exchange_strong(expected, epoch, std::memory_order_seq_cst))
+				{
+					return &slot;
+				}
+			}
+
+			// More than MaxReaders concurrent readers, wait for one to finish
+			std::this_thread::yield();
+		}
+	}
+
+	/// Free retired snapshots that every active reader registered after; called under _writeLock
+	void Reclaim()
+	{
+		uint64_t oldest = UINT64_MAX;
+		for (auto& reader : _readers)
+		{
+			uint64_t epoch = reader.epoch.load(std::memory_order_seq_cst);
+			if (epoch != Inactive && epoch < oldest)
+			{
+				oldest = epoch;
+			}
+		}
+
+		auto kept = _retired.begin();
+		for (auto it = _retired.begin(); it != _retired.end(); ++it)
+		{
+			if (it->first <= oldest)
+			{
+				delete it->second;
+			}
+			else
+			{
+				*kept++ = *it;
+			}
+		}
+		_retired.erase(kept, _retired.end());
+	}
+
+	std::atomic<T*> _current;
+	std::atomic<uint64_t> _epoch;
+	mutable ReaderSlot _readers[MaxReaders];
+
+	std::mutex _writeLock;
+	/// Replaced snapshots tagged with the epoch they were retired in
+	std::vector<std::pair<uint64_t, T*>> _retired;
+};
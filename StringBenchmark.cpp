@@ -0,0 +1,185 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include "Utf8String.h"
+#include "StringBenchmark.h"
+
+#include <cstdio>
+
+static volatile size_t s_sink;
+
+/// Distinct strings cycled through, few enough to stay in cache so the transcoding is measured
+static const unsigned int DistinctStrings = 1024;
+
+/// What device watchers report for names: mostly ASCII, some accented, some CJK
+static const wchar_t* const BenchmarkNames[] =
+{
+	L"DIRECT-4f-HP OfficeJet Pro 8020",
+	L"Living Room TV",
+	L"Galaxy S23 de Zoë",
+	L"Téléphone de François",
+	L"会議室プロジェクター",
+	L"DIRECT-xy-Android_7c1e"
+};
+
+static std::wstring MakeDeviceId(unsigned int i)
+{
+	wchar_t id[64];
+	swprintf(id, sizeof(id) / sizeof(id[0]), L"\\\\?\\SWD#WiFiDirect#02:1a:%02x:%02x:%02x:%02x", (i >> 24) & 0xFF, (i >> 16) & 0xFF, (i >> 8) & 0xFF, i & 0xFF);
+	return id;
+}
+
+static std::wstring MakeDeviceName(unsigned int i)
+{
+	return std::wstring(BenchmarkNames[i % (sizeof(BenchmarkNames) / sizeof(BenchmarkNames[0]))]) + L" " + std::to_wstring(i);
+}
+
+/// UTF-16 whatever the size of wchar_t
+static std::u16string ToUtf16(const std::wstring& text)
+{
+	Utf8String utf8(text);
+	std::u16string utf16(utf8.GetLength(), u'\0');
+	utf16.resize(Utf8ToUtf16(utf8.GetData(), utf8.GetLength(), &utf16[0]));
+	return utf16;
+}
+
+template <typename TPath>
+static TranscodeBenchmarkPath Measure(const wchar_t* label, const wchar_t* text, const std::vector<std::u16string>& inputs, unsigned int strings, TPath path)
+{
+	typedef std::chrono::steady_clock Clock;
+
+	size_t units = 0;
+	size_t written = 0;
+	auto started = Clock::now();
+	for (unsigned int i = 0; i < strings; i++)
+	{
+		const std::u16string& input = inputs[i % inputs.size()];
+		written += path(input);
+		units += input.length();
+	}
+	double elapsed = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - started).count());
+
+	// Keeps the transcoding from being optimized away
+	s_sink = written;
+
+	TranscodeBenchmarkPath result;
+	result.label = label;
+	result.text = text;
+	result.nanoseconds = elapsed / strings;
+	result.megabytes = (elapsed > 0) ? units * sizeof(char16_t) / elapsed * 1000.0 : 0.0;
+	return result;
+}
+
+std::vector<TranscodeBenchmarkPath> RunTranscodeBenchmark(unsigned int strings)
+{
+	std::vector<TranscodeBenchmarkPath> paths;
+
+	std::vector<std::u16string> ids;
+	std::vector<std::u16string> names;
+	for (unsigned int i = 0; i < DistinctStrings; i++)
+	{
+		ids.push_back(ToUtf16(MakeDeviceId(i)));
+		names.push_back(ToUtf16(MakeDeviceName(i)));
+	}
+
+	char narrow[256];
+	char16_t wide[256];
+
+	const struct
+	{
+		const wchar_t* text;
+		const std::vector<std::u16string>* inputs;
+	} kinds[] = { { L"ids", &ids }, { L"names", &names } };
+
+	for (const auto& kind : kinds)
+	{
+		// Encoded once up front for the way back; decoded from the same positions as the input
+		std::vector<std::string> encoded;
+		for (const std::u16string& input : *kind.inputs)
+		{
+			encoded.push_back(std::string(narrow, Utf16ToUtf8(input.data(), input.length(), narrow)));
+		}
+		auto encodedOf = [&encoded, &kind](const std::u16string& input) -> const std::string&
+		{
+			return encoded[&input - kind.inputs->data()];
+		};
+
+		paths.push_back(Measure(L"utf16>8 scalar", kind.text, *kind.inputs, strings, [&](const std::u16string& input)
+		{
+			return Utf16ToUtf8<char16_t, false>(input.data(), input.length(), narrow);
+		}));
+		paths.push_back(Measure(L"utf16>8", kind.text, *kind.inputs, strings, [&](const std::u16string& input)
+		{
+			return Utf16ToUtf8(input.data(), input.length(), narrow);
+		}));
+		paths.push_back(Measure(L"utf8>16 scalar", kind.text, *kind.inputs, strings, [&](const std::u16string& input)
+		{
+			const std::string& text = encodedOf(input);
+			return Utf8ToUtf16<char16_t, false>(text.data(), text.length(), wide);
+		}));
+		paths.push_back(Measure(L"utf8>16", kind.text, *kind.inputs, strings, [&](const std::u16string& input)
+		{
+			const std::string& text = encodedOf(input);
+			return Utf8ToUtf16(text.data(), text.length(), wide);
+		}));
+
+		// What storing a peer's string costs: measure, then transcode into the string
+		Utf8String stored;
+		paths.push_back(Measure(L"AssignUtf16", kind.text, *kind.inputs, strings, [&](const std::u16string& input)
+		{
+			stored.AssignUtf16(input.data(), input.length());
+			return stored.GetLength();
+		}));
+	}
+
+	return paths;
+}
+
+/// Heap bytes of a wstring, 0 if its text is inside the object
+static size_t GetHeapBytes(const std::wstring& text)
+{
+	const char* data = reinterpret_cast<const char*>(text.data());
+	const char* object = reinterpret_cast<const char*>(&text);
+	return (data >= object && data < object + sizeof(text)) ? 0 : (text.capacity() + 1) * sizeof(wchar_t);
+}
+
+std::vector<FootprintBenchmarkPath> RunFootprintBenchmark(unsigned int peers)
+{
+	std::vector<FootprintBenchmarkPath> paths;
+
+	FootprintBenchmarkPath wide = { L"std::wstring", peers, 0, 0, 0 };
+	FootprintBenchmarkPath utf8 = { L"Utf8String", peers, 0, 0, 0 };
+
+	// One peer at a time, so the table's strings are what is measured and not the inputs
+	for (unsigned int i = 0; i < peers; i++)
+	{
+		std::wstring strings[] = { MakeDeviceId(i), MakeDeviceName(i) };
+		for (const std::wstring& text : strings)
+		{
+			// Copied as the table copies them in, sized to the text
+			std::wstring stored(text.c_str(), text.length());
+			size_t heap = GetHeapBytes(stored);
+			wide.objectBytes += sizeof(stored);
+			wide.heapBytes += heap;
+			wide.allocations += (heap != 0) ? 1 : 0;
+
+			Utf8String narrow(text);
+			utf8.objectBytes += sizeof(narrow);
+			utf8.heapBytes += narrow.GetHeapBytes();
+			utf8.allocations += (narrow.GetHeapBytes() != 0) ? 1 : 0;
+		}
+	}
+
+	paths.push_back(wide);
+	paths.push_back(utf8);
+	return paths;
+}
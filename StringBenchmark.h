@@ -0,0 +1,46 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/// How one transcoding path did on one kind of text
+struct TranscodeBenchmarkPath
+{
+	const wchar_t* label;
+	const wchar_t* text;
+	/// Per string, measuring included where the path measures first
+	double nanoseconds;
+	/// UTF-16 bytes read or written per second, in MB
+	double megabytes;
+};
+
+/// What the ID and name of every peer in a table take, one way of storing them
+struct FootprintBenchmarkPath
+{
+	const wchar_t* label;
+	size_t peers;
+	/// The string objects themselves, inside the peer slots
+	size_t objectBytes;
+	/// Allocated for text that does not fit in the objects, allocator overhead not counted
+	size_t heapBytes;
+	/// Strings that needed an allocation
+	size_t allocations;
+};
+
+/// Transcode device IDs (ASCII) and device names (some not ASCII) strings times each way between
+/// UTF-16 and UTF-8, vectorized and with the plain loop
+std::vector<TranscodeBenchmarkPath> RunTranscodeBenchmark(unsigned int strings);
+
+/// Store the IDs and names of peers as std::wstring, the way the peer table did, and as Utf8String
+std::vector<FootprintBenchmarkPath> RunFootprintBenchmark(unsigned int peers);
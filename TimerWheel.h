@@ -0,0 +1,308 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+struct TimerWheelStats
+{
+	TimerWheelStats()
+		: armed(0),
+		  cancelled(0),
+		  expired(0),
+		  cascaded(0)
+	{}
+
+	uint64_t armed;
+	uint64_t cancelled;
+	uint64_t expired;
+	/// Times a timer moved down a level on its way to expiring
+	uint64_t cascaded;
+};
+
+/// Hierarchical timing wheel (Varghese and Lauck) for many deadlines at once. Time is counted in
+/// ticks of whatever length the caller picks. Level 0 has one slot per tick for the next 64
+/// ticks, each level above one slot per 64 ticks of the level below, so four levels span 2^24
+/// ticks; deadlines further out are parked at the edge and placed again as they come closer.
+/// Timers live in one slab and are linked into their slot by index, so Arm and Cancel are O(1)
+/// and only allocate when the slab grows. A handle carries a generation, so cancelling a timer
+/// that already expired or was cancelled is a harmless no-op. Not thread-safe, callers serialize
+/// access.
+template <typename TPayload>
+class TimerWheel
+{
+public:
+	static const unsigned int LevelBits = 6;
+	static const unsigned int Levels = 4;
+	static const uint32_t SlotsPerLevel = 1u << LevelBits;
+	/// Furthest a timer can be placed ahead of the current tick
+	static const uint64_t Span = static_cast<uint64_t>(1) << (LevelBits * Levels);
+
+	/// Handle of no timer
+	static const uint64_t InvalidHandle = 0;
+
+	/// Start counting at tick now
+	explicit TimerWheel(uint64_t now = 0)
+		: _next(now),
+		  _count(0),
+		  _free(None)
+	{
+		for (auto& head : _slots)
+		{
+			head = None;
+		}
+	}
+
+	/// Fire payload once the wheel is advanced to tick expiry, or on the next tick if that has
+	/// passed already
+	uint64_t Arm(uint64_t expiry, TPayload payload)
+	{
+		uint32_t index;
+		if (_free != None)
+		{
+			index = _free;
+			_free = _nodes[index].next;
+		}
+		else
+		{
+			index = static_cast<uint32_t>(_nodes.size());
+			_nodes.push_back(Node());
+		}
+
+		Node& node = _nodes[index];
+		node.expiry = (expiry < _next) ? _next : expiry;
+		node.payload = std::move(payload);
+		node.armed = true;
+		Link(index);
+
+		_count++;
+		_stats.armed++;
+		return Handle(index, node.generation);
+	}
+
+	/// False if the timer already expired or was cancelled. The payload, if wanted, is moved to
+	/// payload so the caller can destroy it outside whatever lock serializes the wheel.
+	bool Cancel(uint64_t handle, TPayload* payload = nullptr)
+	{
+		uint32_t index = static_cast<uint32_t>(handle) - 1;
+		if (handle == InvalidHandle || index >= _nodes.size())
+		{
+			return false;
+		}
+
+		Node& node = _nodes[index];
+		if (!node.armed || node.generation != static_cast<uint32_t>(handle >> 32))
+		{
+			return false;
+		}
+
+		Unlink(index);
+		if (payload != nullptr)
+		{
+			*payload = std::move(node.payload);
+		}
+		Release(index);
+
+		_stats.cancelled++;
+		return true;
+	}
+
+	/// Move time forward to tick now, calling expired(payload) for every timer due by then, in
+	/// tick order. expired may arm and cancel timers.
+	template <typename TFunc>
+	size_t Advance(uint64_t now, TFunc expired)
+	{
+		size_t fired = 0;
+		while (_next <= now)
+		{
+			if (_count == 0)
+			{
+				// Nothing to visit on the way, jump straight there
+				_next = now + 1;
+				break;
+			}
+
+			uint64_t tick = _next;
+
+			// Entering a new lap of a level: move the slot that lap covers one level down
+			for (unsigned int level = 1; level < Levels && (tick & ((static_cast<uint64_t>(1) << (LevelBits * level)) - 1)) == 0; level++)
+			{
+				Cascade(level, static_cast<uint32_t>(tick >> (LevelBits * level)) & (SlotsPerLevel - 1));
+			}
+
+			// Move the due timers to a list of their own first: expired may arm timers that land
+			// in this slot on a later lap, or cancel timers that are due along with its own
+			uint32_t& head = _slots[tick & (SlotsPerLevel - 1)];
+			_slots[Expiring] = head;
+			head = None;
+			for (uint32_t index = _slots[Expiring]; index != None; index = _nodes[index].next)
+			{
+				_nodes[index].slot = Expiring;
+			}
+			_next = tick + 1;
+
+			while (_slots[Expiring] != None)
+			{
+				uint32_t index = _slots[Expiring];
+				Unlink(index);
+				TPayload payload(std::move(_nodes[index].payload));
+				Release(index);
+				_stats.expired++;
+				fired++;
+
+				expired(payload);
+			}
+		}
+		return fired;
+	}
+
+	/// Next tick Advance will look at
+	uint64_t GetNextTick() const
+	{
+		return _next;
+	}
+
+	size_t GetCount() const
+	{
+		return _count;
+	}
+
+	TimerWheelStats GetStats() const
+	{
+		return _stats;
+	}
+
+private:
+	static const uint32_t None = UINT32_MAX;
+	/// Slot of the timers Advance is firing
+	static const uint32_t Expiring = Levels * SlotsPerLevel;
+
+	struct Node
+	{
+		Node()
+			: expiry(0),
+			  prev(None),
+			  next(None),
+			  generation(1),
+			  slot(0),
+			  armed(false)
+		{}
+
+		uint64_t expiry;
+		uint32_t prev;
+		/// Also links free nodes
+		uint32_t next;
+		/// Bumped on release so stale handles miss
+		uint32_t generation;
+		/// Index into _slots of the list the node is on
+		uint32_t slot;
+		bool armed;
+		TPayload payload;
+	};
+
+	static uint64_t Handle(uint32_t index, uint32_t generation)
+	{
+		return (static_cast<uint64_t>(generation) << 32) | (static_cast<uint64_t>(index) + 1);
+	}
+
+	/// Put a node on the slot for its expiry relative to _next
+	void Link(uint32_t index)
+	{
+		Node& node = _nodes[index];
+
+		uint64_t expiry = node.expiry;
+		if (expiry - _next >= Span)
+		{
+			expiry = _next + Span - 1;
+		}
+
+		uint64_t delta = expiry - _next;
+		unsigned int level = 0;
+		while (level + 1 < Levels && delta >= (static_cast<uint64_t>(1) << (LevelBits * (level + 1))))
+		{
+			level++;
+		}
+
+		node.slot = level * SlotsPerLevel + (static_cast<uint32_t>(expiry >> (LevelBits * level)) & (SlotsPerLevel - 1));
+		node.prev = None;
+		node.next = _slots[node.slot];
+		if (node.next != None)
+		{
+			_nodes[node.next].prev = index;
+		}
+		_slots[node.slot] = index;
+	}
+
+	void Unlink(uint32_t index)
+	{
+		Node& node = _nodes[index];
+		if (node.prev != None)
+		{
+			_nodes[node.prev].next = node.next;
+		}
+		else
+		{
+			_slots[node.slot] = node.next;
+		}
+		if (node.next != None)
+		{
+			_nodes[node.next].prev = node.prev;
+		}
+	}
+
+	/// Return a node to the free list; it must already be off its slot
+	void Release(uint32_t index)
+	{
+		Node& node = _nodes[index];
+		node.payload = TPayload();
+		node.armed = false;
+		node.generation++;
+		if (node.generation == 0)
+		{
+			node.generation = 1;
+		}
+		node.next = _free;
+		_free = index;
+		_count--;
+	}
+
+	void Cascade(unsigned int level, uint32_t slot)
+	{
+		uint32_t& head = _slots[level * SlotsPerLevel + slot];
+		uint32_t index = head;
+		head = None;
+
+		while (index != None)
+		{
+			uint32_t following = _nodes[index].next;
+			Link(index);
+			_stats.cascaded++;
+			index = following;
+		}
+	}
+
+	TimerWheel(const TimerWheel&) = delete;
+	TimerWheel& operator=(const TimerWheel&) = delete;
+
+	/// Next tick to expire; everything armed expires at or after it
+	uint64_t _next;
+	size_t _count;
+	std::vector<Node> _nodes;
+	/// Head of each slot's list, level by level, then the expiring list
+	uint32_t _slots[Levels * SlotsPerLevel + 1];
+	/// Head of the free node list
+	uint32_t _free;
+	TimerWheelStats _stats;
+};
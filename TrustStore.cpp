@@ -0,0 +1,485 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include "TrustStore.h"
+#include "MacAddress.h"
+
+static_assert(sizeof(wchar_t) == 2, "trust log stores UTF-16 device IDs");
+
+static const uint32_t TrustLogMagic = 0x54444657; // "WFDT"
+static const uint32_t TrustLogVersion = 1;
+static const size_t TrustIdCapacity = 128;
+
+struct TrustLogHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t recordSize;
+	uint32_t reserved;
+};
+
+/// One change as laid out in the log
+struct TrustStore::Record
+{
+	uint64_t mac;
+	uint64_t updated;
+	uint32_t trust;
+	uint32_t origin;
+	uint32_t pairingKinds;
+	int32_t pairingResult;
+	/// Nonzero if the peer was forgotten
+	uint32_t removed;
+	wchar_t id[TrustIdCapacity];
+	/// Over everything above, a torn write fails it
+	uint32_t checksum;
+};
+
+static uint32_t ChecksumRecord(const void* data, size_t size)
+{
+	// FNV-1a
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static uint64_t GetFileTimeNow()
+{
+	FILETIME now;
+	GetSystemTimeAsFileTime(&now);
+	return (static_cast<uint64_t>(now.dwHighDateTime) << 32) | now.dwLowDateTime;
+}
+
+static HRESULT WriteAll(HANDLE file, const void* data, DWORD size)
+{
+	DWORD written = 0;
+	if (!WriteFile(file, data, size, &written, nullptr))
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+	return (written == size) ? S_OK : HRESULT_FROM_WIN32(ERROR_WRITE_FAULT);
+}
+
+HRESULT TrustStore::WriteHeader(HANDLE file)
+{
+	TrustLogHeader header = {};
+	header.magic = TrustLogMagic;
+	header.version = TrustLogVersion;
+	header.recordSize = sizeof(TrustStore::Record);
+	return WriteAll(file, &header, sizeof(header));
+}
+
+TrustStore::TrustStore()
+	: _file(INVALID_HANDLE_VALUE)
+{
+}
+
+TrustStore::~TrustStore()
+{
+	Close();
+}
+
+HRESULT TrustStore::Open(const wchar_t* path)
+{
+	Close();
+	_path = path;
+
+	_file = CreateFileW(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (_file == INVALID_HANDLE_VALUE)
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	TrustLogHeader header = {};
+	DWORD read = 0;
+	if (!ReadFile(_file, &header, sizeof(header), &read, nullptr) ||
+		read != sizeof(header) ||
+		header.magic != TrustLogMagic ||
+		header.version != TrustLogVersion ||
+		header.recordSize != sizeof(Record))
+	{
+		// New, empty or from another build: start over
+		LARGE_INTEGER start = {};
+		HRESULT hr = S_OK;
+		if (!SetFilePointerEx(_file, start, nullptr, FILE_BEGIN) || !SetEndOfFile(_file))
+		{
+			hr = HRESULT_FROM_WIN32(GetLastError());
+		}
+		if (SUCCEEDED(hr))
+		{
+			hr = WriteHeader(_file);
+		}
+		if (FAILED(hr))
+		{
+			Close();
+		}
+		return hr;
+	}
+
+	// Replay in chunks; the first record that does not check out ends the log
+	std::vector<Record> chunk(256);
+	LARGE_INTEGER valid = {};
+	valid.QuadPart = sizeof(header);
+	bool torn = false;
+
+	for (;;)
+	{
+		if (!ReadFile(_file, chunk.data(), static_cast<DWORD>(chunk.size() * sizeof(Record)), &read, nullptr))
+		{
+			HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+			Close();
+			return hr;
+		}
+
+		size_t count = read / sizeof(Record);
+		for (size_t i = 0; i < count; i++)
+		{
+			if (chunk[i].checksum != ChecksumRecord(&chunk[i], offsetof(Record, checksum)))
+			{
+				torn = true;
+				break;
+			}
+
+			Replay(chunk[i]);
+			_stats.records++;
+			valid.QuadPart += sizeof(Record);
+		}
+
+		if (torn || read < chunk.size() * sizeof(Record))
+		{
+			// A partial record at the end is a torn write too
+			torn = torn || (read % sizeof(Record)) != 0;
+			break;
+		}
+	}
+
+	// Cut off whatever follows the last good record, new records go after it
+	LARGE_INTEGER size = {};
+	GetFileSizeEx(_file, &size);
+	if (size.QuadPart > valid.QuadPart)
+	{
+		_stats.discarded += (size.QuadPart - valid.QuadPart + sizeof(Record) - 1) / sizeof(Record);
+	}
+	if (!SetFilePointerEx(_file, valid, nullptr, FILE_BEGIN) || !SetEndOfFile(_file))
+	{
+		HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+		Close();
+		return hr;
+	}
+
+	return CompactIfGrown();
+}
+
+void TrustStore::Close()
+{
+	if (_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(_file);
+		_file = INVALID_HANDLE_VALUE;
+	}
+
+	_entries.clear();
+	_byMac.clear();
+	_stats = TrustStoreStats();
+}
+
+PeerTrust TrustStore::Lookup(const wchar_t* id, size_t length)
+{
+	const TrustEntry* entry = Find(id, length);
+	PeerTrust trust = (entry != nullptr) ? entry->trust : PeerTrust::Unknown;
+
+	_stats.lookups++;
+	if (trust == PeerTrust::Trusted)
+	{
+		_stats.trustedHits++;
+	}
+	else if (trust == PeerTrust::Banned)
+	{
+		_stats.bannedHits++;
+	}
+	return trust;
+}
+
+const TrustEntry* TrustStore::Find(const wchar_t* id, size_t length) const
+{
+	// By MAC first: no string to build or hash for the common case of a peer known under this ID
+	const TrustEntry* byMac = nullptr;
+	uint64_t mac = ParseMacSuffix(id, length);
+	if (mac != InvalidMacAddress)
+	{
+		auto found = _byMac.find(mac);
+		if (found != _byMac.end())
+		{
+			byMac = found->second;
+			if (byMac->id.length() == length && wmemcmp(byMac->id.c_str(), id, length) == 0)
+			{
+				return byMac;
+			}
+		}
+	}
+
+	// An ID without a MAC, or the entry this exact ID has besides the one its MAC points at
+	auto it = _entries.find(std::wstring(id, length));
+	return (it != _entries.end()) ? &it->second : byMac;
+}
+
+TrustEntry* TrustStore::Locate(const std::wstring& id)
+{
+	auto it = _entries.find(id);
+	return (it != _entries.end()) ? &it->second : nullptr;
+}
+
+HRESULT TrustStore::SetTrust(const wchar_t* id, size_t length, PeerTrust trust, TrustOrigin origin)
+{
+	if (!IsOpen() || length == 0 || length >= TrustIdCapacity)
+	{
+		return E_INVALIDARG;
+	}
+
+	std::wstring key(id, length);
+	TrustEntry* existing = Locate(key);
+
+	TrustEntry entry;
+	if (existing != nullptr)
+	{
+		entry = *existing;
+	}
+	else
+	{
+		entry.id = key;
+		entry.mac = ParseMacSuffix(id, length);
+		entry.pairingKinds = 0;
+		entry.pairingResult = 0;
+	}
+	entry.trust = trust;
+	entry.origin = origin;
+	entry.updated = GetFileTimeNow();
+
+	HRESULT hr = Append(entry, false);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	Index(entry);
+	return CompactIfGrown();
+}
+
+HRESULT TrustStore::RecordPairing(const wchar_t* id, size_t length, uint32_t pairingKinds, int32_t result, bool paired)
+{
+	if (!IsOpen() || length == 0 || length >= TrustIdCapacity)
+	{
+		return E_INVALIDARG;
+	}
+
+	std::wstring key(id, length);
+	TrustEntry* existing = Locate(key);
+
+	TrustEntry entry;
+	if (existing != nullptr)
+	{
+		entry = *existing;
+	}
+	else
+	{
+		entry.id = key;
+		entry.mac = ParseMacSuffix(id, length);
+		entry.trust = PeerTrust::Unknown;
+		entry.origin = TrustOrigin::Pairing;
+	}
+
+	// A failed attempt keeps whatever trust the peer had; a ban always sticks
+	if (paired && entry.trust != PeerTrust::Banned)
+	{
+		entry.trust = PeerTrust::Trusted;
+		entry.origin = TrustOrigin::Pairing;
+	}
+	entry.pairingKinds = pairingKinds;
+	entry.pairingResult = result;
+	entry.updated = GetFileTimeNow();
+
+	HRESULT hr = Append(entry, false);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	Index(entry);
+	return CompactIfGrown();
+}
+
+HRESULT TrustStore::Forget(const wchar_t* id, size_t length)
+{
+	if (!IsOpen())
+	{
+		return E_INVALIDARG;
+	}
+
+	TrustEntry* existing = Locate(std::wstring(id, length));
+	if (existing == nullptr)
+	{
+		return S_FALSE;
+	}
+
+	TrustEntry entry = *existing;
+	HRESULT hr = Append(entry, true);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	Unindex(entry);
+	return CompactIfGrown();
+}
+
+HRESULT TrustStore::Append(const TrustEntry& entry, bool removed)
+{
+	Record record = {};
+	record.mac = entry.mac;
+	record.updated = entry.updated;
+	record.trust = static_cast<uint32_t>(entry.trust);
+	record.origin = static_cast<uint32_t>(entry.origin);
+	record.pairingKinds = entry.pairingKinds;
+	record.pairingResult = entry.pairingResult;
+	record.removed = removed ? 1 : 0;
+	wmemcpy(record.id, entry.id.c_str(), entry.id.length());
+	record.checksum = ChecksumRecord(&record, offsetof(Record, checksum));
+
+	HRESULT hr = WriteAll(_file, &record, sizeof(record));
+	if (SUCCEEDED(hr) && !FlushFileBuffers(_file))
+	{
+		hr = HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	if (SUCCEEDED(hr))
+	{
+		_stats.records++;
+	}
+	return hr;
+}
+
+void TrustStore::Replay(const Record& record)
+{
+	TrustEntry entry;
+	entry.id.assign(record.id, wcsnlen(record.id, TrustIdCapacity));
+	entry.mac = record.mac;
+	entry.trust = static_cast<PeerTrust>(record.trust);
+	entry.origin = static_cast<TrustOrigin>(record.origin);
+	entry.pairingKinds = record.pairingKinds;
+	entry.pairingResult = record.pairingResult;
+	entry.updated = record.updated;
+
+	if (record.removed)
+	{
+		Unindex(entry);
+	}
+	else
+	{
+		Index(entry);
+	}
+}
+
+void TrustStore::Index(const TrustEntry& entry)
+{
+	TrustEntry& stored = _entries[entry.id];
+	stored = entry;
+	if (entry.mac != InvalidMacAddress)
+	{
+		_byMac[entry.mac] = &stored;
+	}
+}
+
+void TrustStore::Unindex(const TrustEntry& entry)
+{
+	auto byMac = _byMac.find(entry.mac);
+	if (byMac != _byMac.end() && byMac->second->id == entry.id)
+	{
+		_byMac.erase(byMac);
+	}
+
+	_entries.erase(entry.id);
+}
+
+HRESULT TrustStore::CompactIfGrown()
+{
+	if (_stats.records <= 2 * _entries.size() + CompactionSlack)
+	{
+		return S_OK;
+	}
+	return Compact();
+}
+
+HRESULT TrustStore::Compact()
+{
+	if (!IsOpen())
+	{
+		return E_ILLEGAL_METHOD_CALL;
+	}
+
+	// Write the live entries next to the log and swap it in; a crash leaves one or the other
+	std::wstring compactPath = _path + L".compact";
+	HANDLE compact = CreateFileW(compactPath.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (compact == INVALID_HANDLE_VALUE)
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	HANDLE log = _file;
+	_file = compact;
+
+	uint64_t records = _stats.records;
+	_stats.records = 0;
+
+	HRESULT hr = WriteHeader(compact);
+	for (auto it = _entries.begin(); SUCCEEDED(hr) && it != _entries.end(); ++it)
+	{
+		// Append flushes every record; acceptable, compaction is rare and the table small
+		hr = Append(it->second, false);
+	}
+
+	CloseHandle(compact);
+	CloseHandle(log);
+
+	if (SUCCEEDED(hr) && !MoveFileExW(compactPath.c_str(), _path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+	{
+		hr = HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	if (FAILED(hr))
+	{
+		DeleteFileW(compactPath.c_str());
+		_stats.records = records;
+	}
+	else
+	{
+		_stats.compactions++;
+	}
+
+	// Keep appending to whichever file is now in place
+	_file = CreateFileW(_path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (_file == INVALID_HANDLE_VALUE)
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	LARGE_INTEGER end = {};
+	if (!SetFilePointerEx(_file, end, nullptr, FILE_END))
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	return hr;
+}
@@ -0,0 +1,161 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+/// What to do with a peer's connection requests
+enum class PeerTrust : uint32_t
+{
+	/// Ask, or follow the auto-accept setting
+	Unknown = 0,
+	/// Accept without asking
+	Trusted = 1,
+	/// Reject before any work is done
+	Banned = 2
+};
+
+/// Who decided a peer's trust
+enum class TrustOrigin : uint32_t
+{
+	/// The peer paired successfully
+	Pairing = 0,
+	/// Someone at the console
+	Manual = 1
+};
+
+struct TrustEntry
+{
+	std::wstring id;
+	/// From the ID suffix, so a peer reconnecting under another interface ID is still found
+	uint64_t mac;
+	PeerTrust trust;
+	TrustOrigin origin;
+	/// DevicePairingKinds of the last pairing ceremony, 0 if the peer never got that far
+	uint32_t pairingKinds;
+	/// DevicePairingResultStatus of the last pairing attempt
+	int32_t pairingResult;
+	/// FILETIME of the last change
+	uint64_t updated;
+};
+
+struct TrustStoreStats
+{
+	TrustStoreStats()
+		: records(0),
+		  compactions(0),
+		  discarded(0),
+		  lookups(0),
+		  trustedHits(0),
+		  bannedHits(0)
+	{}
+
+	/// Records in the log, live or superseded
+	uint64_t records;
+	uint64_t compactions;
+	/// Torn or corrupt records cut off the end of the log when it was opened
+	uint64_t discarded;
+	/// Lookup calls and how many found a trusted or banned peer
+	uint64_t lookups;
+	uint64_t trustedHits;
+	uint64_t bannedHits;
+};
+
+/// Trust decisions about peers, kept across runs. Every change is appended to a log file as one
+/// fixed-size checksummed record and applied to hash tables keyed by device ID and MAC, so lookups
+/// never touch the disk. Open replays the log; once superseded records outnumber live ones the
+/// log is rewritten with one record per peer. Not thread-safe, callers serialize access.
+class TrustStore
+{
+public:
+	TrustStore();
+	~TrustStore();
+
+	/// Replay the log, creating it when missing or resetting it when from an incompatible build
+	HRESULT Open(const wchar_t* path);
+	void Close();
+
+	bool IsOpen() const
+	{
+		return _file != INVALID_HANDLE_VALUE;
+	}
+
+	size_t GetCount() const
+	{
+		return _entries.size();
+	}
+
+	/// Trust of a peer by ID, or by the MAC in its ID; Unknown if neither is recorded
+	PeerTrust Lookup(const wchar_t* id, size_t length);
+
+	/// Entry for a peer by ID or MAC, or nullptr
+	const TrustEntry* Find(const wchar_t* id, size_t length) const;
+
+	HRESULT SetTrust(const wchar_t* id, size_t length, PeerTrust trust, TrustOrigin origin);
+
+	/// Record a pairing attempt; success trusts the peer unless it is banned
+	HRESULT RecordPairing(const wchar_t* id, size_t length, uint32_t pairingKinds, int32_t result, bool paired);
+
+	/// Drop everything recorded about a peer
+	HRESULT Forget(const wchar_t* id, size_t length);
+
+	/// Rewrite the log with one record per peer
+	HRESULT Compact();
+
+	TrustStoreStats GetStats() const
+	{
+		return _stats;
+	}
+
+	/// Call func(entry) for every peer
+	template <typename TFunc>
+	void ForEach(TFunc func) const
+	{
+		for (auto& entry : _entries)
+		{
+			func(entry.second);
+		}
+	}
+
+private:
+	/// Superseded records tolerated beyond the live ones before Compact runs
+	static const uint64_t CompactionSlack = 64;
+
+	struct Record;
+
+	/// Entry for an ID; called with the full ID, nullptr if absent
+	TrustEntry* Locate(const std::wstring& id);
+
+	/// Append one record for entry, or a removal if removed is set, and flush it
+	HRESULT Append(const TrustEntry& entry, bool removed);
+
+	static HRESULT WriteHeader(HANDLE file);
+
+	/// Apply a record read from the log
+	void Replay(const Record& record);
+
+	void Index(const TrustEntry& entry);
+	void Unindex(const TrustEntry& entry);
+
+	/// Compact once superseded records outnumber live ones
+	HRESULT CompactIfGrown();
+
+	std::wstring _path;
+	HANDLE _file;
+	std::unordered_map<std::wstring, TrustEntry> _entries;
+	/// MAC to entry, for peers whose ID has a MAC suffix; node-based, so the pointers stay valid
+	/// while their entries do
+	std::unordered_map<uint64_t, const TrustEntry*> _byMac;
+	TrustStoreStats _stats;
+};
@@ -0,0 +1,786 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+#include <string>
+#include <utility>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define WFD_UTF8_SSE2 1
+#else
+#define WFD_UTF8_SSE2 0
+#endif
+
+/// What malformed input decodes to
+const uint32_t ReplacementCharacter = 0xFFFD;
+
+/// Decode the code point at text[index] and move index past it. An unpaired surrogate decodes as
+/// U+FFFD.
+template <typename TUnit>
+inline uint32_t DecodeUtf16(const TUnit* text, size_t length, size_t& index)
+{
+	static_assert(sizeof(TUnit) == 2, "UTF-16 code units are 16 bits");
+
+	uint32_t unit = static_cast<uint16_t>(text[index++]);
+	if (unit < 0xD800 || unit > 0xDFFF)
+	{
+		return unit;
+	}
+
+	if (unit <= 0xDBFF && index < length)
+	{
+		uint32_t low = static_cast<uint16_t>(text[index]);
+		if (low >= 0xDC00 && low <= 0xDFFF)
+		{
+			index++;
+			return 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+		}
+	}
+	return ReplacementCharacter;
+}
+
+/// Decode the code point at text[index] and move index past it. A truncated or invalid sequence,
+/// an overlong form or an encoded surrogate decodes as U+FFFD and skips one byte.
+inline uint32_t DecodeUtf8(const char* text, size_t length, size_t& index)
+{
+	uint32_t lead = static_cast<unsigned char>(text[index]);
+	if (lead < 0x80)
+	{
+		index++;
+		return lead;
+	}
+
+	size_t extra;
+	uint32_t codePoint;
+	uint32_t minimum;
+	if ((lead & 0xE0) == 0xC0)
+	{
+		extra = 1;
+		codePoint = lead & 0x1F;
+		minimum = 0x80;
+	}
+	else if ((lead & 0xF0) == 0xE0)
+	{
+		extra = 2;
+		codePoint = lead & 0x0F;
+		minimum = 0x800;
+	}
+	else if ((lead & 0xF8) == 0xF0)
+	{
+		extra = 3;
+		codePoint = lead & 0x07;
+		minimum = 0x10000;
+	}
+	else
+	{
+		index++;
+		return ReplacementCharacter;
+	}
+
+	if (extra >= length - index)
+	{
+		index++;
+		return ReplacementCharacter;
+	}
+
+	for (size_t i = 1; i <= extra; i++)
+	{
+		uint32_t next = static_cast<unsigned char>(text[index + i]);
+		if ((next & 0xC0) != 0x80)
+		{
+			index++;
+			return ReplacementCharacter;
+		}
+		codePoint = (codePoint << 6) | (next & 0x3F);
+	}
+
+	if (codePoint < minimum || codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF))
+	{
+		index++;
+		return ReplacementCharacter;
+	}
+
+	index += extra + 1;
+	return codePoint;
+}
+
+/// Code point of a UTF-32 unit; one that is out of range or a surrogate decodes as U+FFFD
+template <typename TUnit>
+inline uint32_t DecodeUtf32(TUnit unit)
+{
+	uint32_t codePoint = static_cast<uint32_t>(unit);
+	return (codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF)) ? ReplacementCharacter : codePoint;
+}
+
+inline size_t GetUtf8Length(uint32_t codePoint)
+{
+	return (codePoint < 0x80) ? 1 : (codePoint < 0x800) ? 2 : (codePoint < 0x10000) ? 3 : 4;
+}
+
+/// Write a valid code point as UTF-8; returns the bytes written
+inline size_t EncodeUtf8(uint32_t codePoint, char* out)
+{
+	if (codePoint < 0x80)
+	{
+		out[0] = static_cast<char>(codePoint);
+		return 1;
+	}
+	if (codePoint < 0x800)
+	{
+		out[0] = static_cast<char>(0xC0 | (codePoint >> 6));
+		out[1] = static_cast<char>(0x80 | (codePoint & 0x3F));
+		return 2;
+	}
+	if (codePoint < 0x10000)
+	{
+		out[0] = static_cast<char>(0xE0 | (codePoint >> 12));
+		out[1] = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+		out[2] = static_cast<char>(0x80 | (codePoint & 0x3F));
+		return 3;
+	}
+	out[0] = static_cast<char>(0xF0 | (codePoint >> 18));
+	out[1] = static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+	out[2] = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+	out[3] = static_cast<char>(0x80 | (codePoint & 0x3F));
+	return 4;
+}
+
+/// Write a valid code point as UTF-16; returns the units written
+template <typename TUnit>
+inline size_t EncodeUtf16(uint32_t codePoint, TUnit* out)
+{
+	if (codePoint < 0x10000)
+	{
+		out[0] = static_cast<TUnit>(codePoint);
+		return 1;
+	}
+	codePoint -= 0x10000;
+	out[0] = static_cast<TUnit>(0xD800 + (codePoint >> 10));
+	out[1] = static_cast<TUnit>(0xDC00 + (codePoint & 0x3FF));
+	return 2;
+}
+
+/// Narrow the run of ASCII at the start of text to out, or only measure it if out is nullptr. Goes
+/// a vector at a time and stops at the first vector holding anything else, so the result is a
+/// multiple of 8 units; the caller carries on from there one code point at a time. 0 without SSE2.
+template <typename TUnit>
+inline size_t NarrowAscii(const TUnit* text, size_t length, char* out)
+{
+	size_t index = 0;
+#if WFD_UTF8_SSE2
+	if constexpr (sizeof(TUnit) == 2)
+	{
+		const __m128i high = _mm_set1_epi16(static_cast<short>(0xFF80));
+		const __m128i zero = _mm_setzero_si128();
+		for (; index + 16 <= length; index += 16)
+		{
+			__m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + index));
+			__m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + index + 8));
+			if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(_mm_or_si128(first, second), high), zero)) != 0xFFFF)
+			{
+				break;
+			}
+			if (out != nullptr)
+			{
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + index), _mm_packus_epi16(first, second));
+			}
+		}
+		if (index + 8 <= length)
+		{
+			__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + index));
+			if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(block, high), zero)) == 0xFFFF)
+			{
+				if (out != nullptr)
+				{
+					_mm_storel_epi64(reinterpret_cast<__m128i*>(out + index), _mm_packus_epi16(block, block));
+				}
+				index += 8;
+			}
+		}
+	}
+	else if constexpr (sizeof(TUnit) == 4)
+	{
+		const __m128i high = _mm_set1_epi32(static_cast<int>(0xFFFFFF80));
+		const __m128i zero = _mm_setzero_si128();
+		for (; index + 16 <= length; index += 16)
+		{
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + index));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + index + 4));
+			__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + index + 8));
+			__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + index + 12));
+			__m128i any = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+			if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(any, high), zero)) != 0xFFFF)
+			{
+				break;
+			}
+			if (out != nullptr)
+			{
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + index), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+			}
+		}
+	}
+#else
+	(void)text;
+	(void)length;
+	(void)out;
+#endif
+	return index;
+}
+
+/// Widen the run of ASCII at the start of text to out, a vector at a time like NarrowAscii
+template <typename TUnit>
+inline size_t WidenAscii(const char* text, size_t length, TUnit* out)
+{
+	size_t index = 0;
+#if WFD_UTF8_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	for (; index + 16 <= length; index += 16)
+	{
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + index));
+		if (_mm_movemask_epi8(block) != 0)
+		{
+			break;
+		}
+
+		__m128i low = _mm_unpacklo_epi8(block, zero);
+		__m128i high = _mm_unpackhi_epi8(block, zero);
+		if constexpr (sizeof(TUnit) == 2)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + index), low);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + index + 8), high);
+		}
+		else
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + index), _mm_unpacklo_epi16(low, zero));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + index + 4), _mm_unpackhi_epi16(low, zero));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + index + 8), _mm_unpacklo_epi16(high, zero));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + index + 12), _mm_unpackhi_epi16(high, zero));
+		}
+	}
+#else
+	(void)text;
+	(void)length;
+	(void)out;
+#endif
+	return index;
+}
+
+/// Length of the run of ASCII at the start of UTF-8 text, a vector at a time like NarrowAscii
+inline size_t SkipAscii(const char* text, size_t length)
+{
+	size_t index = 0;
+#if WFD_UTF8_SSE2
+	for (; index + 16 <= length; index += 16)
+	{
+		if (_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(text + index))) != 0)
+		{
+			break;
+		}
+	}
+#else
+	(void)text;
+	(void)length;
+#endif
+	return index;
+}
+
+/// Bytes UTF-16 text takes as UTF-8
+template <typename TUnit, bool Vectorized = true>
+inline size_t GetUtf8LengthOfUtf16(const TUnit* text, size_t length)
+{
+	size_t bytes = 0;
+	size_t index = 0;
+	while (index < length)
+	{
+		if (Vectorized)
+		{
+			size_t ascii = NarrowAscii(text + index, length - index, static_cast<char*>(nullptr));
+			bytes += ascii;
+			index += ascii;
+			if (index == length)
+			{
+				break;
+			}
+		}
+		bytes += GetUtf8Length(DecodeUtf16(text, length, index));
+	}
+	return bytes;
+}
+
+/// Transcode UTF-16 to UTF-8; out must have room for GetUtf8LengthOfUtf16 bytes (3 per unit
+/// always does). Returns the bytes written. Vectorized = false is the plain loop the vectorized
+/// one falls back to, for comparing the two.
+template <typename TUnit, bool Vectorized = true>
+inline size_t Utf16ToUtf8(const TUnit* text, size_t length, char* out)
+{
+	size_t written = 0;
+	size_t index = 0;
+	while (index < length)
+	{
+		if (Vectorized)
+		{
+			size_t ascii = NarrowAscii(text + index, length - index, out + written);
+			written += ascii;
+			index += ascii;
+			if (index == length)
+			{
+				break;
+			}
+		}
+		written += EncodeUtf8(DecodeUtf16(text, length, index), out + written);
+	}
+	return written;
+}
+
+/// UTF-16 units UTF-8 text takes
+template <bool Vectorized = true>
+inline size_t GetUtf16LengthOfUtf8(const char* text, size_t length)
+{
+	size_t units = 0;
+	size_t index = 0;
+	while (index < length)
+	{
+		if (Vectorized)
+		{
+			size_t ascii = SkipAscii(text + index, length - index);
+			units += ascii;
+			index += ascii;
+			if (index == length)
+			{
+				break;
+			}
+		}
+		units += (DecodeUtf8(text, length, index) < 0x10000) ? 1 : 2;
+	}
+	return units;
+}
+
+/// UTF-32 units, that is code points, UTF-8 text takes
+inline size_t GetUtf32LengthOfUtf8(const char* text, size_t length)
+{
+	size_t units = 0;
+	size_t index = 0;
+	while (index < length)
+	{
+		size_t ascii = SkipAscii(text + index, length - index);
+		units += ascii;
+		index += ascii;
+		if (index == length)
+		{
+			break;
+		}
+		DecodeUtf8(text, length, index);
+		units++;
+	}
+	return units;
+}
+
+/// Transcode UTF-8 to UTF-16; out must have room for GetUtf16LengthOfUtf8 units (1 per byte always
+/// does). Returns the units written.
+template <typename TUnit, bool Vectorized = true>
+inline size_t Utf8ToUtf16(const char* text, size_t length, TUnit* out)
+{
+	static_assert(sizeof(TUnit) == 2, "UTF-16 code units are 16 bits");
+
+	size_t written = 0;
+	size_t index = 0;
+	while (index < length)
+	{
+		if (Vectorized)
+		{
+			size_t ascii = WidenAscii(text + index, length - index, out + written);
+			written += ascii;
+			index += ascii;
+			if (index == length)
+			{
+				break;
+			}
+		}
+		written += EncodeUtf16(DecodeUtf8(text, length, index), out + written);
+	}
+	return written;
+}
+
+/// Bytes UTF-32 text takes as UTF-8
+template <typename TUnit>
+inline size_t GetUtf8LengthOfUtf32(const TUnit* text, size_t length)
+{
+	size_t bytes = 0;
+	size_t index = 0;
+	while (index < length)
+	{
+		size_t ascii = NarrowAscii(text + index, length - index, static_cast<char*>(nullptr));
+		bytes += ascii;
+		index += ascii;
+		if (index == length)
+		{
+			break;
+		}
+		bytes += GetUtf8Length(DecodeUtf32(text[index++]));
+	}
+	return bytes;
+}
+
+/// Transcode UTF-32 to UTF-8; out must have room for GetUtf8LengthOfUtf32 bytes
+template <typename TUnit>
+inline size_t Utf32ToUtf8(const TUnit* text, size_t length, char* out)
+{
+	size_t written = 0;
+	size_t index = 0;
+	while (index < length)
+	{
+		size_t ascii = NarrowAscii(text + index, length - index, out + written);
+		written += ascii;
+		index += ascii;
+		if (index == length)
+		{
+			break;
+		}
+		written += EncodeUtf8(DecodeUtf32(text[index++]), out + written);
+	}
+	return written;
+}
+
+/// Transcode UTF-8 to UTF-32; out must have room for one unit per byte. Returns the units written.
+template <typename TUnit>
+inline size_t Utf8ToUtf32(const char* text, size_t length, TUnit* out)
+{
+	size_t written = 0;
+	size_t index = 0;
+	while (index < length)
+	{
+		size_t ascii = WidenAscii(text + index, length - index, out + written);
+		written += ascii;
+		index += ascii;
+		if (index == length)
+		{
+			break;
+		}
+		out[written++] = static_cast<TUnit>(DecodeUtf8(text, length, index));
+	}
+	return written;
+}
+
+/// UTF-8 string for IDs and names that are stored, compared and rarely handed out again. A
+/// wchar_t is 2 bytes on Windows and 4 on Linux, while the IDs and names peers report are nearly
+/// all ASCII: stored as UTF-8 they take a byte per character on both. Up to InlineCapacity bytes
+/// live in the object itself; that covers Wi-Fi Direct device names (at most 32 bytes of UTF-8)
+/// and device IDs ending in a MAC address, so a peer's strings usually need no allocation at all.
+///
+/// Wide text goes in and comes out through the transcoding functions above, UTF-16 or UTF-32
+/// depending on the size of wchar_t; on Windows that is the HSTRING boundary: AssignWide straight
+/// from HString::GetRawBuffer, and CopyTo into a buffer from WindowsPreallocateStringBuffer sized
+/// with GetWideLength.
+class Utf8String
+{
+public:
+	static const size_t InlineCapacity = 46;
+
+	Utf8String()
+		: _tag(0)
+	{
+		_bytes[0] = '\0';
+	}
+
+	Utf8String(const char* text, size_t length)
+		: Utf8String()
+	{
+		Assign(text, length);
+	}
+
+	Utf8String(const wchar_t* text, size_t length)
+		: Utf8String()
+	{
+		AssignWide(text, length);
+	}
+
+	explicit Utf8String(const std::wstring& text)
+		: Utf8String()
+	{
+		AssignWide(text.c_str(), text.length());
+	}
+
+	Utf8String(const Utf8String& other)
+		: Utf8String()
+	{
+		Assign(other.GetData(), other.GetLength());
+	}
+
+	Utf8String(Utf8String&& other) noexcept
+	{
+		memcpy(_bytes, other._bytes, sizeof(_bytes));
+		_tag = other._tag;
+		other._bytes[0] = '\0';
+		other._tag = 0;
+	}
+
+	~Utf8String()
+	{
+		if (_tag == HeapTag)
+		{
+			delete[] GetHeap().data;
+		}
+	}
+
+	Utf8String& operator=(const Utf8String& other)
+	{
+		if (this != &other)
+		{
+			Assign(other.GetData(), other.GetLength());
+		}
+		return *this;
+	}
+
+	Utf8String& operator=(Utf8String&& other) noexcept
+	{
+		if (this != &other)
+		{
+			if (_tag == HeapTag)
+			{
+				delete[] GetHeap().data;
+			}
+			memcpy(_bytes, other._bytes, sizeof(_bytes));
+			_tag = other._tag;
+			other._bytes[0] = '\0';
+			other._tag = 0;
+		}
+		return *this;
+	}
+
+	/// NUL terminated
+	const char* GetData() const
+	{
+		return (_tag == HeapTag) ? GetHeap().data : _bytes;
+	}
+
+	/// In bytes
+	size_t GetLength() const
+	{
+		return (_tag == HeapTag) ? GetHeap().length : _tag;
+	}
+
+	bool IsEmpty() const
+	{
+		return GetLength() == 0;
+	}
+
+	/// Bytes allocated outside the object, 0 while the text fits inline
+	size_t GetHeapBytes() const
+	{
+		return (_tag == HeapTag) ? GetHeap().capacity + 1 : 0;
+	}
+
+	/// Empty the string, keeping any allocation for the next Assign
+	void Clear()
+	{
+		SetLength(0);
+	}
+
+	/// Copy UTF-8 as it is
+	void Assign(const char* text, size_t length)
+	{
+		char* buffer = Reserve(length);
+		memmove(buffer, text, length);
+		SetLength(length);
+	}
+
+	template <typename TUnit>
+	void AssignUtf16(const TUnit* text, size_t length)
+	{
+		// Short enough to transcode in place whatever it holds, skip measuring it first
+		size_t bytes = (length * 3 <= InlineCapacity) ? length * 3 : GetUtf8LengthOfUtf16(text, length);
+		SetLength(Utf16ToUtf8(text, length, Reserve(bytes)));
+	}
+
+	void AssignWide(const wchar_t* text, size_t length)
+	{
+		if constexpr (sizeof(wchar_t) == 2)
+		{
+			AssignUtf16(text, length);
+		}
+		else
+		{
+			size_t bytes = (length * 4 <= InlineCapacity) ? length * 4 : GetUtf8LengthOfUtf32(text, length);
+			SetLength(Utf32ToUtf8(text, length, Reserve(bytes)));
+		}
+	}
+
+	/// wchar_t units the text takes
+	size_t GetWideLength() const
+	{
+		if constexpr (sizeof(wchar_t) == 2)
+		{
+			return GetUtf16LengthOfUtf8(GetData(), GetLength());
+		}
+		else
+		{
+			return GetUtf32LengthOfUtf8(GetData(), GetLength());
+		}
+	}
+
+	/// Write the text as wchar_t to a buffer of at least GetWideLength units, not NUL terminated.
+	/// Returns the units written.
+	size_t CopyTo(wchar_t* buffer) const
+	{
+		if constexpr (sizeof(wchar_t) == 2)
+		{
+			return Utf8ToUtf16(GetData(), GetLength(), buffer);
+		}
+		else
+		{
+			return Utf8ToUtf32(GetData(), GetLength(), buffer);
+		}
+	}
+
+	/// Replace target with the text, reusing its buffer
+	void CopyTo(std::wstring& target) const
+	{
+		// Never more units than bytes, shrink to what was written
+		target.resize(GetLength());
+		target.resize(CopyTo(&target[0]));
+	}
+
+	std::wstring ToWide() const
+	{
+		std::wstring wide;
+		CopyTo(wide);
+		return wide;
+	}
+
+	/// Same text as wide text, without transcoding either
+	bool EqualsWide(const wchar_t* text, size_t length) const
+	{
+		const char* data = GetData();
+		size_t bytes = GetLength();
+		size_t index = 0;
+		size_t unit = 0;
+		while (index < bytes && unit < length)
+		{
+			unsigned char byte = static_cast<unsigned char>(data[index]);
+			if (byte < 0x80)
+			{
+				if (static_cast<uint32_t>(text[unit]) != byte)
+				{
+					return false;
+				}
+				index++;
+				unit++;
+				continue;
+			}
+
+			uint32_t codePoint = DecodeUtf8(data, bytes, index);
+			uint32_t wide;
+			if constexpr (sizeof(wchar_t) == 2)
+			{
+				wide = DecodeUtf16(text, length, unit);
+			}
+			else
+			{
+				wide = DecodeUtf32(text[unit++]);
+			}
+			if (codePoint != wide)
+			{
+				return false;
+			}
+		}
+		return index == bytes && unit == length;
+	}
+
+	bool operator==(const Utf8String& other) const
+	{
+		return GetLength() == other.GetLength() && memcmp(GetData(), other.GetData(), GetLength()) == 0;
+	}
+
+	bool operator!=(const Utf8String& other) const
+	{
+		return !(*this == other);
+	}
+
+private:
+	static const uint8_t HeapTag = 0xFF;
+
+	/// Where the text is once it outgrows the object, kept at the start of _bytes
+	struct Heap
+	{
+		char* data;
+		size_t length;
+		size_t capacity;
+	};
+
+	Heap GetHeap() const
+	{
+		Heap heap;
+		memcpy(&heap, _bytes, sizeof(heap));
+		return heap;
+	}
+
+	void SetHeap(const Heap& heap)
+	{
+		memcpy(_bytes, &heap, sizeof(heap));
+		_tag = HeapTag;
+	}
+
+	/// Buffer with room for length bytes and a NUL; the old text is kept only if it stays put
+	char* Reserve(size_t length)
+	{
+		if (_tag == HeapTag)
+		{
+			// Only ever allocated for more than fits inline
+			Heap heap = GetHeap();
+			if (length <= heap.capacity)
+			{
+				return heap.data;
+			}
+			delete[] heap.data;
+			_tag = 0;
+		}
+
+		if (length <= InlineCapacity)
+		{
+			return _bytes;
+		}
+
+		Heap heap;
+		heap.data = new char[length + 1];
+		heap.length = 0;
+		heap.capacity = length;
+		SetHeap(heap);
+		return heap.data;
+	}
+
+	void SetLength(size_t length)
+	{
+		if (_tag == HeapTag)
+		{
+			Heap heap = GetHeap();
+			heap.length = length;
+			heap.data[length] = '\0';
+			SetHeap(heap);
+		}
+		else
+		{
+			_bytes[length] = '\0';
+			_tag = static_cast<uint8_t>(length);
+		}
+	}
+
+	alignas(sizeof(void*)) char _bytes[InlineCapacity + 1];
+	/// Length of inline text, or HeapTag
+	uint8_t _tag;
+};
+
+static_assert(sizeof(Utf8String) == 48, "Utf8String is meant to fill 48 bytes");
@@ -1,88 +1,159 @@
-#include "stdafx.h"
-#include "WFDHelper.h"
-#include <wlanapi.h>
-#include <wchar.h>
-
-#define OD_LOGA(fmt,...)	{char buf[1024]; sprintf_s(buf, _countof(buf), fmt, __VA_ARGS__); OutputDebugStringA(buf);}
-#define OD_LOGW(fmt,...)	{wchar_t buf[1024]; swprintf_s(buf, _countof(buf), fmt, __VA_ARGS__); OutputDebugStringW(buf);}
-
-CWFDHelper::CWFDHelper():m_clientHandle(NULL), m_sessionHandle(NULL)
-{
-
-}
-
-CWFDHelper::~CWFDHelper()
-{
-
-}
-
-HRESULT CWFDHelper::Init()
-{
-	DWORD dwClientVersion = WFD_API_VERSION;
-	DWORD pdwNegotiatedVersion = 0;
-	DWORD connHandleStatus = WFDOpenHandle(dwClientVersion, &pdwNegotiatedVersion, &m_clientHandle); // Opening Client Handle  
-	if (connHandleStatus != ERROR_SUCCESS)
-	{
-		int err = GetLastError();
-		OD_LOGA("WFDOpenHandle: {error code: %d}.\n", err);
-
-		return HRESULT_FROM_WIN32(err);
-	}
-
-	return S_OK;
-}
-
-VOID CWFDHelper::WFD_OPEN_SESSION_COMPLETE_Handle(
-	_In_ HANDLE         hSessionHandle,
-	_In_ PVOID          pvContext,
-	_In_ GUID           guidSessionInterface,
-	_In_ DWORD          dwError,
-	_In_ DWORD          dwReasonCode
-)
-{
-	OD_LOGA("WFDStartOpenSession: {error code: %x, reason code: %x}.\n", dwError, dwReasonCode);
-}
-
-HRESULT CWFDHelper::Connect(const wchar_t* deviceId)
-{
-	const wchar_t* sub = wcschr(deviceId, '#');
-	if (sub)
-	{
-		DOT11_MAC_ADDRESS addr;
-		unsigned int address[6];
-		swscanf_s(sub, L"#%x:%x:%x:%x:%x:%x", &address[0], &address[1], &address[2], &address[3], &address[4], &address[5]);
-
-		for (size_t i = 0; i < 6; i++)
-		{
-			addr[i] = address[i];
-		}
-
-		GUID inf = GUID_NULL;
-		DWORD connHandleStatus = WFDOpenLegacySession(m_clientHandle, (PDOT11_MAC_ADDRESS)addr,  &m_sessionHandle, &inf);
-
-		if (connHandleStatus != ERROR_SUCCESS)
-		{
-			int err = GetLastError();
-			OD_LOGA("WFDStartOpenSession: {error code: %d}.\n", err);
-
-			return HRESULT_FROM_WIN32(err);
-		}
-	}
-
-	return S_OK;
-}
-
-HRESULT CWFDHelper::Close()
-{
-	if (m_sessionHandle != NULL)
-	{
-		WFDCloseSession(m_sessionHandle);
-	}
-
-	if (m_clientHandle != NULL)
-	{
-		WFDCloseHandle(m_clientHandle);
-	}
-
-	return S_OK;
-}
+#include "stdafx.h"
+#include "WFDHelper.h"
+#include "MacAddress.h"
+#include "EventLog.h"
+#include <wlanapi.h>
+#include <wchar.h>
+
+CWfdApiBackend::CWfdApiBackend():m_clientHandle(NULL)
+{
+
+}
+
+CWfdApiBackend::~CWfdApiBackend()
+{
+	Close();
+}
+
+HRESULT CWfdApiBackend::Open()
+{
+	DWORD dwClientVersion = WFD_API_VERSION;
+	DWORD pdwNegotiatedVersion = 0;
+	DWORD connHandleStatus = WFDOpenHandle(dwClientVersion, &pdwNegotiatedVersion, &m_clientHandle); // Opening Client Handle
+	if (connHandleStatus != ERROR_SUCCESS)
+	{
+		WFD_LOG_ERROR("WFDOpenHandle: {error code: %d}", connHandleStatus);
+
+		return HRESULT_FROM_WIN32(connHandleStatus);
+	}
+
+	return S_OK;
+}
+
+void CWfdApiBackend::Close()
+{
+	if (m_clientHandle != NULL)
+	{
+		WFDCloseHandle(m_clientHandle);
+		m_clientHandle = NULL;
+	}
+}
+
+uint32_t CWfdApiBackend::StartOpenSession(uint64_t address, OpenCompleted completed, SessionHandle* session)
+{
+	DOT11_MAC_ADDRESS addr;
+	for (size_t i = 0; i < 6; i++)
+	{
+		addr[i] = static_cast<UCHAR>(address >> (40 - 8 * i));
+	}
+
+	// Owned by the completion callback, which the API calls once for every open it started
+	OpenCompleted* context = new OpenCompleted(std::move(completed));
+
+	HANDLE sessionHandle = NULL;
+	DWORD connHandleStatus = WFDStartOpenSession(m_clientHandle, &addr, context, WFD_OPEN_SESSION_COMPLETE_Handle, &sessionHandle);
+	if (connHandleStatus != ERROR_SUCCESS)
+	{
+		delete context;
+		WFD_LOG_ERROR("WFDStartOpenSession: {error code: %d, peer: %012llx}", connHandleStatus, address);
+
+		return connHandleStatus;
+	}
+
+	*session = sessionHandle;
+	return ERROR_SUCCESS;
+}
+
+uint32_t CWfdApiBackend::CancelOpenSession(SessionHandle session)
+{
+	return WFDCancelOpenSession(session);
+}
+
+uint32_t CWfdApiBackend::CloseSession(SessionHandle session)
+{
+	return WFDCloseSession(session);
+}
+
+VOID WINAPI CWfdApiBackend::WFD_OPEN_SESSION_COMPLETE_Handle(
+	_In_ HANDLE         hSessionHandle,
+	_In_ PVOID          pvContext,
+	_In_ GUID           guidSessionInterface,
+	_In_ DWORD          dwError,
+	_In_ DWORD          dwReasonCode
+)
+{
+	WFD_LOG_INFO("WFDStartOpenSession completed: {error code: %x, reason code: %x}", dwError, dwReasonCode);
+
+	std::unique_ptr<OpenCompleted> completed(static_cast<OpenCompleted*>(pvContext));
+	(*completed)(dwError, dwReasonCode);
+}
+
+CWFDHelper::CWFDHelper():m_sessions(m_backend)
+{
+
+}
+
+CWFDHelper::~CWFDHelper()
+{
+
+}
+
+HRESULT CWFDHelper::Init()
+{
+	return m_backend.Open();
+}
+
+HRESULT CWFDHelper::ParseAddress(const wchar_t* deviceId, uint64_t& address)
+{
+	address = ParseMacSuffix(deviceId, wcslen(deviceId));
+	return (address != 0) ? S_OK : E_INVALIDARG;
+}
+
+HRESULT CWFDHelper::Connect(const wchar_t* deviceId, WfdSessionManager::Opened opened)
+{
+	uint64_t address;
+	HRESULT hr = ParseAddress(deviceId, address);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	// Returns once the open has started; opened reports how it went
+	if (!m_sessions.Open(address, opened))
+	{
+		return HRESULT_FROM_WIN32(ERROR_ALREADY_EXISTS);
+	}
+
+	return S_OK;
+}
+
+HRESULT CWFDHelper::Disconnect(const wchar_t* deviceId)
+{
+	uint64_t address;
+	HRESULT hr = ParseAddress(deviceId, address);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	return m_sessions.Close(address) ? S_OK : HRESULT_FROM_WIN32(ERROR_NOT_FOUND);
+}
+
+std::vector<WfdSessionInfo> CWFDHelper::GetSessions()
+{
+	return m_sessions.GetSessions();
+}
+
+WfdSessionCounters CWFDHelper::GetCounters()
+{
+	return m_sessions.GetCounters();
+}
+
+HRESULT CWFDHelper::Close()
+{
+	// Sessions first: closing the client handle with opens pending would lose their callbacks
+	m_sessions.CloseAll();
+	m_backend.Close();
+
+	return S_OK;
+}
@@ -1,25 +1,60 @@
-#pragma once
-class CWFDHelper
-{
-public:
-	CWFDHelper();
-	~CWFDHelper();
-
-	HRESULT Init();
-	HRESULT Connect(const wchar_t* deviceId);
-	HRESULT Close();
-
-protected:
-	static VOID WFD_OPEN_SESSION_COMPLETE_Handle (
-		_In_ HANDLE         hSessionHandle,
-		_In_ PVOID          pvContext,
-		_In_ GUID           guidSessionInterface,
-		_In_ DWORD          dwError,
-		_In_ DWORD          dwReasonCode
-		);
-
-private:
-	HANDLE m_clientHandle;
-	HANDLE m_sessionHandle;
-};
-
+#pragma once
+
+#include "WfdSessionManager.h"
+
+/// The Wi-Fi Direct API (wlanapi) behind IWfdSessionBackend
+class CWfdApiBackend : public IWfdSessionBackend
+{
+public:
+	CWfdApiBackend();
+	~CWfdApiBackend();
+
+	/// Open the client handle sessions are opened with
+	HRESULT Open();
+	/// Close the client handle; sessions must be closed first
+	void Close();
+
+	virtual uint32_t StartOpenSession(uint64_t address, OpenCompleted completed, SessionHandle* session) override;
+	virtual uint32_t CancelOpenSession(SessionHandle session) override;
+	virtual uint32_t CloseSession(SessionHandle session) override;
+
+protected:
+	static VOID WINAPI WFD_OPEN_SESSION_COMPLETE_Handle (
+		_In_ HANDLE         hSessionHandle,
+		_In_ PVOID          pvContext,
+		_In_ GUID           guidSessionInterface,
+		_In_ DWORD          dwError,
+		_In_ DWORD          dwReasonCode
+		);
+
+private:
+	HANDLE m_clientHandle;
+};
+
+/// Legacy sessions to any number of peers, opened without blocking the caller
+class CWFDHelper
+{
+public:
+	CWFDHelper();
+	~CWFDHelper();
+
+	HRESULT Init();
+	/// Start opening a session to the peer whose MAC address ends deviceId ("...#aa:bb:cc:dd:ee:ff");
+	/// opened, if set, gets how the open ended. HRESULT_FROM_WIN32(ERROR_ALREADY_EXISTS) if a
+	/// session to the peer is open or opening.
+	HRESULT Connect(const wchar_t* deviceId, WfdSessionManager::Opened opened = nullptr);
+	/// Close the session to a peer, or cancel its open
+	HRESULT Disconnect(const wchar_t* deviceId);
+	std::vector<WfdSessionInfo> GetSessions();
+	WfdSessionCounters GetCounters();
+	/// Close every session, wait for pending opens and close the client handle
+	HRESULT Close();
+
+	/// The MAC address at the end of a device ID, first octet in the high byte
+	static HRESULT ParseAddress(const wchar_t* deviceId, uint64_t& address);
+
+private:
+	CWfdApiBackend m_backend;
+	/// Declared after m_backend, which it calls until it is destroyed
+	WfdSessionManager m_sessions;
+};
@@ -0,0 +1,339 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/// The calls of the Wi-Fi Direct API the session table makes, so it can run against a stand-in.
+/// Error codes are Win32 error codes, 0 for success.
+class IWfdSessionBackend
+{
+public:
+	typedef void* SessionHandle;
+	typedef std::function<void(uint32_t error, uint32_t reason)> OpenCompleted;
+
+	virtual ~IWfdSessionBackend() {}
+
+	/// Begin opening a legacy session to a peer's MAC address (first octet in the high byte of the
+	/// low 48 bits). Unless this fails, completed is called exactly once, also after
+	/// CancelOpenSession, on a thread of the backend, possibly before this returns.
+	virtual uint32_t StartOpenSession(uint64_t address, OpenCompleted completed, SessionHandle* session) = 0;
+	virtual uint32_t CancelOpenSession(SessionHandle session) = 0;
+	/// Only for a session that opened; one that failed to open holds nothing
+	virtual uint32_t CloseSession(SessionHandle session) = 0;
+};
+
+enum class WfdSessionState
+{
+	Opening,
+	Open,
+	/// Close was called while opening; closed as soon as the open completes
+	Closing
+};
+
+struct WfdSessionInfo
+{
+	uint64_t address;
+	WfdSessionState state;
+	/// Since Open was called
+	std::chrono::milliseconds age;
+};
+
+struct WfdSessionCounters
+{
+	uint64_t opened;
+	uint64_t failed;
+	uint64_t closed;
+	/// Opens that were cancelled, or completed after their session was closed
+	uint64_t cancelled;
+};
+
+/// Legacy sessions to many peers at once, one per MAC address. Opens run asynchronously: Open
+/// returns once the backend has started, and the callback passed to it reports how the open ended.
+/// A session closed while still opening is cancelled and closed when its open completes, so no
+/// handle is left behind. Thread-safe; callbacks run without the lock held.
+class WfdSessionManager
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+	/// error is 0 once the session is open
+	typedef std::function<void(uint64_t address, uint32_t error, uint32_t reason)> Opened;
+
+	explicit WfdSessionManager(IWfdSessionBackend& backend)
+		: _backend(backend),
+		  _nextId(1),
+		  _settling(0)
+	{
+		_counters.opened = 0;
+		_counters.failed = 0;
+		_counters.closed = 0;
+		_counters.cancelled = 0;
+	}
+
+	~WfdSessionManager()
+	{
+		CloseAll();
+	}
+
+	/// False if a session to address is already open or opening. A backend that cannot start the
+	/// open reports it through opened before this returns.
+	bool Open(uint64_t address, Opened opened = nullptr)
+	{
+		uint64_t id;
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			if (_sessions.find(address) != _sessions.end())
+			{
+				return false;
+			}
+
+			id = _nextId++;
+			Session& session = _sessions[address];
+			session.id = id;
+			session.state = WfdSessionState::Opening;
+			session.handle = nullptr;
+			session.started = Clock::now();
+			session.completed = false;
+			session.error = 0;
+			session.reason = 0;
+			session.opened = std::move(opened);
+		}
+
+		IWfdSessionBackend::SessionHandle handle = nullptr;
+		uint32_t error = _backend.StartOpenSession(address, [this, address, id](uint32_t error, uint32_t reason)
+		{
+			OnOpenCompleted(address, id, error, reason);
+		}, &handle);
+
+		std::unique_lock<std::mutex> lock(_lock);
+		Session* session = Find(address, id);
+
+		if (error != 0)
+		{
+			Opened report = std::move(session->opened);
+			_sessions.erase(address);
+			_counters.failed++;
+			lock.unlock();
+			_changed.notify_all();
+
+			if (report)
+			{
+				report(address, error, 0);
+			}
+			return true;
+		}
+
+		session->handle = handle;
+		if (session->completed)
+		{
+			// The open completed before StartOpenSession returned
+			Finish(lock, address);
+		}
+		else if (session->state == WfdSessionState::Closing)
+		{
+			// Closed before the handle was known
+			lock.unlock();
+			_backend.CancelOpenSession(handle);
+		}
+		return true;
+	}
+
+	/// Close the session to address, or cancel its open; false if there is none
+	bool Close(uint64_t address)
+	{
+		std::unique_lock<std::mutex> lock(_lock);
+		auto it = _sessions.find(address);
+		if (it == _sessions.end() || it->second.state == WfdSessionState::Closing)
+		{
+			return false;
+		}
+
+		IWfdSessionBackend::SessionHandle handle = it->second.handle;
+		if (it->second.state == WfdSessionState::Open)
+		{
+			_sessions.erase(it);
+			_counters.closed++;
+			lock.unlock();
+			_changed.notify_all();
+
+			_backend.CloseSession(handle);
+			return true;
+		}
+
+		// Still opening: the completion closes it. Without a handle Open cancels it once it has one.
+		it->second.state = WfdSessionState::Closing;
+		lock.unlock();
+
+		if (handle != nullptr)
+		{
+			_backend.CancelOpenSession(handle);
+		}
+		return true;
+	}
+
+	/// Close every session and wait until every pending open has completed, so no callback can
+	/// arrive afterwards. Nothing may be opened meanwhile.
+	void CloseAll()
+	{
+		std::vector<uint64_t> addresses;
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			for (auto& entry : _sessions)
+			{
+				addresses.push_back(entry.first);
+			}
+		}
+
+		for (uint64_t address : addresses)
+		{
+			Close(address);
+		}
+
+		std::unique_lock<std::mutex> lock(_lock);
+		_changed.wait(lock, [this]() { return _sessions.empty() && _settling == 0; });
+	}
+
+	std::vector<WfdSessionInfo> GetSessions()
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		Clock::time_point now = Clock::now();
+
+		std::vector<WfdSessionInfo> sessions;
+		sessions.reserve(_sessions.size());
+		for (auto& entry : _sessions)
+		{
+			WfdSessionInfo info;
+			info.address = entry.first;
+			info.state = entry.second.state;
+			info.age = std::chrono::duration_cast<std::chrono::milliseconds>(now - entry.second.started);
+			sessions.push_back(info);
+		}
+		return sessions;
+	}
+
+	WfdSessionCounters GetCounters()
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		return _counters;
+	}
+
+private:
+	struct Session
+	{
+		/// Tells a completion for an earlier session to the same address from this one
+		uint64_t id;
+		WfdSessionState state;
+		IWfdSessionBackend::SessionHandle handle;
+		Clock::time_point started;
+		/// The open completed with error and reason; set before the handle is if the backend is quick
+		bool completed;
+		uint32_t error;
+		uint32_t reason;
+		Opened opened;
+	};
+
+	Session* Find(uint64_t address, uint64_t id)
+	{
+		auto it = _sessions.find(address);
+		return (it != _sessions.end() && it->second.id == id) ? &it->second : nullptr;
+	}
+
+	void OnOpenCompleted(uint64_t address, uint64_t id, uint32_t error, uint32_t reason)
+	{
+		std::unique_lock<std::mutex> lock(_lock);
+		Session* session = Find(address, id);
+		if (session == nullptr)
+		{
+			return;
+		}
+
+		session->completed = true;
+		session->error = error;
+		session->reason = reason;
+
+		// Open finishes it once StartOpenSession has returned the handle
+		if (session->handle != nullptr)
+		{
+			Finish(lock, address);
+		}
+	}
+
+	/// Settle a session whose open completed and whose handle is known; lock is released meanwhile
+	void Finish(std::unique_lock<std::mutex>& lock, uint64_t address)
+	{
+		auto it = _sessions.find(address);
+		Session& session = it->second;
+
+		uint32_t error = session.error;
+		uint32_t reason = session.reason;
+		IWfdSessionBackend::SessionHandle handle = session.handle;
+		Opened report;
+
+		bool close = false;
+		if (session.state == WfdSessionState::Closing)
+		{
+			// Nobody wants it any more; an open that made it anyway is closed right away
+			close = (error == 0);
+			_sessions.erase(it);
+			_counters.cancelled++;
+		}
+		else if (error == 0)
+		{
+			session.state = WfdSessionState::Open;
+			report = std::move(session.opened);
+			_counters.opened++;
+		}
+		else
+		{
+			report = std::move(session.opened);
+			_sessions.erase(it);
+			_counters.failed++;
+		}
+
+		// CloseAll waits for this too, the manager must outlive the calls below
+		_settling++;
+		lock.unlock();
+
+		if (close)
+		{
+			_backend.CloseSession(handle);
+		}
+
+		if (report)
+		{
+			report(address, error, reason);
+		}
+
+		lock.lock();
+		_settling--;
+		_changed.notify_all();
+	}
+
+	IWfdSessionBackend& _backend;
+
+	std::mutex _lock;
+	std::condition_variable _changed;
+	/// By MAC address
+	std::map<uint64_t, Session> _sessions;
+	uint64_t _nextId;
+	/// Completions between updating the table and returning
+	size_t _settling;
+	WfdSessionCounters _counters;
+};
@@ -0,0 +1,68 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include "TimerWheel.h"
+#include "WheelBenchmark.h"
+
+WheelBenchmarkResult RunWheelBenchmark(unsigned int timers)
+{
+	// Deadlines spread over 30000 ticks, the helper's longest default timeout at its tick length
+	const uint64_t spread = 30000;
+
+	std::mt19937 random(12345);
+	std::vector<uint64_t> expiries(timers);
+	for (auto& expiry : expiries)
+	{
+		expiry = 1 + random() % spread;
+	}
+
+	std::vector<uint64_t> handles(timers);
+	uint64_t fired = 0;
+	TimerWheel<uint64_t> wheel;
+
+	auto started = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < timers; i++)
+	{
+		handles[i] = wheel.Arm(expiries[i], i);
+	}
+	auto armTime = std::chrono::steady_clock::now() - started;
+
+	// Most operations finish before their deadline
+	started = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < timers; i += 2)
+	{
+		wheel.Cancel(handles[i]);
+	}
+	auto cancelTime = std::chrono::steady_clock::now() - started;
+
+	started = std::chrono::steady_clock::now();
+	wheel.Advance(spread, [&fired](uint64_t&)
+	{
+		fired++;
+	});
+	auto expireTime = std::chrono::steady_clock::now() - started;
+
+	auto perOperation = [](std::chrono::steady_clock::duration elapsed, uint64_t operations)
+	{
+		return operations != 0 ? std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / static_cast<double>(operations) : 0.0;
+	};
+
+	WheelBenchmarkResult result;
+	result.spread = spread;
+	result.cancelled = (timers + 1) / 2;
+	result.fired = fired;
+	result.cascaded = wheel.GetStats().cascaded;
+	result.armNanoseconds = perOperation(armTime, timers);
+	result.cancelNanoseconds = perOperation(cancelTime, result.cancelled);
+	result.expireNanoseconds = perOperation(expireTime, fired);
+	return result;
+}
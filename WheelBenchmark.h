@@ -0,0 +1,33 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+
+/// What arming, cancelling and expiring deadlines cost on a TimerWheel
+struct WheelBenchmarkResult
+{
+	/// Ticks the deadlines were spread over
+	uint64_t spread;
+	uint64_t cancelled;
+	uint64_t fired;
+	/// Timers moved down a level before they fired
+	uint64_t cascaded;
+	/// Nanoseconds per timer armed, cancelled and fired
+	double armNanoseconds;
+	double cancelNanoseconds;
+	double expireNanoseconds;
+};
+
+/// Arm timers deadlines spread over the helper's longest default timeout, cancel every other one
+/// as operations finishing early do, then advance the wheel past the last
+WheelBenchmarkResult RunWheelBenchmark(unsigned int timers);
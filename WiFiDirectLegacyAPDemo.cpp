@@ -1,36 +1,57 @@
-//*********************************************************
-//
-// Copyright (c) Microsoft. All rights reserved.
-// This code is licensed under the MIT License (MIT).
-// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
-// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
-// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
-// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
-//
-//*********************************************************
-
-#include "stdafx.h"
-#include "SimpleConsole.h"
-#include "WlanHostedNetworkWinRT.h"
-
-using namespace ABI::Windows::Foundation;
-using namespace Microsoft::WRL;
-using namespace Microsoft::WRL::Wrappers;
-
-int _tmain(int argc, _TCHAR* argv[])
-{
-    // Initialize the Windows Runtime.
-    RoInitializeWrapper initialize(RO_INIT_MULTITHREADED);
-    if (FAILED(initialize))
-    {
-        std::cout << "Failed to initialize Windows Runtime" << std::endl;
-        return static_cast<HRESULT>(initialize);
-    }
-
-    SimpleConsole console;
-
-    console.RunConsole();
-
-    return 0;
-}
-
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include "SimpleConsole.h"
+#include "WlanHostedNetworkWinRT.h"
+#include "EventLog.h"
+
+using namespace ABI::Windows::Foundation;
+using namespace Microsoft::WRL;
+using namespace Microsoft::WRL::Wrappers;
+
+int _tmain(int argc, _TCHAR* argv[])
+{
+    // Initialize the Windows Runtime.
+    RoInitializeWrapper initialize(RO_INIT_MULTITHREADED);
+    if (FAILED(initialize))
+    {
+        std::cout << "Failed to initialize Windows Runtime" << std::endl;
+        return static_cast<HRESULT>(initialize);
+    }
+
+    // -nocache starts without the persisted peer table, e.g. to compare time to first connection
+    bool usePeerCache = true;
+    for (int i = 1; i < argc; i++)
+    {
+        if (_tcsicmp(argv[i], _T("-nocache")) == 0)
+        {
+            usePeerCache = false;
+        }
+    }
+
+    // Diagnostics go to the debugger, formatted off the threads that log them
+    EventLog::Instance().Start([](LogLevel, const char* line, size_t)
+    {
+        OutputDebugStringA(line);
+    });
+
+    {
+        SimpleConsole console(usePeerCache);
+
+        console.RunConsole();
+    }
+
+    EventLog::Instance().Stop();
+
+    return 0;
+}
+
@@ -1,1053 +1,2912 @@
-//*********************************************************
-//
-// Copyright (c) Microsoft. All rights reserved.
-// This code is licensed under the MIT License (MIT).
-// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
-// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
-// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
-// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
-//
-//*********************************************************
-
-#include "stdafx.h"
-#include "WlanHostedNetworkWinRT.h"
-#include <vector>
-#include <string>
-
-using namespace ABI::Windows::Foundation;
-using namespace ABI::Windows::Foundation::Collections;
-using namespace ABI::Windows::Devices::Enumeration;
-using namespace ABI::Windows::Devices::WiFiDirect;
-using namespace ABI::Windows::Security::Credentials;
-using namespace ABI::Windows::Networking;
-using namespace Microsoft::WRL;
-using namespace Microsoft::WRL::Wrappers;
-
-
-typedef __FITypedEventHandler_2_Windows__CDevices__CWiFiDirect__CWiFiDirectConnectionListener_Windows__CDevices__CWiFiDirect__CWiFiDirectConnectionRequestedEventArgs ConnectionRequestedHandler;
-typedef __FITypedEventHandler_2_Windows__CDevices__CWiFiDirect__CWiFiDirectAdvertisementPublisher_Windows__CDevices__CWiFiDirect__CWiFiDirectAdvertisementPublisherStatusChangedEventArgs StatusChangedHandler;
-typedef __FITypedEventHandler_2_Windows__CDevices__CWiFiDirect__CWiFiDirectDevice_IInspectable ConnectionStatusChangedHandler;
-
-typedef __FIAsyncOperationCompletedHandler_1_Windows__CDevices__CWiFiDirect__CWiFiDirectDevice FromIdAsyncHandler;
-typedef __FIAsyncOperationCompletedHandler_1_Windows__CDevices__CEnumeration__CDeviceUnpairingResult UnpairAsyncHandler;
-typedef __FIAsyncOperationCompletedHandler_1_Windows__CDevices__CEnumeration__CDevicePairingResult PairAsyncHandler;
-
-typedef __FITypedEventHandler_2_Windows__CDevices__CEnumeration__CDeviceWatcher_Windows__CDevices__CEnumeration__CDeviceInformation DeviceAddHandler;
-typedef __FITypedEventHandler_2_Windows__CDevices__CEnumeration__CDeviceWatcher_Windows__CDevices__CEnumeration__CDeviceInformationUpdate DeviceRemovedHandler;
-typedef __FITypedEventHandler_2_Windows__CDevices__CEnumeration__CDeviceWatcher_IInspectable EnumerationNotifyHandler;
-typedef __FITypedEventHandler_2_Windows__CDevices__CEnumeration__CDeviceInformationCustomPairing_Windows__CDevices__CEnumeration__CDevicePairingRequestedEventArgs CustomPairHandler;
-
-typedef __FIVectorView_1_Windows__CNetworking__CEndpointPair EndpointPairCollection;
-
-WlanHostedNetworkHelper::WlanHostedNetworkHelper()
-    : _ssidProvided(false),
-      _passphraseProvided(false),
-      _listener(nullptr),
-      _autoAccept(true)
-{
-}
-
-WlanHostedNetworkHelper::~WlanHostedNetworkHelper()
-{
-    if (_publisher.Get() != nullptr)
-    {
-        _publisher->Stop();
-    }
-    Reset();
-}
-
-void WlanHostedNetworkHelper::Start()
-{
-    HRESULT hr = S_OK;
-
-    // Clean up old state
-    Reset();
-
-    // Create WiFiDirectAdvertisementPublisher
-    hr = Windows::Foundation::ActivateInstance(HStringReference(RuntimeClass_Windows_Devices_WiFiDirect_WiFiDirectAdvertisementPublisher).Get(), &_publisher);
-    if (FAILED(hr))
-    {
-        throw WlanHostedNetworkException("ActivateInstance for WiFiDirectAdvertisementPublisher failed", hr);
-    }
-
-    // Add event handler for advertisement StatusChanged
-    hr = _publisher->add_StatusChanged(
-        Callback<StatusChangedHandler>([this](IWiFiDirectAdvertisementPublisher* sender, IWiFiDirectAdvertisementPublisherStatusChangedEventArgs* args) -> HRESULT
-    {
-        HRESULT hr = S_OK;
-        WiFiDirectAdvertisementPublisherStatus status;
-        WiFiDirectError error;
-
-        try
-        {
-            hr = args->get_Status(&status);
-            if (FAILED(hr))
-            {
-                throw WlanHostedNetworkException("Get Status for AdvertisementPubliserStatusChangedEventArgs failed", hr);
-            }
-
-            switch (status)
-            {
-                case WiFiDirectAdvertisementPublisherStatus_Started:
-                {
-                    // Begin listening for connections and notify listener that the advertisement started
-                    StartListener();
-
-                    if (_listener != nullptr)
-                    {
-                        _listener->OnAdvertisementStarted();
-                    }
-                    break;
-                }
-                case WiFiDirectAdvertisementPublisherStatus_Aborted:
-                {
-                    // Check error and notify listener that the advertisement stopped
-                    hr = args->get_Error(&error);
-                    if (FAILED(hr))
-                    {
-                        throw WlanHostedNetworkException("Get Error for AdvertisementPubliserStatusChangedEventArgs failed", hr);
-                    }
-
-                    if (_listener != nullptr)
-                    {
-                        std::wstring message;
-
-                        switch (error)
-                        {
-                        case WiFiDirectError_RadioNotAvailable:
-                            message = L"Advertisement aborted, Wi-Fi radio is turned off";
-                            break;
-
-                        case WiFiDirectError_ResourceInUse:
-                            message = L"Advertisement aborted, Resource In Use";
-                            break;
-
-                        default:
-                            message = L"Advertisement aborted, unknown reason";
-                            break;
-                        }
-
-                        _listener->OnAdvertisementAborted(message);
-                    }
-                    break;
-                }
-                case WiFiDirectAdvertisementPublisherStatus_Stopped:
-                {
-                    // Notify listener that the advertisement is stopped
-                    if (_listener != nullptr)
-                    {
-                        _listener->OnAdvertisementStopped(L"Advertisement stopped");
-                    }
-                    break;
-                }
-            }
-        }
-        catch (WlanHostedNetworkException& e)
-        {
-            if (_listener != nullptr)
-            {
-                std::wostringstream ss;
-                ss << e.what() << ": " << e.GetErrorCode();
-                _listener->OnAsyncException(ss.str());
-            }
-            return e.GetErrorCode();
-        }
-
-        return hr;
-    }).Get(), &_statusChangedToken);
-
-    // Set Advertisement required settings
-
-    hr = _publisher->get_Advertisement(_advertisement.GetAddressOf());
-    if (FAILED(hr))
-    {
-        throw WlanHostedNetworkException("Get advertisement for WiFiDirectAdvertisementPublisher failed", hr);
-    }
-
-    // Must set the autonomous group owner (GO) enabled flag
-    // Legacy Wi-Fi Direct advertisement uses a Wi-Fi Direct GO to act as an access point to legacy settings
-    hr = _advertisement->put_IsAutonomousGroupOwnerEnabled(false);
-    if (FAILED(hr))
-    {
-        throw WlanHostedNetworkException("Set is autonomous group owner for WiFiDirectAdvertisement failed", hr);
-    }
-
-	hr = _advertisement->put_ListenStateDiscoverability(ABI::Windows::Devices::WiFiDirect::WiFiDirectAdvertisementListenStateDiscoverability_Normal);
-	if (FAILED(hr))
-	{
-		throw WlanHostedNetworkException("Set put_ListenStateDiscoverability failed", hr);
-	}
-
-    //hr = _advertisement->get_LegacySettings(_legacySettings.GetAddressOf());
-    //if (FAILED(hr))
-    //{
-    //    throw WlanHostedNetworkException("Get legacy settings for WiFiDirectAdvertisement failed", hr);
-    //}
-
-    // Must enable legacy settings so that non-Wi-Fi Direct peers can connect in legacy mode
-    //hr = _legacySettings->put_IsEnabled(true);
-    //if (FAILED(hr))
-    //{
-    //    throw WlanHostedNetworkException("Set is enabled for WiFiDirectLegacySettings failed", hr);
-    //}
-
-#if 0
-    HString hstrSSID;
-    HString hstrPassphrase;
-
-    // Either specify an SSID, or read the randomly generated one
-    if (_ssidProvided)
-    {
-        hr = hstrSSID.Set(_ssid.c_str());
-        if (FAILED(hr))
-        {
-            throw WlanHostedNetworkException("Failed to create HSTRING representation for SSID", hr);
-        }
-
-        hr = _legacySettings->put_Ssid(hstrSSID.Get());
-        if (FAILED(hr))
-        {
-            throw WlanHostedNetworkException("Set SSID for WiFiDirectLegacySettings failed", hr);
-        }
-    }
-    else
-    {
-        hr = _legacySettings->get_Ssid(hstrSSID.GetAddressOf());
-        if (FAILED(hr))
-        {
-            throw WlanHostedNetworkException("Get SSID for WiFiDirectLegacySettings failed", hr);
-        }
-
-        _ssid = hstrSSID.GetRawBuffer(nullptr);
-    }
-
-    // Either specify a passphrase, or read the randomly generated one
-    ComPtr<IPasswordCredential> passwordCredential;
-
-    hr = _legacySettings->get_Passphrase(passwordCredential.GetAddressOf());
-    if (FAILED(hr))
-    {
-        throw WlanHostedNetworkException("Get Passphrase for WiFiDirectLegacySettings failed", hr);
-    }
-
-    if (_passphraseProvided)
-    {
-        hr = hstrPassphrase.Set(_passphrase.c_str());
-        if (FAILED(hr))
-        {
-            throw WlanHostedNetworkException("Failed to create HSTRING representation for Passphrase", hr);
-        }
-
-        hr = passwordCredential->put_Password(hstrPassphrase.Get());
-        if (FAILED(hr))
-        {
-            throw WlanHostedNetworkException("Set Passphrase for WiFiDirectLegacySettings failed", hr);
-        }
-    }
-    else
-    {
-        hr = passwordCredential->get_Password(hstrPassphrase.GetAddressOf());
-        if (FAILED(hr))
-        {
-            throw WlanHostedNetworkException("Get Passphrase for WiFiDirectLegacySettings failed", hr);
-        }
-
-        _passphrase = hstrPassphrase.GetRawBuffer(nullptr);
-    }
-#endif
-
-    // Start the advertisement, which will create an access point that other peers can connect to
-    hr = _publisher->Start();
-    if (FAILED(hr))
-    {
-        throw WlanHostedNetworkException("Start WiFiDirectAdvertisementPublisher failed", hr);
-    }
-}
-
-void WlanHostedNetworkHelper::Stop()
-{
-    HRESULT hr = S_OK;
-
-    // Call stop on the publisher and expect the status changed callback
-    if (_publisher.Get() != nullptr)
-    {
-        hr = _publisher->Stop();
-        if (FAILED(hr))
-        {
-            throw WlanHostedNetworkException("Stop WiFiDirectAdvertisementPublisher failed", hr);
-        }
-    }
-    else
-    {
-        throw WlanHostedNetworkException("WiFiDirectAdvertisementPublisher is not running", hr);
-    }
-}
-
-void WlanHostedNetworkHelper::ConnectDevice(const wchar_t* szDeviceId)
-{
-	HString deviceId;
-	deviceId.Set(szDeviceId);
-
-	ConnectDeviceInternal(deviceId.Get());
-}
-
-void WlanHostedNetworkHelper::Disconnect(const wchar_t* szDeviceId)
-{
-	auto itDevice = _connectedDevices.find(szDeviceId);
-	auto itToken = _connectedDeviceStatusChangedTokens.find(szDeviceId);
-
-	if (itToken != _connectedDeviceStatusChangedTokens.end())
-	{
-		if (itDevice != _connectedDevices.end())
-		{
-			itDevice->second->remove_ConnectionStatusChanged(itToken->second);
-		}
-		_connectedDeviceStatusChangedTokens.erase(itToken);
-	}
-
-	if (itDevice != _connectedDevices.end())
-	{
-		ComPtr<IClosable> spInterface;
-		HRESULT hr = itDevice->second.As(&spInterface);
-		if (SUCCEEDED(hr))
-		{
-			spInterface->Close();
-		}
-
-		_connectedDevices.erase(itDevice);
-	}
-}
-
-void WlanHostedNetworkHelper::PairDeviceInternal(const wchar_t* szDeviceId, ABI::Windows::Devices::Enumeration::IDeviceInformation2* pDevInfo2)
-{
-	ComPtr<IDeviceInformationPairing> devInfoPair;
-	HRESULT hr = pDevInfo2->get_Pairing(&devInfoPair);
-	if (SUCCEEDED(hr))
-	{
-		boolean bCanPair = false;
-		boolean isPaired = false;
-		hr = devInfoPair->get_IsPaired(&isPaired);
-		hr = devInfoPair->get_CanPair(&bCanPair);
-		if (!isPaired)
-		{
-			ComPtr<IDeviceInformationPairing2> devInfoPair2;
-			hr = devInfoPair.As(&devInfoPair2);
-			if (SUCCEEDED(hr))
-			{
-				ComPtr<IDeviceInformationCustomPairing> spCustomPairing;
-
-				hr = devInfoPair2->get_Custom(spCustomPairing.GetAddressOf());
-				if (FAILED(hr))
-				{
-					throw WlanHostedNetworkException("Get IDeviceInformationCustomPairing failed", hr);
-				}
-
-				ComPtr<IWiFiDirectConnectionParameters> param;
-				hr = Windows::Foundation::ActivateInstance(HStringReference(RuntimeClass_Windows_Devices_WiFiDirect_WiFiDirectConnectionParameters).Get(), &param);
-				if (FAILED(hr))
-				{
-					throw WlanHostedNetworkException("ActivateInstance IWiFiDirectConnectionParameters failed", hr);
-				}
-
-				hr = param->put_GroupOwnerIntent(15);
-
-				DevicePairingKinds devicePairingKinds = DevicePairingKinds::DevicePairingKinds_ConfirmOnly |
-					DevicePairingKinds::DevicePairingKinds_DisplayPin/* |
-					DevicePairingKinds::DevicePairingKinds_ProvidePin*/;
-
-				ComPtr<IWiFiDirectConnectionParameters2> spConParam2;
-				hr = param.As(&spConParam2);
-				if (FAILED(hr))
-				{
-					throw WlanHostedNetworkException("Get IDevicePairingSettings failed", hr);
-				}
-
-				WiFiDirectPairingProcedure proc = WiFiDirectPairingProcedure::WiFiDirectPairingProcedure_GroupOwnerNegotiation;
-				spConParam2->put_PreferredPairingProcedure(proc);
-
-				ComPtr<IDevicePairingSettings> spSetting;
-				hr = param.As(&spSetting);
-				if (FAILED(hr))
-				{
-					throw WlanHostedNetworkException("Get IDevicePairingSettings failed", hr);
-				}
-
-				spCustomPairing->add_PairingRequested(Callback<CustomPairHandler>([this](IDeviceInformationCustomPairing* pCustomPairing, IDevicePairingRequestedEventArgs* pArgs) -> HRESULT
-					{
-						OutputDebugString(L"pair requested.\n");
-
-						HString pin;
-						ABI::Windows::Devices::Enumeration::DevicePairingKinds kinds;
-						pArgs->get_PairingKind(&kinds);
-						if (kinds == ABI::Windows::Devices::Enumeration::DevicePairingKinds::DevicePairingKinds_DisplayPin)
-						{
-							pArgs->get_Pin(pin.GetAddressOf());
-						}
-
-						if (_PairRequest)
-						{
-							std::wstring strPin = pin.GetRawBuffer(NULL);
-
-							bool bAllowed = _PairRequest->PairRequest(kinds, strPin);
-							if (bAllowed)
-							{
-								if (kinds & ABI::Windows::Devices::Enumeration::DevicePairingKinds::DevicePairingKinds_ConfirmOnly |
-									kinds & ABI::Windows::Devices::Enumeration::DevicePairingKinds::DevicePairingKinds_DisplayPin)
-								{
-									pArgs->Accept();
-								}
-								else if (kinds & ABI::Windows::Devices::Enumeration::DevicePairingKinds::DevicePairingKinds_ProvidePin)
-								{
-									pin.Set(strPin.c_str());
-									pArgs->AcceptWithPin(pin.Get());
-								}
-							}
-						}
-
-						return S_OK;
-					}).Get(), &_DevicePairToken);
-
-				ComPtr<IAsyncOperation<ABI::Windows::Devices::Enumeration::DevicePairingResult*>> asyncAction;
-				hr = spCustomPairing->PairWithProtectionLevelAndSettingsAsync(devicePairingKinds, DevicePairingProtectionLevel::DevicePairingProtectionLevel_Default,
-					spSetting.Get(), &asyncAction);
-				if (SUCCEEDED(hr))
-				{
-					IDeviceInformation2* pDevInfo = pDevInfo2;
-					asyncAction->put_Completed(Callback<PairAsyncHandler>([this, pDevInfo](IAsyncOperation<DevicePairingResult*>* pHandler, AsyncStatus status) -> HRESULT
-						{
-							if (status == AsyncStatus::Completed)
-							{
-								HString id;
-								ABI::Windows::Devices::Enumeration::DevicePairingResultStatus pairStatus;
-								ComPtr<IDevicePairingResult> spResult;
-								ComPtr<IDeviceInformation> devInfoInfo;
-
-								HRESULT hr = pHandler->GetResults(spResult.GetAddressOf());
-								if (SUCCEEDED(hr))
-								{
-									hr = spResult->get_Status(&pairStatus);
-								}
-
-								pDevInfo->QueryInterface(IID_PPV_ARGS(devInfoInfo.GetAddressOf()));
-								if (devInfoInfo)
-								{
-									devInfoInfo->get_Id(id.GetAddressOf());
-								}
-
-								if (pairStatus == ABI::Windows::Devices::Enumeration::DevicePairingResultStatus::DevicePairingResultStatus_Paired)
-								{
-									if (_listener != nullptr)
-										_listener->OnDevicePaired(id.GetRawBuffer(NULL));
-								}
-								else
-								{
-									if (_listener != nullptr) _listener->OnDevicePairedError(id.GetRawBuffer(NULL), pairStatus);
-								}
-							}
-							else
-							{
-								if (_listener != nullptr)
-								{
-									switch (status)
-									{
-									case AsyncStatus::Started:
-										_listener->LogMessage(L"Device pair, status=Started");
-										break;
-									case AsyncStatus::Canceled:
-										_listener->LogMessage(L"Device pair, status=Canceled");
-										break;
-									case AsyncStatus::Error:
-										_listener->LogMessage(L"Device pair, status=Error");
-										break;
-									}
-								}
-							}
-
-							return S_OK;
-						}).Get());
-				}
-			}
-
-		}
-	}
-}
-
-void WlanHostedNetworkHelper::Pair(const wchar_t* szDeviceId)
-{
-	auto itDeviceInfo = _discoverDevices.find(szDeviceId);
-
-	if (itDeviceInfo != _discoverDevices.end())
-	{
-		this->PairDeviceInternal(szDeviceId, itDeviceInfo->second.Get());
-	}
-}
-
-void WlanHostedNetworkHelper::Unpair(const wchar_t* szDeviceId)
-{
-	auto itDevice = _connectedDevices.find(szDeviceId);
-	auto itToken = _connectedDeviceStatusChangedTokens.find(szDeviceId);
-
-	if (itToken != _connectedDeviceStatusChangedTokens.end())
-	{
-		if (itDevice != _connectedDevices.end())
-		{
-			itDevice->second->remove_ConnectionStatusChanged(itToken->second);
-		}
-		_connectedDeviceStatusChangedTokens.erase(itToken);
-	}
-
-	if (itDevice != _connectedDevices.end())
-	{
-		//ComPtr<IClosable> spInterface;
-		//HRESULT hr = itDevice->second.As(&spInterface);
-		//if (SUCCEEDED(hr))
-		//{
-		//	spInterface->Close();
-		//}
-
-		_connectedDevices.erase(itDevice);
-	}
-
-	auto itDeviceInfo = _discoverDevices.find(szDeviceId);
-
-	if (itDeviceInfo != _discoverDevices.end())
-	{
-		ComPtr<IDeviceInformationPairing> devInfoPair;
-		HRESULT hr = itDeviceInfo->second->get_Pairing(&devInfoPair);
-		if (SUCCEEDED(hr))
-		{
-			ComPtr<IDeviceInformationPairing2> devInfoPair2;
-			devInfoPair.As(&devInfoPair2);
-			if (devInfoPair2)
-			{
-				ComPtr<IAsyncOperation<DeviceUnpairingResult*>> asyncUnpairAction;
-
-				hr = devInfoPair2->UnpairAsync(&asyncUnpairAction);
-				if (SUCCEEDED(hr))
-				{
-					HString devId;
-					devId.Set(szDeviceId);
-					HSTRING* id = devId.GetAddressOf();
-
-					asyncUnpairAction->put_Completed(Callback<UnpairAsyncHandler>([this](IAsyncOperation<DeviceUnpairingResult*>* pHandler, AsyncStatus status) -> HRESULT
-					{
-						if (status == AsyncStatus::Completed)
-						{
-							if (_listener != nullptr)
-								_listener->OnDeviceUnpaired(L"Device Unpair successfully");
-						}
-						else
-						{
-							if (_listener != nullptr)
-							{
-								switch (status)
-								{
-								case AsyncStatus::Started:
-									_listener->LogMessage(L"Device Unpair, status=Started");
-									break;
-								case AsyncStatus::Canceled:
-									_listener->LogMessage(L"Device Unpair, status=Canceled");
-									break;
-								case AsyncStatus::Error:
-									_listener->LogMessage(L"Device Unpair, status=Error");
-									break;
-								}
-							}
-						}
-
-						return S_OK;
-					}).Get());
-				}
-			}
-		}
-	}
-}
-
-void WlanHostedNetworkHelper::ConnectDeviceInternal(HSTRING targetDeviceId)
-{
-	HRESULT hr = S_OK;
-	ComPtr<IWiFiDirectDeviceStatics2> wfdStatics;
-
-	hr = GetActivationFactory(HStringReference(RuntimeClass_Windows_Devices_WiFiDirect_WiFiDirectDevice).Get(), &wfdStatics);
-	if (FAILED(hr))
-	{
-		throw WlanHostedNetworkException("GetActivationFactory for WiFiDirectDevice failed", hr);
-	}
-
-	HString devId;
-	devId.Set(targetDeviceId);
-
-	auto itDeviceInfo = _discoverDevices.find(devId.GetRawBuffer(NULL));
-
-	if (itDeviceInfo != _discoverDevices.end())
-	{
-		ComPtr<IDeviceInformationPairing> devInfoPair;
-		hr = itDeviceInfo->second->get_Pairing(&devInfoPair);
-		if (SUCCEEDED(hr))
-		{
-			boolean bCanPair = false;
-			boolean isPaired = false;
-			hr = devInfoPair->get_IsPaired(&isPaired);
-			hr = devInfoPair->get_CanPair(&bCanPair);
-			if (isPaired)
-			{
-				return;
-			}			
-		}
-	}
-
-	ComPtr<IWiFiDirectConnectionParameters> param;
-	hr = Windows::Foundation::ActivateInstance(HStringReference(RuntimeClass_Windows_Devices_WiFiDirect_WiFiDirectConnectionParameters).Get(), &param);
-	if (FAILED(hr))
-	{
-		throw WlanHostedNetworkException("ActivateInstance IWiFiDirectConnectionParameters failed", hr);
-	}
-
-	hr = param->put_GroupOwnerIntent(15);
-
-	//ComPtr<IWiFiDirectConnectionParameters2> spConParam2;
-	//hr = param.As(&spConParam2);
-	//if (FAILED(hr))
-	//{
-	//	throw WlanHostedNetworkException("Get IDevicePairingSettings failed", hr);
-	//}
-
-	//WiFiDirectPairingProcedure proc = WiFiDirectPairingProcedure::WiFiDirectPairingProcedure_GroupOwnerNegotiation;
-	//spConParam2->put_PreferredPairingProcedure(proc);
-
-	ComPtr<IAsyncOperation<WiFiDirectDevice*>> asyncAction;
-	hr = wfdStatics->FromIdAsync(targetDeviceId, param.Get(), &asyncAction);
-	if (FAILED(hr))
-	{
-		throw WlanHostedNetworkException("From ID Async for WiFiDirectDevice failed", hr);
-	}
-
-	hr = asyncAction->put_Completed(Callback<FromIdAsyncHandler>([this](IAsyncOperation<WiFiDirectDevice*>* pHandler, AsyncStatus status) -> HRESULT
-	{
-		HRESULT hr = S_OK;
-		ComPtr<IWiFiDirectDevice> wfdDevice;
-		ComPtr<EndpointPairCollection> endpointPairs;
-		ComPtr<IEndpointPair> endpointPair;
-		ComPtr<IHostName> remoteHostName;
-		HString remoteHostNameDisplay;
-		HString deviceId;
-
-		try
-		{
-			if (status == AsyncStatus::Completed)
-			{
-				// Get the WiFiDirectDevice object
-				hr = pHandler->GetResults(wfdDevice.GetAddressOf());
-				if (FAILED(hr))
-				{
-					throw WlanHostedNetworkException("Put Completed for FromIDAsync operation failed", hr);
-				}
-
-				// Now retrieve the endpoint pairs, which includes the IP address assigned to the peer
-				hr = wfdDevice->GetConnectionEndpointPairs(endpointPairs.GetAddressOf());
-				if (FAILED(hr))
-				{
-					throw WlanHostedNetworkException("Get EndpointPairs for WiFiDirectDevice failed", hr);
-				}
-
-				hr = endpointPairs->GetAt(0, endpointPair.GetAddressOf());
-				if (FAILED(hr))
-				{
-					throw WlanHostedNetworkException("Get first EndpointPair in collection failed", hr);
-				}
-
-				hr = endpointPair->get_RemoteHostName(remoteHostName.GetAddressOf());
-				if (FAILED(hr))
-				{
-					throw WlanHostedNetworkException("Get Remote HostName for EndpointPair failed", hr);
-				}
-
-				hr = remoteHostName->get_DisplayName(remoteHostNameDisplay.GetAddressOf());
-				if (FAILED(hr))
-				{
-					throw WlanHostedNetworkException("Get Display Name for Remote HostName failed", hr);
-				}
-
-				// Add handler for connection status changed
-				EventRegistrationToken statusChangedToken;
-				hr = wfdDevice->add_ConnectionStatusChanged(Callback<ConnectionStatusChangedHandler>([this](IWiFiDirectDevice* sender, IInspectable*) -> HRESULT
-				{
-					WiFiDirectConnectionStatus status;
-					HString deviceId;
-					HRESULT hr = S_OK;
-
-					try
-					{
-						hr = sender->get_ConnectionStatus(&status);
-						if (FAILED(hr))
-						{
-							throw WlanHostedNetworkException("Get connection status for peer failed", hr);
-						}
-
-						switch (status)
-						{
-						case WiFiDirectConnectionStatus_Connected:
-							// NO-OP
-							break;
-						case WiFiDirectConnectionStatus_Disconnected:
-							// Clean-up state
-							hr = sender->get_DeviceId(deviceId.GetAddressOf());
-							if (FAILED(hr))
-							{
-								throw WlanHostedNetworkException("Get Device ID failed", hr);
-							}
-
-							auto itDevice = _connectedDevices.find(deviceId.GetRawBuffer(nullptr));
-							auto itToken = _connectedDeviceStatusChangedTokens.find(deviceId.GetRawBuffer(nullptr));
-
-							if (itToken != _connectedDeviceStatusChangedTokens.end())
-							{
-								if (itDevice != _connectedDevices.end())
-								{
-									itDevice->second->remove_ConnectionStatusChanged(itToken->second);
-								}
-								_connectedDeviceStatusChangedTokens.erase(itToken);
-							}
-
-							if (itDevice != _connectedDevices.end())
-							{
-								_connectedDevices.erase(itDevice);
-							}
-
-							// Notify listener of disconnect
-							if (_listener != nullptr)
-							{
-								_listener->OnDeviceDisconnected(deviceId.GetRawBuffer(nullptr));
-							}
-
-							break;
-						}
-					}
-					catch (WlanHostedNetworkException& e)
-					{
-						if (_listener != nullptr)
-						{
-							std::wostringstream ss;
-							ss << e.what() << ": " << e.GetErrorCode();
-							_listener->OnAsyncException(ss.str());
-						}
-						return e.GetErrorCode();
-					}
-
-					return hr;
-				}).Get(), &statusChangedToken);
-
-				// Store the connected peer
-				hr = wfdDevice->get_DeviceId(deviceId.GetAddressOf());
-				if (FAILED(hr))
-				{
-					throw WlanHostedNetworkException("Get Device ID failed", hr);
-				}
-
-				_connectedDevices.insert(std::make_pair(deviceId.GetRawBuffer(nullptr), wfdDevice));
-				_connectedDeviceStatusChangedTokens.insert(std::make_pair(deviceId.GetRawBuffer(nullptr), statusChangedToken));
-
-				// Notify Listener
-				if (_listener != nullptr)
-				{
-					_listener->OnDeviceConnected(remoteHostNameDisplay.GetRawBuffer(nullptr));
-				}
-			}
-			else
-			{
-				if (_listener != nullptr)
-				{
-					switch (status)
-					{
-					case AsyncStatus::Started:
-						_listener->LogMessage(L"Device connected, status=Started");
-						break;
-					case AsyncStatus::Canceled:
-						_listener->LogMessage(L"Device connected, status=Canceled");
-						break;
-					case AsyncStatus::Error:
-						_listener->LogMessage(L"Device connected, status=Error");
-						break;
-					}
-				}
-			}
-		}
-		catch (WlanHostedNetworkException& e)
-		{
-			if (_listener != nullptr)
-			{
-				std::wostringstream ss;
-				ss << e.what() << ": " << e.GetErrorCode();
-				_listener->OnAsyncException(ss.str());
-			}
-			return e.GetErrorCode();
-		}
-
-		return hr;
-	}).Get());
-	if (FAILED(hr))
-	{
-		throw WlanHostedNetworkException("Put Completed for FromIDAsync operation failed", hr);
-	}
-}
-
-void WlanHostedNetworkHelper::StartListener()
-{
-    HRESULT hr = S_OK;
-
-    // Create WiFiDirectConnectionListener
-    hr = Windows::Foundation::ActivateInstance(HStringReference(RuntimeClass_Windows_Devices_WiFiDirect_WiFiDirectConnectionListener).Get(), &_connectionListener);
-    if (FAILED(hr))
-    {
-        throw WlanHostedNetworkException("ActivateInstance for WiFiDirectConnectionListener failed", hr);
-    }
-
-    hr = _connectionListener->add_ConnectionRequested(
-        Callback<ConnectionRequestedHandler>([this](IWiFiDirectConnectionListener* sender, IWiFiDirectConnectionRequestedEventArgs* args) -> HRESULT
-    {
-        HRESULT hr = S_OK;
-        ComPtr<IWiFiDirectConnectionRequest> request;
-
-        if (_listener != nullptr)
-        {
-            _listener->LogMessage(L"Connection Requested...");
-        }
-
-        bool acceptConnection = true;
-        if (!_autoAccept && _prompt != nullptr)
-        {
-            acceptConnection = _prompt->AcceptIncommingConnection();
-        }
-
-        try
-        {
-            hr = args->GetConnectionRequest(request.GetAddressOf());
-            if (FAILED(hr))
-            {
-                throw WlanHostedNetworkException("Get connection request for ConnectionRequestedEventArgs failed", hr);
-            }
-            
-            if (acceptConnection)
-            {
-				HString deviceId;
-				ComPtr<IDeviceInformation> deviceInformation;
-
-                hr = request->get_DeviceInformation(deviceInformation.GetAddressOf());
-                if (FAILED(hr))
-                {
-                    throw WlanHostedNetworkException("Get device information for ConnectionRequest failed", hr);
-                }
-
-				hr = deviceInformation->get_Id(deviceId.GetAddressOf());
-				if (FAILED(hr))
-				{
-					throw WlanHostedNetworkException("Get ID for DeviceInformation failed", hr);
-				}
-
-#if 0 
-				this->ConnectDeviceInternal(deviceId.Get());
-#else
-				ComPtr<IDeviceInformation2> info2;
-				HRESULT hr = deviceInformation->QueryInterface(IID_PPV_ARGS(&info2));
-				if (FAILED(hr))
-				{
-					throw WlanHostedNetworkException("Get DeviceInformation2 failed", hr);
-				}
-
-				this->PairDeviceInternal(deviceId.GetRawBuffer(NULL), info2.Get());
-#endif
-            }
-            else
-            {
-                if (_listener != nullptr)
-                {
-                    _listener->LogMessage(L"Declined");
-                }
-            }
-        }
-        catch (WlanHostedNetworkException& e)
-        {
-            if (_listener != nullptr)
-            {
-                std::wostringstream ss;
-                ss << e.what() << ": " << e.GetErrorCode();
-                _listener->OnAsyncException(ss.str());
-            }
-            return e.GetErrorCode();
-        }
-
-        return hr;
-    }).Get(), &_connectionRequestedToken);
-    if (FAILED(hr))
-    {
-        throw WlanHostedNetworkException("Add ConnectionRequested handler for WiFiDirectConnectionListener failed", hr);
-    }
-
-    if (_listener != nullptr)
-    {
-        _listener->LogMessage(L"Connection Listener is ready");
-    }
-}
-
-void WlanHostedNetworkHelper::Reset()
-{
-	if (_deviceWatcher)
-	{
-		_deviceWatcher->remove_Added(_DeviceAddToken);
-		_deviceWatcher->remove_Removed(_DeviceRemoveToken);
-		_deviceWatcher->remove_Updated(_DeviceUpdatedToken);
-		_deviceWatcher->remove_Stopped(_EnumerationStopToken);
-		_deviceWatcher->remove_EnumerationCompleted(_EnumerationCompletedToken);
-	}
-
-    if (_connectionListener.Get() != nullptr)
-    {
-        _connectionListener->remove_ConnectionRequested(_connectionRequestedToken);
-    }
-
-    if (_publisher.Get() != nullptr)
-    {
-        _publisher->remove_StatusChanged(_statusChangedToken);
-    }
-
-	_deviceWatcher.Reset();
-    _legacySettings.Reset();
-    _advertisement.Reset();
-    _publisher.Reset();
-    _connectionListener.Reset();
-
-    _connectedDevices.clear();
-	_discoverDevices.clear();
-}
-
-void WlanHostedNetworkHelper::Scan()
-{
-	try
-	{
-		HRESULT hr = S_OK;
-		if (_deviceWatcher.Get() == nullptr)
-		{
-			ComPtr<IDeviceInformationStatics> deviceInfoStatics;
-			ComPtr<IWiFiDirectDeviceStatics2> wfdStatics;
-			HString deviceSelector;
-
-			//std::vector<HSTRING*> requestedProperties;
-			//std::wstring str(L"System.Devices.WiFiDirect.InformationElements");
-			//HString strIE;
-			//strIE.Set(str.c_str());
-
-			//requestedProperties.push_back(strIE.GetAddressOf());
-
-			hr = Windows::Foundation::GetActivationFactory(HStringReference(RuntimeClass_Windows_Devices_WiFiDirect_WiFiDirectDevice).Get(), &wfdStatics);
-			if (FAILED(hr))
-			{
-				throw WlanHostedNetworkException("GetActivationFactory for IWiFiDirectDeviceStatics2 failed", hr);
-			}
-
-			hr = wfdStatics->GetDeviceSelector(ABI::Windows::Devices::WiFiDirect::WiFiDirectDeviceSelectorType::WiFiDirectDeviceSelectorType_AssociationEndpoint, deviceSelector.GetAddressOf());
-			if (FAILED(hr))
-			{
-				throw WlanHostedNetworkException("GetDeviceSelector for WiFiDirectDevice failed", hr);
-			}
-
-			hr = GetActivationFactory(HStringReference(RuntimeClass_Windows_Devices_Enumeration_DeviceInformation).Get(), &deviceInfoStatics);
-			if (FAILED(hr))
-			{
-				throw WlanHostedNetworkException("GetActivationFactory for IDeviceInformation failed", hr);
-			}
-
-			hr = deviceInfoStatics->CreateWatcherAqsFilter(deviceSelector.Get(), &_deviceWatcher);
-			if (FAILED(hr))
-			{
-				throw WlanHostedNetworkException("CreateWatcherAqsFilterAndAdditionalProperties failed", hr);
-			}
-
-			_deviceWatcher->add_Added(Callback<DeviceAddHandler>([this](IDeviceWatcher* sender, IDeviceInformation* deviceInfo) -> HRESULT
-			{
-				//Add device
-				HString id;
-				HString name;
-
-				deviceInfo->get_Id(id.GetAddressOf());
-				deviceInfo->get_Name(name.GetAddressOf());
-
-				ComPtr<IDeviceInformation2> info;
-				HRESULT hr = deviceInfo->QueryInterface(IID_PPV_ARGS(&info));
-				if (SUCCEEDED(hr))
-				{
-					_discoverDevices.insert(std::make_pair(id.GetRawBuffer(NULL), info));
-				}
-				else
-				{
-					OutputDebugStringA("Can't get IDeviceInformation2.\n");
-				}
-
-				_listener->OnDeviceAdded(id.GetRawBuffer(NULL), name.GetRawBuffer(NULL));
-
-				return S_OK;
-			}).Get(), &_DeviceAddToken);
-
-			_deviceWatcher->add_Removed(Callback<DeviceRemovedHandler>([this](IDeviceWatcher* sender, IDeviceInformationUpdate* deviceInfoUpdate) -> HRESULT
-			{
-				//remove device
-				HString id;
-				deviceInfoUpdate->get_Id(id.GetAddressOf());
-
-				auto it = _discoverDevices.find(id.GetRawBuffer(NULL));
-				if (it != _discoverDevices.end())
-				{
-					_discoverDevices.erase(it);
-				}
-
-				_listener->OnDeviceRemoved(id.GetRawBuffer(NULL));
-
-				return S_OK;
-			}).Get(), &_DeviceRemoveToken);
-
-			_deviceWatcher->add_Updated(Callback<DeviceRemovedHandler>([this](IDeviceWatcher* sender, IDeviceInformationUpdate* deviceInfoUpdate) -> HRESULT
-			{
-				//Update device
-				OutputDebugStringA("device updated.\n");
-
-				return S_OK;
-			}).Get(), &_DeviceUpdatedToken);
-
-			_deviceWatcher->add_Stopped(Callback<EnumerationNotifyHandler>([this](IDeviceWatcher* sender, IInspectable* object) -> HRESULT
-			{
-				//Enumeration stop
-				OutputDebugStringA("Enumeration stopped.\n");
-
-				_listener->OnEnumerationStopped(L"");
-
-				return S_OK;
-			}).Get(), &_EnumerationStopToken);
-
-			_deviceWatcher->add_EnumerationCompleted(Callback<EnumerationNotifyHandler>([this](IDeviceWatcher* sender, IInspectable* object) -> HRESULT
-			{
-				//Enumeration completed
-				OutputDebugStringA("Enumeration Completed.\n");
-
-				_listener->OnEnumerationCompleted(L"");
-
-				return _deviceWatcher->Stop();
-			}).Get(), &_EnumerationCompletedToken);
-		}
-
-		_discoverDevices.clear();
-
-		hr = _deviceWatcher->Start();
-		if (FAILED(hr))
-		{
-			throw WlanHostedNetworkException("device watcher start failed", hr);
-		}
-	}
-	catch (WlanHostedNetworkException& e)
-	{
-		if (_listener != nullptr)
-		{
-			std::wostringstream ss;
-			ss << e.what() << ": " << e.GetErrorCode();
-			_listener->OnAsyncException(ss.str());
-		}
-	}
-}
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+#include "WlanHostedNetworkWinRT.h"
+#include "InformationElements.h"
+#include "EventLog.h"
+#include <vector>
+#include <string>
+
+using namespace ABI::Windows::Foundation;
+using namespace ABI::Windows::Foundation::Collections;
+using namespace ABI::Windows::Devices::Enumeration;
+using namespace ABI::Windows::Devices::WiFiDirect;
+using namespace ABI::Windows::Security::Credentials;
+using namespace ABI::Windows::Networking;
+using namespace Microsoft::WRL;
+using namespace Microsoft::WRL::Wrappers;
+
+
+typedef __FITypedEventHandler_2_Windows__CDevices__CWiFiDirect__CWiFiDirectConnectionListener_Windows__CDevices__CWiFiDirect__CWiFiDirectConnectionRequestedEventArgs ConnectionRequestedHandler;
+typedef __FITypedEventHandler_2_Windows__CDevices__CWiFiDirect__CWiFiDirectAdvertisementPublisher_Windows__CDevices__CWiFiDirect__CWiFiDirectAdvertisementPublisherStatusChangedEventArgs StatusChangedHandler;
+typedef __FITypedEventHandler_2_Windows__CDevices__CWiFiDirect__CWiFiDirectDevice_IInspectable ConnectionStatusChangedHandler;
+
+typedef __FITypedEventHandler_2_Windows__CDevices__CEnumeration__CDeviceWatcher_Windows__CDevices__CEnumeration__CDeviceInformation DeviceAddHandler;
+typedef __FITypedEventHandler_2_Windows__CDevices__CEnumeration__CDeviceWatcher_Windows__CDevices__CEnumeration__CDeviceInformationUpdate DeviceRemovedHandler;
+typedef __FITypedEventHandler_2_Windows__CDevices__CEnumeration__CDeviceWatcher_IInspectable EnumerationNotifyHandler;
+typedef __FITypedEventHandler_2_Windows__CDevices__CEnumeration__CDeviceInformationCustomPairing_Windows__CDevices__CEnumeration__CDevicePairingRequestedEventArgs CustomPairHandler;
+
+typedef __FIVectorView_1_Windows__CNetworking__CEndpointPair EndpointPairCollection;
+
+/// Connection parameters used for every connect and pair
+static const INT16 DefaultGroupOwnerIntent = 15;
+static const WiFiDirectPairingProcedure DefaultPairingProcedure = WiFiDirectPairingProcedure_GroupOwnerNegotiation;
+
+/// Resolution of operation deadlines; timeouts are seconds long, so a late tick costs little
+static const DWORD DeadlineTickMs = 50;
+
+/// Raw information elements of a peer, requested from the device watcher as an additional property
+static const wchar_t InformationElementsProperty[] = L"System.Devices.WiFiDirect.InformationElements";
+
+class HStringIterator;
+
+/// Fixed list of strings handed to WinRT APIs that take an IIterable<String>, e.g. requested properties
+class HStringIterable : public RuntimeClass<IIterable<HSTRING>>
+{
+	InspectableClass(L"Windows.Foundation.Collections.IIterable`1<String>", BaseTrust)
+
+public:
+	HStringIterable(const wchar_t* const* strings, size_t count)
+		: _strings(strings, strings + count)
+	{}
+
+	IFACEMETHODIMP First(IIterator<HSTRING>** first) override;
+
+	const std::vector<std::wstring>& GetStrings() const
+	{
+		return _strings;
+	}
+
+private:
+	std::vector<std::wstring> _strings;
+};
+
+class HStringIterator : public RuntimeClass<IIterator<HSTRING>>
+{
+	InspectableClass(L"Windows.Foundation.Collections.IIterator`1<String>", BaseTrust)
+
+public:
+	HStringIterator(HStringIterable* iterable)
+		: _iterable(iterable),
+		  _index(0)
+	{}
+
+	IFACEMETHODIMP get_Current(HSTRING* current) override
+	{
+		const std::vector<std::wstring>& strings = _iterable->GetStrings();
+		if (_index >= strings.size())
+		{
+			*current = nullptr;
+			return E_BOUNDS;
+		}
+		return WindowsCreateString(strings[_index].c_str(), static_cast<UINT32>(strings[_index].length()), current);
+	}
+
+	IFACEMETHODIMP get_HasCurrent(boolean* hasCurrent) override
+	{
+		*hasCurrent = (_index < _iterable->GetStrings().size());
+		return S_OK;
+	}
+
+	IFACEMETHODIMP MoveNext(boolean* hasCurrent) override
+	{
+		if (_index < _iterable->GetStrings().size())
+		{
+			_index++;
+		}
+		return get_HasCurrent(hasCurrent);
+	}
+
+	IFACEMETHODIMP GetMany(unsigned capacity, HSTRING* value, unsigned* actual) override
+	{
+		const std::vector<std::wstring>& strings = _iterable->GetStrings();
+		*actual = 0;
+		while (*actual < capacity && _index < strings.size())
+		{
+			HRESULT hr = WindowsCreateString(strings[_index].c_str(), static_cast<UINT32>(strings[_index].length()), &value[*actual]);
+			if (FAILED(hr))
+			{
+				for (unsigned i = 0; i < *actual; i++)
+				{
+					WindowsDeleteString(value[i]);
+				}
+				*actual = 0;
+				return hr;
+			}
+			(*actual)++;
+			_index++;
+		}
+		return S_OK;
+	}
+
+private:
+	ComPtr<HStringIterable> _iterable;
+	size_t _index;
+};
+
+IFACEMETHODIMP HStringIterable::First(IIterator<HSTRING>** first)
+{
+	ComPtr<HStringIterator> iterator = Make<HStringIterator>(this);
+	if (!iterator)
+	{
+		*first = nullptr;
+		return E_OUTOFMEMORY;
+	}
+
+	*first = iterator.Detach();
+	return S_OK;
+}
+
+void ListenerAdapter::OnEvent(const ListenerEventView& event)
+{
+	switch (event.kind)
+	{
+	case ListenerEventKind::DeviceConnected:
+		_listener->OnDeviceConnected(event.CopyText());
+		break;
+	case ListenerEventKind::DevicesConnected:
+		_listener->OnDevicesConnected(*event.batch);
+		break;
+	case ListenerEventKind::DeviceDisconnected:
+		_listener->OnDeviceDisconnected(event.CopyText());
+		break;
+	case ListenerEventKind::AdvertisementStarted:
+		_listener->OnAdvertisementStarted();
+		break;
+	case ListenerEventKind::AdvertisementStopped:
+		_listener->OnAdvertisementStopped(event.CopyText());
+		break;
+	case ListenerEventKind::AdvertisementAborted:
+		_listener->OnAdvertisementAborted(event.CopyText());
+		break;
+	case ListenerEventKind::EnumerationCompleted:
+		_listener->OnEnumerationCompleted(event.CopyText());
+		break;
+	case ListenerEventKind::EnumerationStopped:
+		_listener->OnEnumerationStopped(event.CopyText());
+		break;
+	case ListenerEventKind::PeersChanged:
+		_listener->OnPeersChanged(*event.delta);
+		break;
+	case ListenerEventKind::DeviceUnpaired:
+		_listener->OnDeviceUnpaired(event.CopyText());
+		break;
+	case ListenerEventKind::DevicePaired:
+		_listener->OnDevicePaired(event.CopyText());
+		break;
+	case ListenerEventKind::DevicePairedError:
+		_listener->OnDevicePairedError(event.CopyText(), event.error);
+		break;
+	case ListenerEventKind::AsyncException:
+		_listener->OnAsyncException(event.CopyText());
+		break;
+	case ListenerEventKind::LogMessage:
+		_listener->LogMessage(event.CopyText());
+		break;
+	}
+}
+
+uint64_t ListenerBus::Subscribe(IWlanHostedNetworkListener* listener, const SubscriberOptions& options)
+{
+	ListenerAdapter adapter(listener);
+	return _bus.Subscribe([adapter](const RecordRef& event) mutable { adapter.OnEvent((*event).GetView()); }, options);
+}
+
+uint64_t ListenerBus::Subscribe(IWlanHostedNetworkListener2* listener, const SubscriberOptions& options)
+{
+	return _bus.Subscribe([listener](const RecordRef& event) { listener->OnEvent((*event).GetView()); }, options);
+}
+
+ListenerBus::Record* ListenerBus::Acquire(ListenerEventKind kind, HRESULT error, PeerHandle peer)
+{
+	Record* record;
+	if (!_pool.records.TryPop(record))
+	{
+		record = new Record();
+		record->pool = &_pool;
+	}
+
+	record->references.store(1, std::memory_order_relaxed);
+	record->kind = kind;
+	record->peer = peer;
+	record->error = error;
+	return record;
+}
+
+void ListenerBus::Recycle(Record* record)
+{
+	// Keep the text's buffer for the next event, not a peer list nobody reads again
+	record->text.clear();
+	record->delta = PeerDelta();
+	record->batch = ConnectBatchResult();
+
+	if (!record->pool->records.TryPush(record))
+	{
+		delete record;
+	}
+}
+
+void ListenerBus::Raise(ListenerEventKind kind, std::wstring_view text, HRESULT error, PeerHandle peer)
+{
+	if (kind == ListenerEventKind::AsyncException)
+	{
+		WFD_LOG_ERROR("Caught exception in asynchronous method: %s", text);
+	}
+	else if (kind == ListenerEventKind::LogMessage)
+	{
+		WFD_LOG_INFO("%s", text);
+	}
+
+	// Nobody to copy the text for
+	if (_bus.GetSubscriberCount() == 0)
+	{
+		return;
+	}
+
+	Record* record = Acquire(kind, error, peer);
+	record->text.assign(text.data(), text.length());
+	_bus.Publish(RecordRef(record));
+}
+
+void ListenerBus::RaiseException(const WlanHostedNetworkException& e)
+{
+	const char* what = e.what();
+	WFD_LOG_ERROR("Caught exception in asynchronous method: %s: %d", what, static_cast<int>(e.GetErrorCode()));
+
+	if (_bus.GetSubscriberCount() == 0)
+	{
+		return;
+	}
+
+	// The message is ASCII; widen it straight into the record instead of through a stream
+	Record* record = Acquire(ListenerEventKind::AsyncException, e.GetErrorCode(), InvalidPeerHandle);
+	for (const char* c = what; *c != '\0'; c++)
+	{
+		record->text.push_back(static_cast<wchar_t>(static_cast<unsigned char>(*c)));
+	}
+
+	wchar_t code[16];
+	int length = swprintf_s(code, _countof(code), L": %ld", e.GetErrorCode());
+	record->text.append(code, length > 0 ? length : 0);
+
+	_bus.Publish(RecordRef(record));
+}
+
+void ListenerBus::RaisePeersChanged(const PeerDelta& delta)
+{
+	if (_bus.GetSubscriberCount() == 0)
+	{
+		return;
+	}
+
+	Record* record = Acquire(ListenerEventKind::PeersChanged, S_OK, InvalidPeerHandle);
+	record->delta = delta;
+	_bus.Publish(RecordRef(record));
+}
+
+void ListenerBus::RaiseDevicesConnected(const ConnectBatchResult& result)
+{
+	if (_bus.GetSubscriberCount() == 0)
+	{
+		return;
+	}
+
+	Record* record = Acquire(ListenerEventKind::DevicesConnected, S_OK, InvalidPeerHandle);
+	record->batch = result;
+	_bus.Publish(RecordRef(record));
+}
+
+void ListenerBus::OnDeviceConnected(std::wstring remoteHostName)
+{
+	Raise(ListenerEventKind::DeviceConnected, remoteHostName);
+}
+
+void ListenerBus::OnDevicesConnected(const ConnectBatchResult& result)
+{
+	RaiseDevicesConnected(result);
+}
+
+void ListenerBus::OnDeviceDisconnected(std::wstring deviceId)
+{
+	Raise(ListenerEventKind::DeviceDisconnected, deviceId);
+}
+
+void ListenerBus::OnAdvertisementStarted()
+{
+	Raise(ListenerEventKind::AdvertisementStarted);
+}
+
+void ListenerBus::OnAdvertisementStopped(std::wstring message)
+{
+	Raise(ListenerEventKind::AdvertisementStopped, message);
+}
+
+void ListenerBus::OnAdvertisementAborted(std::wstring message)
+{
+	Raise(ListenerEventKind::AdvertisementAborted, message);
+}
+
+void ListenerBus::OnEnumerationCompleted(std::wstring message)
+{
+	Raise(ListenerEventKind::EnumerationCompleted, message);
+}
+
+void ListenerBus::OnEnumerationStopped(std::wstring message)
+{
+	Raise(ListenerEventKind::EnumerationStopped, message);
+}
+
+void ListenerBus::OnPeersChanged(const PeerDelta& delta)
+{
+	RaisePeersChanged(delta);
+}
+
+void ListenerBus::OnDeviceUnpaired(std::wstring message)
+{
+	Raise(ListenerEventKind::DeviceUnpaired, message);
+}
+
+void ListenerBus::OnDevicePaired(std::wstring message)
+{
+	Raise(ListenerEventKind::DevicePaired, message);
+}
+
+void ListenerBus::OnDevicePairedError(std::wstring message, int errorCode)
+{
+	Raise(ListenerEventKind::DevicePairedError, message, errorCode);
+}
+
+void ListenerBus::OnAsyncException(std::wstring message)
+{
+	Raise(ListenerEventKind::AsyncException, message);
+}
+
+void ListenerBus::LogMessage(std::wstring message)
+{
+	Raise(ListenerEventKind::LogMessage, message);
+}
+
+WlanHostedNetworkHelper::WlanHostedNetworkHelper()
+    : _peerEventsPending(false),
+      _peerTracker(_peers),
+      _peerTableChanged(false),
+      _peerBatchTimer(nullptr),
+      _peerBatchArmed(false),
+      _peerBatchWindow(0),
+      _peerBatchSize(0),
+      _deadlineTimer(nullptr),
+      _deadlineTimerArmed(false),
+      _enumerationDeadline(0),
+      _reconnectTimer(nullptr),
+      _decisionTimer(nullptr),
+      _decisionTimerArmed(false),
+      _admissionTimer(nullptr),
+      _admissionTimerArmed(false),
+      _startTime(std::chrono::steady_clock::now()),
+      _firstConnectionReported(false),
+      _cachedPeersAtStartup(0),
+      _ssidProvided(false),
+      _passphraseProvided(false),
+      _registeredListener(0),
+      _autoAccept(true),
+      _continuousDiscovery(false),
+      _vendorElement(0)
+{
+	_events.Start([this]() { OnEventBatch(); });
+}
+
+WlanHostedNetworkHelper::~WlanHostedNetworkHelper()
+{
+    if (_publisher.Get() != nullptr)
+    {
+        _publisher->Stop();
+    }
+    Reset();
+    _events.Stop();
+
+    if (_peerBatchTimer != nullptr)
+    {
+        SetThreadpoolTimer(_peerBatchTimer, nullptr, 0, 0);
+        WaitForThreadpoolTimerCallbacks(_peerBatchTimer, TRUE);
+        CloseThreadpoolTimer(_peerBatchTimer);
+    }
+
+    if (_deadlineTimer != nullptr)
+    {
+        SetThreadpoolTimer(_deadlineTimer, nullptr, 0, 0);
+        WaitForThreadpoolTimerCallbacks(_deadlineTimer, TRUE);
+        CloseThreadpoolTimer(_deadlineTimer);
+    }
+
+    if (_reconnectTimer != nullptr)
+    {
+        SetThreadpoolTimer(_reconnectTimer, nullptr, 0, 0);
+        WaitForThreadpoolTimerCallbacks(_reconnectTimer, TRUE);
+        CloseThreadpoolTimer(_reconnectTimer);
+    }
+
+    if (_decisionTimer != nullptr)
+    {
+        SetThreadpoolTimer(_decisionTimer, nullptr, 0, 0);
+        WaitForThreadpoolTimerCallbacks(_decisionTimer, TRUE);
+        CloseThreadpoolTimer(_decisionTimer);
+    }
+
+    if (_admissionTimer != nullptr)
+    {
+        SetThreadpoolTimer(_admissionTimer, nullptr, 0, 0);
+        WaitForThreadpoolTimerCallbacks(_admissionTimer, TRUE);
+        CloseThreadpoolTimer(_admissionTimer);
+    }
+}
+
+Completion<OperationResult> WlanHostedNetworkHelper::Start(std::chrono::milliseconds deadline)
+{
+    HRESULT hr = S_OK;
+
+    // Clean up old state
+    Reset();
+
+    // Create WiFiDirectAdvertisementPublisher
+    hr = Windows::Foundation::ActivateInstance(HStringReference(RuntimeClass_Windows_Devices_WiFiDirect_WiFiDirectAdvertisementPublisher).Get(), &_publisher);
+    if (FAILED(hr))
+    {
+        throw WlanHostedNetworkException("ActivateInstance for WiFiDirectAdvertisementPublisher failed", hr);
+    }
+
+    // Add event handler for advertisement StatusChanged
+    hr = _publisher->add_StatusChanged(
+        Callback<StatusChangedHandler>([this](IWiFiDirectAdvertisementPublisher* sender, IWiFiDirectAdvertisementPublisherStatusChangedEventArgs* args) -> HRESULT
+    {
+        HRESULT hr = S_OK;
+        WiFiDirectAdvertisementPublisherStatus status;
+        WiFiDirectError error;
+
+        try
+        {
+            hr = args->get_Status(&status);
+            if (FAILED(hr))
+            {
+                throw WlanHostedNetworkException("Get Status for AdvertisementPubliserStatusChangedEventArgs failed", hr);
+            }
+
+            switch (status)
+            {
+                case WiFiDirectAdvertisementPublisherStatus_Started:
+                {
+                    // Begin listening for connections and notify listener that the advertisement started
+                    StartListener();
+
+                    _listeners.Raise(ListenerEventKind::AdvertisementStarted);
+                    _startCompletions.Complete(L"", OperationResult());
+                    break;
+                }
+                case WiFiDirectAdvertisementPublisherStatus_Aborted:
+                {
+                    // Check error and notify listener that the advertisement stopped
+                    hr = args->get_Error(&error);
+                    if (FAILED(hr))
+                    {
+                        throw WlanHostedNetworkException("Get Error for AdvertisementPubliserStatusChangedEventArgs failed", hr);
+                    }
+
+                    std::wstring message;
+
+                    switch (error)
+                    {
+                    case WiFiDirectError_RadioNotAvailable:
+                        message = L"Advertisement aborted, Wi-Fi radio is turned off";
+                        break;
+
+                    case WiFiDirectError_ResourceInUse:
+                        message = L"Advertisement aborted, Resource In Use";
+                        break;
+
+                    default:
+                        message = L"Advertisement aborted, unknown reason";
+                        break;
+                    }
+
+                    _listeners.Raise(ListenerEventKind::AdvertisementAborted, message);
+                    _startCompletions.Complete(L"", OperationResult(E_ABORT, message));
+                    _stopCompletions.Complete(L"", OperationResult(E_ABORT, message));
+                    break;
+                }
+                case WiFiDirectAdvertisementPublisherStatus_Stopped:
+                {
+                    // Notify listener that the advertisement is stopped
+                    _listeners.Raise(ListenerEventKind::AdvertisementStopped, L"Advertisement stopped");
+                    _stopCompletions.Complete(L"", OperationResult(S_OK, L"Advertisement stopped"));
+                    break;
+                }
+            }
+        }
+        catch (WlanHostedNetworkException& e)
+        {
+            _listeners.RaiseException(e);
+            return e.GetErrorCode();
+        }
+
+        return hr;
+    }).Get(), &_statusChangedToken);
+
+    // Set Advertisement required settings
+
+    hr = _publisher->get_Advertisement(_advertisement.GetAddressOf());
+    if (FAILED(hr))
+    {
+        throw WlanHostedNetworkException("Get advertisement for WiFiDirectAdvertisementPublisher failed", hr);
+    }
+
+    // Must set the autonomous group owner (GO) enabled flag
+    // Legacy Wi-Fi Direct advertisement uses a Wi-Fi Direct GO to act as an access point to legacy settings
+    hr = _advertisement->put_IsAutonomousGroupOwnerEnabled(false);
+    if (FAILED(hr))
+    {
+        throw WlanHostedNetworkException("Set is autonomous group owner for WiFiDirectAdvertisement failed", hr);
+    }
+
+	hr = _advertisement->put_ListenStateDiscoverability(ABI::Windows::Devices::WiFiDirect::WiFiDirectAdvertisementListenStateDiscoverability_Normal);
+	if (FAILED(hr))
+	{
+		throw WlanHostedNetworkException("Set put_ListenStateDiscoverability failed", hr);
+	}
+
+    //hr = _advertisement->get_LegacySettings(_legacySettings.GetAddressOf());
+    //if (FAILED(hr))
+    //{
+    //    throw WlanHostedNetworkException("Get legacy settings for WiFiDirectAdvertisement failed", hr);
+    //}
+
+    // Must enable legacy settings so that non-Wi-Fi Direct peers can connect in legacy mode
+    //hr = _legacySettings->put_IsEnabled(true);
+    //if (FAILED(hr))
+    //{
+    //    throw WlanHostedNetworkException("Set is enabled for WiFiDirectLegacySettings failed", hr);
+    //}
+
+#if 0
+    HString hstrSSID;
+    HString hstrPassphrase;
+
+    // Either specify an SSID, or read the randomly generated one
+    if (_ssidProvided)
+    {
+        hr = hstrSSID.Set(_ssid.c_str());
+        if (FAILED(hr))
+        {
+            throw WlanHostedNetworkException("Failed to create HSTRING representation for SSID", hr);
+        }
+
+        hr = _legacySettings->put_Ssid(hstrSSID.Get());
+        if (FAILED(hr))
+        {
+            throw WlanHostedNetworkException("Set SSID for WiFiDirectLegacySettings failed", hr);
+        }
+    }
+    else
+    {
+        hr = _legacySettings->get_Ssid(hstrSSID.GetAddressOf());
+        if (FAILED(hr))
+        {
+            throw WlanHostedNetworkException("Get SSID for WiFiDirectLegacySettings failed", hr);
+        }
+
+        _ssid = hstrSSID.GetRawBuffer(nullptr);
+    }
+
+    // Either specify a passphrase, or read the randomly generated one
+    ComPtr<IPasswordCredential> passwordCredential;
+
+    hr = _legacySettings->get_Passphrase(passwordCredential.GetAddressOf());
+    if (FAILED(hr))
+    {
+        throw WlanHostedNetworkException("Get Passphrase for WiFiDirectLegacySettings failed", hr);
+    }
+
+    if (_passphraseProvided)
+    {
+        hr = hstrPassphrase.Set(_passphrase.c_str());
+        if (FAILED(hr))
+        {
+            throw WlanHostedNetworkException("Failed to create HSTRING representation for Passphrase", hr);
+        }
+
+        hr = passwordCredential->put_Password(hstrPassphrase.Get());
+        if (FAILED(hr))
+        {
+            throw WlanHostedNetworkException("Set Passphrase for WiFiDirectLegacySettings failed", hr);
+        }
+    }
+    else
+    {
+        hr = passwordCredential->get_Password(hstrPassphrase.GetAddressOf());
+        if (FAILED(hr))
+        {
+            throw WlanHostedNetworkException("Get Passphrase for WiFiDirectLegacySettings failed", hr);
+        }
+
+        _passphrase = hstrPassphrase.GetRawBuffer(nullptr);
+    }
+#endif
+
+    // Registered first, Started may be reported before Start returns
+    CompletionSource<OperationResult> started;
+    Completion<OperationResult> completion = TrackCompletion(_startCompletions, L"", started, deadline);
+
+    // Start the advertisement, which will create an access point that other peers can connect to
+    hr = _publisher->Start();
+    if (FAILED(hr))
+    {
+        started.Complete(OperationResult(hr));
+        throw WlanHostedNetworkException("Start WiFiDirectAdvertisementPublisher failed", hr);
+    }
+
+    return completion;
+}
+
+Completion<OperationResult> WlanHostedNetworkHelper::Stop(std::chrono::milliseconds deadline)
+{
+    HRESULT hr = S_OK;
+
+    // Call stop on the publisher and expect the status changed callback
+    if (_publisher.Get() != nullptr)
+    {
+        CompletionSource<OperationResult> stopped;
+        Completion<OperationResult> completion = TrackCompletion(_stopCompletions, L"", stopped, deadline);
+
+        hr = _publisher->Stop();
+        if (FAILED(hr))
+        {
+            stopped.Complete(OperationResult(hr));
+            throw WlanHostedNetworkException("Stop WiFiDirectAdvertisementPublisher failed", hr);
+        }
+
+        return completion;
+    }
+    else
+    {
+        throw WlanHostedNetworkException("WiFiDirectAdvertisementPublisher is not running", hr);
+    }
+}
+
+void WlanHostedNetworkHelper::ConnectDevice(const wchar_t* szDeviceId)
+{
+	HString deviceId;
+	deviceId.Set(szDeviceId);
+
+	ConnectDeviceInternal(deviceId.Get());
+}
+
+/// State shared by the connections of one ConnectDevices call; guarded by lock
+struct WlanHostedNetworkHelper::ConnectBatch
+{
+	ConnectBatch()
+		: maxInFlight(1),
+		  timeout(0),
+		  next(0),
+		  inFlight(0),
+		  finished(0),
+		  launching(false)
+	{}
+
+	std::mutex lock;
+	ConnectBatchResult result;
+	size_t maxInFlight;
+	std::chrono::milliseconds timeout;
+	std::chrono::steady_clock::time_point start;
+	/// Index of the next device to connect
+	size_t next;
+	size_t inFlight;
+	size_t finished;
+	/// A thread is inside LaunchConnections for this batch
+	bool launching;
+};
+
+void WlanHostedNetworkHelper::ConnectDevices(const std::vector<std::wstring>& deviceIds, size_t maxInFlight, DWORD timeoutMs)
+{
+	std::shared_ptr<ConnectBatch> batch = std::make_shared<ConnectBatch>();
+	batch->maxInFlight = (maxInFlight != 0) ? maxInFlight : 1;
+	batch->timeout = std::chrono::milliseconds(timeoutMs);
+	batch->start = std::chrono::steady_clock::now();
+
+	for (auto& deviceId : deviceIds)
+	{
+		ConnectBatchEntry entry;
+		entry.deviceId = deviceId;
+		entry.outcome = ConnectOutcome::Pending;
+		entry.error = S_OK;
+		batch->result.devices.push_back(entry);
+	}
+
+	if (deviceIds.empty())
+	{
+		_listeners.RaiseDevicesConnected(batch->result);
+		return;
+	}
+
+	LaunchConnections(batch);
+}
+
+void WlanHostedNetworkHelper::LaunchConnections(const std::shared_ptr<ConnectBatch>& batch)
+{
+	std::unique_lock<std::mutex> lock(batch->lock);
+
+	// Connections that finish while a thread is launching free a slot that thread will fill
+	if (batch->launching)
+	{
+		return;
+	}
+	batch->launching = true;
+
+	while (batch->inFlight < batch->maxInFlight && batch->next < batch->result.devices.size())
+	{
+		size_t index = batch->next++;
+		batch->inFlight++;
+
+		HString deviceId;
+		deviceId.Set(batch->result.devices[index].deviceId.c_str());
+
+		lock.unlock();
+
+		try
+		{
+			// The connection's deadline is the batch timeout, reported here as ERROR_TIMEOUT
+			std::shared_ptr<ConnectBatch> owner(batch);
+			ConnectDeviceInternal(deviceId.Get(), [this, owner, index](HRESULT hr)
+			{
+				ConnectOutcome outcome = (hr == S_OK) ? ConnectOutcome::Succeeded :
+					(hr == S_FALSE) ? ConnectOutcome::Skipped :
+					(hr == HRESULT_FROM_WIN32(ERROR_TIMEOUT)) ? ConnectOutcome::TimedOut : ConnectOutcome::Failed;
+				FinishConnection(owner, index, outcome, hr);
+			}, batch->timeout);
+		}
+		catch (WlanHostedNetworkException& e)
+		{
+			FinishConnection(batch, index, ConnectOutcome::Failed, FAILED(e.GetErrorCode()) ? e.GetErrorCode() : E_FAIL);
+		}
+
+		lock.lock();
+	}
+
+	batch->launching = false;
+}
+
+void WlanHostedNetworkHelper::FinishConnection(const std::shared_ptr<ConnectBatch>& batch, size_t index, ConnectOutcome outcome, HRESULT error)
+{
+	bool done;
+	{
+		std::lock_guard<std::mutex> lock(batch->lock);
+
+		ConnectBatchEntry& entry = batch->result.devices[index];
+		if (entry.outcome != ConnectOutcome::Pending)
+		{
+			// Late completion of a connection that already timed out
+			return;
+		}
+
+		entry.outcome = outcome;
+		entry.error = error;
+
+		switch (outcome)
+		{
+		case ConnectOutcome::Succeeded:
+			batch->result.succeeded++;
+			break;
+		case ConnectOutcome::Skipped:
+			batch->result.skipped++;
+			break;
+		case ConnectOutcome::TimedOut:
+			batch->result.timedOut++;
+			break;
+		default:
+			batch->result.failed++;
+			break;
+		}
+
+		batch->inFlight--;
+		batch->finished++;
+
+		done = (batch->finished == batch->result.devices.size());
+		if (done)
+		{
+			batch->result.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - batch->start);
+		}
+	}
+
+	if (!done)
+	{
+		LaunchConnections(batch);
+		return;
+	}
+
+	_listeners.RaiseDevicesConnected(batch->result);
+}
+
+void WlanHostedNetworkHelper::SetReconnectSettings(const ReconnectSettings& settings)
+{
+	std::lock_guard<std::mutex> lock(_reconnectLock);
+
+	if (settings.enabled && _reconnectTimer == nullptr)
+	{
+		_reconnectTimer = CreateThreadpoolTimer(ReconnectTimerCallback, this, nullptr);
+		if (_reconnectTimer == nullptr)
+		{
+			throw WlanHostedNetworkException("CreateThreadpoolTimer for reconnects failed", HRESULT_FROM_WIN32(GetLastError()));
+		}
+	}
+
+	_reconnects.Configure(settings);
+}
+
+ReconnectStats WlanHostedNetworkHelper::GetReconnectStats()
+{
+	std::lock_guard<std::mutex> lock(_reconnectLock);
+	return _reconnects.GetStats();
+}
+
+void WlanHostedNetworkHelper::ScheduleReconnect(const wchar_t* deviceId)
+{
+	std::lock_guard<std::mutex> lock(_reconnectLock);
+
+	if (!_reconnects.GetSettings().enabled)
+	{
+		return;
+	}
+
+	bool idle = !_reconnects.HasPending();
+	_reconnects.OnDisconnected(deviceId, ReconnectScheduler::Clock::now());
+
+	if (idle)
+	{
+		// Poll every 100 ms while reconnects are pending; the backoff delays are far coarser
+		ULARGE_INTEGER relative;
+		relative.QuadPart = static_cast<ULONGLONG>(-100LL * 10000);
+
+		FILETIME dueTime;
+		dueTime.dwLowDateTime = relative.LowPart;
+		dueTime.dwHighDateTime = relative.HighPart;
+		SetThreadpoolTimer(_reconnectTimer, &dueTime, 100, 0);
+	}
+}
+
+void WlanHostedNetworkHelper::RunDueReconnects()
+{
+	std::vector<std::wstring> due;
+	{
+		std::lock_guard<std::mutex> lock(_reconnectLock);
+
+		due = _reconnects.TakeDue(ReconnectScheduler::Clock::now());
+		if (!_reconnects.HasPending())
+		{
+			SetThreadpoolTimer(_reconnectTimer, nullptr, 0, 0);
+		}
+	}
+
+	for (auto& deviceId : due)
+	{
+		HString id;
+		id.Set(deviceId.c_str());
+
+		// Success is recorded by the connect path itself; only failures come back here
+		auto failed = [this, deviceId](HRESULT hr)
+		{
+			if (hr == S_OK)
+			{
+				return;
+			}
+
+			bool gaveUp;
+			{
+				std::lock_guard<std::mutex> lock(_reconnectLock);
+
+				if (hr == S_FALSE)
+				{
+					// Paired peers are not connected by this path, stop trying
+					_reconnects.Cancel(deviceId);
+					return;
+				}
+
+				gaveUp = _reconnects.OnAttemptFailed(deviceId, ReconnectScheduler::Clock::now());
+			}
+
+			if (gaveUp)
+			{
+				_listeners.Raise(ListenerEventKind::LogMessage, L"Gave up reconnecting " + deviceId);
+			}
+		};
+
+		try
+		{
+			ConnectDeviceInternal(id.Get(), failed);
+		}
+		catch (WlanHostedNetworkException& e)
+		{
+			failed(FAILED(e.GetErrorCode()) ? e.GetErrorCode() : E_FAIL);
+		}
+	}
+}
+
+VOID CALLBACK WlanHostedNetworkHelper::ReconnectTimerCallback(PTP_CALLBACK_INSTANCE instance, PVOID context, PTP_TIMER timer)
+{
+	static_cast<WlanHostedNetworkHelper*>(context)->RunDueReconnects();
+}
+
+uint64_t WlanHostedNetworkHelper::ParkDecision(PendingDecision& decision, DecisionQueue::Resolver resolver)
+{
+	{
+		std::lock_guard<std::mutex> lock(_decisionTimerLock);
+
+		if (_decisionTimer == nullptr)
+		{
+			_decisionTimer = CreateThreadpoolTimer(DecisionTimerCallback, this, nullptr);
+			if (_decisionTimer == nullptr)
+			{
+				throw WlanHostedNetworkException("CreateThreadpoolTimer for decisions failed", HRESULT_FROM_WIN32(GetLastError()));
+			}
+		}
+	}
+
+	uint64_t id = _decisions.Add(decision, std::move(resolver));
+
+	std::lock_guard<std::mutex> lock(_decisionTimerLock);
+
+	if (!_decisionTimerArmed)
+	{
+		// Timeouts are seconds long, checking every 100 ms is plenty
+		ULARGE_INTEGER relative;
+		relative.QuadPart = static_cast<ULONGLONG>(-100LL * 10000);
+
+		FILETIME dueTime;
+		dueTime.dwLowDateTime = relative.LowPart;
+		dueTime.dwHighDateTime = relative.HighPart;
+		SetThreadpoolTimer(_decisionTimer, &dueTime, 100, 0);
+		_decisionTimerArmed = true;
+	}
+
+	return id;
+}
+
+VOID CALLBACK WlanHostedNetworkHelper::DecisionTimerCallback(PTP_CALLBACK_INSTANCE instance, PVOID context, PTP_TIMER timer)
+{
+	WlanHostedNetworkHelper* helper = static_cast<WlanHostedNetworkHelper*>(context);
+
+	size_t expired = helper->_decisions.ExpireDue(DecisionQueue::Clock::now());
+	if (expired != 0)
+	{
+		std::wostringstream ss;
+		ss << expired << L" request(s) timed out, " << (helper->_decisions.GetPolicy().acceptOnTimeout ? L"accepted" : L"declined");
+		helper->_listeners.Raise(ListenerEventKind::LogMessage, ss.str());
+	}
+
+	// A request parked after this check arms the timer again
+	std::lock_guard<std::mutex> lock(helper->_decisionTimerLock);
+	if (!helper->_decisions.HasPending())
+	{
+		SetThreadpoolTimer(timer, nullptr, 0, 0);
+		helper->_decisionTimerArmed = false;
+	}
+}
+
+uint64_t WlanHostedNetworkHelper::ArmDeadline(std::chrono::milliseconds timeout, std::function<void()> expired)
+{
+	uint64_t now = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - _startTime).count());
+	uint64_t expiry = (now + static_cast<uint64_t>(timeout.count()) + DeadlineTickMs - 1) / DeadlineTickMs;
+
+	std::lock_guard<std::mutex> lock(_deadlineLock);
+
+	if (_deadlineTimer == nullptr)
+	{
+		_deadlineTimer = CreateThreadpoolTimer(DeadlineTimerCallback, this, nullptr);
+		if (_deadlineTimer == nullptr)
+		{
+			// The operation is already running; it goes on without a deadline rather than failing
+			HRESULT error = HRESULT_FROM_WIN32(GetLastError());
+			std::wostringstream ss;
+			ss << L"CreateThreadpoolTimer for deadlines failed: " << error;
+			_listeners.Raise(ListenerEventKind::AsyncException, ss.str(), error);
+			return TimerWheel<std::function<void()>>::InvalidHandle;
+		}
+	}
+
+	uint64_t deadline = _deadlines.Arm(expiry, std::move(expired));
+
+	if (!_deadlineTimerArmed)
+	{
+		ULARGE_INTEGER relative;
+		relative.QuadPart = static_cast<ULONGLONG>(-static_cast<LONGLONG>(DeadlineTickMs) * 10000);
+
+		FILETIME dueTime;
+		dueTime.dwLowDateTime = relative.LowPart;
+		dueTime.dwHighDateTime = relative.HighPart;
+		SetThreadpoolTimer(_deadlineTimer, &dueTime, DeadlineTickMs, DeadlineTickMs / 2);
+		_deadlineTimerArmed = true;
+	}
+
+	return deadline;
+}
+
+bool WlanHostedNetworkHelper::CancelDeadline(uint64_t deadline)
+{
+	// Destroyed outside the lock, it may hold the last reference to an operation
+	std::function<void()> expired;
+
+	std::lock_guard<std::mutex> lock(_deadlineLock);
+	return _deadlines.Cancel(deadline, &expired);
+}
+
+uint64_t WlanHostedNetworkHelper::WatchOperation(const ComPtr<IAsyncInfo>& operation, std::chrono::milliseconds timeout, std::function<void()> timedOut)
+{
+	return ArmDeadline(timeout, [operation, timedOut]()
+	{
+		// Reported first so the cancelled completion can tell it was not cancelled by anyone else
+		timedOut();
+		operation->Cancel();
+	});
+}
+
+VOID CALLBACK WlanHostedNetworkHelper::DeadlineTimerCallback(PTP_CALLBACK_INSTANCE instance, PVOID context, PTP_TIMER timer)
+{
+	WlanHostedNetworkHelper* helper = static_cast<WlanHostedNetworkHelper*>(context);
+
+	uint64_t now = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - helper->_startTime).count()) / DeadlineTickMs;
+
+	std::vector<std::function<void()>> expired;
+	{
+		std::lock_guard<std::mutex> lock(helper->_deadlineLock);
+
+		helper->_deadlines.Advance(now, [&expired](std::function<void()>& callback)
+		{
+			expired.push_back(std::move(callback));
+		});
+
+		// A deadline armed after this check arms the timer again
+		if (helper->_deadlines.GetCount() == 0)
+		{
+			SetThreadpoolTimer(timer, nullptr, 0, 0);
+			helper->_deadlineTimerArmed = false;
+		}
+	}
+
+	// Cancelling calls completion handlers, which cancel their own deadlines
+	for (auto& callback : expired)
+	{
+		try
+		{
+			callback();
+		}
+		catch (WlanHostedNetworkException& e)
+		{
+			helper->_listeners.RaiseException(e);
+		}
+	}
+}
+
+void WlanHostedNetworkHelper::Disconnect(const wchar_t* szDeviceId)
+{
+	std::wstring deviceId(szDeviceId);
+
+	_events.Post([this, deviceId]()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_reconnectLock);
+			_reconnects.Cancel(deviceId);
+		}
+
+		ReleaseConnectedDevice(deviceId.c_str(), deviceId.length(), true);
+	});
+}
+
+ComPtr<IDeviceInformation2> WlanHostedNetworkHelper::FindDeviceInformation(const wchar_t* deviceId, size_t length)
+{
+	std::lock_guard<std::mutex> lock(_peerLock);
+
+	PeerState* peer = _peers.Get(_peers.Find(deviceId, length));
+	if (peer == nullptr)
+	{
+		return nullptr;
+	}
+
+	return peer->deviceInfo;
+}
+
+bool WlanHostedNetworkHelper::ReleaseConnectedDevice(const wchar_t* deviceId, size_t length, bool close)
+{
+	ComPtr<IWiFiDirectDevice> device;
+	EventRegistrationToken statusChangedToken;
+
+	{
+		std::lock_guard<std::mutex> lock(_peerLock);
+
+		PeerHandle handle = _peers.Find(deviceId, length);
+		PeerState* peer = _peers.Get(handle);
+		if (peer == nullptr || !peer->device)
+		{
+			return false;
+		}
+
+		device.Swap(peer->device);
+		statusChangedToken = peer->statusChangedToken;
+		_peerTracker.ReleaseIfIdle(handle);
+		RefreshPeerEntry(deviceId, length);
+		PublishPeerSnapshot();
+	}
+
+	device->remove_ConnectionStatusChanged(statusChangedToken);
+
+	if (close)
+	{
+		ComPtr<IClosable> spInterface;
+		HRESULT hr = device.As(&spInterface);
+		if (SUCCEEDED(hr))
+		{
+			spInterface->Close();
+		}
+	}
+
+	return true;
+}
+
+PeerHandle WlanHostedNetworkHelper::FindPeerHandle(const wchar_t* deviceId, size_t length)
+{
+	std::lock_guard<std::mutex> lock(_peerLock);
+	return _peers.Find(deviceId, length);
+}
+
+void WlanHostedNetworkHelper::SetPairingState(const wchar_t* deviceId, size_t length, PeerPairingState state)
+{
+	std::lock_guard<std::mutex> lock(_peerLock);
+
+	PeerState* peer = _peers.Get(_peers.Find(deviceId, length));
+	if (peer != nullptr)
+	{
+		peer->pairing = state;
+		RefreshPeerEntry(deviceId, length);
+		PublishPeerSnapshot();
+	}
+
+	_peerCache.SetPairing(deviceId, length, static_cast<uint32_t>(state));
+}
+
+void WlanHostedNetworkHelper::OpenPeerCache(const wchar_t* path)
+{
+	std::lock_guard<std::mutex> lock(_peerLock);
+
+	HRESULT hr = _peerCache.Open(path);
+	if (FAILED(hr))
+	{
+		throw WlanHostedNetworkException("Open peer cache failed", hr);
+	}
+
+	_cachedPeersAtStartup = _peerCache.GetCount();
+}
+
+std::vector<PeerCacheEntry> WlanHostedNetworkHelper::GetKnownPeers()
+{
+	std::lock_guard<std::mutex> lock(_peerLock);
+
+	std::vector<PeerCacheEntry> peers;
+	peers.reserve(_peerCache.GetCount());
+	_peerCache.ForEach([&peers](const PeerCacheEntry& entry)
+	{
+		peers.push_back(entry);
+	});
+
+	return peers;
+}
+
+void WlanHostedNetworkHelper::OpenTrustStore(const wchar_t* path)
+{
+	std::lock_guard<std::mutex> lock(_trustLock);
+
+	HRESULT hr = _trust.Open(path);
+	if (FAILED(hr))
+	{
+		throw WlanHostedNetworkException("Open trust store failed", hr);
+	}
+}
+
+void WlanHostedNetworkHelper::SetPeerTrust(const wchar_t* deviceId, PeerTrust trust)
+{
+	std::lock_guard<std::mutex> lock(_trustLock);
+
+	if (!_trust.IsOpen())
+	{
+		throw WlanHostedNetworkException("Trust store is not open");
+	}
+
+	size_t length = wcslen(deviceId);
+	HRESULT hr = (trust == PeerTrust::Unknown) ? _trust.Forget(deviceId, length) : _trust.SetTrust(deviceId, length, trust, TrustOrigin::Manual);
+	if (FAILED(hr))
+	{
+		throw WlanHostedNetworkException("Update trust store failed", hr);
+	}
+}
+
+std::vector<TrustEntry> WlanHostedNetworkHelper::GetTrustEntries()
+{
+	std::lock_guard<std::mutex> lock(_trustLock);
+
+	std::vector<TrustEntry> entries;
+	entries.reserve(_trust.GetCount());
+	_trust.ForEach([&entries](const TrustEntry& entry)
+	{
+		entries.push_back(entry);
+	});
+
+	return entries;
+}
+
+PeerTrust WlanHostedNetworkHelper::LookupTrust(const std::wstring& deviceId)
+{
+	std::lock_guard<std::mutex> lock(_trustLock);
+	return _trust.IsOpen() ? _trust.Lookup(deviceId.c_str(), deviceId.length()) : PeerTrust::Unknown;
+}
+
+void WlanHostedNetworkHelper::RecordPairingOutcome(const std::wstring& deviceId, uint32_t pairingKinds, int32_t result, bool paired)
+{
+	std::lock_guard<std::mutex> lock(_trustLock);
+
+	if (_trust.IsOpen())
+	{
+		// Losing the record only means the peer is asked again next time
+		_trust.RecordPairing(deviceId.c_str(), deviceId.length(), pairingKinds, result, paired);
+	}
+}
+
+void WlanHostedNetworkHelper::ReportFirstConnection()
+{
+	if (_firstConnectionReported.exchange(true))
+	{
+		return;
+	}
+
+	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - _startTime);
+
+	std::wostringstream ss;
+	ss << L"First connection " << elapsed.count() << L" ms after startup (peer cache: ";
+	if (!_peerCache.IsOpen())
+	{
+		ss << L"disabled)";
+	}
+	else
+	{
+		ss << _cachedPeersAtStartup << L" known peers at startup)";
+	}
+	_listeners.Raise(ListenerEventKind::LogMessage, ss.str());
+}
+
+void WlanHostedNetworkHelper::QueuePairing(const wchar_t* deviceId, const ComPtr<IDeviceInformation2>& deviceInformation, std::shared_ptr<void> slot)
+{
+	std::wstring pairingId(deviceId);
+
+	bool queued = _pairings.Request(pairingId, [this, pairingId, deviceInformation, slot]()
+	{
+		try
+		{
+			PairDeviceInternal(pairingId, deviceInformation.Get(), slot);
+		}
+		catch (WlanHostedNetworkException& e)
+		{
+			SetPairingState(pairingId.c_str(), pairingId.length(), PeerPairingState::Failed);
+			FinishPairing(pairingId, false);
+			ReportPairing(pairingId, false, e.GetErrorCode());
+		}
+	});
+
+	if (!queued)
+	{
+		// Completions are keyed by device ID, so whoever waits for this request already gets the
+		// outcome of the pairing running; listeners hear about that one pairing only
+		WFD_LOG_INFO("Pairing already in progress, joining it: %s", pairingId);
+	}
+}
+
+void WlanHostedNetworkHelper::FinishPairing(const std::wstring& deviceId, bool paired)
+{
+	PairingSession session;
+	if (_pairings.Complete(deviceId, paired, &session))
+	{
+		ReleasePairingSession(session);
+	}
+}
+
+void WlanHostedNetworkHelper::ReportPairing(const std::wstring& deviceId, bool paired, int errorCode)
+{
+	PeerHandle peer = FindPeerHandle(deviceId.c_str(), deviceId.length());
+	if (paired)
+	{
+		_listeners.Raise(ListenerEventKind::DevicePaired, deviceId, S_OK, peer);
+		_pairCompletions.Complete(deviceId, PairResult());
+	}
+	else
+	{
+		_listeners.Raise(ListenerEventKind::DevicePairedError, deviceId, errorCode, peer);
+		_pairCompletions.Complete(deviceId, PairResult(errorCode < 0 ? errorCode : E_FAIL, errorCode));
+	}
+}
+
+void WlanHostedNetworkHelper::ReleasePairingSession(PairingSession& session)
+{
+	if (session.customPairing && session.requestedToken.value != 0)
+	{
+		session.customPairing->remove_PairingRequested(session.requestedToken);
+		session.requestedToken.value = 0;
+	}
+}
+
+void WlanHostedNetworkHelper::PairDeviceInternal(const std::wstring& deviceId, ABI::Windows::Devices::Enumeration::IDeviceInformation2* pDevInfo2, std::shared_ptr<void> slot)
+{
+	ComPtr<IDeviceInformationPairing> devInfoPair;
+	HRESULT hr = pDevInfo2->get_Pairing(&devInfoPair);
+	if (FAILED(hr))
+	{
+		throw WlanHostedNetworkException("Get IDeviceInformationPairing failed", hr);
+	}
+
+	boolean isPaired = false;
+	hr = devInfoPair->get_IsPaired(&isPaired);
+	if (SUCCEEDED(hr) && isPaired)
+	{
+		SetPairingState(deviceId.c_str(), deviceId.length(), PeerPairingState::Paired);
+		RecordPairingOutcome(deviceId, 0, DevicePairingResultStatus_AlreadyPaired, true);
+		FinishPairing(deviceId, true);
+		ReportPairing(deviceId, true);
+		return;
+	}
+
+	ComPtr<IDeviceInformationPairing2> devInfoPair2;
+	hr = devInfoPair.As(&devInfoPair2);
+	if (FAILED(hr))
+	{
+		throw WlanHostedNetworkException("Get IDeviceInformationPairing2 failed", hr);
+	}
+
+	// Everything the ceremony and its handlers use is held here, per device, until it completes
+	PairingSession session;
+	session.deviceInformation = pDevInfo2;
+	session.slot = std::move(slot);
+
+	hr = devInfoPair2->get_Custom(session.customPairing.GetAddressOf());
+	if (FAILED(hr))
+	{
+		throw WlanHostedNetworkException("Get IDeviceInformationCustomPairing failed", hr);
+	}
+
+	ComPtr<IWiFiDirectConnectionParameters> param;
+	hr = _activationCache.GetConnectionParameters(DefaultGroupOwnerIntent, DefaultPairingProcedure, param);
+	if (FAILED(hr))
+	{
+		throw WlanHostedNetworkException("ActivateInstance IWiFiDirectConnectionParameters failed", hr);
+	}
+
+	// ProvidePin is answered from the console or a pairing policy's provisioning table
+	DevicePairingKinds devicePairingKinds = DevicePairingKinds::DevicePairingKinds_ConfirmOnly |
+		DevicePairingKinds::DevicePairingKinds_DisplayPin |
+		DevicePairingKinds::DevicePairingKinds_ProvidePin;
+
+	ComPtr<IDevicePairingSettings> spSetting;
+	hr = param.As(&spSetting);
+	if (FAILED(hr))
+	{
+		throw WlanHostedNetworkException("Get IDevicePairingSettings failed", hr);
+	}
+
+	LatencyRecorder::Clock::time_point started = LatencyRecorder::Clock::now();
+	std::wstring pairingId(deviceId);
+	// Set by the ceremony, recorded with the outcome
+	std::shared_ptr<std::atomic<uint32_t>> ceremonyKinds = std::make_shared<std::atomic<uint32_t>>(0);
+	// The deadline, the completion and a declined ceremony race to finish the pairing; only the
+	// first one does
+	std::shared_ptr<std::atomic<bool>> settled = std::make_shared<std::atomic<bool>>(false);
+
+	hr = session.customPairing->add_PairingRequested(Callback<CustomPairHandler>([this, started, pairingId, ceremonyKinds, settled](IDeviceInformationCustomPairing* pCustomPairing, IDevicePairingRequestedEventArgs* pArgs) -> HRESULT
+		{
+			LatencyRecorder::Clock::time_point requested = _latency.Record(LatencyPhase::PairRequested, started);
+			WFD_LOG_INFO("Pair requested: %s", pairingId);
+
+			HString pin;
+			ABI::Windows::Devices::Enumeration::DevicePairingKinds kinds;
+			pArgs->get_PairingKind(&kinds);
+			if (kinds == ABI::Windows::Devices::Enumeration::DevicePairingKinds::DevicePairingKinds_DisplayPin)
+			{
+				pArgs->get_Pin(pin.GetAddressOf());
+			}
+			ceremonyKinds->store(static_cast<uint32_t>(kinds));
+
+			// Confirming needs no answer from anyone, a PIN to provide only comes from a decision
+			bool confirm = (kinds & (DevicePairingKinds_ConfirmOnly | DevicePairingKinds_DisplayPin)) != 0;
+			PeerTrust trust = LookupTrust(pairingId);
+
+			// Returning without Accept declines the ceremony. Settle the pairing here so callers and
+			// listeners hear the result now rather than when the peer gives up.
+			auto decline = [&](const wchar_t* reason)
+			{
+				_latency.Record(LatencyPhase::PairDecision, requested);
+				_listeners.Raise(ListenerEventKind::LogMessage, L"Declined pairing with " + pairingId + reason);
+				if (!settled->exchange(true))
+				{
+					SetPairingState(pairingId.c_str(), pairingId.length(), PeerPairingState::Failed);
+					RecordPairingOutcome(pairingId, static_cast<uint32_t>(kinds), DevicePairingResultStatus_RejectedByHandler, false);
+					FinishPairing(pairingId, false);
+					ReportPairing(pairingId, false, DevicePairingResultStatus_RejectedByHandler);
+				}
+			};
+
+			if (trust == PeerTrust::Banned)
+			{
+				decline(L": banned");
+			}
+			else if (confirm && trust == PeerTrust::Trusted)
+			{
+				// A peer that paired before is confirmed without asking again
+				_latency.Record(LatencyPhase::PairDecision, requested);
+				pArgs->Accept();
+			}
+			else if (_PairRequest)
+			{
+				// Hold the ceremony open without holding this thread until someone decides
+				ComPtr<ABI::Windows::Foundation::IDeferral> deferral;
+				HRESULT hr = pArgs->GetDeferral(&deferral);
+				if (FAILED(hr))
+				{
+					return hr;
+				}
+
+				ComPtr<IDevicePairingRequestedEventArgs> args(pArgs);
+
+				PendingDecision decision;
+				decision.kind = DecisionKind::Pairing;
+				decision.deviceId = pairingId;
+				decision.pairingKinds = static_cast<uint32_t>(kinds);
+				decision.pin = pin.GetRawBuffer(NULL);
+
+				_pairings.SetStage(pairingId, PairingStage::AwaitingDecision);
+
+				try
+				{
+					ParkDecision(decision, [this, args, deferral, kinds, requested, pairingId](bool accept, const std::wstring& strPin)
+					{
+						_latency.Record(LatencyPhase::PairDecision, requested);
+						_pairings.SetStage(pairingId, PairingStage::Pairing);
+						if (accept)
+						{
+							if (kinds & ABI::Windows::Devices::Enumeration::DevicePairingKinds::DevicePairingKinds_ConfirmOnly |
+								kinds & ABI::Windows::Devices::Enumeration::DevicePairingKinds::DevicePairingKinds_DisplayPin)
+							{
+								args->Accept();
+							}
+							else if (kinds & ABI::Windows::Devices::Enumeration::DevicePairingKinds::DevicePairingKinds_ProvidePin)
+							{
+								HString pin;
+								pin.Set(strPin.c_str());
+								args->AcceptWithPin(pin.Get());
+							}
+						}
+						deferral->Complete();
+					});
+				}
+				catch (WlanHostedNetworkException& e)
+				{
+					deferral->Complete();
+					_listeners.RaiseException(e);
+					return e.GetErrorCode();
+				}
+
+				_PairRequest->OnPairingDecisionPending(decision);
+			}
+			else if (confirm && _autoAccept)
+			{
+				// Nobody registered to decide, confirm as incoming connections are accepted
+				_latency.Record(LatencyPhase::PairDecision, requested);
+				pArgs->Accept();
+			}
+			else if (confirm)
+			{
+				decline(L": not trusted and nobody registered to decide");
+			}
+			else
+			{
+				decline(L": it asks for a PIN and nobody registered to provide one");
+			}
+
+			return S_OK;
+		}).Get(), &session.requestedToken);
+	if (FAILED(hr))
+	{
+		throw WlanHostedNetworkException("Register PairingRequested handler failed", hr);
+	}
+
+	SetPairingState(deviceId.c_str(), deviceId.length(), PeerPairingState::Pairing);
+	_pairings.SetStage(deviceId, PairingStage::Pairing);
+
+	ComPtr<IAsyncOperation<ABI::Windows::Devices::Enumeration::DevicePairingResult*>> asyncAction;
+	hr = session.customPairing->PairWithProtectionLevelAndSettingsAsync(devicePairingKinds, DevicePairingProtectionLevel::DevicePairingProtectionLevel_Default,
+		spSetting.Get(), &asyncAction);
+	if (FAILED(hr))
+	{
+		ReleasePairingSession(session);
+		throw WlanHostedNetworkException("PairWithProtectionLevelAndSettingsAsync failed", hr);
+	}
+
+	asyncAction.As(&session.operation);
+	uint64_t deadline = WatchOperation(session.operation, GetOperationTimeouts().pairing, [this, pairingId, settled]()
+	{
+		if (settled->exchange(true))
+		{
+			return;
+		}
+
+		SetPairingState(pairingId.c_str(), pairingId.length(), PeerPairingState::Failed);
+		FinishPairing(pairingId, false);
+		ReportPairing(pairingId, false, HRESULT_FROM_WIN32(ERROR_TIMEOUT));
+	});
+
+	CompletePairing(asyncAction, pairingId, ceremonyKinds, settled, deadline, started);
+
+	// Completed already, or cancelled by Reset: nobody else will release the session
+	if (!_pairings.Attach(deviceId, session))
+	{
+		ReleasePairingSession(session);
+	}
+}
+
+AsyncTask WlanHostedNetworkHelper::CompletePairing(ComPtr<IAsyncOperation<DevicePairingResult*>> operation, std::wstring pairingId,
+	std::shared_ptr<std::atomic<uint32_t>> ceremonyKinds, std::shared_ptr<std::atomic<bool>> settled, uint64_t deadline, LatencyRecorder::Clock::time_point started)
+{
+	AsyncCompletion completion = co_await AwaitOperation(operation.Get());
+	CancelDeadline(deadline);
+	if (settled->exchange(true))
+	{
+		// Timed out and already reported
+		co_return;
+	}
+
+	_latency.Record(LatencyPhase::PairTotal, started);
+
+	if (completion.status != AsyncStatus::Completed)
+	{
+		SetPairingState(pairingId.c_str(), pairingId.length(), PeerPairingState::Failed);
+		FinishPairing(pairingId, false);
+
+		_listeners.Raise(ListenerEventKind::LogMessage, std::wstring(L"Device pair, status=") + GetAsyncStatusName(completion.status));
+		_pairCompletions.Complete(pairingId, PairResult(completion.error, completion.error));
+		co_return;
+	}
+
+	ABI::Windows::Devices::Enumeration::DevicePairingResultStatus pairStatus = DevicePairingResultStatus_Failed;
+	ComPtr<IDevicePairingResult> spResult;
+
+	HRESULT hr = operation->GetResults(spResult.GetAddressOf());
+	if (SUCCEEDED(hr))
+	{
+		hr = spResult->get_Status(&pairStatus);
+	}
+
+	bool paired = (pairStatus == ABI::Windows::Devices::Enumeration::DevicePairingResultStatus::DevicePairingResultStatus_Paired);
+
+	SetPairingState(pairingId.c_str(), pairingId.length(), paired ? PeerPairingState::Paired : PeerPairingState::Failed);
+	RecordPairingOutcome(pairingId, ceremonyKinds->load(), pairStatus, paired);
+
+	// Unregisters the handler and lets the next pairing (and admitted connection) start
+	FinishPairing(pairingId, paired);
+
+	ReportPairing(pairingId, paired, pairStatus);
+}
+
+Completion<PairResult> WlanHostedNetworkHelper::Pair(const wchar_t* szDeviceId, std::chrono::milliseconds deadline)
+{
+	size_t deviceIdLength = wcslen(szDeviceId);
+	ComPtr<IDeviceInformation2> deviceInfo = FindDeviceInformation(szDeviceId, deviceIdLength);
+
+	// Registered before the pairing is queued, it may finish before QueuePairing returns
+	CompletionSource<PairResult> paired;
+
+	if (deviceInfo)
+	{
+		Completion<PairResult> completion = TrackCompletion(_pairCompletions, szDeviceId, paired, deadline);
+		QueuePairing(szDeviceId, deviceInfo);
+		return completion;
+	}
+
+	bool cached;
+	{
+		std::lock_guard<std::mutex> lock(_peerLock);
+		cached = (_peerCache.Find(szDeviceId, deviceIdLength) != nullptr);
+	}
+
+	if (!cached)
+	{
+		throw WlanHostedNetworkException("Device has not been discovered, scan first");
+	}
+
+	Completion<PairResult> completion = TrackCompletion(_pairCompletions, szDeviceId, paired, deadline);
+	try
+	{
+		PairCachedDevice(szDeviceId);
+	}
+	catch (WlanHostedNetworkException& e)
+	{
+		// Only this request failed; a pairing of the device already running goes on
+		paired.Complete(PairResult(e.GetErrorCode(), e.GetErrorCode()));
+		throw;
+	}
+	return completion;
+}
+
+void WlanHostedNetworkHelper::PairCachedDevice(const wchar_t* szDeviceId)
+{
+	HRESULT hr = S_OK;
+	ComPtr<IDeviceInformationStatics> deviceInfoStatics;
+
+	hr = _activationCache.GetDeviceInformationStatics(deviceInfoStatics);
+	if (FAILED(hr))
+	{
+		throw WlanHostedNetworkException("GetActivationFactory for IDeviceInformation failed", hr);
+	}
+
+	HString deviceId;
+	deviceId.Set(szDeviceId);
+
+	ComPtr<IAsyncOperation<DeviceInformation*>> asyncAction;
+	hr = deviceInfoStatics->CreateFromIdAsync(deviceId.Get(), &asyncAction);
+	if (FAILED(hr))
+	{
+		throw WlanHostedNetworkException("CreateFromIdAsync for DeviceInformation failed", hr);
+	}
+
+	std::wstring cachedId(szDeviceId);
+
+	// The deadline and the completion handler race to report; only the first one does
+	std::shared_ptr<std::atomic<bool>> settled = std::make_shared<std::atomic<bool>>(false);
+
+	ComPtr<IAsyncInfo> asyncInfo;
+	asyncAction.As(&asyncInfo);
+	uint64_t deadline = WatchOperation(asyncInfo, GetOperationTimeouts().resolve, [this, cachedId, settled]()
+	{
+		if (!settled->exchange(true))
+		{
+			ReportPairing(cachedId, false, HRESULT_FROM_WIN32(ERROR_TIMEOUT));
+		}
+	});
+
+	ResolveCachedDevice(asyncAction, cachedId, settled, deadline);
+}
+
+AsyncTask WlanHostedNetworkHelper::ResolveCachedDevice(ComPtr<IAsyncOperation<DeviceInformation*>> operation, std::wstring cachedId, std::shared_ptr<std::atomic<bool>> settled, uint64_t deadline)
+{
+	AsyncCompletion completion = co_await AwaitOperation(operation.Get());
+	CancelDeadline(deadline);
+	if (settled->exchange(true))
+	{
+		co_return;
+	}
+
+	HRESULT hr = S_OK;
+	ComPtr<IDeviceInformation> deviceInfo;
+	ComPtr<IDeviceInformation2> deviceInfo2;
+
+	try
+	{
+		if (completion.status != AsyncStatus::Completed)
+		{
+			throw WlanHostedNetworkException("Resolve cached device failed", completion.error);
+		}
+
+		hr = operation->GetResults(deviceInfo.GetAddressOf());
+		if (FAILED(hr))
+		{
+			throw WlanHostedNetworkException("Get results for CreateFromIdAsync operation failed", hr);
+		}
+
+		hr = deviceInfo.As(&deviceInfo2);
+		if (FAILED(hr))
+		{
+			throw WlanHostedNetworkException("Get DeviceInformation2 failed", hr);
+		}
+
+		QueuePairing(cachedId.c_str(), deviceInfo2);
+	}
+	catch (WlanHostedNetworkException& e)
+	{
+		ReportPairing(cachedId, false, e.GetErrorCode());
+	}
+}
+
+Completion<OperationResult> WlanHostedNetworkHelper::Unpair(const wchar_t* szDeviceId, std::chrono::milliseconds deadline)
+{
+	size_t deviceIdLength = wcslen(szDeviceId);
+
+	std::wstring unpairedId(szDeviceId, deviceIdLength);
+	CompletionSource<OperationResult> unpaired;
+	Completion<OperationResult> completion = TrackCompletion(_unpairCompletions, unpairedId, unpaired, deadline);
+
+	_events.Post([this, unpairedId]()
+	{
+		ReleaseConnectedDevice(unpairedId.c_str(), unpairedId.length(), false);
+	});
+
+	ComPtr<IDeviceInformation2> deviceInfo = FindDeviceInformation(szDeviceId, deviceIdLength);
+
+	HRESULT hr = HRESULT_FROM_WIN32(ERROR_NOT_FOUND);
+	if (deviceInfo)
+	{
+		ComPtr<IDeviceInformationPairing> devInfoPair;
+		hr = deviceInfo->get_Pairing(&devInfoPair);
+		if (SUCCEEDED(hr))
+		{
+			ComPtr<IDeviceInformationPairing2> devInfoPair2;
+			hr = devInfoPair.As(&devInfoPair2);
+			if (SUCCEEDED(hr))
+			{
+				ComPtr<IAsyncOperation<DeviceUnpairingResult*>> asyncUnpairAction;
+
+				hr = devInfoPair2->UnpairAsync(&asyncUnpairAction);
+				if (SUCCEEDED(hr))
+				{
+					std::shared_ptr<std::atomic<bool>> settled = std::make_shared<std::atomic<bool>>(false);
+
+					ComPtr<IAsyncInfo> asyncInfo;
+					asyncUnpairAction.As(&asyncInfo);
+					uint64_t unpairDeadline = WatchOperation(asyncInfo, GetOperationTimeouts().unpair, [this, unpairedId, settled]()
+					{
+						if (!settled->exchange(true))
+						{
+							_listeners.Raise(ListenerEventKind::AsyncException, L"Unpairing " + unpairedId + L" timed out");
+							_unpairCompletions.Complete(unpairedId, OperationResult(HRESULT_FROM_WIN32(ERROR_TIMEOUT), L"Unpairing timed out"));
+						}
+					});
+
+					CompleteUnpairing(asyncUnpairAction, unpairedId, settled, unpairDeadline);
+					return completion;
+				}
+			}
+		}
+	}
+
+	unpaired.Complete(OperationResult(hr));
+	return completion;
+}
+
+AsyncTask WlanHostedNetworkHelper::CompleteUnpairing(ComPtr<IAsyncOperation<DeviceUnpairingResult*>> operation, std::wstring unpairedId, std::shared_ptr<std::atomic<bool>> settled, uint64_t deadline)
+{
+	AsyncCompletion completion = co_await AwaitOperation(operation.Get());
+	CancelDeadline(deadline);
+	if (settled->exchange(true))
+	{
+		co_return;
+	}
+
+	if (completion.status == AsyncStatus::Completed)
+	{
+		SetPairingState(unpairedId.c_str(), unpairedId.length(), PeerPairingState::Unpaired);
+
+		_listeners.Raise(ListenerEventKind::DeviceUnpaired, L"Device Unpair successfully", S_OK, FindPeerHandle(unpairedId.c_str(), unpairedId.length()));
+		_unpairCompletions.Complete(unpairedId, OperationResult(S_OK, L"Device Unpair successfully"));
+	}
+	else
+	{
+		std::wstring message = std::wstring(L"Device Unpair, status=") + GetAsyncStatusName(completion.status);
+		_listeners.Raise(ListenerEventKind::LogMessage, message);
+		_unpairCompletions.Complete(unpairedId, OperationResult(completion.error, message));
+	}
+}
+
+ComPtr<IAsyncInfo> WlanHostedNetworkHelper::ConnectDeviceInternal(HSTRING targetDeviceId, std::function<void(HRESULT)> completed, std::chrono::milliseconds timeout)
+{
+	LatencyRecorder::Clock::time_point started = LatencyRecorder::Clock::now();
+	HRESULT hr = S_OK;
+	ComPtr<IWiFiDirectDeviceStatics2> wfdStatics;
+
+	hr = _activationCache.GetWiFiDirectDeviceStatics(wfdStatics);
+	if (FAILED(hr))
+	{
+		throw WlanHostedNetworkException("GetActivationFactory for WiFiDirectDevice failed", hr);
+	}
+
+	HString devId;
+	devId.Set(targetDeviceId);
+
+	UINT32 devIdLength;
+	const wchar_t* rawDevId = devId.GetRawBuffer(&devIdLength);
+
+	ComPtr<IDeviceInformation2> deviceInfo = FindDeviceInformation(rawDevId, devIdLength);
+
+	if (deviceInfo)
+	{
+		ComPtr<IDeviceInformationPairing> devInfoPair;
+		hr = deviceInfo->get_Pairing(&devInfoPair);
+		if (SUCCEEDED(hr))
+		{
+			boolean bCanPair = false;
+			boolean isPaired = false;
+			hr = devInfoPair->get_IsPaired(&isPaired);
+			hr = devInfoPair->get_CanPair(&bCanPair);
+			if (isPaired)
+			{
+				if (completed)
+				{
+					completed(S_FALSE);
+				}
+				return nullptr;
+			}			
+		}
+	}
+
+	ComPtr<IWiFiDirectConnectionParameters> param;
+	hr = _activationCache.GetConnectionParameters(DefaultGroupOwnerIntent, DefaultPairingProcedure, param);
+	if (FAILED(hr))
+	{
+		throw WlanHostedNetworkException("ActivateInstance IWiFiDirectConnectionParameters failed", hr);
+	}
+
+	ComPtr<IAsyncOperation<WiFiDirectDevice*>> asyncAction;
+	LatencyRecorder::Clock::time_point issued = LatencyRecorder::Clock::now();
+	hr = wfdStatics->FromIdAsync(targetDeviceId, param.Get(), &asyncAction);
+	if (FAILED(hr))
+	{
+		throw WlanHostedNetworkException("From ID Async for WiFiDirectDevice failed", hr);
+	}
+	_latency.Record(LatencyPhase::ConnectIssue, issued);
+
+	ComPtr<IAsyncInfo> asyncInfo;
+	asyncAction.As(&asyncInfo);
+
+	// The deadline and the completion handler race to report; only the first one gets through
+	std::shared_ptr<std::atomic<bool>> reported = std::make_shared<std::atomic<bool>>(false);
+	std::function<void(HRESULT)> report = [completed, reported](HRESULT result)
+	{
+		if (completed && !reported->exchange(true))
+		{
+			completed(result);
+		}
+	};
+
+	std::wstring targetId(rawDevId, devIdLength);
+	uint64_t deadline = WatchOperation(asyncInfo, (timeout.count() != 0) ? timeout : GetOperationTimeouts().connect, [this, completed, report, targetId]()
+	{
+		if (completed)
+		{
+			report(HRESULT_FROM_WIN32(ERROR_TIMEOUT));
+		}
+		else
+		{
+			_listeners.Raise(ListenerEventKind::AsyncException, L"Connecting to " + targetId + L" timed out");
+		}
+	});
+
+	CompleteConnection(asyncAction, report, deadline, started, issued);
+
+	return asyncInfo;
+}
+
+AsyncTask WlanHostedNetworkHelper::CompleteConnection(ComPtr<IAsyncOperation<WiFiDirectDevice*>> operation, std::function<void(HRESULT)> report, uint64_t deadline,
+	LatencyRecorder::Clock::time_point started, LatencyRecorder::Clock::time_point issued)
+{
+	AsyncCompletion completion = co_await AwaitOperation(operation.Get());
+	CancelDeadline(deadline);
+
+	LatencyRecorder::Clock::time_point phase = _latency.Record(LatencyPhase::ConnectCompletion, issued);
+	HRESULT hr = S_OK;
+	ComPtr<IWiFiDirectDevice> wfdDevice;
+	ComPtr<EndpointPairCollection> endpointPairs;
+	ComPtr<IEndpointPair> endpointPair;
+	ComPtr<IHostName> remoteHostName;
+	HString remoteHostNameDisplay;
+	HString deviceId;
+
+	try
+	{
+		if (completion.status == AsyncStatus::Completed)
+		{
+			// Get the WiFiDirectDevice object
+			hr = operation->GetResults(wfdDevice.GetAddressOf());
+			if (FAILED(hr))
+			{
+				throw WlanHostedNetworkException("Get results for FromIDAsync operation failed", hr);
+			}
+
+			// Now retrieve the endpoint pairs, which includes the IP address assigned to the peer
+			hr = wfdDevice->GetConnectionEndpointPairs(endpointPairs.GetAddressOf());
+			if (FAILED(hr))
+			{
+				throw WlanHostedNetworkException("Get EndpointPairs for WiFiDirectDevice failed", hr);
+			}
+
+			hr = endpointPairs->GetAt(0, endpointPair.GetAddressOf());
+			if (FAILED(hr))
+			{
+				throw WlanHostedNetworkException("Get first EndpointPair in collection failed", hr);
+			}
+			phase = _latency.Record(LatencyPhase::ConnectEndpoints, phase);
+
+			hr = endpointPair->get_RemoteHostName(remoteHostName.GetAddressOf());
+			if (FAILED(hr))
+			{
+				throw WlanHostedNetworkException("Get Remote HostName for EndpointPair failed", hr);
+			}
+
+			hr = remoteHostName->get_DisplayName(remoteHostNameDisplay.GetAddressOf());
+			if (FAILED(hr))
+			{
+				throw WlanHostedNetworkException("Get Display Name for Remote HostName failed", hr);
+			}
+			phase = _latency.Record(LatencyPhase::ConnectHostName, phase);
+
+			// Add handler for connection status changed
+			EventRegistrationToken statusChangedToken;
+			hr = wfdDevice->add_ConnectionStatusChanged(Callback<ConnectionStatusChangedHandler>([this](IWiFiDirectDevice* sender, IInspectable*) -> HRESULT
+			{
+				WiFiDirectConnectionStatus status;
+				HString deviceId;
+				HRESULT hr = S_OK;
+
+				try
+				{
+					hr = sender->get_ConnectionStatus(&status);
+					if (FAILED(hr))
+					{
+						throw WlanHostedNetworkException("Get connection status for peer failed", hr);
+					}
+
+					switch (status)
+					{
+					case WiFiDirectConnectionStatus_Connected:
+						// NO-OP
+						break;
+					case WiFiDirectConnectionStatus_Disconnected:
+						// Clean-up state
+						hr = sender->get_DeviceId(deviceId.GetAddressOf());
+						if (FAILED(hr))
+						{
+							throw WlanHostedNetworkException("Get Device ID failed", hr);
+						}
+
+						std::wstring disconnectedId(deviceId.GetRawBuffer(nullptr));
+
+						_events.Post([this, disconnectedId]()
+						{
+							// Releasing the device may forget the peer, look it up first
+							PeerHandle peer = FindPeerHandle(disconnectedId.c_str(), disconnectedId.length());
+
+							// Already gone if Disconnect or Unpair got to it first
+							if (!ReleaseConnectedDevice(disconnectedId.c_str(), disconnectedId.length(), false))
+							{
+								return;
+							}
+
+							// Notify listener of disconnect
+							_listeners.Raise(ListenerEventKind::DeviceDisconnected, disconnectedId, S_OK, peer);
+
+							ScheduleReconnect(disconnectedId.c_str());
+						});
+
+						break;
+					}
+				}
+				catch (WlanHostedNetworkException& e)
+				{
+					_listeners.RaiseException(e);
+					return e.GetErrorCode();
+				}
+
+				return hr;
+			}).Get(), &statusChangedToken);
+			_latency.Record(LatencyPhase::ConnectStatusHandler, phase);
+
+			// Store the connected peer
+			hr = wfdDevice->get_DeviceId(deviceId.GetAddressOf());
+			if (FAILED(hr))
+			{
+				throw WlanHostedNetworkException("Get Device ID failed", hr);
+			}
+
+			UINT32 deviceIdLength;
+			const wchar_t* rawDeviceId = deviceId.GetRawBuffer(&deviceIdLength);
+
+			// A repeated connect replaces the previous device object and its handler
+			ReleaseConnectedDevice(rawDeviceId, deviceIdLength, false);
+
+			PeerHandle connectedPeer;
+			{
+				std::lock_guard<std::mutex> lock(_peerLock);
+
+				connectedPeer = _peers.Intern(rawDeviceId, deviceIdLength);
+				PeerState* peer = _peers.Get(connectedPeer);
+				peer->device = wfdDevice;
+				peer->statusChangedToken = statusChangedToken;
+				RefreshPeerEntry(rawDeviceId, deviceIdLength);
+				PublishPeerSnapshot();
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(_reconnectLock);
+				_reconnects.OnConnected(std::wstring(rawDeviceId, deviceIdLength), ReconnectScheduler::Clock::now());
+			}
+
+			_latency.Record(LatencyPhase::ConnectTotal, started);
+
+			// Notify Listener
+			UINT32 hostNameLength;
+			const wchar_t* rawHostName = remoteHostNameDisplay.GetRawBuffer(&hostNameLength);
+			_listeners.Raise(ListenerEventKind::DeviceConnected, std::wstring_view(rawHostName, hostNameLength), S_OK, connectedPeer);
+
+			ReportFirstConnection();
+
+			report(S_OK);
+		}
+		else
+		{
+			_listeners.Raise(ListenerEventKind::LogMessage, std::wstring(L"Device connected, status=") + GetAsyncStatusName(completion.status));
+			report(completion.error);
+		}
+	}
+	catch (WlanHostedNetworkException& e)
+	{
+		_listeners.RaiseException(e);
+
+		report(e.GetErrorCode());
+	}
+}
+
+void WlanHostedNetworkHelper::StartListener()
+{
+    HRESULT hr = S_OK;
+
+    // Create WiFiDirectConnectionListener
+    hr = Windows::Foundation::ActivateInstance(HStringReference(RuntimeClass_Windows_Devices_WiFiDirect_WiFiDirectConnectionListener).Get(), &_connectionListener);
+    if (FAILED(hr))
+    {
+        throw WlanHostedNetworkException("ActivateInstance for WiFiDirectConnectionListener failed", hr);
+    }
+
+    hr = _connectionListener->add_ConnectionRequested(
+        Callback<ConnectionRequestedHandler>([this](IWiFiDirectConnectionListener* sender, IWiFiDirectConnectionRequestedEventArgs* args) -> HRESULT
+    {
+        HRESULT hr = S_OK;
+        ComPtr<IWiFiDirectConnectionRequest> request;
+        LatencyRecorder::Clock::time_point received = LatencyRecorder::Clock::now();
+
+        _listeners.Raise(ListenerEventKind::LogMessage, L"Connection Requested...");
+
+        try
+        {
+            hr = args->GetConnectionRequest(request.GetAddressOf());
+            if (FAILED(hr))
+            {
+                throw WlanHostedNetworkException("Get connection request for ConnectionRequestedEventArgs failed", hr);
+            }
+
+            HString deviceId;
+            ComPtr<IDeviceInformation> deviceInformation;
+
+            hr = request->get_DeviceInformation(deviceInformation.GetAddressOf());
+            if (FAILED(hr))
+            {
+                throw WlanHostedNetworkException("Get device information for ConnectionRequest failed", hr);
+            }
+
+            hr = deviceInformation->get_Id(deviceId.GetAddressOf());
+            if (FAILED(hr))
+            {
+                throw WlanHostedNetworkException("Get ID for DeviceInformation failed", hr);
+            }
+
+            // Known peers are decided here, before any pairing or prompt work
+            std::wstring requestingId(deviceId.GetRawBuffer(NULL));
+            PeerTrust trust = LookupTrust(requestingId);
+            if (trust == PeerTrust::Banned)
+            {
+                _listeners.Raise(ListenerEventKind::LogMessage, L"Rejected banned peer " + requestingId);
+                return hr;
+            }
+
+            if (_autoAccept || trust == PeerTrust::Trusted)
+            {
+                PendingConnection connection;
+                connection.deviceId = requestingId;
+                connection.deviceInformation = deviceInformation;
+                connection.request = request;
+                connection.trusted = (trust == PeerTrust::Trusted);
+                _latency.Record(connection.trusted ? LatencyPhase::RequestTrusted : LatencyPhase::RequestDecided, received);
+                AdmitConnection(connection);
+                return hr;
+            }
+
+            // Park the request, the prompt answers through ResolveDecision
+            PendingDecision decision;
+            decision.kind = DecisionKind::Connection;
+            decision.deviceId = deviceId.GetRawBuffer(NULL);
+            decision.pairingKinds = 0;
+
+            // The request is held until decided so the peer keeps waiting rather than being dropped
+            PendingConnection connection;
+            connection.deviceId = decision.deviceId;
+            connection.deviceInformation = deviceInformation;
+            connection.request = request;
+            connection.trusted = false;
+
+            ParkDecision(decision, [this, connection, received](bool accept, const std::wstring&)
+            {
+                try
+                {
+                    if (accept)
+                    {
+                        _latency.Record(LatencyPhase::RequestDecided, received);
+                        AdmitConnection(connection);
+                    }
+                    else
+                    {
+                        _listeners.Raise(ListenerEventKind::LogMessage, L"Declined");
+                    }
+                }
+                catch (WlanHostedNetworkException& e)
+                {
+                    _listeners.RaiseException(e);
+                }
+            });
+
+            if (_prompt != nullptr)
+            {
+                _prompt->OnConnectionDecisionPending(decision);
+            }
+        }
+        catch (WlanHostedNetworkException& e)
+        {
+            _listeners.RaiseException(e);
+            return e.GetErrorCode();
+        }
+
+        return hr;
+    }).Get(), &_connectionRequestedToken);
+    if (FAILED(hr))
+    {
+        throw WlanHostedNetworkException("Add ConnectionRequested handler for WiFiDirectConnectionListener failed", hr);
+    }
+
+    _listeners.Raise(ListenerEventKind::LogMessage, L"Connection Listener is ready");
+}
+
+void WlanHostedNetworkHelper::AdmitConnection(const PendingConnection& connection)
+{
+	// Trusted peers and peers seen in earlier runs get ahead of strangers when the queue backs up
+	bool known = connection.trusted;
+	if (!known)
+	{
+		std::lock_guard<std::mutex> lock(_peerLock);
+		known = (_peerCache.Find(connection.deviceId.c_str(), connection.deviceId.length()) != nullptr);
+	}
+
+	AdmissionOutcome outcome;
+	std::vector<PendingConnection> evicted;
+	{
+		std::lock_guard<std::mutex> lock(_admissionLock);
+
+		if (_admissionTimer == nullptr)
+		{
+			_admissionTimer = CreateThreadpoolTimer(AdmissionTimerCallback, this, nullptr);
+			if (_admissionTimer == nullptr)
+			{
+				throw WlanHostedNetworkException("CreateThreadpoolTimer for admission failed", HRESULT_FROM_WIN32(GetLastError()));
+			}
+		}
+
+		outcome = _admission.Offer(connection, known, AdmissionController<PendingConnection>::Clock::now(), evicted);
+
+		if (outcome == AdmissionOutcome::Deferred && !_admissionTimerArmed)
+		{
+			// Tokens refill continuously, look for admissible connections every 100 ms while any wait
+			ULARGE_INTEGER relative;
+			relative.QuadPart = static_cast<ULONGLONG>(-100LL * 10000);
+
+			FILETIME dueTime;
+			dueTime.dwLowDateTime = relative.LowPart;
+			dueTime.dwHighDateTime = relative.HighPart;
+			SetThreadpoolTimer(_admissionTimer, &dueTime, 100, 0);
+			_admissionTimerArmed = true;
+		}
+	}
+
+	switch (outcome)
+	{
+	case AdmissionOutcome::Admitted:
+		StartAdmittedConnections(std::vector<PendingConnection>(1, connection));
+		break;
+	case AdmissionOutcome::Deferred:
+		_listeners.Raise(ListenerEventKind::LogMessage, L"Connection from " + connection.deviceId + L" queued");
+		break;
+	case AdmissionOutcome::Rejected:
+		_listeners.Raise(ListenerEventKind::LogMessage, L"Connection from " + connection.deviceId + L" rejected, too many pending");
+		break;
+	}
+
+	// Dropping the request turns the peer away, as for a rejected one
+	for (auto& rejected : evicted)
+	{
+		_listeners.Raise(ListenerEventKind::LogMessage, L"Connection from " + rejected.deviceId + L" rejected, made way for a known peer");
+	}
+}
+
+void WlanHostedNetworkHelper::StartAdmittedConnections(const std::vector<PendingConnection>& connections)
+{
+	for (auto& connection : connections)
+	{
+		// Frees the admission slot when the last reference goes, however pairing ends
+		AdmissionController<PendingConnection>::Clock::time_point started = AdmissionController<PendingConnection>::Clock::now();
+		std::shared_ptr<void> slot(nullptr, [this, started](void*)
+		{
+			std::vector<PendingConnection> admitted;
+			{
+				std::lock_guard<std::mutex> lock(_admissionLock);
+
+				auto now = AdmissionController<PendingConnection>::Clock::now();
+				_admission.OnCompleted(now - started);
+				admitted = _admission.TakeAdmitted(now);
+			}
+
+			StartAdmittedConnections(admitted);
+		});
+
+		try
+		{
+			AcceptConnection(connection.deviceId.c_str(), connection.deviceInformation.Get(), std::move(slot));
+		}
+		catch (WlanHostedNetworkException& e)
+		{
+			_listeners.RaiseException(e);
+		}
+	}
+}
+
+VOID CALLBACK WlanHostedNetworkHelper::AdmissionTimerCallback(PTP_CALLBACK_INSTANCE instance, PVOID context, PTP_TIMER timer)
+{
+	WlanHostedNetworkHelper* helper = static_cast<WlanHostedNetworkHelper*>(context);
+
+	std::vector<PendingConnection> admitted;
+	{
+		std::lock_guard<std::mutex> lock(helper->_admissionLock);
+
+		admitted = helper->_admission.TakeAdmitted(AdmissionController<PendingConnection>::Clock::now());
+		if (!helper->_admission.HasQueued())
+		{
+			SetThreadpoolTimer(timer, nullptr, 0, 0);
+			helper->_admissionTimerArmed = false;
+		}
+	}
+
+	helper->StartAdmittedConnections(admitted);
+}
+
+void WlanHostedNetworkHelper::AcceptConnection(const wchar_t* deviceId, IDeviceInformation* deviceInformation, std::shared_ptr<void> slot)
+{
+#if 0 
+	HString id;
+	id.Set(deviceId);
+	this->ConnectDeviceInternal(id.Get());
+#else
+	ComPtr<IDeviceInformation2> info2;
+	HRESULT hr = deviceInformation->QueryInterface(IID_PPV_ARGS(&info2));
+	if (FAILED(hr))
+	{
+		throw WlanHostedNetworkException("Get DeviceInformation2 failed", hr);
+	}
+
+	QueuePairing(deviceId, info2, std::move(slot));
+#endif
+}
+
+void WlanHostedNetworkHelper::Reset()
+{
+	if (_deviceWatcher)
+	{
+		_deviceWatcher->remove_Added(_DeviceAddToken);
+		_deviceWatcher->remove_Removed(_DeviceRemoveToken);
+		_deviceWatcher->remove_Updated(_DeviceUpdatedToken);
+		_deviceWatcher->remove_Stopped(_EnumerationStopToken);
+		_deviceWatcher->remove_EnumerationCompleted(_EnumerationCompletedToken);
+	}
+	CancelDeadline(_enumerationDeadline.exchange(TimerWheel<std::function<void()>>::InvalidHandle));
+
+	// Let watcher events already queued land before the table is cleared
+	_events.Flush();
+
+	// Nobody is left to act on an answer
+	_decisions.DeclineAll();
+
+	// Connections waiting for admission are turned away, or the slots the cancelled pairings
+	// free would start them
+	std::vector<PendingConnection> turnedAway;
+	{
+		std::lock_guard<std::mutex> lock(_admissionLock);
+
+		turnedAway = _admission.Clear();
+		if (_admissionTimerArmed)
+		{
+			SetThreadpoolTimer(_admissionTimer, nullptr, 0, 0);
+			_admissionTimerArmed = false;
+		}
+	}
+	for (auto& connection : turnedAway)
+	{
+		_listeners.Raise(ListenerEventKind::LogMessage, L"Connection from " + connection.deviceId + L" rejected, resetting");
+	}
+	turnedAway.clear();
+
+	// Pairings still running are abandoned; their completions find nothing left to finish
+	std::vector<PairingSession> pairings = _pairings.CancelAll();
+	for (auto& session : pairings)
+	{
+		ReleasePairingSession(session);
+		if (session.operation)
+		{
+			session.operation->Cancel();
+		}
+	}
+
+	// Nor will the handlers that would have completed these
+	_startCompletions.CompleteAll(OperationResult(E_ABORT, L"Reset"));
+	_stopCompletions.CompleteAll(OperationResult(E_ABORT, L"Reset"));
+	_scanCompletions.CompleteAll(ScanResult(E_ABORT, L"Reset"));
+	_pairCompletions.CompleteAll(PairResult(E_ABORT, E_ABORT));
+
+    if (_connectionListener.Get() != nullptr)
+    {
+        _connectionListener->remove_ConnectionRequested(_connectionRequestedToken);
+    }
+
+    if (_publisher.Get() != nullptr)
+    {
+        _publisher->remove_StatusChanged(_statusChangedToken);
+    }
+
+	_deviceWatcher.Reset();
+    _legacySettings.Reset();
+    _advertisement.Reset();
+    _publisher.Reset();
+    _connectionListener.Reset();
+
+	{
+		std::lock_guard<std::mutex> lock(_peerLock);
+
+		_peers.ForEach([](PeerHandle handle, PeerState& peer)
+		{
+			if (peer.device)
+			{
+				peer.device->remove_ConnectionStatusChanged(peer.statusChangedToken);
+				peer.device.Reset();
+			}
+			peer.deviceInfo.Reset();
+		});
+		_peerTracker.Clear();
+	}
+	PublishPeerChanges();
+
+	// Peers that were only connected never show up in a delta, drop whatever is left
+	{
+		std::lock_guard<std::mutex> lock(_peerLock);
+		_peers.Clear();
+		_peerTable.peers.clear();
+		_peerTableChanged = true;
+		PublishPeerSnapshot();
+	}
+}
+
+void WlanHostedNetworkHelper::SetPeerBatching(DWORD windowMs, size_t maxChanges)
+{
+	if (windowMs != 0 && _peerBatchTimer == nullptr)
+	{
+		_peerBatchTimer = CreateThreadpoolTimer(PeerBatchTimerCallback, this, nullptr);
+		if (_peerBatchTimer == nullptr)
+		{
+			throw WlanHostedNetworkException("CreateThreadpoolTimer for peer batching failed", HRESULT_FROM_WIN32(GetLastError()));
+		}
+	}
+
+	_peerBatchSize = (maxChanges != 0) ? maxChanges : SIZE_MAX;
+	_peerBatchWindow = windowMs;
+
+	// Don't leave changes collected under the old settings waiting
+	PublishPeerChanges();
+}
+
+void WlanHostedNetworkHelper::OnEventBatch()
+{
+	// One delta per burst of watcher events instead of one per event
+	if (_peerEventsPending)
+	{
+		_peerEventsPending = false;
+		QueuePeerChanges();
+	}
+}
+
+void WlanHostedNetworkHelper::QueuePeerChanges()
+{
+	DWORD window = _peerBatchWindow;
+	if (window == 0)
+	{
+		PublishPeerChanges();
+		return;
+	}
+
+	bool full;
+	{
+		std::lock_guard<std::mutex> lock(_peerLock);
+		full = (_peerTracker.GetPendingCount() >= _peerBatchSize);
+	}
+
+	if (full)
+	{
+		PublishPeerChanges();
+		return;
+	}
+
+	// The first change of a batch starts the window, later ones ride along
+	if (!_peerBatchArmed.exchange(true))
+	{
+		ULARGE_INTEGER relative;
+		relative.QuadPart = static_cast<ULONGLONG>(-static_cast<LONGLONG>(window) * 10000);
+
+		FILETIME dueTime;
+		dueTime.dwLowDateTime = relative.LowPart;
+		dueTime.dwHighDateTime = relative.HighPart;
+		SetThreadpoolTimer(_peerBatchTimer, &dueTime, 0, 0);
+	}
+}
+
+VOID CALLBACK WlanHostedNetworkHelper::PeerBatchTimerCallback(PTP_CALLBACK_INSTANCE instance, PVOID context, PTP_TIMER timer)
+{
+	WlanHostedNetworkHelper* helper = static_cast<WlanHostedNetworkHelper*>(context);
+
+	// Clear first, a change queued from here on arms a new window or lands in this delta
+	helper->_peerBatchArmed = false;
+	helper->PublishPeerChanges();
+}
+
+void WlanHostedNetworkHelper::PublishPeerChanges()
+{
+	std::lock_guard<std::mutex> dispatchLock(_peerDispatchLock);
+	PeerDelta delta;
+
+	{
+		std::lock_guard<std::mutex> lock(_peerLock);
+		if (!_peerTracker.TakeDelta(delta))
+		{
+			// Watcher events that left the delta empty may still have changed what a peer advertises
+			PublishPeerSnapshot();
+			return;
+		}
+
+		// Peers swept at the end of a rescan never got a Removed event, drop their device information too
+		for (auto& change : delta.changes)
+		{
+			PeerState* peer = _peers.Get(change.handle);
+			if (peer != nullptr && change.kind == PeerChangeKind::Removed)
+			{
+				peer->deviceInfo.Reset();
+			}
+
+			// Sweeps and Clear change peers without a watcher event of their own
+			RefreshPeerEntry(change.id.c_str(), change.id.length());
+		}
+
+		// Readers see the generation listeners are about to be told about
+		_peerTableChanged = true;
+		PublishPeerSnapshot();
+	}
+
+	_listeners.RaisePeersChanged(delta);
+}
+
+void WlanHostedNetworkHelper::RefreshPeerEntry(const wchar_t* deviceId, size_t length)
+{
+	size_t position = _peerTable.LowerBound(deviceId, length);
+	bool found = (position != _peerTable.peers.size() &&
+		_peerTable.peers[position]->id.compare(0, std::wstring::npos, deviceId, length) == 0);
+
+	PeerHandle handle = _peers.Find(deviceId, length);
+	const PeerState* peer = _peers.Get(handle);
+	if (peer == nullptr || peer->IsIdle())
+	{
+		// Idle peers are on their way out of the registry, readers never see them
+		if (found)
+		{
+			_peerTable.peers.erase(_peerTable.peers.begin() + position);
+			_peerTableChanged = true;
+		}
+		return;
+	}
+
+	std::shared_ptr<PeerSnapshotEntry> entry = std::make_shared<PeerSnapshotEntry>();
+	entry->handle = handle;
+	_peers.GetId(handle)->CopyTo(entry->id);
+	peer->discovery.name.CopyTo(entry->name);
+	entry->discovered = peer->discovery.present;
+	entry->connected = (peer->device != nullptr);
+	entry->pairing = peer->pairing;
+	entry->elements = peer->elements;
+
+	if (found)
+	{
+		_peerTable.peers[position] = std::move(entry);
+	}
+	else
+	{
+		_peerTable.peers.insert(_peerTable.peers.begin() + position, std::move(entry));
+	}
+	_peerTableChanged = true;
+}
+
+void WlanHostedNetworkHelper::PublishPeerSnapshot()
+{
+	if (!_peerTableChanged)
+	{
+		return;
+	}
+	_peerTableChanged = false;
+
+	// Copies pointers only, every entry is shared with _peerTable until its peer changes again
+	std::unique_ptr<PeerSnapshot> snapshot(new PeerSnapshot(_peerTable));
+	snapshot->generation = _peerTracker.GetGeneration();
+	_peerSnapshot.Publish(std::move(snapshot));
+}
+
+void WlanHostedNetworkHelper::ReadPeerElements(IDeviceInformation* deviceInfo, PeerElements& elements) const
+{
+	ComPtr<IMapView<HSTRING, IInspectable*>> properties;
+	HRESULT hr = deviceInfo->get_Properties(&properties);
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	ComPtr<IInspectable> value;
+	hr = properties->Lookup(HStringReference(InformationElementsProperty).Get(), &value);
+	if (FAILED(hr) || !value)
+	{
+		return;
+	}
+
+	ComPtr<IPropertyValue> propertyValue;
+	hr = value.As(&propertyValue);
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	UINT32 length = 0;
+	BYTE* buffer = nullptr;
+	hr = propertyValue->GetUInt8Array(&length, &buffer);
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	// Everything below reads the buffer in place; only the vendor payload we keep is copied
+	elements.hasDeviceType = FindPrimaryDeviceType(buffer, length, elements.deviceCategory, elements.deviceSubCategory);
+
+	uint32_t vendorElement = _vendorElement;
+	InformationElement element;
+	if (vendorElement != 0 && FindVendorElement(buffer, length, vendorElement >> 8, static_cast<uint8_t>(vendorElement), element))
+	{
+		elements.hasVendorElement = true;
+		elements.vendorPayload.assign(element.GetVendorPayload(), element.GetVendorPayload() + element.GetVendorPayloadLength());
+	}
+
+	CoTaskMemFree(buffer);
+}
+
+Completion<ScanResult> WlanHostedNetworkHelper::Scan(std::chrono::milliseconds deadline)
+{
+	CompletionSource<ScanResult> scanned;
+	Completion<ScanResult> completion = TrackCompletion(_scanCompletions, L"", scanned, deadline);
+
+	try
+	{
+		HRESULT hr = S_OK;
+		if (_deviceWatcher.Get() == nullptr)
+		{
+			ComPtr<IDeviceInformationStatics> deviceInfoStatics;
+			ComPtr<IWiFiDirectDeviceStatics2> wfdStatics;
+			HString deviceSelector;
+
+			hr = _activationCache.GetWiFiDirectDeviceStatics(wfdStatics);
+			if (FAILED(hr))
+			{
+				throw WlanHostedNetworkException("GetActivationFactory for IWiFiDirectDeviceStatics2 failed", hr);
+			}
+
+			hr = wfdStatics->GetDeviceSelector(ABI::Windows::Devices::WiFiDirect::WiFiDirectDeviceSelectorType::WiFiDirectDeviceSelectorType_AssociationEndpoint, deviceSelector.GetAddressOf());
+			if (FAILED(hr))
+			{
+				throw WlanHostedNetworkException("GetDeviceSelector for WiFiDirectDevice failed", hr);
+			}
+
+			hr = _activationCache.GetDeviceInformationStatics(deviceInfoStatics);
+			if (FAILED(hr))
+			{
+				throw WlanHostedNetworkException("GetActivationFactory for IDeviceInformation failed", hr);
+			}
+
+			// Request the information elements with every peer so picking one needs no query per device
+			const wchar_t* requestedProperties[] = { InformationElementsProperty };
+			ComPtr<IIterable<HSTRING>> additionalProperties = Make<HStringIterable>(requestedProperties, _countof(requestedProperties));
+			if (!additionalProperties)
+			{
+				throw WlanHostedNetworkException("Create requested properties failed", E_OUTOFMEMORY);
+			}
+
+			hr = deviceInfoStatics->CreateWatcherAqsFilterAndAdditionalProperties(deviceSelector.Get(), additionalProperties.Get(), &_deviceWatcher);
+			if (FAILED(hr))
+			{
+				throw WlanHostedNetworkException("CreateWatcherAqsFilterAndAdditionalProperties failed", hr);
+			}
+
+			_deviceWatcher->add_Added(Callback<DeviceAddHandler>([this](IDeviceWatcher* sender, IDeviceInformation* deviceInfo) -> HRESULT
+			{
+				//Add device
+				HString id;
+				HString name;
+
+				deviceInfo->get_Id(id.GetAddressOf());
+				deviceInfo->get_Name(name.GetAddressOf());
+
+				ComPtr<IDeviceInformation2> info;
+				HRESULT hr = deviceInfo->QueryInterface(IID_PPV_ARGS(&info));
+
+				if (FAILED(hr))
+				{
+					WFD_LOG_WARNING("Can't get IDeviceInformation2: %08x", hr);
+				}
+
+				std::wstring addedId(id.GetRawBuffer(nullptr));
+				std::wstring addedName(name.GetRawBuffer(nullptr));
+
+				PeerElements elements;
+				ReadPeerElements(deviceInfo, elements);
+
+				_events.Post([this, addedId, addedName, info, elements]()
+				{
+					std::lock_guard<std::mutex> lock(_peerLock);
+
+					bool changed = _peerTracker.OnAdded(addedId.c_str(), addedId.length(), addedName.c_str());
+					_peerCache.Touch(addedId.c_str(), addedId.length(), addedName.c_str());
+
+					// A rescan hands out a fresh object for a known peer, keep the newest one
+					PeerState* peer = _peers.Get(_peers.Find(addedId.c_str(), addedId.length()));
+					if (peer != nullptr)
+					{
+						if (info)
+						{
+							peer->deviceInfo = info;
+						}
+						if (!(peer->elements == elements))
+						{
+							peer->elements = elements;
+							changed = true;
+						}
+					}
+
+					// A rescan re-reporting a peer unchanged leaves its snapshot entry alone
+					if (changed)
+					{
+						RefreshPeerEntry(addedId.c_str(), addedId.length());
+					}
+
+					_peerEventsPending = true;
+				});
+
+				return S_OK;
+			}).Get(), &_DeviceAddToken);
+
+			_deviceWatcher->add_Removed(Callback<DeviceRemovedHandler>([this](IDeviceWatcher* sender, IDeviceInformationUpdate* deviceInfoUpdate) -> HRESULT
+			{
+				//remove device
+				HString id;
+				deviceInfoUpdate->get_Id(id.GetAddressOf());
+
+				std::wstring removedId(id.GetRawBuffer(nullptr));
+
+				_events.Post([this, removedId]()
+				{
+					std::lock_guard<std::mutex> lock(_peerLock);
+
+					PeerState* peer = _peers.Get(_peers.Find(removedId.c_str(), removedId.length()));
+					if (peer != nullptr)
+					{
+						peer->deviceInfo.Reset();
+						peer->elements = PeerElements();
+					}
+
+					_peerTracker.OnRemoved(removedId.c_str(), removedId.length());
+					RefreshPeerEntry(removedId.c_str(), removedId.length());
+					_peerEventsPending = true;
+				});
+
+				return S_OK;
+			}).Get(), &_DeviceRemoveToken);
+
+			_deviceWatcher->add_Updated(Callback<DeviceRemovedHandler>([this](IDeviceWatcher* sender, IDeviceInformationUpdate* deviceInfoUpdate) -> HRESULT
+			{
+				//Update device
+				HString id;
+				deviceInfoUpdate->get_Id(id.GetAddressOf());
+
+				std::wstring updatedId(id.GetRawBuffer(nullptr));
+				ComPtr<IDeviceInformationUpdate> update(deviceInfoUpdate);
+
+				_events.Post([this, updatedId, update]()
+				{
+					const wchar_t* rawId = updatedId.c_str();
+					size_t idLength = updatedId.length();
+
+					std::lock_guard<std::mutex> lock(_peerLock);
+
+					PeerState* peer = _peers.Get(_peers.Find(rawId, idLength));
+					if (peer != nullptr && peer->deviceInfo)
+					{
+						// Apply the new properties to the stored object and report the peer as changed
+						ComPtr<IDeviceInformation> info;
+						HRESULT hr = peer->deviceInfo.As(&info);
+						if (SUCCEEDED(hr))
+						{
+							hr = info->Update(update.Get());
+						}
+
+						if (SUCCEEDED(hr))
+						{
+							HString name;
+							info->get_Name(name.GetAddressOf());
+
+							PeerElements elements;
+							ReadPeerElements(info.Get(), elements);
+							peer->elements = std::move(elements);
+
+							_peerTracker.OnUpdated(rawId, idLength, name.GetRawBuffer(NULL));
+							_peerCache.Touch(rawId, idLength, name.GetRawBuffer(NULL));
+							RefreshPeerEntry(rawId, idLength);
+						}
+						else
+						{
+							WFD_LOG_WARNING("Can't apply device update");
+						}
+					}
+
+					_peerEventsPending = true;
+				});
+
+				return S_OK;
+			}).Get(), &_DeviceUpdatedToken);
+
+			_deviceWatcher->add_Stopped(Callback<EnumerationNotifyHandler>([this](IDeviceWatcher* sender, IInspectable* object) -> HRESULT
+			{
+				//Enumeration stop
+				WFD_LOG_INFO("Enumeration stopped");
+				CancelDeadline(_enumerationDeadline.exchange(TimerWheel<std::function<void()>>::InvalidHandle));
+
+				_listeners.Raise(ListenerEventKind::EnumerationStopped);
+				_scanCompletions.Complete(L"", ScanResult(E_ABORT, L"Enumeration stopped"));
+
+				return S_OK;
+			}).Get(), &_EnumerationStopToken);
+
+			_deviceWatcher->add_EnumerationCompleted(Callback<EnumerationNotifyHandler>([this](IDeviceWatcher* sender, IInspectable* object) -> HRESULT
+			{
+				//Enumeration completed
+				WFD_LOG_INFO("Enumeration completed");
+				CancelDeadline(_enumerationDeadline.exchange(TimerWheel<std::function<void()>>::InvalidHandle));
+
+				// Queued behind the Added events of this enumeration
+				ComPtr<IDeviceWatcher> watcher(sender);
+				_events.Post([this, watcher]()
+				{
+					// Anything not re-reported by this enumeration has gone away
+					{
+						std::lock_guard<std::mutex> lock(_peerLock);
+						_peerTracker.EndEnumeration();
+					}
+
+					_peerEventsPending = false;
+					PublishPeerChanges();
+
+					_listeners.Raise(ListenerEventKind::EnumerationCompleted);
+
+					ScanResult result;
+					result.peers = CountDiscoveredPeers();
+					_scanCompletions.Complete(L"", result);
+
+					// In continuous mode the watcher stays up and keeps reporting changes as deltas
+					if (!_continuousDiscovery)
+					{
+						watcher->Stop();
+					}
+				});
+
+				return S_OK;
+			}).Get(), &_EnumerationCompletedToken);
+		}
+
+		DeviceWatcherStatus watcherStatus;
+		hr = _deviceWatcher->get_Status(&watcherStatus);
+		if (FAILED(hr))
+		{
+			throw WlanHostedNetworkException("Get Status for DeviceWatcher failed", hr);
+		}
+
+		if (watcherStatus == DeviceWatcherStatus_Started ||
+			watcherStatus == DeviceWatcherStatus_EnumerationCompleted)
+		{
+			// Watcher is still running, the peer table is already current
+			_listeners.Raise(ListenerEventKind::EnumerationCompleted, L"Discovery already running");
+
+			ScanResult result(S_OK, L"Discovery already running");
+			result.peers = CountDiscoveredPeers();
+			_scanCompletions.Complete(L"", result);
+			return completion;
+		}
+
+		// Known peers are kept; the ones not reported again are swept when enumeration completes.
+		// Queued so events still pending from the last enumeration count towards that one.
+		_events.Post([this]()
+		{
+			std::lock_guard<std::mutex> lock(_peerLock);
+			_peerTracker.BeginEnumeration();
+		});
+
+		// A watcher that never completes its enumeration is stopped, which reports it to the listener
+		ComPtr<IDeviceWatcher> watcher(_deviceWatcher);
+		std::chrono::milliseconds timeout = GetOperationTimeouts().enumeration;
+		uint64_t enumerationDeadline = ArmDeadline(timeout, [this, watcher, timeout]()
+		{
+			_enumerationDeadline.store(TimerWheel<std::function<void()>>::InvalidHandle);
+
+			std::wostringstream ss;
+			ss << L"Discovery did not complete within " << timeout.count() << L" ms";
+			std::wstring message(ss.str());
+			_listeners.Raise(ListenerEventKind::AsyncException, message, HRESULT_FROM_WIN32(ERROR_TIMEOUT));
+			_scanCompletions.Complete(L"", ScanResult(HRESULT_FROM_WIN32(ERROR_TIMEOUT), std::move(message)));
+			watcher->Stop();
+		});
+		CancelDeadline(_enumerationDeadline.exchange(enumerationDeadline));
+
+		hr = _deviceWatcher->Start();
+		if (FAILED(hr))
+		{
+			CancelDeadline(_enumerationDeadline.exchange(TimerWheel<std::function<void()>>::InvalidHandle));
+			throw WlanHostedNetworkException("device watcher start failed", hr);
+		}
+	}
+	catch (WlanHostedNetworkException& e)
+	{
+		_listeners.RaiseException(e);
+
+		std::wostringstream ss;
+		ss << e.what() << ": " << e.GetErrorCode();
+		_scanCompletions.Complete(L"", ScanResult(e.GetErrorCode(), ss.str()));
+	}
+
+	return completion;
+}
+
+size_t WlanHostedNetworkHelper::CountDiscoveredPeers() const
+{
+	auto snapshot = _peerSnapshot.Read();
+
+	size_t discovered = 0;
+	if (snapshot)
+	{
+		for (auto& peer : snapshot->peers)
+		{
+			discovered += peer->discovered ? 1 : 0;
+		}
+	}
+	return discovered;
+}
@@ -1,209 +1,1143 @@
-//*********************************************************
-//
-// Copyright (c) Microsoft. All rights reserved.
-// This code is licensed under the MIT License (MIT).
-// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
-// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
-// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
-// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
-//
-//*********************************************************
-
-#pragma once
-
-/// App-specific exception class
-class WlanHostedNetworkException : public std::exception
-{
-public:
-    WlanHostedNetworkException(const char* message)
-        : std::exception(message),
-          _hr(S_OK)
-    {}
-
-    WlanHostedNetworkException(const char* message, HRESULT hr)
-        : std::exception(message),
-        _hr(hr)
-    {}
-
-    HRESULT GetErrorCode() const
-    {
-        return _hr;
-    }
-private:
-    HRESULT _hr;
-};
-
-/// Helper interface that can be notified about changes in the "soft AP"
-class IWlanHostedNetworkListener
-{
-public:
-    virtual ~IWlanHostedNetworkListener() {}
-
-    virtual void OnDeviceConnected(std::wstring remoteHostName) = 0;
-    virtual void OnDeviceDisconnected(std::wstring deviceId) = 0;
-
-    virtual void OnAdvertisementStarted() = 0;
-    virtual void OnAdvertisementStopped(std::wstring message) = 0;
-    virtual void OnAdvertisementAborted(std::wstring message) = 0;
-	virtual void OnEnumerationCompleted(std::wstring message) = 0;
-	virtual void OnEnumerationStopped(std::wstring message) = 0;
-
-	virtual void OnDeviceAdded(std::wstring id, std::wstring name) = 0;
-	virtual void OnDeviceRemoved(std::wstring message) = 0;
-	virtual void OnDeviceUnpaired(std::wstring message) = 0;
-	virtual void OnDevicePaired(std::wstring message) = 0;
-    virtual void OnDevicePairedError(std::wstring message, int errorCode) = 0;
-
-    virtual void OnAsyncException(std::wstring message) = 0;
-
-    virtual void LogMessage(std::wstring message) = 0;
-};
-
-/// Helper interface to handle user input
-class IWlanHostedNetworkPrompt
-{
-public:
-    virtual ~IWlanHostedNetworkPrompt() {};
-
-    virtual bool AcceptIncommingConnection() = 0;
-};
-
-/// Helper interface to handle user input
-class IWlanHostedNetworkDevicePairRequest
-{
-public:
-	virtual ~IWlanHostedNetworkDevicePairRequest() {};
-
-	virtual bool PairRequest(ABI::Windows::Devices::Enumeration::DevicePairingKinds kinds, std::wstring& strPin) = 0;
-};
-
-/// Wraps code to call into the WiFiDirect WinRT APIs as a replacement for the WlanHostedNetwork* functions
-/// https://msdn.microsoft.com/en-us/library/windows.devices.wifidirect.aspx
-class WlanHostedNetworkHelper
-{
-public:
-    WlanHostedNetworkHelper();
-    ~WlanHostedNetworkHelper();
-
-    /// Set SSID (optional, falls back to a Wi-FI Direct default SSID which begins with "DIRECT-")
-    void SetSSID(const std::wstring& ssid)
-    {
-        _ssid = ssid;
-        _ssidProvided = true;
-    }
-
-    std::wstring GetSSID() const
-    {
-        return _ssid;
-    }
-
-    /// Set Passphrase (optional, falls back to a random string)
-    void SetPassphrase(const std::wstring& passphrase)
-    {
-        _passphraseProvided = true;
-        _passphrase = passphrase;
-    }
-
-    std::wstring GetPassphrase() const
-    {
-        return _passphrase;
-    }
-
-    /// Register listener to receive updates (only one listener is supported)
-    void RegisterListener(IWlanHostedNetworkListener* listener)
-    {
-        _listener = listener;
-    }
-
-    /// Register user prompt to get user input
-    void RegisterPrompt(IWlanHostedNetworkPrompt* prompt)
-    {
-        _prompt = prompt;
-    }
-
-	/// Register user prompt to get user input
-	void RegisterPairRequest(IWlanHostedNetworkDevicePairRequest* request)
-	{
-		_PairRequest = request;
-	}
-
-    /// Change behavior to auto-accept or ask user
-    void SetAutoAccept(bool autoAccept)
-    {
-        _autoAccept = autoAccept;
-    }
-
-    /// Start advertising
-    void Start();
-
-    /// Stop advertising
-    void Stop();
-
-	/// Scan network
-	void Scan();
-
-	/// Connect device
-	void ConnectDevice(const wchar_t* szDeviceId);
-	void Disconnect(const wchar_t* szDeviceId);
-	void Pair(const wchar_t* szDeviceId);
-	void Unpair(const wchar_t* szDeviceId);
-
-private:
-    /// Start connection listener
-    void StartListener();
-
-    /// Clear out old state
-    void Reset();
-
-	/// Connect device
-	void ConnectDeviceInternal(HSTRING deviceId);
-    void PairDeviceInternal(const wchar_t* szDeviceId, ABI::Windows::Devices::Enumeration::IDeviceInformation2* pDevInfo2);
-
-    // WinRT helpers
-
-    /// Main class that is used to start advertisement
-    Microsoft::WRL::ComPtr<ABI::Windows::Devices::WiFiDirect::IWiFiDirectAdvertisementPublisher> _publisher;
-    /// Advertisement Settings within the publisher
-    Microsoft::WRL::ComPtr<ABI::Windows::Devices::WiFiDirect::IWiFiDirectAdvertisement> _advertisement;
-    /// Legacy settings within the advertisement settings
-    Microsoft::WRL::ComPtr<ABI::Windows::Devices::WiFiDirect::IWiFiDirectLegacySettings> _legacySettings;
-    /// Listen for incoming connections
-    Microsoft::WRL::ComPtr<ABI::Windows::Devices::WiFiDirect::IWiFiDirectConnectionListener> _connectionListener;
-
-    /// Keep references to all connected peers
-    std::map<std::wstring, Microsoft::WRL::ComPtr<ABI::Windows::Devices::WiFiDirect::IWiFiDirectDevice>> _connectedDevices;
-    std::map<std::wstring, EventRegistrationToken> _connectedDeviceStatusChangedTokens;
-
-	Microsoft::WRL::ComPtr <ABI::Windows::Devices::Enumeration::IDeviceWatcher> _deviceWatcher;
-	std::map<std::wstring, Microsoft::WRL::ComPtr<ABI::Windows::Devices::Enumeration::IDeviceInformation2>> _discoverDevices;
-
-    /// Used to un-register for events
-    EventRegistrationToken _connectionRequestedToken;
-    EventRegistrationToken _statusChangedToken;
-
-	EventRegistrationToken _DeviceUpdatedToken;
-	EventRegistrationToken _DeviceAddToken;
-	EventRegistrationToken _DeviceRemoveToken;
-	EventRegistrationToken _EnumerationStopToken;
-	EventRegistrationToken _EnumerationCompletedToken;
-
-	EventRegistrationToken _DevicePairToken;
-
-    // Settings for "soft AP"
-
-    bool _ssidProvided;
-    std::wstring _ssid;
-    bool _passphraseProvided;
-    std::wstring _passphrase;
-
-    // Listeners that can be notified of changes to the "soft AP"
-
-    IWlanHostedNetworkListener* _listener;
-
-    IWlanHostedNetworkPrompt* _prompt;
-
-	IWlanHostedNetworkDevicePairRequest* _PairRequest;
-
-    /// tracks whether we should accept incoming connections or ask the user
-    bool _autoAccept;
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "ActivationCache.h"
+#include "AdmissionController.h"
+#include "AsyncAwait.h"
+#include "Completion.h"
+#include "DecisionQueue.h"
+#include "EventBus.h"
+#include "EventLoop.h"
+#include "LatencyHistogram.h"
+#include "PairingPipeline.h"
+#include "PeerCache.h"
+#include "PeerDeltaTracker.h"
+#include "ReconnectScheduler.h"
+#include "SnapshotPublisher.h"
+#include "TimerWheel.h"
+#include "TrustStore.h"
+
+/// App-specific exception class
+class WlanHostedNetworkException : public std::exception
+{
+public:
+    WlanHostedNetworkException(const char* message)
+        : std::exception(message),
+          _hr(S_OK)
+    {}
+
+    WlanHostedNetworkException(const char* message, HRESULT hr)
+        : std::exception(message),
+        _hr(hr)
+    {}
+
+    HRESULT GetErrorCode() const
+    {
+        return _hr;
+    }
+private:
+    HRESULT _hr;
+};
+
+/// Pairing progress recorded for a peer
+enum class PeerPairingState
+{
+	Unknown,
+	Pairing,
+	Paired,
+	Failed,
+	Unpaired
+};
+
+/// What a peer advertises in its information elements
+struct PeerElements
+{
+	PeerElements()
+		: hasDeviceType(false),
+		  deviceCategory(0),
+		  deviceSubCategory(0),
+		  hasVendorElement(false)
+	{}
+
+	bool operator==(const PeerElements& other) const
+	{
+		return hasDeviceType == other.hasDeviceType &&
+			deviceCategory == other.deviceCategory &&
+			deviceSubCategory == other.deviceSubCategory &&
+			hasVendorElement == other.hasVendorElement &&
+			vendorPayload == other.vendorPayload;
+	}
+
+	/// Primary device type from the P2P element
+	bool hasDeviceType;
+	uint16_t deviceCategory;
+	uint16_t deviceSubCategory;
+
+	/// Set when the peer carries the vendor element registered with SetVendorElement
+	bool hasVendorElement;
+	std::vector<uint8_t> vendorPayload;
+};
+
+/// Everything the helper keeps for one peer, stored together in the peer registry
+struct PeerState
+{
+	PeerState()
+		: pairing(PeerPairingState::Unknown)
+	{
+		statusChangedToken.value = 0;
+	}
+
+	/// Only discovery bookkeeping refers to the peer, so it can leave the registry
+	bool IsIdle() const
+	{
+		return !discovery.present && !device;
+	}
+
+	/// Maintained by PeerDeltaTracker from device watcher events
+	PeerDiscoveryRecord discovery;
+	/// Set while the device watcher reports the peer
+	Microsoft::WRL::ComPtr<ABI::Windows::Devices::Enumeration::IDeviceInformation2> deviceInfo;
+	/// Set while connected; statusChangedToken is only valid together with it
+	Microsoft::WRL::ComPtr<ABI::Windows::Devices::WiFiDirect::IWiFiDirectDevice> device;
+	EventRegistrationToken statusChangedToken;
+	PeerPairingState pairing;
+	/// Parsed from the information elements the device watcher reports
+	PeerElements elements;
+};
+
+/// Copy of one peer as seen by snapshot readers
+struct PeerSnapshotEntry
+{
+	PeerHandle handle;
+	std::wstring id;
+	std::wstring name;
+	bool discovered;
+	bool connected;
+	PeerPairingState pairing;
+	PeerElements elements;
+};
+
+/// Immutable copy of the peer table, readable from any thread without taking _peerLock
+struct PeerSnapshot
+{
+	PeerSnapshot()
+		: generation(0)
+	{}
+
+	/// Position of the entry for a device ID, or where it would be inserted
+	size_t LowerBound(const wchar_t* id, size_t length) const
+	{
+		auto it = std::lower_bound(peers.begin(), peers.end(), std::make_pair(id, length),
+			[](const std::shared_ptr<const PeerSnapshotEntry>& entry, const std::pair<const wchar_t*, size_t>& key)
+		{
+			return entry->id.compare(0, std::wstring::npos, key.first, key.second) < 0;
+		});
+		return it - peers.begin();
+	}
+
+	/// Entry for a device ID, or nullptr
+	const PeerSnapshotEntry* Find(const wchar_t* id, size_t length) const
+	{
+		size_t position = LowerBound(id, length);
+		if (position == peers.size() || peers[position]->id.compare(0, std::wstring::npos, id, length) != 0)
+		{
+			return nullptr;
+		}
+		return peers[position].get();
+	}
+
+	/// Delta generation the snapshot reflects
+	uint64_t generation;
+	/// Sorted by ID; entries of peers that did not change are shared with the previous snapshot
+	std::vector<std::shared_ptr<const PeerSnapshotEntry>> peers;
+};
+
+/// How one connection of a ConnectDevices batch ended
+enum class ConnectOutcome
+{
+	Pending,
+	Succeeded,
+	/// Already paired, nothing to connect
+	Skipped,
+	Failed,
+	TimedOut
+};
+
+struct ConnectBatchEntry
+{
+	std::wstring deviceId;
+	ConnectOutcome outcome;
+	HRESULT error;
+};
+
+/// Outcome of a ConnectDevices batch, reported once every device has finished
+struct ConnectBatchResult
+{
+	ConnectBatchResult()
+		: succeeded(0),
+		  skipped(0),
+		  failed(0),
+		  timedOut(0),
+		  elapsed(0)
+	{}
+
+	double GetConnectionsPerSecond() const
+	{
+		return elapsed.count() > 0 ? succeeded * 1000.0 / elapsed.count() : 0.0;
+	}
+
+	/// In the order the IDs were passed
+	std::vector<ConnectBatchEntry> devices;
+	size_t succeeded;
+	size_t skipped;
+	size_t failed;
+	size_t timedOut;
+	std::chrono::milliseconds elapsed;
+};
+
+/// How long each kind of WinRT operation may stay pending before it is cancelled and reported as
+/// timed out
+struct OperationTimeouts
+{
+	OperationTimeouts()
+		: connect(30000),
+		  pairing(120000),
+		  resolve(15000),
+		  unpair(15000),
+		  enumeration(60000)
+	{}
+
+	/// FromIdAsync for a connection, unless ConnectDevices passes its own
+	std::chrono::milliseconds connect;
+	/// A whole pairing ceremony, including the time a decision is pending
+	std::chrono::milliseconds pairing;
+	/// Looking up a cached device before pairing it
+	std::chrono::milliseconds resolve;
+	std::chrono::milliseconds unpair;
+	/// A discovery pass of the device watcher up to EnumerationCompleted
+	std::chrono::milliseconds enumeration;
+};
+
+/// How a Start, Stop or Unpair ended
+struct OperationResult
+{
+	explicit OperationResult(HRESULT error = S_OK, const std::wstring& message = std::wstring())
+		: error(error),
+		  message(message)
+	{}
+
+	/// HRESULT_FROM_WIN32(ERROR_TIMEOUT) if the caller's deadline passed first, E_ABORT if the
+	/// helper was reset or the advertisement aborted
+	HRESULT error;
+	std::wstring message;
+};
+
+/// How a Scan ended
+struct ScanResult
+{
+	explicit ScanResult(HRESULT error = S_OK, const std::wstring& message = std::wstring())
+		: error(error),
+		  peers(0),
+		  message(message)
+	{}
+
+	HRESULT error;
+	/// Discovered peers once the enumeration completed
+	size_t peers;
+	std::wstring message;
+};
+
+/// How a Pair ended
+struct PairResult
+{
+	explicit PairResult(HRESULT error = S_OK, int errorCode = 0)
+		: error(error),
+		  errorCode(errorCode)
+	{}
+
+	/// S_OK once paired; E_FAIL if the ceremony ran and did not pair, see errorCode
+	HRESULT error;
+	/// What OnDevicePairedError got: a DevicePairingResultStatus, or an HRESULT if pairing could not run
+	int errorCode;
+};
+
+/// Helper interface that can be notified about changes in the "soft AP"
+class IWlanHostedNetworkListener
+{
+public:
+    virtual ~IWlanHostedNetworkListener() {}
+
+    virtual void OnDeviceConnected(std::wstring remoteHostName) = 0;
+	/// Every device of a ConnectDevices batch has finished
+	virtual void OnDevicesConnected(const ConnectBatchResult& result) = 0;
+    virtual void OnDeviceDisconnected(std::wstring deviceId) = 0;
+
+    virtual void OnAdvertisementStarted() = 0;
+    virtual void OnAdvertisementStopped(std::wstring message) = 0;
+    virtual void OnAdvertisementAborted(std::wstring message) = 0;
+	virtual void OnEnumerationCompleted(std::wstring message) = 0;
+	virtual void OnEnumerationStopped(std::wstring message) = 0;
+
+	/// Discovered peers that were added, changed or removed since the previous delta
+	virtual void OnPeersChanged(const PeerDelta& delta) = 0;
+	virtual void OnDeviceUnpaired(std::wstring message) = 0;
+	virtual void OnDevicePaired(std::wstring message) = 0;
+    virtual void OnDevicePairedError(std::wstring message, int errorCode) = 0;
+
+    virtual void OnAsyncException(std::wstring message) = 0;
+
+    virtual void LogMessage(std::wstring message) = 0;
+};
+
+/// Helper interface to handle user input. Return at once and decide later with
+/// WlanHostedNetworkHelper::ResolveDecision; the request waits on no thread meanwhile.
+class IWlanHostedNetworkPrompt
+{
+public:
+    virtual ~IWlanHostedNetworkPrompt() {};
+
+    virtual void OnConnectionDecisionPending(const PendingDecision& decision) = 0;
+};
+
+/// Helper interface to handle user input, see IWlanHostedNetworkPrompt
+class IWlanHostedNetworkDevicePairRequest
+{
+public:
+	virtual ~IWlanHostedNetworkDevicePairRequest() {};
+
+	virtual void OnPairingDecisionPending(const PendingDecision& decision) = 0;
+};
+
+/// Which IWlanHostedNetworkListener method a ListenerEvent is for
+enum class ListenerEventKind
+{
+	DeviceConnected,
+	DevicesConnected,
+	DeviceDisconnected,
+	AdvertisementStarted,
+	AdvertisementStopped,
+	AdvertisementAborted,
+	EnumerationCompleted,
+	EnumerationStopped,
+	PeersChanged,
+	DeviceUnpaired,
+	DevicePaired,
+	DevicePairedError,
+	AsyncException,
+	LogMessage
+};
+
+/// One listener call as an IWlanHostedNetworkListener2 gets it. Everything here is borrowed from
+/// the bus's record of the event and only valid until OnEvent returns; a listener that keeps any
+/// of it makes its own copy, e.g. with CopyText.
+struct ListenerEventView
+{
+	ListenerEventKind kind;
+	/// Peer the event is about, the handle PeerChange and PeerSnapshotEntry carry; InvalidPeerHandle
+	/// if the event is about no peer in particular. May be stale by the time a listener sees it.
+	PeerHandle peer;
+	/// Message, host name or device ID, depending on kind, as the v1 method gets it
+	std::wstring_view text;
+	/// DevicePairedError: what OnDevicePairedError gets as errorCode, a DevicePairingResultStatus
+	/// or an HRESULT. AsyncException: the HRESULT thrown, if there was one. S_OK otherwise.
+	HRESULT error;
+	/// PeersChanged only
+	const PeerDelta* delta;
+	/// DevicesConnected only
+	const ConnectBatchResult* batch;
+
+	std::wstring CopyText() const
+	{
+		return std::wstring(text.data(), text.length());
+	}
+};
+
+/// Listener that gets every event through one call and copies nothing it does not ask for, unlike
+/// IWlanHostedNetworkListener whose methods each take their string by value
+class IWlanHostedNetworkListener2
+{
+public:
+	virtual ~IWlanHostedNetworkListener2() {}
+
+	virtual void OnEvent(const ListenerEventView& event) = 0;
+};
+
+/// Makes the IWlanHostedNetworkListener call an event stands for. This is where a v1 listener
+/// pays for the string its method takes by value.
+class ListenerAdapter : public IWlanHostedNetworkListener2
+{
+public:
+	explicit ListenerAdapter(IWlanHostedNetworkListener* listener)
+		: _listener(listener)
+	{}
+
+	virtual void OnEvent(const ListenerEventView& event) override;
+
+private:
+	IWlanHostedNetworkListener* _listener;
+};
+
+/// One listener call, published once and shared by every subscriber. ListenerBus pools these and
+/// reuses one once the last subscriber is done with it, text keeping its capacity, so raising an
+/// event does not allocate once the pool has warmed up.
+struct ListenerEvent
+{
+	ListenerEvent()
+		: kind(ListenerEventKind::LogMessage),
+		  peer(InvalidPeerHandle),
+		  error(S_OK)
+	{}
+
+	ListenerEventView GetView() const
+	{
+		ListenerEventView view;
+		view.kind = kind;
+		view.peer = peer;
+		view.text = std::wstring_view(text.data(), text.length());
+		view.error = error;
+		view.delta = (kind == ListenerEventKind::PeersChanged) ? &delta : nullptr;
+		view.batch = (kind == ListenerEventKind::DevicesConnected) ? &batch : nullptr;
+		return view;
+	}
+
+	ListenerEventKind kind;
+	PeerHandle peer;
+	std::wstring text;
+	HRESULT error;
+	PeerDelta delta;
+	ConnectBatchResult batch;
+};
+
+/// Fans listener calls out to any number of listeners. Each subscribed listener is called on a
+/// thread of its own from a bounded buffer, so a slow one drops its own events instead of holding
+/// up the WinRT callback that raised them. Listeners see events in the order they were raised.
+///
+/// Raise copies an event's text once, into a pooled record every subscriber shares; v2 listeners
+/// read it in place. The IWlanHostedNetworkListener methods the bus implements are kept for code
+/// that holds it as a v1 listener and cost the caller's string on top.
+class ListenerBus : public IWlanHostedNetworkListener
+{
+public:
+	/// Returns the id to unsubscribe with. Calls listener through a ListenerAdapter.
+	uint64_t Subscribe(IWlanHostedNetworkListener* listener, const SubscriberOptions& options = SubscriberOptions());
+	uint64_t Subscribe(IWlanHostedNetworkListener2* listener, const SubscriberOptions& options = SubscriberOptions());
+
+	/// Delivers what is already buffered, then stops calling the listener
+	void Unsubscribe(uint64_t id)
+	{
+		_bus.Unsubscribe(id);
+	}
+
+	std::vector<SubscriberStats> GetStats() const
+	{
+		return _bus.GetStats();
+	}
+
+	size_t GetSubscriberCount() const
+	{
+		return _bus.GetSubscriberCount();
+	}
+
+	/// Publish an event; text need only be valid for the call. Not for PeersChanged or
+	/// DevicesConnected, see RaisePeersChanged and RaiseDevicesConnected.
+	void Raise(ListenerEventKind kind, std::wstring_view text = std::wstring_view(), HRESULT error = S_OK, PeerHandle peer = InvalidPeerHandle);
+
+	/// AsyncException with the text OnAsyncException used to get for e, "what: code", and e's code
+	void RaiseException(const WlanHostedNetworkException& e);
+
+	void RaisePeersChanged(const PeerDelta& delta);
+	void RaiseDevicesConnected(const ConnectBatchResult& result);
+
+	virtual void OnDeviceConnected(std::wstring remoteHostName) override;
+	virtual void OnDevicesConnected(const ConnectBatchResult& result) override;
+	virtual void OnDeviceDisconnected(std::wstring deviceId) override;
+
+	virtual void OnAdvertisementStarted() override;
+	virtual void OnAdvertisementStopped(std::wstring message) override;
+	virtual void OnAdvertisementAborted(std::wstring message) override;
+	virtual void OnEnumerationCompleted(std::wstring message) override;
+	virtual void OnEnumerationStopped(std::wstring message) override;
+
+	virtual void OnPeersChanged(const PeerDelta& delta) override;
+	virtual void OnDeviceUnpaired(std::wstring message) override;
+	virtual void OnDevicePaired(std::wstring message) override;
+	virtual void OnDevicePairedError(std::wstring message, int errorCode) override;
+
+	virtual void OnAsyncException(std::wstring message) override;
+
+	virtual void LogMessage(std::wstring message) override;
+
+private:
+	/// Idle records kept for reuse; more than this in flight at once are allocated and freed
+	static const size_t PoolCapacity = 1024;
+
+	struct RecordPool;
+
+	struct Record : ListenerEvent
+	{
+		std::atomic<uint32_t> references;
+		RecordPool* pool;
+	};
+
+	/// Idle records
+	struct RecordPool
+	{
+		RecordPool()
+			: records(PoolCapacity)
+		{}
+
+		~RecordPool()
+		{
+			Record* record;
+			while (records.TryPop(record))
+			{
+				delete record;
+			}
+		}
+
+		BoundedQueue<Record*> records;
+	};
+
+	/// Counted reference to a record, what the subscriber buffers hold. The last one to let go
+	/// puts the record back in the pool.
+	class RecordRef
+	{
+	public:
+		RecordRef()
+			: _record(nullptr)
+		{}
+
+		/// Takes over the reference the pool handed out with the record
+		explicit RecordRef(Record* record)
+			: _record(record)
+		{}
+
+		RecordRef(const RecordRef& other)
+			: _record(other._record)
+		{
+			if (_record != nullptr)
+			{
+				_record->references.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		RecordRef(RecordRef&& other) noexcept
+			: _record(other._record)
+		{
+			other._record = nullptr;
+		}
+
+		~RecordRef()
+		{
+			Reset();
+		}
+
+		RecordRef& operator=(RecordRef other) noexcept
+		{
+			std::swap(_record, other._record);
+			return *this;
+		}
+
+		const ListenerEvent& operator*() const
+		{
+			return *_record;
+		}
+
+		void Reset()
+		{
+			if (_record != nullptr && _record->references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			{
+				Recycle(_record);
+			}
+			_record = nullptr;
+		}
+
+	private:
+		Record* _record;
+	};
+
+	/// Record for a new event from the pool, or a new one if the pool is empty
+	Record* Acquire(ListenerEventKind kind, HRESULT error, PeerHandle peer);
+	/// Drop what a record holds on to besides the capacity of its text, and pool it
+	static void Recycle(Record* record);
+
+	/// Declared before _bus: buffered events go back to the pool as the subscribers are destroyed
+	RecordPool _pool;
+	EventBus<RecordRef> _bus;
+};
+
+/// Wraps code to call into the WiFiDirect WinRT APIs as a replacement for the WlanHostedNetwork* functions
+/// https://msdn.microsoft.com/en-us/library/windows.devices.wifidirect.aspx
+class WlanHostedNetworkHelper
+{
+public:
+    WlanHostedNetworkHelper();
+    ~WlanHostedNetworkHelper();
+
+    /// Set SSID (optional, falls back to a Wi-FI Direct default SSID which begins with "DIRECT-")
+    void SetSSID(const std::wstring& ssid)
+    {
+        _ssid = ssid;
+        _ssidProvided = true;
+    }
+
+    std::wstring GetSSID() const
+    {
+        return _ssid;
+    }
+
+    /// Set Passphrase (optional, falls back to a random string)
+    void SetPassphrase(const std::wstring& passphrase)
+    {
+        _passphraseProvided = true;
+        _passphrase = passphrase;
+    }
+
+    std::wstring GetPassphrase() const
+    {
+        return _passphrase;
+    }
+
+    /// Register listener to receive updates, replacing the one registered before; see SubscribeListener for more
+    void RegisterListener(IWlanHostedNetworkListener* listener)
+    {
+        if (_registeredListener != 0)
+        {
+            _listeners.Unsubscribe(_registeredListener);
+            _registeredListener = 0;
+        }
+
+        if (listener != nullptr)
+        {
+            _registeredListener = _listeners.Subscribe(listener);
+        }
+    }
+
+	/// Add a listener next to the registered one, e.g. for metrics or log shipping. Listeners are
+	/// called on their own thread; one that falls behind by more than options.capacity events
+	/// loses events rather than slowing down the others.
+	uint64_t SubscribeListener(IWlanHostedNetworkListener* listener, const SubscriberOptions& options = SubscriberOptions())
+	{
+		return _listeners.Subscribe(listener, options);
+	}
+
+	/// Same for a listener that takes borrowed event records
+	uint64_t SubscribeListener(IWlanHostedNetworkListener2* listener, const SubscriberOptions& options = SubscriberOptions())
+	{
+		return _listeners.Subscribe(listener, options);
+	}
+
+	void UnsubscribeListener(uint64_t id)
+	{
+		_listeners.Unsubscribe(id);
+	}
+
+	std::vector<SubscriberStats> GetListenerStats() const
+	{
+		return _listeners.GetStats();
+	}
+
+    /// Register user prompt to get user input
+    void RegisterPrompt(IWlanHostedNetworkPrompt* prompt)
+    {
+        _prompt = prompt;
+    }
+
+	/// Register user prompt to get user input
+	void RegisterPairRequest(IWlanHostedNetworkDevicePairRequest* request)
+	{
+		_PairRequest = request;
+	}
+
+    /// Change behavior to auto-accept or ask user
+    void SetAutoAccept(bool autoAccept)
+    {
+        _autoAccept = autoAccept;
+    }
+
+	// Start, Stop, Scan, Pair and Unpair return right away; the result arrives in the returned
+	// Completion once the listener has been told how the operation ended. Several may be pending
+	// at once, see WaitAny and WaitAll. A non-zero deadline completes the result with
+	// HRESULT_FROM_WIN32(ERROR_TIMEOUT) if the operation has not ended by then; the operation
+	// itself goes on under its OperationTimeouts.
+
+    /// Start advertising; completes once the advertisement started or aborted
+    Completion<OperationResult> Start(std::chrono::milliseconds deadline = std::chrono::milliseconds(0));
+
+    /// Stop advertising; completes once the advertisement stopped
+    Completion<OperationResult> Stop(std::chrono::milliseconds deadline = std::chrono::milliseconds(0));
+
+	/// Scan network; completes once the enumeration completed or the watcher stopped
+	Completion<ScanResult> Scan(std::chrono::milliseconds deadline = std::chrono::milliseconds(0));
+
+	/// Keep the device watcher running after enumeration completes and report changes as they happen
+	void SetContinuousDiscovery(bool continuous)
+	{
+		_continuousDiscovery = continuous;
+	}
+
+	/// Look for a vendor specific element with this OUI and vendor type in what peers advertise;
+	/// oui 0 stops looking. Applies to peers reported from now on.
+	void SetVendorElement(uint32_t oui, uint8_t vendorType)
+	{
+		_vendorElement = (oui != 0) ? ((oui & 0xFFFFFF) << 8) | vendorType : 0;
+	}
+
+	/// Collect watcher events for up to windowMs or maxChanges changes and deliver them as one delta;
+	/// windowMs 0 delivers every event immediately (default). Enumeration completion always flushes.
+	void SetPeerBatching(DWORD windowMs, size_t maxChanges);
+
+	/// Consistent view of discovered and connected peers; lock-free, hold the guard only briefly
+	SnapshotPublisher<PeerSnapshot>::ReadGuard GetPeerSnapshot() const
+	{
+		return _peerSnapshot.Read();
+	}
+
+	/// Keep known peers in a memory-mapped file so connect/pair work before the first scan completes
+	void OpenPeerCache(const wchar_t* path);
+
+	/// Snapshot of the peers in the cache
+	std::vector<PeerCacheEntry> GetKnownPeers();
+
+	/// Remember pairing outcomes and trust decisions across runs; trusted peers are accepted
+	/// without a prompt, banned ones rejected as soon as they ask
+	void OpenTrustStore(const wchar_t* path);
+
+	/// Trust, ban, or with Unknown forget a peer
+	void SetPeerTrust(const wchar_t* deviceId, PeerTrust trust);
+
+	std::vector<TrustEntry> GetTrustEntries();
+
+	TrustStoreStats GetTrustStats()
+	{
+		std::lock_guard<std::mutex> lock(_trustLock);
+		return _trust.GetStats();
+	}
+
+	/// Timeout and default action for connection and pairing requests nobody decides on
+	void SetDecisionPolicy(const DecisionPolicy& policy)
+	{
+		_decisions.SetPolicy(policy);
+	}
+
+	/// Accept or decline a pending request; pin is used for ProvidePin pairing. False if the
+	/// request is no longer pending.
+	bool ResolveDecision(uint64_t id, bool accept, const std::wstring& pin = std::wstring())
+	{
+		return _decisions.Resolve(id, accept, pin);
+	}
+
+	std::vector<PendingDecision> GetPendingDecisions()
+	{
+		return _decisions.GetPending();
+	}
+
+	DecisionStats GetDecisionStats()
+	{
+		return _decisions.GetStats();
+	}
+
+	/// Rate and concurrency limits for incoming connections; see AdmissionSettings
+	void SetAdmissionSettings(const AdmissionSettings& settings)
+	{
+		std::lock_guard<std::mutex> lock(_admissionLock);
+		_admission.Configure(settings);
+	}
+
+	AdmissionCounters GetAdmissionCounters()
+	{
+		std::lock_guard<std::mutex> lock(_admissionLock);
+		return _admission.GetCounters();
+	}
+
+	/// How many pairings may run at once (default 4); more wait their turn
+	void SetMaxConcurrentPairings(uint32_t maxConcurrent)
+	{
+		_pairings.SetMaxConcurrent(maxConcurrent);
+	}
+
+	PairingCounters GetPairingCounters()
+	{
+		return _pairings.GetCounters();
+	}
+
+	/// Stage of every device being paired; finished pairings only show in the counters
+	std::vector<PairingStatus> GetPairingStatus()
+	{
+		return _pairings.GetStatus();
+	}
+
+	/// Reconnect peers that drop on their own (off by default); see ReconnectSettings
+	void SetReconnectSettings(const ReconnectSettings& settings);
+
+	ReconnectStats GetReconnectStats();
+
+	/// Time spent in each phase of the connect and pair flows
+	const LatencyHistogram& GetLatency(LatencyPhase phase) const
+	{
+		return _latency.Get(phase);
+	}
+
+	/// Activations avoided by reusing factories and connection parameters
+	ActivationCounters GetActivationCounters() const
+	{
+		return _activationCache.GetCounters();
+	}
+
+	/// Deadlines of pending operations; see OperationTimeouts
+	void SetOperationTimeouts(const OperationTimeouts& timeouts)
+	{
+		std::lock_guard<std::mutex> lock(_deadlineLock);
+		_timeouts = timeouts;
+	}
+
+	OperationTimeouts GetOperationTimeouts()
+	{
+		std::lock_guard<std::mutex> lock(_deadlineLock);
+		return _timeouts;
+	}
+
+	TimerWheelStats GetDeadlineStats(size_t& pending)
+	{
+		std::lock_guard<std::mutex> lock(_deadlineLock);
+		pending = _deadlines.GetCount();
+		return _deadlines.GetStats();
+	}
+
+	/// Connect device
+	void ConnectDevice(const wchar_t* szDeviceId);
+
+	/// Connect many devices with at most maxInFlight connections pending at once; a connection still
+	/// pending after timeoutMs is cancelled. The result goes to OnDevicesConnected.
+	void ConnectDevices(const std::vector<std::wstring>& deviceIds, size_t maxInFlight, DWORD timeoutMs = 30000);
+	void Disconnect(const wchar_t* szDeviceId);
+	/// Completes with the pairing's outcome; a second Pair of a device being paired completes with it
+	Completion<PairResult> Pair(const wchar_t* szDeviceId, std::chrono::milliseconds deadline = std::chrono::milliseconds(0));
+	/// Completes with HRESULT_FROM_WIN32(ERROR_NOT_FOUND) if the device was not discovered
+	Completion<OperationResult> Unpair(const wchar_t* szDeviceId, std::chrono::milliseconds deadline = std::chrono::milliseconds(0));
+
+private:
+    /// Start connection listener
+    void StartListener();
+
+    /// Clear out old state
+    void Reset();
+
+	/// Connect device; completed gets S_OK once connected, S_FALSE if already paired, or the error,
+	/// HRESULT_FROM_WIN32(ERROR_TIMEOUT) if still pending after timeout (0 for the connect timeout).
+	/// Returns the pending operation, or nullptr if completed was already called.
+	Microsoft::WRL::ComPtr<ABI::Windows::Foundation::IAsyncInfo> ConnectDeviceInternal(HSTRING deviceId, std::function<void(HRESULT)> completed = nullptr, std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+
+	/// Rest of a connect once FromIdAsync is issued; reports through report
+	AsyncTask CompleteConnection(Microsoft::WRL::ComPtr<ABI::Windows::Foundation::IAsyncOperation<ABI::Windows::Devices::WiFiDirect::WiFiDirectDevice*>> operation,
+		std::function<void(HRESULT)> report, uint64_t deadline, LatencyRecorder::Clock::time_point started, LatencyRecorder::Clock::time_point issued);
+
+	struct ConnectBatch;
+
+	/// Start connections of a batch until maxInFlight are pending
+	void LaunchConnections(const std::shared_ptr<ConnectBatch>& batch);
+
+	/// Record how one connection of a batch ended and report the batch once all have
+	void FinishConnection(const std::shared_ptr<ConnectBatch>& batch, size_t index, ConnectOutcome outcome, HRESULT error);
+
+	/// Call expired once timeout has passed unless the returned handle is cancelled first. Returns
+	/// TimerWheel::InvalidHandle, after reporting why, if no deadline could be armed.
+	uint64_t ArmDeadline(std::chrono::milliseconds timeout, std::function<void()> expired);
+
+	/// False if the deadline already expired
+	bool CancelDeadline(uint64_t deadline);
+
+	/// Arm a deadline that calls timedOut and then cancels operation
+	uint64_t WatchOperation(const Microsoft::WRL::ComPtr<ABI::Windows::Foundation::IAsyncInfo>& operation, std::chrono::milliseconds timeout, std::function<void()> timedOut);
+
+	/// Register source under key in registry and, unless deadline is 0, time it out after deadline.
+	/// The deadline is cancelled once the source completes, whoever completes it.
+	template <typename TResult>
+	Completion<TResult> TrackCompletion(CompletionRegistry<TResult>& registry, const std::wstring& key, const CompletionSource<TResult>& source, std::chrono::milliseconds deadline)
+	{
+		registry.Add(key, source);
+		if (deadline.count() > 0)
+		{
+			uint64_t timer = ArmDeadline(deadline, [source]()
+			{
+				source.Complete(TResult(HRESULT_FROM_WIN32(ERROR_TIMEOUT)));
+			});
+
+			if (timer != TimerWheel<std::function<void()>>::InvalidHandle)
+			{
+				source.GetCompletion().OnCompleted([this, timer]()
+				{
+					CancelDeadline(timer);
+				});
+			}
+		}
+		return source.GetCompletion();
+	}
+
+	static VOID CALLBACK DeadlineTimerCallback(PTP_CALLBACK_INSTANCE instance, PVOID context, PTP_TIMER timer);
+
+	/// Schedule reconnects for a peer that dropped
+	void ScheduleReconnect(const wchar_t* deviceId);
+
+	/// Start the reconnects whose backoff has expired
+	void RunDueReconnects();
+
+	static VOID CALLBACK ReconnectTimerCallback(PTP_CALLBACK_INSTANCE instance, PVOID context, PTP_TIMER timer);
+
+	/// Queue a request for a decision and make sure its timeout will be applied
+	uint64_t ParkDecision(PendingDecision& decision, DecisionQueue::Resolver resolver);
+
+	static VOID CALLBACK DecisionTimerCallback(PTP_CALLBACK_INSTANCE instance, PVOID context, PTP_TIMER timer);
+
+	/// An accepted incoming connection waiting for admission
+	struct PendingConnection
+	{
+		std::wstring deviceId;
+		Microsoft::WRL::ComPtr<ABI::Windows::Devices::Enumeration::IDeviceInformation> deviceInformation;
+		/// Held so the peer keeps waiting rather than being dropped
+		Microsoft::WRL::ComPtr<ABI::Windows::Devices::WiFiDirect::IWiFiDirectConnectionRequest> request;
+		/// The trust store accepted it
+		bool trusted;
+	};
+
+	/// Start an accepted connection now, queue it or turn it away, see AdmissionController
+	void AdmitConnection(const PendingConnection& connection);
+
+	/// Start connections that were admitted; each holds its slot until pairing finishes
+	void StartAdmittedConnections(const std::vector<PendingConnection>& connections);
+
+	static VOID CALLBACK AdmissionTimerCallback(PTP_CALLBACK_INSTANCE instance, PVOID context, PTP_TIMER timer);
+
+	/// Go ahead with an incoming connection; slot, if set, is released once pairing finishes
+	void AcceptConnection(const wchar_t* deviceId, ABI::Windows::Devices::Enumeration::IDeviceInformation* deviceInformation, std::shared_ptr<void> slot = nullptr);
+
+	/// What a running pairing keeps alive until it completes, see PairingPipeline
+	struct PairingSession
+	{
+		PairingSession()
+		{
+			requestedToken.value = 0;
+		}
+
+		Microsoft::WRL::ComPtr<ABI::Windows::Devices::Enumeration::IDeviceInformation2> deviceInformation;
+		Microsoft::WRL::ComPtr<ABI::Windows::Devices::Enumeration::IDeviceInformationCustomPairing> customPairing;
+		EventRegistrationToken requestedToken;
+		Microsoft::WRL::ComPtr<ABI::Windows::Foundation::IAsyncInfo> operation;
+		/// Admission slot of an incoming connection
+		std::shared_ptr<void> slot;
+	};
+
+	/// Pair once the pipeline has a free slot; slot, if set, is released once pairing finishes
+	void QueuePairing(const wchar_t* deviceId, const Microsoft::WRL::ComPtr<ABI::Windows::Devices::Enumeration::IDeviceInformation2>& deviceInformation, std::shared_ptr<void> slot = nullptr);
+	/// Runs when the pipeline starts the pairing; ends in FinishPairing unless it throws
+    void PairDeviceInternal(const std::wstring& deviceId, ABI::Windows::Devices::Enumeration::IDeviceInformation2* pDevInfo2, std::shared_ptr<void> slot);
+	/// Rest of a pairing once the ceremony is started; whichever of it and the deadline sets settled
+	/// first finishes the pairing
+	AsyncTask CompletePairing(Microsoft::WRL::ComPtr<ABI::Windows::Foundation::IAsyncOperation<ABI::Windows::Devices::Enumeration::DevicePairingResult*>> operation,
+		std::wstring pairingId, std::shared_ptr<std::atomic<uint32_t>> ceremonyKinds, std::shared_ptr<std::atomic<bool>> settled, uint64_t deadline,
+		LatencyRecorder::Clock::time_point started);
+	/// Complete a device's pairing in the pipeline and drop its session
+	void FinishPairing(const std::wstring& deviceId, bool paired);
+	/// Tell the listeners how a pairing ended and complete the Pairs waiting for it; errorCode as
+	/// for OnDevicePairedError
+	void ReportPairing(const std::wstring& deviceId, bool paired, int errorCode = 0);
+	/// Unregister the PairingRequested handler of a session
+	static void ReleasePairingSession(PairingSession& session);
+
+	/// Deliver pending peer table changes to the listener
+	void PublishPeerChanges();
+
+	/// Deliver pending peer table changes now or when the batch window closes
+	void QueuePeerChanges();
+
+	/// Runs on _events after each drained batch of messages
+	void OnEventBatch();
+
+	static VOID CALLBACK PeerBatchTimerCallback(PTP_CALLBACK_INSTANCE instance, PVOID context, PTP_TIMER timer);
+
+	/// Rebuild the snapshot entry of one peer in _peerTable, dropping it once the peer is idle or
+	/// gone; called with _peerLock held
+	void RefreshPeerEntry(const wchar_t* deviceId, size_t length);
+
+	/// Publish _peerTable if it changed since the last snapshot; called with _peerLock held
+	void PublishPeerSnapshot();
+
+	/// Peers the device watcher reports, by the current snapshot
+	size_t CountDiscoveredPeers() const;
+
+	/// Parse the information elements requested from the device watcher
+	void ReadPeerElements(ABI::Windows::Devices::Enumeration::IDeviceInformation* deviceInfo, PeerElements& elements) const;
+
+	/// Device information of a discovered peer, or nullptr if the peer is unknown
+	Microsoft::WRL::ComPtr<ABI::Windows::Devices::Enumeration::IDeviceInformation2> FindDeviceInformation(const wchar_t* deviceId, size_t length);
+
+	/// Drop the connected device of a peer and its status handler; returns false if it was not connected
+	bool ReleaseConnectedDevice(const wchar_t* deviceId, size_t length, bool close);
+
+	/// Handle of a known peer for the events about it, InvalidPeerHandle if unknown
+	PeerHandle FindPeerHandle(const wchar_t* deviceId, size_t length);
+
+	/// Record pairing progress for a known peer
+	void SetPairingState(const wchar_t* deviceId, size_t length, PeerPairingState state);
+
+	/// Pair a peer known only from the cache by resolving its ID directly
+	void PairCachedDevice(const wchar_t* szDeviceId);
+	AsyncTask ResolveCachedDevice(Microsoft::WRL::ComPtr<ABI::Windows::Foundation::IAsyncOperation<ABI::Windows::Devices::Enumeration::DeviceInformation*>> operation,
+		std::wstring cachedId, std::shared_ptr<std::atomic<bool>> settled, uint64_t deadline);
+
+	AsyncTask CompleteUnpairing(Microsoft::WRL::ComPtr<ABI::Windows::Foundation::IAsyncOperation<ABI::Windows::Devices::Enumeration::DeviceUnpairingResult*>> operation,
+		std::wstring unpairedId, std::shared_ptr<std::atomic<bool>> settled, uint64_t deadline);
+
+	/// Log the startup-to-first-connection latency once
+	void ReportFirstConnection();
+
+	/// Trust of a peer, Unknown if the trust store is not open
+	PeerTrust LookupTrust(const std::wstring& deviceId);
+
+	/// Remember how a pairing went, if the trust store is open
+	void RecordPairingOutcome(const std::wstring& deviceId, uint32_t pairingKinds, int32_t result, bool paired);
+
+	/// Every listener; declared first so it outlives anything that publishes to it
+	ListenerBus _listeners;
+
+    // WinRT helpers
+
+    /// Main class that is used to start advertisement
+    Microsoft::WRL::ComPtr<ABI::Windows::Devices::WiFiDirect::IWiFiDirectAdvertisementPublisher> _publisher;
+    /// Advertisement Settings within the publisher
+    Microsoft::WRL::ComPtr<ABI::Windows::Devices::WiFiDirect::IWiFiDirectAdvertisement> _advertisement;
+    /// Legacy settings within the advertisement settings
+    Microsoft::WRL::ComPtr<ABI::Windows::Devices::WiFiDirect::IWiFiDirectLegacySettings> _legacySettings;
+    /// Listen for incoming connections
+    Microsoft::WRL::ComPtr<ABI::Windows::Devices::WiFiDirect::IWiFiDirectConnectionListener> _connectionListener;
+
+	Microsoft::WRL::ComPtr <ABI::Windows::Devices::Enumeration::IDeviceWatcher> _deviceWatcher;
+
+	/// Statics and connection parameters shared by connect, pair and scan
+	ActivationCache _activationCache;
+	LatencyRecorder _latency;
+
+	/// Watcher events, peer disconnects and Disconnect/Unpair run here one at a time, in order,
+	/// so they cannot interleave on the same peer
+	EventLoop _events;
+	/// A message changed the peer table; only touched on _events
+	bool _peerEventsPending;
+
+	/// Discovered and connected peers, interned by device ID; guarded by _peerLock
+	PeerRegistry<PeerState> _peers;
+	/// Turns watcher events into versioned deltas over _peers
+	PeerDeltaTracker<PeerState> _peerTracker;
+	std::mutex _peerLock;
+	/// Snapshot entries of the non-idle peers, kept current one peer at a time; guarded by _peerLock
+	PeerSnapshot _peerTable;
+	/// _peerTable changed since it was last published
+	bool _peerTableChanged;
+	/// Copies of _peerTable published once per batch of changes, for readers that must not block
+	/// writers
+	SnapshotPublisher<PeerSnapshot> _peerSnapshot;
+
+	/// Held while a delta is taken and delivered so listeners see generations in order
+	std::mutex _peerDispatchLock;
+
+	/// Batching of watcher events, see SetPeerBatching
+	PTP_TIMER _peerBatchTimer;
+	std::atomic<bool> _peerBatchArmed;
+	std::atomic<DWORD> _peerBatchWindow;
+	std::atomic<size_t> _peerBatchSize;
+
+	/// Deadlines of every pending operation in ticks since _startTime; _deadlineTimer runs while
+	/// any are armed
+	TimerWheel<std::function<void()>> _deadlines;
+	OperationTimeouts _timeouts;
+	std::mutex _deadlineLock;
+	PTP_TIMER _deadlineTimer;
+	bool _deadlineTimerArmed;
+	/// Of the discovery pass in progress
+	std::atomic<uint64_t> _enumerationDeadline;
+
+	/// Callers waiting for an operation to end; pairings and unpairings by device ID, the others
+	/// under the empty key
+	CompletionRegistry<OperationResult> _startCompletions;
+	CompletionRegistry<OperationResult> _stopCompletions;
+	CompletionRegistry<ScanResult> _scanCompletions;
+	CompletionRegistry<PairResult> _pairCompletions;
+	CompletionRegistry<OperationResult> _unpairCompletions;
+
+	/// Peers waiting to be reconnected; _reconnectTimer runs while any are
+	ReconnectScheduler _reconnects;
+	std::mutex _reconnectLock;
+	PTP_TIMER _reconnectTimer;
+
+	/// Connection and pairing requests waiting for a decision; _decisionTimer runs while any are
+	DecisionQueue _decisions;
+	std::mutex _decisionTimerLock;
+	PTP_TIMER _decisionTimer;
+	bool _decisionTimerArmed;
+
+	/// Accepted connections are admitted through here; _admissionTimer runs while any are queued
+	AdmissionController<PendingConnection> _admission;
+	std::mutex _admissionLock;
+	PTP_TIMER _admissionTimer;
+	bool _admissionTimerArmed;
+
+	/// Pairings by device, each with its own session; runs a few at a time
+	PairingPipeline<PairingSession> _pairings;
+
+	/// Peers seen in this or earlier runs, also guarded by _peerLock
+	PeerCache _peerCache;
+
+	/// Trust decisions from this and earlier runs
+	TrustStore _trust;
+	std::mutex _trustLock;
+
+	/// Used to measure startup-to-first-connection latency with and without a warm cache
+	std::chrono::steady_clock::time_point _startTime;
+	std::atomic<bool> _firstConnectionReported;
+	uint32_t _cachedPeersAtStartup;
+
+    /// Used to un-register for events
+    EventRegistrationToken _connectionRequestedToken;
+    EventRegistrationToken _statusChangedToken;
+
+	EventRegistrationToken _DeviceUpdatedToken;
+	EventRegistrationToken _DeviceAddToken;
+	EventRegistrationToken _DeviceRemoveToken;
+	EventRegistrationToken _EnumerationStopToken;
+	EventRegistrationToken _EnumerationCompletedToken;
+
+    // Settings for "soft AP"
+
+    bool _ssidProvided;
+    std::wstring _ssid;
+    bool _passphraseProvided;
+    std::wstring _passphrase;
+
+    // Listeners that can be notified of changes to the "soft AP"
+
+    /// Subscription of the listener set with RegisterListener, 0 for none
+    uint64_t _registeredListener;
+
+    IWlanHostedNetworkPrompt* _prompt;
+
+	IWlanHostedNetworkDevicePairRequest* _PairRequest;
+
+    /// tracks whether we should accept incoming connections or ask the user
+    bool _autoAccept;
+
+	/// tracks whether the device watcher keeps running after enumeration completes; read on the
+	/// watcher's callback thread
+	std::atomic<bool> _continuousDiscovery;
+
+	/// OUI << 8 | vendor type of the vendor element to look for, 0 for none
+	std::atomic<uint32_t> _vendorElement;
 };
\ No newline at end of file